@@ -36,6 +36,55 @@
 #define HOBD_CAN_ID_RESPONSE (0x021)
 
 
+//
+#define HOBD_CAN_ID_RX_STATS_BASE (0x030)
+#define HOBD_CAN_ID_RX_STATS_OBD_GATEWAY (0x035)
+#define HOBD_CAN_ID_RX_STATS_IMU_GATEWAY (0x036)
+
+
+//
+#define HOBD_CAN_ID_PUBLISH_STATS_BASE (0x090)
+#define HOBD_CAN_ID_PUBLISH_STATS_OBD_GATEWAY (0x095)
+#define HOBD_CAN_ID_PUBLISH_STATS_IMU_GATEWAY (0x096)
+
+
+// ms
+#define HOBD_CAN_TX_INTERVAL_PUBLISH_STATS (1000)
+
+
+//
+#define HOBD_CAN_ID_PROFILE_BASE (0x0A0)
+#define HOBD_CAN_ID_PROFILE_OBD_GATEWAY (0x0A5)
+#define HOBD_CAN_ID_PROFILE_IMU_GATEWAY (0x0A6)
+
+
+//
+#define HOBD_CAN_ID_PROFILE_HIST_BASE (0x0B0)
+#define HOBD_CAN_ID_PROFILE_HIST_OBD_GATEWAY (0x0B5)
+#define HOBD_CAN_ID_PROFILE_HIST_IMU_GATEWAY (0x0B6)
+
+
+// ms
+#define HOBD_CAN_TX_INTERVAL_PROFILE (1000)
+
+
+//
+#define HOBD_CAN_ID_TRACE_BASE (0x0C0)
+#define HOBD_CAN_ID_TRACE_OBD_GATEWAY (0x0C5)
+#define HOBD_CAN_ID_TRACE_IMU_GATEWAY (0x0C6)
+
+
+//
+#define HOBD_CAN_ID_TIME_SYNC_BASE (0x0D0)
+#define HOBD_CAN_ID_TIME_SYNC_OBD_GATEWAY (0x0D5)
+#define HOBD_CAN_ID_TIME_SYNC_IMU_GATEWAY (0x0D6)
+
+
+// master sync/follow-up pair interval
+// ms
+#define HOBD_CAN_TX_INTERVAL_TIME_SYNC (1000)
+
+
 // GPS ID's
 #define HOBD_CAN_ID_GPS_TIME1 (0x040)
 #define HOBD_CAN_ID_GPS_TIME2 (0x041)
@@ -53,6 +102,7 @@
 #define HOBD_CAN_ID_GPS_HEADING2 (0x04D)
 #define HOBD_CAN_ID_GPS_DOP1 (0x04E)
 #define HOBD_CAN_ID_GPS_DOP2 (0x04F)
+#define HOBD_CAN_ID_GPS_TIME_US (0x050)
 
 
 // IMU ID's
@@ -73,6 +123,10 @@
 #define HOBD_CAN_ID_IMU_ACCEL2 (0x06E)
 #define HOBD_CAN_ID_IMU_MAGF1 (0x06F)
 #define HOBD_CAN_ID_IMU_MAGF2 (0x070)
+#define HOBD_CAN_ID_IMU_TIME_US (0x071)
+#define HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT (0x072)
+#define HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN (0x073)
+#define HOBD_CAN_ID_IMU_COMPACT_ACCEL (0x074)
 
 
 // OBD ID's
@@ -80,6 +134,7 @@
 #define HOBD_CAN_ID_OBD1 (0x081)
 #define HOBD_CAN_ID_OBD2 (0x082)
 #define HOBD_CAN_ID_OBD3 (0x083)
+#define HOBD_CAN_ID_OBD_TIME_US (0x084)
 
 
 //
@@ -97,6 +152,8 @@
 #define HOBD_HEARTBEAT_WARN_NO_GPS_FIX (1 << 10)
 #define HOBD_HEARTBEAT_WARN_NO_IMU_FIX (1 << 11)
 #define HOBD_HEARTBEAT_WARN_NO_OBD_ECU (1 << 12)
+#define HOBD_HEARTBEAT_WARN_NO_TIME_SYNC (1 << 13)
+#define HOBD_HEARTBEAT_WARN_IMU_CONFIG (1 << 14)
 
 
 //
@@ -112,6 +169,71 @@
 #define HOBD_HEARTBEAT_ERROR_IMU_STATUS (1 << 13)
 
 
+// command ID's, the command key is the target node ID
+#define HOBD_COMMAND_ID_INVALID (0x00)
+#define HOBD_COMMAND_ID_PUBLISH_MODE (0x01)
+#define HOBD_COMMAND_ID_PUBLISH_INTERVAL (0x02)
+#define HOBD_COMMAND_ID_TRACE (0x03)
+#define HOBD_COMMAND_ID_TIME_SYNC (0x04)
+#define HOBD_COMMAND_ID_TIME_FOLLOW_UP (0x05)
+#define HOBD_COMMAND_ID_IMU_OUTPUT_RATE (0x06)
+
+
+// command key addressing every node, broadcast commands are not answered
+#define HOBD_COMMAND_KEY_BROADCAST (0xFF)
+
+
+// response data_1
+#define HOBD_RESPONSE_STATUS_OK (0x00)
+#define HOBD_RESPONSE_STATUS_INVALID_COMMAND (0x01)
+#define HOBD_RESPONSE_STATUS_INVALID_DATA (0x02)
+#define HOBD_RESPONSE_STATUS_NO_RESOURCES (0x03)
+
+
+// never published
+#define HOBD_PUBLISH_MODE_DISABLED (0x00)
+// published every time the data is updated
+#define HOBD_PUBLISH_MODE_ALWAYS (0x01)
+// published when the frame, or its deadband signal, changes
+#define HOBD_PUBLISH_MODE_ON_CHANGE (0x02)
+
+
+// deadband signal types, NONE compares the whole frame
+#define HOBD_PUBLISH_DEADBAND_NONE (0x00)
+#define HOBD_PUBLISH_DEADBAND_U8 (0x01)
+#define HOBD_PUBLISH_DEADBAND_S8 (0x02)
+#define HOBD_PUBLISH_DEADBAND_U16 (0x03)
+#define HOBD_PUBLISH_DEADBAND_S16 (0x04)
+#define HOBD_PUBLISH_DEADBAND_S32 (0x05)
+
+
+// HOBD_COMMAND_ID_PUBLISH_MODE data_1 fields, data_0 is the CAN ID
+#define HOBD_PUBLISH_MODE_DATA(mode, deadband, type, offset) \
+    ((uint32_t) (mode) \
+    | ((uint32_t) (deadband) << 8) \
+    | ((uint32_t) (type) << 24) \
+    | ((uint32_t) (offset) << 28))
+#define HOBD_PUBLISH_MODE_DATA_MODE(data) ((uint8_t) ((data) & 0xFF))
+#define HOBD_PUBLISH_MODE_DATA_DEADBAND(data) ((uint16_t) (((data) >> 8) & 0xFFFF))
+#define HOBD_PUBLISH_MODE_DATA_TYPE(data) ((uint8_t) (((data) >> 24) & 0x0F))
+#define HOBD_PUBLISH_MODE_DATA_OFFSET(data) ((uint8_t) (((data) >> 28) & 0x0F))
+
+
+// HOBD_COMMAND_ID_PUBLISH_INTERVAL data_1 fields, data_0 is the CAN ID
+// intervals are in ms, a zero max interval never forces a publish
+#define HOBD_PUBLISH_INTERVAL_DATA(min, max) \
+    ((uint32_t) (min) | ((uint32_t) (max) << 16))
+#define HOBD_PUBLISH_INTERVAL_DATA_MIN(data) ((uint16_t) ((data) & 0xFFFF))
+#define HOBD_PUBLISH_INTERVAL_DATA_MAX(data) ((uint16_t) (((data) >> 16) & 0xFFFF))
+
+
+//
+#define HOBD_RX_BUFFER_ID_INVALID (0x00)
+#define HOBD_RX_BUFFER_ID_OBD (0x01)
+#define HOBD_RX_BUFFER_ID_IMU (0x02)
+#define HOBD_RX_BUFFER_ID_GPS (0x03)
+
+
 //
 #define HOBD_GPS_FIX_MODE_SPP (0)
 #define HOBD_GPS_FIX_MODE_RTK_FLOAT (1)
@@ -123,6 +245,102 @@
 #define HOBD_GPS_HEIGHT_MODE_MEANSEA (1)
 
 
+// main loop stages timed by the profiler, each node reports the ones it runs
+#define HOBD_PROFILE_STAGE_MAIN_LOOP (0x00)
+#define HOBD_PROFILE_STAGE_DIAGNOSTICS (0x01)
+#define HOBD_PROFILE_STAGE_COMMAND (0x02)
+#define HOBD_PROFILE_STAGE_PUBLISH_STATS (0x03)
+#define HOBD_PROFILE_STAGE_OBD_PROCESS_BUFFER (0x04)
+#define HOBD_PROFILE_STAGE_OBD_PARSE (0x05)
+#define HOBD_PROFILE_STAGE_OBD_PUBLISH (0x06)
+#define HOBD_PROFILE_STAGE_GPS_PROCESS_BUFFER (0x07)
+#define HOBD_PROFILE_STAGE_GPS_PARSE (0x08)
+#define HOBD_PROFILE_STAGE_GPS_PUBLISH (0x09)
+#define HOBD_PROFILE_STAGE_IMU_PROCESS_BUFFER (0x0A)
+#define HOBD_PROFILE_STAGE_IMU_PARSE (0x0B)
+#define HOBD_PROFILE_STAGE_IMU_PUBLISH (0x0C)
+#define HOBD_PROFILE_STAGE_COUNT (0x0D)
+
+
+// profiler timer resolution, CPU cycles per tick and tick length
+// at the 16 MHz gateway clock
+#define HOBD_PROFILE_CYCLES_PER_TICK (8)
+#define HOBD_PROFILE_TICK_NS (500)
+
+
+// histogram bin N counts samples below 4^(N+1) ticks, the last bin
+// counts everything above
+#define HOBD_PROFILE_HIST_BIN_COUNT (7)
+#define HOBD_PROFILE_HIST_BIN_SHIFT (2)
+
+
+// HOBD_COMMAND_ID_TRACE data_1, data_0 is unused
+#define HOBD_TRACE_DISABLED (0x00)
+#define HOBD_TRACE_ENABLED (0x01)
+
+
+// traced publish groups, each node reports the ones it runs
+#define HOBD_TRACE_GROUP_OBD_TABLE_16 (0x00)
+#define HOBD_TRACE_GROUP_OBD_TABLE_209 (0x01)
+#define HOBD_TRACE_GROUP_GPS (0x02)
+#define HOBD_TRACE_GROUP_IMU (0x03)
+#define HOBD_TRACE_GROUP_COUNT (0x04)
+
+
+// trace latencies at or above this are saturated
+// microseconds
+#define HOBD_TRACE_LATENCY_MAX (0xFFFF)
+
+
+// HOBD_COMMAND_ID_IMU_OUTPUT_RATE, IMU gateway only
+// data_0 is an Xsens data identifier the gateway parses, data_1 is its
+// output rate in Hz, the Xsens is reconfigured after each accepted command
+#define HOBD_IMU_OUTPUT_RATE_OFF (0x0000)
+// included in every Xsens data message
+#define HOBD_IMU_OUTPUT_RATE_ALL (0xFFFF)
+
+
+// IMU gateway orientation, rate of turn and acceleration frame encodings
+//
+// full: float fields, two frames per quantity
+// compact: scaled 16 bit fixed point fields, one frame per quantity
+#define HOBD_IMU_ENCODING_FULL (0x00)
+#define HOBD_IMU_ENCODING_COMPACT (0x01)
+
+
+// compact encoding schema version, a schema change increments it
+// every compact frame identifies its version on its own: the rate of turn
+// and acceleration frames carry it in their first byte, the orientation
+// frame has no spare byte so its CAN ID is per version, a new orientation
+// layout takes a new ID
+#define HOBD_IMU_COMPACT_VERSION (0x01)
+
+
+// compact encoding fixed point scales, value = field / scale
+// counts per unit
+#define HOBD_IMU_COMPACT_QUAT_SCALE (16384.0f)
+#define HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE (1000.0f)
+#define HOBD_IMU_COMPACT_ACCEL_SCALE (100.0f)
+
+
+// HOBD_COMMAND_ID_TIME_SYNC, broadcast by the time master
+// data_0 is the sync sequence number, data_1 is unused
+// nodes take their local time when the frame is received
+//
+// HOBD_COMMAND_ID_TIME_FOLLOW_UP, broadcast after each sync
+// data_0 is the sequence number of the sync it follows up
+// data_1 is the master time the sync was transmitted, microseconds
+#define HOBD_TIME_SYNC_STATE_NONE (0x00)
+#define HOBD_TIME_SYNC_STATE_LOCKING (0x01)
+#define HOBD_TIME_SYNC_STATE_LOCKED (0x02)
+#define HOBD_TIME_SYNC_STATE_HOLDOVER (0x03)
+
+
+// sync errors at or beyond this are saturated
+// microseconds
+#define HOBD_TIME_SYNC_ERROR_MAX (INT16_MAX)
+
+
 
 
 //
@@ -152,42 +370,231 @@ typedef struct
 } hobd_heartbeat_s;
 
 
-//
+/**
+ * @brief Command message.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_COMMAND
+ * Transmit rate: on demand
+ *
+ */
 typedef struct
 {
     //
     //
-    uint8_t id;
+    uint8_t id; /*!< Command ID. See \ref HOBD_COMMAND_ID_PUBLISH_MODE. */
     //
     //
-    uint8_t key;
+    uint8_t key; /*!< Node ID the command is for. */
     //
     //
-    uint16_t data_0;
+    uint16_t data_0; /*!< Command specific. */
     //
     //
-    uint32_t data_1;
+    uint32_t data_1; /*!< Command specific. */
 } hobd_command_s;
 
 
-//
+/**
+ * @brief Command response message.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_RESPONSE
+ * Transmit rate: once per command
+ *
+ */
 typedef struct
 {
     //
     //
-    uint8_t cmd_id;
+    uint8_t cmd_id; /*!< Command ID being answered. */
     //
     //
-    uint8_t key;
+    uint8_t key; /*!< Node ID that handled the command. */
     //
     //
-    uint16_t data_0;
+    uint16_t data_0; /*!< Command data_0 echoed back. */
     //
     //
-    uint32_t data_1;
+    uint32_t data_1; /*!< Response status. See \ref HOBD_RESPONSE_STATUS_OK. */
 } hobd_response_s;
 
 
+/**
+ * @brief Rx buffer statistics message.
+ *
+ * One frame per UART rx buffer on the node, sent along with each heartbeat.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_RX_STATS_BASE + node ID
+ * Transmit rate: \ref HOBD_CAN_TX_INTERVAL_HEARTBEAT ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t rx_buffer_id; /*!< Rx buffer this frame describes. See \ref HOBD_RX_BUFFER_ID_OBD. */
+    //
+    //
+    uint8_t high_water_percent; /*!< High-water mark as a percentage of the buffer capacity. [percent] */
+    //
+    //
+    uint16_t high_water; /*!< Most bytes held in the rx buffer since boot. [bytes] */
+    //
+    //
+    uint16_t overflow_count; /*!< Bytes dropped because the rx buffer was full. */
+    //
+    //
+    uint16_t error_count; /*!< UART framing/overrun and protocol errors. */
+} hobd_rx_stats_s;
+
+
+/**
+ * @brief CAN publish policy statistics message.
+ *
+ * Counts are for the last transmit interval. Bus load is relative to the
+ * CAN bit rate, using the nominal frame size without stuffing bits.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_PUBLISH_STATS_BASE + node ID
+ * Transmit rate: \ref HOBD_CAN_TX_INTERVAL_PUBLISH_STATS ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint16_t sent_count; /*!< Frames published. */
+    //
+    //
+    uint16_t suppressed_count; /*!< Frames held back by their publish policy. */
+    //
+    //
+    uint16_t sent_load; /*!< Bus load of the published frames. [0.01 percent] */
+    //
+    //
+    uint16_t saved_load; /*!< Bus load saved by the suppressed frames. [0.01 percent] */
+} hobd_publish_stats_s;
+
+
+/**
+ * @brief Main loop stage timing message.
+ *
+ * One frame per stage that ran during the last transmit interval.
+ * Times are in profiler ticks, see \ref HOBD_PROFILE_CYCLES_PER_TICK.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_PROFILE_BASE + node ID
+ * Transmit rate: \ref HOBD_CAN_TX_INTERVAL_PROFILE ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t stage; /*!< Stage this frame describes. See \ref HOBD_PROFILE_STAGE_MAIN_LOOP. */
+    //
+    //
+    uint8_t load; /*!< Time spent in the stage over the interval. [percent] */
+    //
+    //
+    uint16_t min; /*!< Shortest run of the stage. [ticks] */
+    //
+    //
+    uint16_t max; /*!< Longest run of the stage. [ticks] */
+    //
+    //
+    uint16_t mean; /*!< Mean run of the stage. [ticks] */
+} hobd_profile_s;
+
+
+/**
+ * @brief Main loop stage timing histogram message.
+ *
+ * Sent after the \ref hobd_profile_s frame of the same stage. Bins hold
+ * the share of the interval's samples, so the bins of a frame add up
+ * to about 255.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_PROFILE_HIST_BASE + node ID
+ * Transmit rate: \ref HOBD_CAN_TX_INTERVAL_PROFILE ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t stage; /*!< Stage this frame describes. See \ref HOBD_PROFILE_STAGE_MAIN_LOOP. */
+    //
+    //
+    uint8_t bins[ HOBD_PROFILE_HIST_BIN_COUNT ]; /*!< Share of samples per bin, see \ref HOBD_PROFILE_HIST_BIN_SHIFT. [1/255] */
+} hobd_profile_hist_s;
+
+
+/**
+ * @brief Publish group latency trace message.
+ *
+ * Sent once every CAN frame of a traced publish is transmitted, only
+ * while tracing is enabled by \ref HOBD_COMMAND_ID_TRACE. The rx time is
+ * the first byte of an OBD packet, or the start of the rx buffer pass
+ * that completed the GPS/IMU message. The sequence number increments for
+ * each traced publish of the group, gaps are traces that never completed.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_TRACE_BASE + node ID
+ * Transmit rate: once per traced publish
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t group; /*!< Publish group this frame describes. See \ref HOBD_TRACE_GROUP_OBD_TABLE_16. */
+    //
+    //
+    uint8_t sequence; /*!< Traced publish counter of the group. */
+    //
+    //
+    uint16_t parse_latency; /*!< UART rx to parse complete. [microseconds] */
+    //
+    //
+    uint16_t queue_latency; /*!< Parse complete to the first frame queued. [microseconds] */
+    //
+    //
+    uint16_t tx_latency; /*!< First frame queued to the last frame transmitted. [microseconds] */
+} hobd_trace_s;
+
+
+/**
+ * @brief Time synchronization status message.
+ *
+ * Sent along with each heartbeat. The error is how far the node's
+ * prediction of the master time was off when the last follow-up arrived,
+ * times converted to the master time base are about that accurate.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_TIME_SYNC_BASE + node ID
+ * Transmit rate: \ref HOBD_CAN_TX_INTERVAL_HEARTBEAT ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t state; /*!< Synchronization state. See \ref HOBD_TIME_SYNC_STATE_NONE. */
+    //
+    //
+    uint8_t sequence; /*!< Low byte of the last follow-up sequence number. */
+    //
+    //
+    int16_t error; /*!< Master time minus the predicted master time at the last follow-up, saturated at \ref HOBD_TIME_SYNC_ERROR_MAX. [microseconds] */
+    //
+    //
+    int32_t drift; /*!< Master clock rate minus the node clock rate. [parts per billion] */
+} hobd_time_sync_s;
+
+
 /**
  * @brief GPS time 1 message.
  *
@@ -229,6 +636,30 @@ typedef struct
 } hobd_gps_time2_s;
 
 
+/**
+ * @brief GPS microsecond time message.
+ *
+ * Sent with \ref hobd_gps_time1_s, both times are of the same GPS rx
+ * event. The sync time is in the master time base of
+ * \ref HOBD_COMMAND_ID_TIME_SYNC, comparable across nodes, and equals the
+ * rx time until the node first syncs. Both wrap every 71.6 minutes.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_GPS_TIME_US
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint32_t rx_time_us; /*!< Local rx microsecond timestamp when the GPS data was received. [microseconds] */
+    //
+    //
+    uint32_t sync_time_us; /*!< rx_time_us in the master time base. See \ref hobd_time_sync_s. [microseconds] */
+} hobd_gps_time_us_s;
+
+
 /**
  * @brief GPS dilution of precision 1 message.
  *
@@ -718,6 +1149,30 @@ typedef struct
 } hobd_imu_sample_time_s;
 
 
+/**
+ * @brief IMU microsecond time message.
+ *
+ * Sent with \ref hobd_imu_sample_time_s, both times are of the same IMU rx
+ * event. The sync time is in the master time base of
+ * \ref HOBD_COMMAND_ID_TIME_SYNC, comparable across nodes, and equals the
+ * rx time until the node first syncs. Both wrap every 71.6 minutes.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_IMU_TIME_US
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint32_t rx_time_us; /*!< Local rx microsecond timestamp when the IMU data was received. [microseconds] */
+    //
+    //
+    uint32_t sync_time_us; /*!< rx_time_us in the master time base. See \ref hobd_time_sync_s. [microseconds] */
+} hobd_imu_time_us_s;
+
+
 /**
  * @brief IMU time 1 message.
  *
@@ -1031,6 +1486,93 @@ typedef struct
 } hobd_imu_magf2_s;
 
 
+/**
+ * @brief IMU compact orientation quaternion message.
+ *
+ * Sent instead of \ref hobd_imu_orient_quat1_s and
+ * \ref hobd_imu_orient_quat2_s with \ref HOBD_IMU_ENCODING_COMPACT.
+ * Version 1 layout, the version is given by the CAN ID, see
+ * \ref HOBD_IMU_COMPACT_VERSION.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    int16_t q1; /*!< Quaternion q1. [1/HOBD_IMU_COMPACT_QUAT_SCALE] */
+    //
+    //
+    int16_t q2; /*!< Quaternion q2. [1/HOBD_IMU_COMPACT_QUAT_SCALE] */
+    //
+    //
+    int16_t q3; /*!< Quaternion q3. [1/HOBD_IMU_COMPACT_QUAT_SCALE] */
+    //
+    //
+    int16_t q4; /*!< Quaternion q4. [1/HOBD_IMU_COMPACT_QUAT_SCALE] */
+} hobd_imu_compact_orient_quat_s;
+
+
+/**
+ * @brief IMU compact rate of turn message.
+ *
+ * Sent instead of \ref hobd_imu_rate_of_turn1_s and
+ * \ref hobd_imu_rate_of_turn2_s with \ref HOBD_IMU_ENCODING_COMPACT.
+ * Fields saturate at the int16_t limits.
+ *
+ * Message size (CAN frame DLC): 7 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t version; /*!< Schema version. \ref HOBD_IMU_COMPACT_VERSION */
+    //
+    //
+    int16_t x; /*!< Rate of turn X. [radians/second / HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE] */
+    //
+    //
+    int16_t y; /*!< Rate of turn Y. [radians/second / HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE] */
+    //
+    //
+    int16_t z; /*!< Rate of turn Z. [radians/second / HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE] */
+} hobd_imu_compact_rate_of_turn_s;
+
+
+/**
+ * @brief IMU compact acceleration message.
+ *
+ * Sent instead of \ref hobd_imu_accel1_s and \ref hobd_imu_accel2_s with
+ * \ref HOBD_IMU_ENCODING_COMPACT. Fields saturate at the int16_t limits.
+ *
+ * Message size (CAN frame DLC): 7 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_IMU_COMPACT_ACCEL
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint8_t version; /*!< Schema version. \ref HOBD_IMU_COMPACT_VERSION */
+    //
+    //
+    int16_t x; /*!< Free acceleration X. [meters/second^2 / HOBD_IMU_COMPACT_ACCEL_SCALE] */
+    //
+    //
+    int16_t y; /*!< Free acceleration Y. [meters/second^2 / HOBD_IMU_COMPACT_ACCEL_SCALE] */
+    //
+    //
+    int16_t z; /*!< Free acceleration Z. [meters/second^2 / HOBD_IMU_COMPACT_ACCEL_SCALE] */
+} hobd_imu_compact_accel_s;
+
+
 /**
  * @brief On-board diagnostics time message.
  *
@@ -1053,6 +1595,30 @@ typedef struct
 } hobd_obd_time_s;
 
 
+/**
+ * @brief OBD microsecond time message.
+ *
+ * Sent with \ref hobd_obd_time_s, both times are of the same OBD rx
+ * event. The sync time is in the master time base of
+ * \ref HOBD_COMMAND_ID_TIME_SYNC, comparable across nodes, and equals the
+ * rx time until the node first syncs. Both wrap every 71.6 minutes.
+ *
+ * Message size (CAN frame DLC): 8 bytes
+ * CAN frame ID: \ref HOBD_CAN_ID_OBD_TIME_US
+ * Transmit rate: TODO ms
+ *
+ */
+typedef struct
+{
+    //
+    //
+    uint32_t rx_time_us; /*!< Local rx microsecond timestamp when the OBD data was received. [microseconds] */
+    //
+    //
+    uint32_t sync_time_us; /*!< rx_time_us in the master time base. See \ref hobd_time_sync_s. [microseconds] */
+} hobd_obd_time_us_s;
+
+
 /**
  * @brief On-board diagnostics 1 message.
  *
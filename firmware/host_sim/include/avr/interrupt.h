@@ -0,0 +1,40 @@
+/**
+ * @file interrupt.h
+ * @brief Host stand-in for <avr/interrupt.h>.
+ *
+ * The global interrupt flag lives in SREG like on the target, the
+ * simulated peripherals only call vectors while it is set.
+ *
+ */
+
+
+
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+
+
+
+#include <avr/io.h>
+
+
+
+
+//
+#define ISR(vector, ...) \
+    void vector( void ); \
+    void vector( void )
+
+
+//
+#define sei() (SREG |= _BV(SREG_I))
+
+
+//
+#define cli() (SREG &= (uint8_t) ~_BV(SREG_I))
+
+
+
+
+#endif /* SIM_AVR_INTERRUPT_H */
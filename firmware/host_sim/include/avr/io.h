@@ -0,0 +1,283 @@
+/**
+ * @file io.h
+ * @brief Host stand-in for <avr/io.h>, AT90CAN128 only.
+ *
+ * Registers are plain host variables, see sim_registers.h. Interrupt
+ * vectors are named functions that the simulated peripherals call.
+ *
+ */
+
+
+
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+
+
+
+#include <inttypes.h>
+
+
+
+
+#ifndef __AVR_AT90CAN128__
+#define __AVR_AT90CAN128__ 1
+#endif
+
+
+//
+#define _BV(bit) (1 << (bit))
+
+
+//
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+
+
+//
+#define SIM_REG8(name) extern volatile uint8_t name;
+#define SIM_REG16(name) extern volatile uint16_t name;
+#include "sim_registers.h"
+#undef SIM_REG8
+#undef SIM_REG16
+
+
+// SREG
+#define SREG_I (7)
+
+
+// WDTCR
+#define WDCE (4)
+#define WDE (3)
+
+
+// UCSRnA
+#define RXC0 (7)
+#define TXC0 (6)
+#define UDRE0 (5)
+#define FE0 (4)
+#define DOR0 (3)
+#define UPE0 (2)
+#define U2X0 (1)
+#define MPCM0 (0)
+#define RXC1 (7)
+#define TXC1 (6)
+#define UDRE1 (5)
+#define FE1 (4)
+#define DOR1 (3)
+#define UPE1 (2)
+#define U2X1 (1)
+#define MPCM1 (0)
+
+
+// UCSRnB
+#define RXCIE0 (7)
+#define TXCIE0 (6)
+#define UDRIE0 (5)
+#define RXEN0 (4)
+#define TXEN0 (3)
+#define UCSZ02 (2)
+#define RXB80 (1)
+#define TXB80 (0)
+#define RXCIE1 (7)
+#define TXCIE1 (6)
+#define UDRIE1 (5)
+#define RXEN1 (4)
+#define TXEN1 (3)
+#define UCSZ12 (2)
+#define RXB81 (1)
+#define TXB81 (0)
+
+
+// UCSRnC
+#define UMSEL0 (6)
+#define UPM01 (5)
+#define UPM00 (4)
+#define USBS0 (3)
+#define UCSZ01 (2)
+#define UCSZ00 (1)
+#define UCPOL0 (0)
+#define UMSEL1 (6)
+#define UPM11 (5)
+#define UPM10 (4)
+#define USBS1 (3)
+#define UCSZ11 (2)
+#define UCSZ10 (1)
+#define UCPOL1 (0)
+
+
+// 16-bit register halves, the host is little endian
+#define TCNT1L (((volatile uint8_t *) &TCNT1)[ 0 ])
+#define TCNT1H (((volatile uint8_t *) &TCNT1)[ 1 ])
+#define TCNT3L (((volatile uint8_t *) &TCNT3)[ 0 ])
+#define TCNT3H (((volatile uint8_t *) &TCNT3)[ 1 ])
+#define ICR1L (((volatile uint8_t *) &ICR1)[ 0 ])
+#define ICR1H (((volatile uint8_t *) &ICR1)[ 1 ])
+#define ICR3L (((volatile uint8_t *) &ICR3)[ 0 ])
+#define ICR3H (((volatile uint8_t *) &ICR3)[ 1 ])
+
+
+// TCCR1A/TCCR3A
+#define WGM11 (1)
+#define WGM10 (0)
+#define WGM31 (1)
+#define WGM30 (0)
+
+
+// TCCR1B/TCCR3B
+#define ICNC1 (7)
+#define ICES1 (6)
+#define WGM13 (4)
+#define WGM12 (3)
+#define CS12 (2)
+#define CS11 (1)
+#define CS10 (0)
+#define ICNC3 (7)
+#define ICES3 (6)
+#define WGM33 (4)
+#define WGM32 (3)
+#define CS32 (2)
+#define CS31 (1)
+#define CS30 (0)
+
+
+// TIMSKn/TIFRn
+#define ICIE1 (5)
+#define OCIE1C (3)
+#define OCIE1B (2)
+#define OCIE1A (1)
+#define TOIE1 (0)
+#define ICF1 (5)
+#define OCF1C (3)
+#define OCF1B (2)
+#define OCF1A (1)
+#define TOV1 (0)
+#define ICIE3 (5)
+#define OCIE3C (3)
+#define OCIE3B (2)
+#define OCIE3A (1)
+#define TOIE3 (0)
+#define ICF3 (5)
+#define OCF3C (3)
+#define OCF3B (2)
+#define OCF3A (1)
+#define TOV3 (0)
+#define OCIE2A (1)
+#define TOIE2 (0)
+#define OCF2A (1)
+#define TOV2 (0)
+
+
+// CANGCON
+#define ABRQ (7)
+#define OVRQ (6)
+#define TTC (5)
+#define SYNTTC (4)
+#define LISTEN (3)
+#define TEST (2)
+#define ENASTB (1)
+#define SWRES (0)
+
+
+// CANGSTA
+#define OVRG (6)
+#define TXBSY (4)
+#define RXBSY (3)
+#define ENFG (2)
+#define BOFF (1)
+#define ERRP (0)
+
+
+// CANGIT
+#define CANIT (7)
+#define BOFFIT (6)
+#define OVRTIM (5)
+#define BXOK (4)
+#define SERG (3)
+#define CERG (2)
+#define FERG (1)
+#define AERG (0)
+
+
+// CANGIE
+#define ENIT (7)
+#define ENBOFF (6)
+#define ENRX (5)
+#define ENTX (4)
+#define ENERR (3)
+#define ENBX (2)
+#define ENERG (1)
+#define ENOVRT (0)
+
+
+// CANHPMOB/CANPAGE
+#define HPMOB3 (7)
+#define HPMOB2 (6)
+#define HPMOB1 (5)
+#define HPMOB0 (4)
+#define MOBNB3 (7)
+#define MOBNB2 (6)
+#define MOBNB1 (5)
+#define MOBNB0 (4)
+#define AINC (3)
+#define INDX2 (2)
+#define INDX1 (1)
+#define INDX0 (0)
+
+
+// CANSTMOB
+#define DLCW (7)
+#define TXOK (6)
+#define RXOK (5)
+#define BERR (4)
+#define SERR (3)
+#define CERR (2)
+#define FERR (1)
+#define AERR (0)
+
+
+// CANCDMOB
+#define CONMOB1 (7)
+#define CONMOB0 (6)
+#define RPLV (5)
+#define IDE (4)
+#define DLC3 (3)
+#define DLC2 (2)
+#define DLC1 (1)
+#define DLC0 (0)
+
+
+// CANIDT4/CANIDM4
+#define RTRTAG (2)
+#define RB1TAG (1)
+#define RB0TAG (0)
+#define RTRMSK (2)
+#define IDEMSK (0)
+
+
+// interrupt vectors, called by the simulated peripherals
+#define USART0_RX_vect sim_vector_usart0_rx
+#define USART0_UDRE_vect sim_vector_usart0_udre
+#define USART1_RX_vect sim_vector_usart1_rx
+#define USART1_UDRE_vect sim_vector_usart1_udre
+#define CANIT_vect sim_vector_canit
+#define TIMER1_OVF_vect sim_vector_timer1_ovf
+#define TIMER3_OVF_vect sim_vector_timer3_ovf
+#define TIMER2_COMP_vect sim_vector_timer2_comp
+
+
+//
+void USART0_RX_vect( void );
+void USART0_UDRE_vect( void );
+void USART1_RX_vect( void );
+void USART1_UDRE_vect( void );
+void CANIT_vect( void );
+void TIMER1_OVF_vect( void );
+void TIMER3_OVF_vect( void );
+void TIMER2_COMP_vect( void );
+
+
+
+
+#endif /* SIM_AVR_IO_H */
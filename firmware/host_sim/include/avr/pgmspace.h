@@ -0,0 +1,37 @@
+/**
+ * @file pgmspace.h
+ * @brief Host stand-in for <avr/pgmspace.h>, flash is ordinary memory.
+ *
+ */
+
+
+
+
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+
+
+
+#include <inttypes.h>
+
+
+
+
+//
+#define PROGMEM
+
+
+//
+#define PSTR(s) (s)
+
+
+//
+#define pgm_read_byte(addr) (*((const uint8_t*) (addr)))
+#define pgm_read_word(addr) (*((const uint16_t*) (addr)))
+#define pgm_read_dword(addr) (*((const uint32_t*) (addr)))
+
+
+
+
+#endif /* SIM_AVR_PGMSPACE_H */
@@ -0,0 +1,121 @@
+/**
+ * @file sim_registers.h
+ * @brief AT90CAN128 I/O registers backed by host memory.
+ *
+ * X-macro list, define SIM_REG8/SIM_REG16 before including.
+ * Only the registers used by the gateways and the BSP headers are listed.
+ *
+ */
+
+
+
+
+// status register
+SIM_REG8( SREG )
+
+
+// watchdog
+SIM_REG8( WDTCR )
+
+
+// ports
+SIM_REG8( PINC )
+SIM_REG8( DDRC )
+SIM_REG8( PORTC )
+SIM_REG8( PIND )
+SIM_REG8( DDRD )
+SIM_REG8( PORTD )
+SIM_REG8( PINE )
+SIM_REG8( DDRE )
+SIM_REG8( PORTE )
+
+
+// USART0
+SIM_REG8( UCSR0A )
+SIM_REG8( UCSR0B )
+SIM_REG8( UCSR0C )
+SIM_REG8( UBRR0H )
+SIM_REG8( UBRR0L )
+SIM_REG8( UDR0 )
+
+
+// USART1
+SIM_REG8( UCSR1A )
+SIM_REG8( UCSR1B )
+SIM_REG8( UCSR1C )
+SIM_REG8( UBRR1H )
+SIM_REG8( UBRR1L )
+SIM_REG8( UDR1 )
+
+
+// timer/counter 0 and 2
+SIM_REG8( TCCR0A )
+SIM_REG8( TCNT0 )
+SIM_REG8( OCR0A )
+SIM_REG8( TIMSK0 )
+SIM_REG8( TIFR0 )
+SIM_REG8( TCCR2A )
+SIM_REG8( TCNT2 )
+SIM_REG8( OCR2A )
+SIM_REG8( TIMSK2 )
+SIM_REG8( TIFR2 )
+SIM_REG8( ASSR )
+
+
+// timer/counter 1 and 3
+SIM_REG8( TCCR1A )
+SIM_REG8( TCCR1B )
+SIM_REG8( TCCR1C )
+SIM_REG16( TCNT1 )
+SIM_REG16( OCR1A )
+SIM_REG16( OCR1B )
+SIM_REG16( OCR1C )
+SIM_REG16( ICR1 )
+SIM_REG8( TIMSK1 )
+SIM_REG8( TIFR1 )
+SIM_REG8( TCCR3A )
+SIM_REG8( TCCR3B )
+SIM_REG8( TCCR3C )
+SIM_REG16( TCNT3 )
+SIM_REG16( OCR3A )
+SIM_REG16( OCR3B )
+SIM_REG16( OCR3C )
+SIM_REG16( ICR3 )
+SIM_REG8( TIMSK3 )
+SIM_REG8( TIFR3 )
+
+
+// CAN controller
+SIM_REG8( CANGCON )
+SIM_REG8( CANGSTA )
+SIM_REG8( CANGIT )
+SIM_REG8( CANGIE )
+SIM_REG8( CANEN1 )
+SIM_REG8( CANEN2 )
+SIM_REG8( CANIE1 )
+SIM_REG8( CANIE2 )
+SIM_REG8( CANSIT1 )
+SIM_REG8( CANSIT2 )
+SIM_REG8( CANBT1 )
+SIM_REG8( CANBT2 )
+SIM_REG8( CANBT3 )
+SIM_REG8( CANTCON )
+SIM_REG16( CANTIM )
+SIM_REG16( CANTTC )
+SIM_REG8( CANTEC )
+SIM_REG8( CANREC )
+SIM_REG8( CANHPMOB )
+SIM_REG8( CANPAGE )
+SIM_REG8( CANSTMOB )
+SIM_REG8( CANCDMOB )
+SIM_REG8( CANIDT1 )
+SIM_REG8( CANIDT2 )
+SIM_REG8( CANIDT3 )
+SIM_REG8( CANIDT4 )
+SIM_REG8( CANIDM1 )
+SIM_REG8( CANIDM2 )
+SIM_REG8( CANIDM3 )
+SIM_REG8( CANIDM4 )
+SIM_REG8( CANSTML )
+SIM_REG8( CANSTMH )
+SIM_REG8( CANMSG )
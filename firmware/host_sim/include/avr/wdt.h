@@ -0,0 +1,49 @@
+/**
+ * @file wdt.h
+ * @brief Host stand-in for <avr/wdt.h>.
+ *
+ * The gateway main loops kick the watchdog once per pass, the simulation
+ * advances the clock and services the peripherals there.
+ *
+ */
+
+
+
+
+#ifndef SIM_AVR_WDT_H
+#define SIM_AVR_WDT_H
+
+
+
+
+#include "sim.h"
+
+
+
+
+//
+#define WDTO_15MS (0)
+#define WDTO_30MS (1)
+#define WDTO_60MS (2)
+#define WDTO_120MS (3)
+#define WDTO_250MS (4)
+#define WDTO_500MS (5)
+#define WDTO_1S (6)
+#define WDTO_2S (7)
+
+
+//
+#define wdt_enable(timeout) ((void) (timeout))
+
+
+//
+#define wdt_disable()
+
+
+//
+#define wdt_reset() sim_poll()
+
+
+
+
+#endif /* SIM_AVR_WDT_H */
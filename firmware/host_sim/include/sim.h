@@ -0,0 +1,134 @@
+/**
+ * @file sim.h
+ * @brief Host simulation of the AT90CAN128 gateway boards.
+ *
+ * The gateway sources are built unchanged against the host stand-ins in
+ * include/avr and a simulated BSP. Time is virtual: every main loop pass
+ * advances the clock by a fixed step, UART bytes arrive from files at
+ * the configured baud rate and transmitted CAN frames are logged.
+ *
+ * Configured through the environment:
+ *   - HOBD_SIM_UART0, HOBD_SIM_UART1 - files replayed into the UART's
+ *   - HOBD_SIM_UART0_TX, HOBD_SIM_UART1_TX - bytes the UART's transmit
+ *   - HOBD_SIM_CAN_LOG - transmitted and received frames, candump log format
+ *   - HOBD_SIM_STEP_US - virtual time per main loop pass, default 1000
+ *   - HOBD_SIM_DURATION_MS - stop after this much virtual time
+ *   - HOBD_SIM_TIME_SYNC_PPM - runs a time master on the bus whose clock
+ *     is fast by this many ppm, negative for slow
+ *
+ * Without a duration the run ends shortly after the last UART input byte.
+ *
+ */
+
+
+
+
+#ifndef SIM_H
+#define SIM_H
+
+
+
+
+#include <inttypes.h>
+
+
+
+
+// number of simulated UART's
+#define SIM_UART_COUNT (2)
+
+
+// virtual time per main loop pass
+// microseconds
+#define SIM_STEP_US_DEFAULT (1000UL)
+
+
+// virtual time the run continues after the UART inputs are drained
+// microseconds
+#define SIM_DRAIN_US (250000UL)
+
+
+// run length when there is no UART input
+// ms
+#define SIM_DURATION_MS_DEFAULT (10000UL)
+
+
+//
+#define SIM_UART_NO_DATA (-1)
+
+
+// frames waiting to be received
+#define SIM_CAN_RX_QUEUE_SIZE (4)
+
+
+// time master clock at virtual time zero
+// microseconds
+#define SIM_TIME_SYNC_MASTER_OFFSET_US (0x40000000UL)
+
+
+
+
+// one main loop pass, called from wdt_reset
+void sim_poll( void );
+
+
+// advances the virtual clock, servicing the peripherals
+void sim_run(
+        const uint32_t interval_us );
+
+
+//
+uint64_t sim_get_time_us( void );
+
+
+// next byte of the UART's input file or SIM_UART_NO_DATA
+int16_t sim_uart_read(
+        const uint8_t uart );
+
+
+// byte transmitted by the UART
+void sim_uart_write(
+        const uint8_t uart,
+        const uint8_t data );
+
+
+// frame transmitted on the CAN bus
+void sim_can_write(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+// next frame on the CAN bus for the node
+// returns non-zero if there is none
+uint8_t sim_can_read(
+        uint16_t * const id,
+        uint8_t * const dlc,
+        uint8_t * const data );
+
+
+
+
+// simulated BSP peripherals, interrupts are enabled when called
+void sim_rtc_service(
+        const uint32_t interval_us );
+
+
+//
+void sim_uart_service(
+        const uint32_t interval_us );
+
+
+//
+void sim_can_service(
+        const uint32_t interval_us );
+
+
+// timers run with interrupts disabled too
+void sim_timer16_service(
+        const uint32_t interval_us );
+
+
+
+
+#endif /* SIM_H */
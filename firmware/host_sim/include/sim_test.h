@@ -0,0 +1,49 @@
+/**
+ * @file sim_test.h
+ * @brief Checks for the host unit tests.
+ *
+ * The tests build gateway sources unchanged like the simulation, without
+ * sim.c, so this side also provides the target registers. A failed check
+ * is printed with its location and the test carries on, sim_test_result
+ * gives the exit status.
+ *
+ */
+
+
+
+
+#ifndef SIM_TEST_H
+#define SIM_TEST_H
+
+
+
+
+#include <inttypes.h>
+
+
+
+
+//
+#define SIM_TEST_CHECK(cond) \
+    sim_test_check( ((cond) ? 1 : 0), #cond, __FILE__, __LINE__ )
+
+
+
+
+//
+void sim_test_check(
+        const uint8_t ok,
+        const char * const expr,
+        const char * const file,
+        const int line );
+
+
+// prints the check counts
+// returns EXIT_SUCCESS if no check failed
+int sim_test_result(
+        const char * const name );
+
+
+
+
+#endif /* SIM_TEST_H */
@@ -0,0 +1,349 @@
+/**
+ * @file can_lib.c
+ * @brief Simulated CAN library, replaces the BSP can_lib.c on the host.
+ *
+ * Same descriptor contract as the BSP: can_cmd claims a MOB, can_get_status
+ * frees it once completed. The bus sends one frame at a time at
+ * CAN_BAUDRATE, lowest MOB number first like the controller, and raises
+ * the CAN interrupt after each frame. Frames from sim_can_read complete
+ * the lowest armed receive MOB with their ID, frames no MOB accepts are
+ * dropped.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "board.h"
+#include "can_drv.h"
+#include "can_lib.h"
+#include "sim.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// nominal standard frame size without stuffing bits
+#define FRAME_BITS(dlc) (47UL + (8UL * (uint32_t) (dlc)))
+
+
+//
+#define MOB_STATE_FREE (0)
+#define MOB_STATE_TX (1)
+#define MOB_STATE_RX (2)
+
+
+//
+typedef struct
+{
+    //
+    // MOB_STATE_*
+    uint8_t state;
+    //
+    // CANSTMOB bits
+    uint8_t status;
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    //
+    uint8_t data[ NB_DATA_MAX ];
+} sim_mob_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static sim_mob_s mobs[ NB_MOB ];
+
+
+// bus time not yet used by a whole frame
+// bits
+static uint32_t bus_bits = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t get_tx_mob( void );
+
+
+//
+static uint8_t get_rx_mob(
+        const uint16_t id );
+
+
+//
+static void raise_interrupt(
+        const uint8_t enable );
+
+
+//
+static void receive_frames( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// gateways without a CAN interrupt still link
+__attribute__((weak)) void CANIT_vect( void )
+{
+}
+
+
+// NB_MOB if nothing is waiting to transmit
+static uint8_t get_tx_mob( void )
+{
+    uint8_t mob = 0;
+
+    while( (mob < NB_MOB) && ((mobs[ mob ].state != MOB_STATE_TX) || (mobs[ mob ].status != MOB_NOT_COMPLETED)) )
+    {
+        mob += 1;
+    }
+
+    return mob;
+}
+
+
+// NB_MOB if no receive MOB is armed for the ID
+static uint8_t get_rx_mob(
+        const uint16_t id )
+{
+    uint8_t mob = 0;
+
+    while(
+            (mob < NB_MOB)
+            && ((mobs[ mob ].state != MOB_STATE_RX) || (mobs[ mob ].status != MOB_NOT_COMPLETED) || (mobs[ mob ].id != id)) )
+    {
+        mob += 1;
+    }
+
+    return mob;
+}
+
+
+// enable is ENTX or ENRX
+static void raise_interrupt(
+        const uint8_t enable )
+{
+    const uint8_t enabled = (1 << ENIT) | (1 << enable);
+
+    if( (CANGIE & enabled) == enabled )
+    {
+        CANIT_vect();
+    }
+}
+
+
+// takes no bus time, the simulated bus only accounts for transmits
+static void receive_frames( void )
+{
+    uint16_t id = 0;
+    uint8_t dlc = 0;
+    uint8_t data[ NB_DATA_MAX ];
+
+    while( sim_can_read( &id, &dlc, data ) == 0 )
+    {
+        const uint8_t mob = get_rx_mob( id );
+
+        if( mob != NB_MOB )
+        {
+            mobs[ mob ].dlc = MIN( dlc, (uint8_t) NB_DATA_MAX );
+            memcpy( mobs[ mob ].data, data, mobs[ mob ].dlc );
+
+            mobs[ mob ].status = MOB_RX_COMPLETED;
+
+            raise_interrupt( ENRX );
+        }
+    }
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_can_service(
+        const uint32_t interval_us )
+{
+    receive_frames();
+
+    uint8_t mob = get_tx_mob();
+
+    if( mob == NB_MOB )
+    {
+        // idle bus time is not banked
+        bus_bits = 0;
+    }
+    else
+    {
+        bus_bits += (uint32_t) (((uint64_t) interval_us * CAN_BAUDRATE) / 1000ULL);
+
+        while( (mob != NB_MOB) && (bus_bits >= FRAME_BITS( mobs[ mob ].dlc )) )
+        {
+            bus_bits -= FRAME_BITS( mobs[ mob ].dlc );
+
+            sim_can_write(
+                    mobs[ mob ].id,
+                    mobs[ mob ].dlc,
+                    mobs[ mob ].data );
+
+            mobs[ mob ].status = MOB_TX_COMPLETED;
+
+            raise_interrupt( ENTX );
+
+            mob = get_tx_mob();
+        }
+    }
+}
+
+
+//
+uint8_t can_init(
+        uint8_t mode )
+{
+    (void) mode;
+
+    memset( mobs, 0, sizeof(mobs) );
+
+    bus_bits = 0;
+
+    return 1;
+}
+
+
+//
+uint8_t can_cmd(
+        st_cmd_t * cmd )
+{
+    uint8_t ret = CAN_CMD_ACCEPTED;
+    uint8_t mob = 0;
+
+    if( cmd->cmd == CMD_ABORT )
+    {
+        if( cmd->status == MOB_PENDING )
+        {
+            mobs[ cmd->handle ].state = MOB_STATE_FREE;
+            cmd->handle = 0;
+        }
+
+        cmd->status = STATUS_CLEARED;
+    }
+    else
+    {
+        while( (mob < NB_MOB) && (mobs[ mob ].state != MOB_STATE_FREE) )
+        {
+            mob += 1;
+        }
+
+        if( mob == NB_MOB )
+        {
+            cmd->status = MOB_NOT_REACHED;
+
+            ret = CAN_CMD_REFUSED;
+        }
+        else
+        {
+            cmd->status = MOB_PENDING;
+            cmd->handle = mob;
+
+            mobs[ mob ].status = MOB_NOT_COMPLETED;
+            mobs[ mob ].id = cmd->id.std;
+            mobs[ mob ].dlc = MIN( cmd->dlc, (uint8_t) NB_DATA_MAX );
+
+            if( (cmd->cmd == CMD_TX) || (cmd->cmd == CMD_TX_DATA) )
+            {
+                memcpy( mobs[ mob ].data, cmd->pt_data, mobs[ mob ].dlc );
+
+                mobs[ mob ].state = MOB_STATE_TX;
+            }
+            else if( cmd->cmd == CMD_TX_REMOTE )
+            {
+                mobs[ mob ].state = MOB_STATE_TX;
+            }
+            else if( cmd->cmd != CMD_NONE )
+            {
+                mobs[ mob ].state = MOB_STATE_RX;
+            }
+            else
+            {
+                cmd->status = STATUS_CLEARED;
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+//
+uint8_t can_get_status(
+        st_cmd_t * cmd )
+{
+    uint8_t ret = CAN_STATUS_NOT_COMPLETED;
+
+    if(
+            (cmd->status == STATUS_CLEARED)
+            || (cmd->status == MOB_NOT_REACHED)
+            || (cmd->status == MOB_DISABLE) )
+    {
+        ret = CAN_STATUS_ERROR;
+    }
+    else
+    {
+        sim_mob_s * const sim_mob = &mobs[ cmd->handle ];
+
+        if( sim_mob->status == MOB_TX_COMPLETED )
+        {
+            cmd->status = sim_mob->status;
+
+            // free the MOB
+            sim_mob->state = MOB_STATE_FREE;
+
+            ret = CAN_STATUS_COMPLETED;
+        }
+        else if( sim_mob->status == MOB_RX_COMPLETED )
+        {
+            cmd->status = sim_mob->status;
+            cmd->ctrl.rtr = 0;
+            cmd->ctrl.ide = 0;
+            cmd->id.std = sim_mob->id;
+            cmd->dlc = sim_mob->dlc;
+
+            memcpy( cmd->pt_data, sim_mob->data, sim_mob->dlc );
+
+            // free the MOB
+            sim_mob->state = MOB_STATE_FREE;
+
+            ret = CAN_STATUS_COMPLETED;
+        }
+    }
+
+    return ret;
+}
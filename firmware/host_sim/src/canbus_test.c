@@ -0,0 +1,383 @@
+/**
+ * @file canbus_test.c
+ * @brief Host test of the canbus transmit queue on the simulated MOB's.
+ *
+ * The IMU gateway canbus.c runs on the simulated can_lib.c, the bus is
+ * stepped one 8 byte frame at a time and each frame is checked against
+ * what was queued. Covers a full queue, the drop counts and the send by
+ * reference contract: the reference count only reaches zero once the
+ * last referenced frame is loaded into a MOB, after which the payload
+ * may be overwritten without changing what goes out.
+ *
+ * Usage: canbus-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "board.h"
+#include "can_drv.h"
+#include "can_lib.h"
+#include "time.h"
+#include "canbus.h"
+#include "sim.h"
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// frames the queue holds, one entry is kept free
+#define QUEUE_CAPACITY (CANBUS_TX_QUEUE_SIZE - 1)
+
+
+// frames accepted before the queue is full
+#define FRAME_COUNT (NB_MOB + QUEUE_CAPACITY)
+
+
+//
+#define TX_ID (0x123)
+
+
+// IDs dropped on the full queue, one more than the drop table holds
+#define DROP_ID_BASE (0x700)
+
+
+// bus time of one 8 byte frame at CAN_BAUDRATE kbit/s, see can_lib.c
+// microseconds
+#define FRAME_TIME_US ((uint32_t) (((47UL + 64UL) * 1000UL) / CAN_BAUDRATE))
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    //
+    uint8_t data[ NB_DATA_MAX ];
+} test_frame_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// referenced payloads, one per queued frame
+static uint8_t payloads[ FRAME_COUNT ][ NB_DATA_MAX ];
+
+
+// frames on the bus
+static test_frame_s written[ FRAME_COUNT + 1 ];
+static uint16_t written_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void fill_payload(
+        const uint16_t seq,
+        uint8_t * const data );
+
+
+//
+static void step_bus( void );
+
+
+//
+static void test_queue_full(
+        volatile uint8_t * const ref_count );
+
+
+//
+static void test_drop_counts( void );
+
+
+//
+static void test_ref_release(
+        volatile uint8_t * const ref_count );
+
+
+//
+static void test_send_copy( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void fill_payload(
+        const uint16_t seq,
+        uint8_t * const data )
+{
+    uint8_t idx = 0;
+
+    for( idx = 0; idx < NB_DATA_MAX; idx += 1 )
+    {
+        data[ idx ] = (uint8_t) (seq + (idx * 31));
+    }
+}
+
+
+// one frame, if one is waiting
+static void step_bus( void )
+{
+    sim_can_service( FRAME_TIME_US );
+}
+
+
+//
+static void test_queue_full(
+        volatile uint8_t * const ref_count )
+{
+    uint16_t seq = 0;
+    uint8_t refused = 0;
+
+    for( seq = 0; seq < FRAME_COUNT; seq += 1 )
+    {
+        fill_payload( seq, payloads[ seq ] );
+
+        refused |= canbus_send_ref( TX_ID, NB_DATA_MAX, payloads[ seq ], ref_count );
+
+        // the first NB_MOB go straight into a MOB
+        if( seq < NB_MOB )
+        {
+            SIM_TEST_CHECK( (*ref_count) == 0 );
+        }
+    }
+
+    SIM_TEST_CHECK( refused == 0 );
+    SIM_TEST_CHECK( (*ref_count) == QUEUE_CAPACITY );
+    SIM_TEST_CHECK( canbus_get_tx_pending() == QUEUE_CAPACITY );
+
+    // full, the frame is dropped and the reference is not taken
+    SIM_TEST_CHECK( canbus_send_ref( DROP_ID_BASE, NB_DATA_MAX, payloads[ 0 ], ref_count ) != 0 );
+    SIM_TEST_CHECK( (*ref_count) == QUEUE_CAPACITY );
+    SIM_TEST_CHECK( canbus_get_tx_pending() == QUEUE_CAPACITY );
+}
+
+
+// the queue is still full
+static void test_drop_counts( void )
+{
+    uint16_t idx = 0;
+    canbus_stats_s stats;
+
+    const uint8_t data[ NB_DATA_MAX ] = { 0 };
+
+    for( idx = 0; idx <= CANBUS_DROP_ID_COUNT; idx += 1 )
+    {
+        SIM_TEST_CHECK( canbus_send( DROP_ID_BASE + idx, NB_DATA_MAX, data ) != 0 );
+    }
+
+    canbus_get_stats( &stats );
+
+    SIM_TEST_CHECK( stats.queue_full_count == (CANBUS_DROP_ID_COUNT + 2) );
+    SIM_TEST_CHECK( stats.queue_high_water == QUEUE_CAPACITY );
+    SIM_TEST_CHECK( stats.drop_other_count == 1 );
+    SIM_TEST_CHECK( canbus_get_drop_count( DROP_ID_BASE ) == 2 );
+    SIM_TEST_CHECK( canbus_get_drop_count( TX_ID ) == 0 );
+
+    for( idx = 1; idx < CANBUS_DROP_ID_COUNT; idx += 1 )
+    {
+        SIM_TEST_CHECK( canbus_get_drop_count( DROP_ID_BASE + idx ) == 1 );
+    }
+
+    // no entry left for the last ID
+    SIM_TEST_CHECK( canbus_get_drop_count( DROP_ID_BASE + CANBUS_DROP_ID_COUNT ) == 0 );
+}
+
+
+//
+static void test_ref_release(
+        volatile uint8_t * const ref_count )
+{
+    uint16_t seq = 0;
+    uint16_t step = 0;
+    uint8_t seen[ FRAME_COUNT ];
+    canbus_stats_s stats;
+
+    // each frame on the bus frees a MOB, the interrupt loads the next
+    // queued frame and releases its reference
+    for( step = 0; step < QUEUE_CAPACITY; step += 1 )
+    {
+        SIM_TEST_CHECK( (*ref_count) == canbus_get_tx_pending() );
+        SIM_TEST_CHECK( (*ref_count) != 0 );
+
+        step_bus();
+
+        SIM_TEST_CHECK( written_count == (step + 1) );
+        SIM_TEST_CHECK( (*ref_count) == (QUEUE_CAPACITY - step - 1) );
+    }
+
+    SIM_TEST_CHECK( (*ref_count) == 0 );
+    SIM_TEST_CHECK( canbus_get_tx_pending() == 0 );
+
+    // every payload is in a MOB, the caller may reuse the buffers
+    memset( payloads, 0xFF, sizeof(payloads) );
+
+    for( step = 0; step < NB_MOB; step += 1 )
+    {
+        step_bus();
+    }
+
+    // nothing left
+    step_bus();
+
+    SIM_TEST_CHECK( written_count == FRAME_COUNT );
+
+    // lowest free MOB first, so not in queue order, each frame once
+    memset( seen, 0, sizeof(seen) );
+
+    for( step = 0; step < written_count; step += 1 )
+    {
+        uint8_t expected[ NB_DATA_MAX ];
+
+        seq = written[ step ].data[ 0 ];
+
+        fill_payload( seq, expected );
+
+        SIM_TEST_CHECK( written[ step ].id == TX_ID );
+        SIM_TEST_CHECK( written[ step ].dlc == NB_DATA_MAX );
+        SIM_TEST_CHECK( seq < FRAME_COUNT );
+        SIM_TEST_CHECK( memcmp( written[ step ].data, expected, NB_DATA_MAX ) == 0 );
+
+        if( seq < FRAME_COUNT )
+        {
+            SIM_TEST_CHECK( seen[ seq ] == 0 );
+            seen[ seq ] = 1;
+        }
+    }
+
+    canbus_get_stats( &stats );
+
+    SIM_TEST_CHECK( stats.tx_count == FRAME_COUNT );
+    SIM_TEST_CHECK( stats.tx_error_count == 0 );
+}
+
+
+// the payload is copied when queued
+static void test_send_copy( void )
+{
+    uint8_t data[ NB_DATA_MAX ];
+    uint8_t expected[ NB_DATA_MAX ];
+    uint16_t seq = 0;
+
+    written_count = 0;
+
+    // keep the frames in the queue behind busy MOB's
+    for( seq = 0; seq < (NB_MOB + 1); seq += 1 )
+    {
+        fill_payload( seq, data );
+
+        SIM_TEST_CHECK( canbus_send( TX_ID, NB_DATA_MAX, data ) == 0 );
+
+        memset( data, 0xFF, sizeof(data) );
+    }
+
+    SIM_TEST_CHECK( canbus_get_tx_pending() == 1 );
+
+    for( seq = 0; seq < (NB_MOB + 2); seq += 1 )
+    {
+        step_bus();
+    }
+
+    SIM_TEST_CHECK( written_count == (NB_MOB + 1) );
+    SIM_TEST_CHECK( canbus_get_tx_pending() == 0 );
+
+    for( seq = 0; seq < written_count; seq += 1 )
+    {
+        fill_payload( written[ seq ].data[ 0 ], expected );
+
+        SIM_TEST_CHECK( memcmp( written[ seq ].data, expected, NB_DATA_MAX ) == 0 );
+    }
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+// no canbus_recv test, the bus delivers nothing
+uint8_t sim_can_read(
+        uint16_t * const id,
+        uint8_t * const dlc,
+        uint8_t * const data )
+{
+    return 1;
+}
+
+
+//
+void sim_can_write(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    if( written_count < (sizeof(written) / sizeof(written[0])) )
+    {
+        written[ written_count ].id = id;
+        written[ written_count ].dlc = dlc;
+        memcpy( written[ written_count ].data, data, dlc );
+    }
+
+    written_count += 1;
+}
+
+
+//
+uint32_t time_get_us( void )
+{
+    return 0;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    volatile uint8_t ref_count = 0;
+
+    (void) canbus_init();
+
+    test_queue_full( &ref_count );
+
+    test_drop_counts();
+
+    test_ref_release( &ref_count );
+
+    test_send_copy();
+
+    return sim_test_result( "canbus-test" );
+}
@@ -0,0 +1,620 @@
+/**
+ * @file crc_test.c
+ * @brief Host test and throughput of the SBP CRC16.
+ *
+ * edc.c is built with BUILD_TARGET_AVR, so crc16_ccitt reads its table
+ * through the pgm_read_word stand-in like the gateway does from flash.
+ * Checked against a bitwise CRC and the original table loop on random
+ * buffers, seeds and split points, then sbp_scan is fed random SBP
+ * frames split at random points and must deliver the same frames as a
+ * single pass over the whole stream.
+ *
+ * Prints the host throughput of each CRC. The table read from flash
+ * costs more on the target than it does here.
+ *
+ * Usage: crc-test [megabytes]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "libsbp/edc.h"
+#include "libsbp/sbp.h"
+#include "libsbp/system.h"
+#include "libsbp/navigation.h"
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// x^16 + x^12 + x^5 + 1
+#define CRC16_POLY (0x1021)
+
+
+// private to sbp.c
+#define SBP_PREAMBLE (0x55)
+
+
+//
+#define RANDOM_BUFFER_COUNT (20000UL)
+
+
+//
+#define RANDOM_BUFFER_SIZE_MAX (1024UL)
+
+
+//
+#define THROUGHPUT_MEGABYTES_DEFAULT (16UL)
+
+
+// frames per random SBP stream
+#define SBP_FRAME_COUNT (2000UL)
+
+
+// one in this many frames has a payload byte flipped
+#define SBP_CORRUPT_RATIO (16UL)
+
+
+//
+#define SBP_STREAM_SIZE_MAX (SBP_FRAME_COUNT * (SBP_FRAME_LEN_MAX + 8UL))
+
+
+//
+#define SBP_STREAM_COUNT (20UL)
+
+
+//
+#define SBP_DELIVERED_MAX (SBP_FRAME_COUNT)
+
+
+// a delivered frame
+typedef struct
+{
+    //
+    //
+    uint16_t msg_type;
+    //
+    //
+    uint16_t sender_id;
+    //
+    //
+    uint8_t len;
+    //
+    // sum of the payload bytes
+    uint16_t sum;
+} delivered_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    delivered_s frames[ SBP_DELIVERED_MAX ];
+    //
+    //
+    uint32_t count;
+} delivery_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// built from the bitwise CRC
+static uint16_t ref_table[ 256 ];
+
+
+//
+static uint8_t buffer[ RANDOM_BUFFER_SIZE_MAX ];
+
+
+//
+static uint8_t stream[ SBP_STREAM_SIZE_MAX ];
+
+
+//
+static delivery_s *delivery = NULL;
+
+
+//
+static delivery_s whole_delivery;
+
+
+//
+static delivery_s split_delivery;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static uint32_t random_below(
+        const uint32_t bound );
+
+
+//
+static uint16_t crc_bitwise(
+        const uint8_t * const buf,
+        const uint32_t len,
+        uint16_t crc );
+
+
+//
+static void build_ref_table( void );
+
+
+//
+static uint16_t crc_ref_table(
+        const uint8_t *buf,
+        const uint32_t len,
+        uint16_t crc );
+
+
+//
+static void frame_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+
+
+//
+static uint32_t build_sbp_stream(
+        uint32_t * const corrupt_count );
+
+
+//
+static void scan_stream(
+        const uint32_t size,
+        const uint8_t split,
+        sbp_scanner_t * const scanner );
+
+
+//
+static void test_vectors( void );
+
+
+//
+static void test_random_buffers( void );
+
+
+//
+static void test_sbp_scan( void );
+
+
+//
+static double measure(
+        uint16_t (*crc_fn)( const uint8_t *buf, const uint32_t len, uint16_t crc ),
+        const unsigned long megabytes );
+
+
+//
+static uint16_t crc_flash(
+        const uint8_t *buf,
+        const uint32_t len,
+        uint16_t crc );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// one entry per type, delivered through frame_cb
+static const sbp_msg_dispatch_t DISPATCH_TABLE[] =
+{
+    { SBP_MSG_GPS_TIME, &frame_cb, (void*) (uintptr_t) SBP_MSG_GPS_TIME },
+    { SBP_MSG_POS_LLH, &frame_cb, (void*) (uintptr_t) SBP_MSG_POS_LLH },
+    { SBP_MSG_VEL_NED, &frame_cb, (void*) (uintptr_t) SBP_MSG_VEL_NED },
+    { SBP_MSG_BASELINE_NED, &frame_cb, (void*) (uintptr_t) SBP_MSG_BASELINE_NED },
+    { SBP_MSG_BASELINE_HEADING, &frame_cb, (void*) (uintptr_t) SBP_MSG_BASELINE_HEADING },
+    { SBP_MSG_DOPS, &frame_cb, (void*) (uintptr_t) SBP_MSG_DOPS },
+    { SBP_MSG_HEARTBEAT, &frame_cb, (void*) (uintptr_t) SBP_MSG_HEARTBEAT }
+};
+
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+//
+static uint32_t random_below(
+        const uint32_t bound )
+{
+    return (uint32_t) (((uint64_t) (uint32_t) rand() * bound) / ((uint64_t) RAND_MAX + 1));
+}
+
+
+// XMODEM, MSB first, not reflected
+static uint16_t crc_bitwise(
+        const uint8_t * const buf,
+        const uint32_t len,
+        uint16_t crc )
+{
+    uint32_t idx = 0;
+    uint8_t bit = 0;
+
+    for( idx = 0; idx < len; idx += 1 )
+    {
+        crc ^= (uint16_t) ((uint16_t) buf[ idx ] << 8);
+
+        for( bit = 0; bit < 8; bit += 1 )
+        {
+            if( (crc & 0x8000) != 0 )
+            {
+                crc = (uint16_t) ((crc << 1) ^ CRC16_POLY);
+            }
+            else
+            {
+                crc = (uint16_t) (crc << 1);
+            }
+        }
+    }
+
+    return crc;
+}
+
+
+//
+static void build_ref_table( void )
+{
+    uint16_t idx = 0;
+
+    for( idx = 0; idx < 256; idx += 1 )
+    {
+        const uint8_t data = (uint8_t) idx;
+
+        ref_table[ idx ] = crc_bitwise( &data, 1, 0 );
+    }
+}
+
+
+// the loop crc16_ccitt had with the table in SRAM
+static uint16_t crc_ref_table(
+        const uint8_t *buf,
+        const uint32_t len,
+        uint16_t crc )
+{
+    uint32_t idx = 0;
+
+    for( idx = 0; idx < len; idx += 1 )
+    {
+        crc = (uint16_t) ((crc << 8) ^ ref_table[ ((crc >> 8) ^ buf[ idx ]) & 0x00FF ]);
+    }
+
+    return crc;
+}
+
+
+//
+static uint16_t crc_flash(
+        const uint8_t *buf,
+        const uint32_t len,
+        uint16_t crc )
+{
+    return crc16_ccitt( buf, len, crc );
+}
+
+
+// context is the message type
+static void frame_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    uint16_t idx = 0;
+
+    if( delivery->count < SBP_DELIVERED_MAX )
+    {
+        delivered_s * const frame = &delivery->frames[ delivery->count ];
+
+        frame->msg_type = (uint16_t) (uintptr_t) context;
+        frame->sender_id = sender_id;
+        frame->len = len;
+        frame->sum = 0;
+
+        for( idx = 0; idx < len; idx += 1 )
+        {
+            frame->sum = (uint16_t) (frame->sum + msg[ idx ]);
+        }
+    }
+
+    delivery->count += 1;
+}
+
+
+// random types, lengths and payloads, with junk between some frames,
+// the junk has no preamble so every good frame is found
+// returns the stream size
+static uint32_t build_sbp_stream(
+        uint32_t * const corrupt_count )
+{
+    uint32_t size = 0;
+    uint32_t frame = 0;
+    uint32_t idx = 0;
+
+    const uint8_t table_len = (uint8_t) (sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0]));
+
+    (*corrupt_count) = 0;
+
+    for( frame = 0; frame < SBP_FRAME_COUNT; frame += 1 )
+    {
+        uint8_t * const start = &stream[ size ];
+
+        const uint16_t msg_type = DISPATCH_TABLE[ random_below( table_len ) ].msg_type;
+        const uint16_t sender_id = (uint16_t) random_below( 0x10000 );
+        const uint8_t len = (uint8_t) ((random_below( 4 ) == 0) ? random_below( 256 ) : random_below( 48 ));
+
+        start[ 0 ] = SBP_PREAMBLE;
+        start[ 1 ] = (uint8_t) (msg_type & 0xFF);
+        start[ 2 ] = (uint8_t) (msg_type >> 8);
+        start[ 3 ] = (uint8_t) (sender_id & 0xFF);
+        start[ 4 ] = (uint8_t) (sender_id >> 8);
+        start[ 5 ] = len;
+
+        for( idx = 0; idx < len; idx += 1 )
+        {
+            start[ 6 + idx ] = (uint8_t) random_below( 256 );
+        }
+
+        const uint16_t crc = crc_bitwise( &start[ 1 ], 5UL + len, 0 );
+
+        start[ 6 + len ] = (uint8_t) (crc & 0xFF);
+        start[ 7 + len ] = (uint8_t) (crc >> 8);
+
+        if( random_below( SBP_CORRUPT_RATIO ) == 0 )
+        {
+            // flip a bit after the preamble
+            start[ 1 + random_below( 7UL + len ) ] ^= (uint8_t) (1 << random_below( 8 ));
+
+            (*corrupt_count) += 1;
+        }
+
+        size += (8UL + len);
+
+        if( random_below( 8 ) == 0 )
+        {
+            const uint32_t junk = 1 + random_below( 8 );
+
+            for( idx = 0; idx < junk; idx += 1 )
+            {
+                uint8_t value = (uint8_t) random_below( 256 );
+
+                if( value == SBP_PREAMBLE )
+                {
+                    value = 0;
+                }
+
+                stream[ size ] = value;
+                size += 1;
+            }
+        }
+    }
+
+    return size;
+}
+
+
+// split - feed random spans, otherwise as much as fits
+static void scan_stream(
+        const uint32_t size,
+        const uint8_t split,
+        sbp_scanner_t * const scanner )
+{
+    uint32_t pos = 0;
+    uint8_t *dst = NULL;
+
+    sbp_scanner_init(
+            scanner,
+            DISPATCH_TABLE,
+            (uint8_t) (sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0])) );
+
+    while( pos < size )
+    {
+        const uint16_t space = sbp_scanner_space( scanner, &dst );
+
+        uint32_t count = (split == 0) ? space : (1 + random_below( space ));
+
+        if( count > (size - pos) )
+        {
+            count = (size - pos);
+        }
+
+        memcpy( dst, &stream[ pos ], count );
+
+        (void) sbp_scan( scanner, (u16) count );
+
+        pos += count;
+    }
+}
+
+
+// published XMODEM check values
+static void test_vectors( void )
+{
+    const uint8_t check[] = "123456789";
+
+    SIM_TEST_CHECK( crc_bitwise( check, 9, 0 ) == 0x31C3 );
+    SIM_TEST_CHECK( crc16_ccitt( check, 9, 0 ) == 0x31C3 );
+    SIM_TEST_CHECK( crc16_ccitt( check, 0, 0x1234 ) == 0x1234 );
+
+    // the table is the CRC of each byte value
+    SIM_TEST_CHECK( (ref_table[ 0 ] == 0) && (ref_table[ 1 ] == CRC16_POLY) );
+}
+
+
+//
+static void test_random_buffers( void )
+{
+    unsigned long iter = 0;
+    uint32_t idx = 0;
+    uint8_t table_match = 1;
+    uint8_t split_match = 1;
+
+    for( iter = 0; iter < RANDOM_BUFFER_COUNT; iter += 1 )
+    {
+        const uint32_t len = random_below( RANDOM_BUFFER_SIZE_MAX + 1 );
+        const uint16_t seed = (iter < (RANDOM_BUFFER_COUNT / 2)) ? 0 : (uint16_t) random_below( 0x10000 );
+
+        for( idx = 0; idx < len; idx += 1 )
+        {
+            buffer[ idx ] = (uint8_t) random_below( 256 );
+        }
+
+        const uint16_t expected = crc_bitwise( buffer, len, seed );
+
+        if(
+                (crc16_ccitt( buffer, len, seed ) != expected)
+                || (crc_ref_table( buffer, len, seed ) != expected) )
+        {
+            table_match = 0;
+        }
+
+        // up to four pieces, empty ones included
+        uint16_t crc = seed;
+        uint32_t pos = 0;
+        const uint8_t pieces = (uint8_t) (1 + random_below( 4 ));
+
+        for( idx = 1; idx < pieces; idx += 1 )
+        {
+            const uint32_t piece = random_below( (len - pos) + 1 );
+
+            crc = crc16_ccitt( &buffer[ pos ], piece, crc );
+            pos += piece;
+        }
+
+        crc = crc16_ccitt( &buffer[ pos ], len - pos, crc );
+
+        if( crc != expected )
+        {
+            split_match = 0;
+        }
+    }
+
+    SIM_TEST_CHECK( table_match != 0 );
+    SIM_TEST_CHECK( split_match != 0 );
+}
+
+
+// the scanner carries the CRC of a partial frame across spans
+static void test_sbp_scan( void )
+{
+    unsigned long iter = 0;
+    uint32_t corrupt_count = 0;
+    sbp_scanner_t scanner;
+
+    for( iter = 0; iter < SBP_STREAM_COUNT; iter += 1 )
+    {
+        const uint32_t size = build_sbp_stream( &corrupt_count );
+
+        memset( &whole_delivery, 0, sizeof(whole_delivery) );
+        delivery = &whole_delivery;
+        scan_stream( size, 0, &scanner );
+
+        const uint16_t whole_crc_errors = scanner.n_crc_errors;
+
+        memset( &split_delivery, 0, sizeof(split_delivery) );
+        delivery = &split_delivery;
+        scan_stream( size, 1, &scanner );
+
+        SIM_TEST_CHECK( whole_delivery.count == (SBP_FRAME_COUNT - corrupt_count) );
+        SIM_TEST_CHECK( whole_crc_errors >= corrupt_count );
+
+        SIM_TEST_CHECK( split_delivery.count == whole_delivery.count );
+        SIM_TEST_CHECK( scanner.n_crc_errors == whole_crc_errors );
+        SIM_TEST_CHECK(
+                memcmp(
+                    split_delivery.frames,
+                    whole_delivery.frames,
+                    sizeof(whole_delivery.frames) ) == 0 );
+    }
+}
+
+
+// MB/s
+static double measure(
+        uint16_t (*crc_fn)( const uint8_t *buf, const uint32_t len, uint16_t crc ),
+        const unsigned long megabytes )
+{
+    unsigned long pass = 0;
+    uint16_t crc = 0;
+
+    const unsigned long passes = (megabytes * 1000000UL) / RANDOM_BUFFER_SIZE_MAX;
+
+    const double start = get_time_ns();
+
+    for( pass = 0; pass < passes; pass += 1 )
+    {
+        crc = crc_fn( buffer, RANDOM_BUFFER_SIZE_MAX, crc );
+    }
+
+    const double end = get_time_ns();
+
+    // keep the result
+    buffer[ 0 ] ^= (uint8_t) crc;
+
+    return ((double) passes * (double) RANDOM_BUFFER_SIZE_MAX) / ((end - start) / 1.0e3);
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    unsigned long megabytes = THROUGHPUT_MEGABYTES_DEFAULT;
+
+    if( argc == 2 )
+    {
+        megabytes = strtoul( argv[ 1 ], NULL, 0 );
+    }
+
+    srand( 1 );
+
+    build_ref_table();
+
+    test_vectors();
+
+    test_random_buffers();
+
+    test_sbp_scan();
+
+    const double bitwise_mbs = measure( &crc_bitwise, megabytes );
+    const double table_mbs = measure( &crc_ref_table, megabytes );
+    const double flash_mbs = measure( &crc_flash, megabytes );
+
+    printf(
+            "crc-test: %lu MB, bitwise %.1f MB/s, table %.1f MB/s, flash table %.1f MB/s\n",
+            megabytes,
+            bitwise_mbs,
+            table_mbs,
+            flash_mbs );
+
+    return sim_test_result( "crc-test" );
+}
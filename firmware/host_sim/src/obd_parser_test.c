@@ -0,0 +1,982 @@
+/**
+ * @file obd_parser_test.c
+ * @brief Host test of the OBD gateway K-line packet parser.
+ *
+ * Replays an OBD stream, as written by hobd-stream-gen, through the
+ * gateway's UART rx interrupt and process_buffer at line rate, 12 bytes
+ * per 1 ms main loop pass. obd.c is included so the parser counters and
+ * the decoded tables can be checked directly.
+ *
+ * The clean stream must decode every packet without errors. Packets are
+ * then corrupted one at a time between clean ones: bad type, truncated
+ * size, flipped checksum and a stall mid-packet. Each must be counted as
+ * the expected framing/checksum/timeout errors, and the parser must pick
+ * up the next clean packet. Last, random bit flips over the whole stream
+ * must not keep the parser from decoding a clean tail.
+ *
+ * Crafted table 16 responses then go through obd_update: two full ones
+ * and a partial one. The published OBD1/OBD2 frames must carry the
+ * partial response's registers and the last full response's for the
+ * rest.
+ *
+ * Usage: obd-parser-test <obd file>
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sim_test.h"
+
+#include "obd.c"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// bytes per main loop pass, ~11.5 bytes per ms at OBD_BAUDRATE
+#define BYTES_PER_PASS (12U)
+
+
+// main loop pass
+// ms
+#define PASS_TIME (1UL)
+
+
+// a gap the ECU may leave within a packet
+// ms
+#define SHORT_GAP (OBD_RX_BYTE_TIMEOUT - 10UL)
+
+
+// clean packets replayed either side of a corrupted one
+#define CLEAN_PACKETS (8U)
+
+
+// packets with a random bit flip, one in RANDOM_FLIP_RATE
+#define RANDOM_FLIP_RATE (20)
+
+
+//
+#define RANDOM_SEED (0x0BD)
+
+
+// stray type byte
+#define BAD_TYPE (0x55)
+
+
+//
+typedef enum
+{
+    CORRUPT_TYPE,
+    CORRUPT_SIZE,
+    CORRUPT_CHECKSUM,
+    CORRUPT_STALL,
+    CORRUPT_GAP
+} corrupt_kind_e;
+
+
+// parser counters a replay should end with
+typedef struct
+{
+    //
+    //
+    uint16_t framing_error_count;
+    //
+    //
+    uint16_t checksum_error_count;
+    //
+    //
+    uint16_t timeout_count;
+} expected_errors_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// captured stream
+static uint8_t *stream_data = NULL;
+static uint32_t stream_size = 0;
+
+
+// start of each packet in the stream
+static uint32_t *packets = NULL;
+static uint32_t packet_count = 0;
+
+
+// main loop time
+// ms
+static uint32_t loop_time = 0;
+
+
+// last clean packet of each table, and the number replayed
+static const uint8_t *last_table_16 = NULL;
+static const uint8_t *last_table_209 = NULL;
+static uint16_t expected_table_16 = 0;
+static uint16_t expected_table_209 = 0;
+
+
+// last published OBD1/OBD2 payloads, and the number of each
+static hobd_obd1_s published_obd1;
+static hobd_obd2_s published_obd2;
+static uint16_t published_obd1_count = 0;
+static uint16_t published_obd2_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t load_stream(
+        const char * const path );
+
+
+//
+static uint8_t split_packets( void );
+
+
+//
+static void reset_gateway( void );
+
+
+//
+static void replay_bytes(
+        const uint8_t * const data,
+        const uint32_t len );
+
+
+//
+static void replay_idle(
+        const uint32_t duration );
+
+
+//
+static void expect_packet(
+        const uint8_t * const packet );
+
+
+//
+static void replay_clean(
+        const uint32_t first,
+        const uint32_t count );
+
+
+//
+static void replay_corrupt(
+        const uint32_t packet,
+        const corrupt_kind_e kind );
+
+
+//
+static uint32_t find_packet(
+        const uint32_t start,
+        const uint8_t table );
+
+
+//
+static void check_register(
+        const void * const dst,
+        const uint8_t * const packet,
+        const uint8_t offset,
+        const uint8_t size );
+
+
+//
+static void check_decoded( void );
+
+
+//
+static void check_errors(
+        const expected_errors_s * const expected );
+
+
+//
+static void test_clean_replay( void );
+
+
+//
+static void test_corruption(
+        const uint8_t table,
+        const corrupt_kind_e kind,
+        const expected_errors_s * const expected );
+
+
+//
+static void test_random_flips( void );
+
+
+//
+static uint8_t build_response(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t * const registers,
+        const uint8_t register_count,
+        uint8_t * const packet );
+
+
+//
+static void fill_table_16(
+        const uint8_t seed,
+        hobd_table_16_s * const table );
+
+
+//
+static void check_published_table_16(
+        const hobd_table_16_s * const table );
+
+
+//
+static void test_partial_response( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static uint8_t load_stream(
+        const char * const path )
+{
+    uint8_t ret = 1;
+    long file_size = 0;
+
+    FILE * const file = fopen( path, "rb" );
+
+    if( file != NULL )
+    {
+        if( fseek( file, 0, SEEK_END ) == 0 )
+        {
+            file_size = ftell( file );
+        }
+
+        if( (file_size > 0) && (fseek( file, 0, SEEK_SET ) == 0) )
+        {
+            stream_data = malloc( (size_t) file_size );
+        }
+
+        if(
+                (stream_data != NULL)
+                && (fread( stream_data, 1, (size_t) file_size, file ) == (size_t) file_size) )
+        {
+            stream_size = (uint32_t) file_size;
+
+            ret = 0;
+        }
+
+        (void) fclose( file );
+    }
+
+    return ret;
+}
+
+
+// the captured stream is back to back table responses, a partial
+// packet at the end is left out
+static uint8_t split_packets( void )
+{
+    uint8_t ret = 0;
+    uint32_t pos = 0;
+
+    packets = malloc( sizeof(*packets) * ((stream_size / sizeof(hobd_table_response_s)) + 1) );
+
+    if( packets == NULL )
+    {
+        ret = 1;
+    }
+
+    while(
+            (ret == 0)
+            && ((pos + sizeof(hobd_packet_header_s)) <= stream_size) )
+    {
+        const uint8_t size = stream_data[ pos + 1 ];
+
+        if(
+                (stream_data[ pos ] != HOBD_PACKET_TYPE_RESPONSE)
+                || (size <= (uint8_t) sizeof(hobd_table_response_s)) )
+        {
+            ret = 1;
+        }
+        else if( (pos + size) <= stream_size )
+        {
+            packets[ packet_count ] = pos;
+            packet_count += 1;
+        }
+
+        pos += size;
+    }
+
+    return ret;
+}
+
+
+// obd_init leaves the rx counters
+static void reset_gateway( void )
+{
+    (void) obd_init();
+
+    rx_count_table_16 = 0;
+    rx_count_table_209 = 0;
+
+    last_table_16 = NULL;
+    last_table_209 = NULL;
+    expected_table_16 = 0;
+    expected_table_209 = 0;
+}
+
+
+// bytes arrive at line rate, the main loop drains them once per pass
+static void replay_bytes(
+        const uint8_t * const data,
+        const uint32_t len )
+{
+    uint32_t idx = 0;
+
+    for( idx = 0; idx < len; idx += 1 )
+    {
+        UART_UCSRA = 0;
+        UART_DATA = data[ idx ];
+
+        UART_RX_INTERRUPT();
+
+        if( ((idx + 1) % BYTES_PER_PASS) == 0 )
+        {
+            loop_time += PASS_TIME;
+
+            (void) process_buffer( &loop_time );
+        }
+    }
+
+    loop_time += PASS_TIME;
+
+    (void) process_buffer( &loop_time );
+}
+
+
+// nothing on the line
+static void replay_idle(
+        const uint32_t duration )
+{
+    uint32_t elapsed = 0;
+
+    for( elapsed = 0; elapsed < duration; elapsed += PASS_TIME )
+    {
+        loop_time += PASS_TIME;
+
+        (void) process_buffer( &loop_time );
+    }
+}
+
+
+// a packet the gateway should have decoded
+static void expect_packet(
+        const uint8_t * const packet )
+{
+    if( packet[ 3 ] == HOBD_TABLE_16 )
+    {
+        last_table_16 = packet;
+        expected_table_16 += 1;
+    }
+    else if( packet[ 3 ] == HOBD_TABLE_209 )
+    {
+        last_table_209 = packet;
+        expected_table_209 += 1;
+    }
+}
+
+
+//
+static void replay_clean(
+        const uint32_t first,
+        const uint32_t count )
+{
+    uint32_t idx = 0;
+
+    for( idx = first; (idx < (first + count)) && (idx < packet_count); idx += 1 )
+    {
+        const uint8_t * const packet = &stream_data[ packets[ idx ] ];
+
+        replay_bytes( packet, packet[ 1 ] );
+
+        expect_packet( packet );
+    }
+}
+
+
+// replays a corrupted copy of a packet followed by a line stall, except
+// for CORRUPT_GAP which is a clean packet with a short gap in it
+static void replay_corrupt(
+        const uint32_t packet,
+        const corrupt_kind_e kind )
+{
+    uint8_t copy[ HOBD_PACKET_SIZE_MAX ];
+
+    const uint8_t size = stream_data[ packets[ packet ] + 1 ];
+
+    memcpy( copy, &stream_data[ packets[ packet ] ], size );
+
+    if( kind == CORRUPT_TYPE )
+    {
+        copy[ 0 ] = BAD_TYPE;
+    }
+    else if( kind == CORRUPT_SIZE )
+    {
+        copy[ 1 ] = (uint8_t) sizeof(hobd_packet_header_s);
+    }
+    else if( kind == CORRUPT_CHECKSUM )
+    {
+        copy[ size - 1 ] ^= 0x01;
+    }
+
+    if( kind == CORRUPT_STALL )
+    {
+        replay_bytes( copy, size / 2 );
+        replay_idle( OBD_RX_BYTE_TIMEOUT );
+    }
+    else if( kind == CORRUPT_GAP )
+    {
+        replay_bytes( copy, size / 2 );
+        replay_idle( SHORT_GAP );
+        replay_bytes( &copy[ size / 2 ], size - (size / 2) );
+
+        expect_packet( &stream_data[ packets[ packet ] ] );
+    }
+    else
+    {
+        replay_bytes( copy, size );
+        replay_idle( OBD_RX_BYTE_TIMEOUT );
+    }
+}
+
+
+//
+static uint32_t find_packet(
+        const uint32_t start,
+        const uint8_t table )
+{
+    uint32_t idx = start;
+
+    while( (idx < packet_count) && (stream_data[ packets[ idx ] + 3 ] != table) )
+    {
+        idx += 1;
+    }
+
+    return idx;
+}
+
+
+// register bytes as they came in the response
+static void check_register(
+        const void * const dst,
+        const uint8_t * const packet,
+        const uint8_t offset,
+        const uint8_t size )
+{
+    const uint8_t * const registers = &packet[ sizeof(hobd_table_response_s) ];
+
+    const uint8_t first = packet[ offsetof(hobd_table_response_s, register_offset) ];
+
+    SIM_TEST_CHECK( memcmp( dst, &registers[ offset - first ], size ) == 0 );
+}
+
+
+// groups hold the last clean packet of their table
+static void check_decoded( void )
+{
+    const obd_data_s * const data = back_data;
+
+    SIM_TEST_CHECK( rx_count_table_16 == expected_table_16 );
+    SIM_TEST_CHECK( rx_count_table_209 == expected_table_209 );
+
+    if( last_table_16 != NULL )
+    {
+        const uint8_t * const packet = last_table_16;
+
+        check_register( &data->group_a.obd1.engine_rpm, packet, offsetof(hobd_table_16_s, engine_rpm), 2 );
+        check_register( &data->group_a.obd1.wheel_speed, packet, offsetof(hobd_table_16_s, wheel_speed), 1 );
+        check_register( &data->group_a.obd1.battery_volt, packet, offsetof(hobd_table_16_s, battery_volt), 1 );
+        check_register( &data->group_a.obd1.tps_volt, packet, offsetof(hobd_table_16_s, tps_volt), 1 );
+        check_register( &data->group_a.obd1.tps_percent, packet, offsetof(hobd_table_16_s, tps_percent), 1 );
+        check_register( &data->group_a.obd2.ect_volt, packet, offsetof(hobd_table_16_s, ect_volt), 1 );
+        check_register( &data->group_a.obd2.ect_temp, packet, offsetof(hobd_table_16_s, ect_temp), 1 );
+        check_register( &data->group_a.obd2.iat_volt, packet, offsetof(hobd_table_16_s, iat_volt), 1 );
+        check_register( &data->group_a.obd2.iat_temp, packet, offsetof(hobd_table_16_s, iat_temp), 1 );
+        check_register( &data->group_a.obd2.map_volt, packet, offsetof(hobd_table_16_s, map_volt), 1 );
+        check_register( &data->group_a.obd2.map_pressure, packet, offsetof(hobd_table_16_s, map_pressure), 1 );
+        check_register( &data->group_a.obd2.fuel_injectors, packet, offsetof(hobd_table_16_s, fuel_injectors), 2 );
+
+        SIM_TEST_CHECK( data->group_a.time.counter_1 == expected_table_16 );
+        SIM_TEST_CHECK( (data->ready_groups & OBD_GROUP_A_READY) != 0 );
+    }
+
+    if( last_table_209 != NULL )
+    {
+        const uint8_t * const registers = &last_table_209[ sizeof(hobd_table_response_s) ];
+
+        // obd3 fields are bit-fields
+        SIM_TEST_CHECK( data->group_b.obd3.gear == (registers[ offsetof(hobd_table_209_s, gear) ] & 0x0F) );
+        SIM_TEST_CHECK( data->group_b.obd3.engine_on == (registers[ offsetof(hobd_table_209_s, engine_on) ] & 0x01) );
+
+        SIM_TEST_CHECK( data->group_b.time.counter_2 == expected_table_209 );
+        SIM_TEST_CHECK( (data->ready_groups & OBD_GROUP_B_READY) != 0 );
+    }
+}
+
+
+//
+static void check_errors(
+        const expected_errors_s * const expected )
+{
+    SIM_TEST_CHECK( parser.framing_error_count == expected->framing_error_count );
+    SIM_TEST_CHECK( parser.checksum_error_count == expected->checksum_error_count );
+    SIM_TEST_CHECK( parser.timeout_count == expected->timeout_count );
+}
+
+
+//
+static void test_clean_replay( void )
+{
+    const expected_errors_s none = { 0, 0, 0 };
+
+    reset_gateway();
+
+    replay_clean( 0, packet_count );
+
+    SIM_TEST_CHECK( expected_table_16 != 0 );
+    SIM_TEST_CHECK( expected_table_209 != 0 );
+
+    check_decoded();
+    check_errors( &none );
+
+    // nothing left behind
+    SIM_TEST_CHECK( parser.state == PARSER_STATE_TYPE );
+    SIM_TEST_CHECK( ring_buffer_available( &rx_buffer ) == 0 );
+}
+
+
+// the packets before the corrupted one must decode, and the parser must
+// be back in sync for the ones after it
+static void test_corruption(
+        const uint8_t table,
+        const corrupt_kind_e kind,
+        const expected_errors_s * const expected )
+{
+    const uint32_t packet = find_packet( CLEAN_PACKETS, table );
+
+    reset_gateway();
+
+    SIM_TEST_CHECK( (packet + 1 + CLEAN_PACKETS) <= packet_count );
+
+    if( (packet + 1 + CLEAN_PACKETS) <= packet_count )
+    {
+        replay_clean( packet - CLEAN_PACKETS, CLEAN_PACKETS );
+
+        replay_corrupt( packet, kind );
+
+        replay_clean( packet + 1, CLEAN_PACKETS );
+
+        check_decoded();
+        check_errors( expected );
+
+        SIM_TEST_CHECK( parser.state == PARSER_STATE_TYPE );
+    }
+}
+
+
+// the parser may lose any packet near a flip, but a clean tail after
+// a stall always decodes
+static void test_random_flips( void )
+{
+    uint32_t idx = 0;
+    uint32_t flips = 0;
+    uint16_t errors = 0;
+    uint8_t * const copy = malloc( stream_size );
+
+    SIM_TEST_CHECK( copy != NULL );
+
+    if( copy != NULL )
+    {
+        reset_gateway();
+
+        srand( RANDOM_SEED );
+
+        memcpy( copy, stream_data, stream_size );
+
+        for( idx = 0; idx < packet_count; idx += 1 )
+        {
+            if( (rand() % RANDOM_FLIP_RATE) == 0 )
+            {
+                const uint8_t size = copy[ packets[ idx ] + 1 ];
+
+                copy[ packets[ idx ] + ((uint32_t) rand() % size) ] ^= (uint8_t) (1 << (rand() % 8));
+
+                flips += 1;
+            }
+        }
+
+        replay_bytes( copy, stream_size );
+        replay_idle( OBD_RX_BYTE_TIMEOUT );
+
+        errors = parser.framing_error_count + parser.checksum_error_count + parser.timeout_count;
+
+        SIM_TEST_CHECK( flips != 0 );
+        SIM_TEST_CHECK( errors != 0 );
+        SIM_TEST_CHECK( parser.state == PARSER_STATE_TYPE );
+
+        // only the tail is expected
+        rx_count_table_16 = 0;
+        rx_count_table_209 = 0;
+
+        replay_clean( 0, CLEAN_PACKETS );
+
+        check_decoded();
+
+        // no new errors
+        SIM_TEST_CHECK(
+                (parser.framing_error_count + parser.checksum_error_count + parser.timeout_count)
+                == errors );
+
+        free( copy );
+    }
+}
+
+
+// returns the packet size
+static uint8_t build_response(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t * const registers,
+        const uint8_t register_count,
+        uint8_t * const packet )
+{
+    hobd_table_response_s * const response = (hobd_table_response_s*) packet;
+
+    const uint8_t size = (uint8_t) (sizeof(*response) + register_count + 1);
+
+    response->header.type = HOBD_PACKET_TYPE_RESPONSE;
+    response->header.size = size;
+    response->header.subtype = HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP;
+    response->table = table;
+    response->register_offset = register_offset;
+
+    memcpy( &packet[ sizeof(*response) ], registers, register_count );
+
+    packet[ size - 1 ] = obd_checksum( packet, size - 1 );
+
+    return size;
+}
+
+
+// every register differs from the other seeds'
+static void fill_table_16(
+        const uint8_t seed,
+        hobd_table_16_s * const table )
+{
+    uint8_t idx = 0;
+    uint8_t * const registers = (uint8_t*) table;
+
+    for( idx = 0; idx < (uint8_t) sizeof(*table); idx += 1 )
+    {
+        registers[ idx ] = (uint8_t) (seed + idx);
+    }
+}
+
+
+// published frames hold the table 16 fields
+static void check_published_table_16(
+        const hobd_table_16_s * const table )
+{
+    SIM_TEST_CHECK( published_obd1.engine_rpm == table->engine_rpm );
+    SIM_TEST_CHECK( published_obd1.wheel_speed == table->wheel_speed );
+    SIM_TEST_CHECK( published_obd1.battery_volt == table->battery_volt );
+    SIM_TEST_CHECK( published_obd1.tps_volt == table->tps_volt );
+    SIM_TEST_CHECK( published_obd1.tps_percent == table->tps_percent );
+
+    SIM_TEST_CHECK( published_obd2.ect_volt == table->ect_volt );
+    SIM_TEST_CHECK( published_obd2.ect_temp == table->ect_temp );
+    SIM_TEST_CHECK( published_obd2.iat_volt == table->iat_volt );
+    SIM_TEST_CHECK( published_obd2.iat_temp == table->iat_temp );
+    SIM_TEST_CHECK( published_obd2.map_volt == table->map_volt );
+    SIM_TEST_CHECK( published_obd2.map_pressure == table->map_pressure );
+    SIM_TEST_CHECK( published_obd2.fuel_injectors == table->fuel_injectors );
+}
+
+
+// a passive gateway sees whatever another tester queries, a response
+// with only the RPM registers must not bring back older values for the
+// other fields after the double buffers swapped
+static void test_partial_response( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+    hobd_table_16_s first;
+    hobd_table_16_s second;
+    hobd_table_16_s expected;
+    uint8_t size = 0;
+
+    reset_gateway();
+
+    published_obd1_count = 0;
+    published_obd2_count = 0;
+
+    fill_table_16( 0x10, &first );
+    fill_table_16( 0x40, &second );
+
+    size = build_response( HOBD_TABLE_16, 0, (const uint8_t*) &first, (uint8_t) sizeof(first), packet );
+    replay_bytes( packet, size );
+    (void) obd_update();
+
+    SIM_TEST_CHECK( published_obd1_count == 1 );
+    check_published_table_16( &first );
+
+    size = build_response( HOBD_TABLE_16, 0, (const uint8_t*) &second, (uint8_t) sizeof(second), packet );
+    replay_bytes( packet, size );
+    (void) obd_update();
+
+    SIM_TEST_CHECK( published_obd1_count == 2 );
+    check_published_table_16( &second );
+
+    expected = second;
+    expected.engine_rpm = 0x7A7A;
+
+    size = build_response(
+            HOBD_TABLE_16,
+            (uint8_t) offsetof(hobd_table_16_s, engine_rpm),
+            (const uint8_t*) &expected.engine_rpm,
+            (uint8_t) sizeof(expected.engine_rpm),
+            packet );
+    replay_bytes( packet, size );
+    (void) obd_update();
+
+    SIM_TEST_CHECK( published_obd1_count == 3 );
+    SIM_TEST_CHECK( published_obd2_count == 3 );
+    check_published_table_16( &expected );
+
+    SIM_TEST_CHECK( parser.checksum_error_count == 0 );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+// uart_drv.c is not linked, obd_init selects the OBD UART
+uint8_t uart_selected = 0;
+
+
+//
+void diagnostics_set_warn(
+        const uint16_t warn )
+{
+}
+
+
+//
+uint16_t diagnostics_get_warn( void )
+{
+    return 0;
+}
+
+
+//
+void diagnostics_clear_warn(
+        const uint16_t warn )
+{
+}
+
+
+//
+void diagnostics_set_rx_stats(
+        const uint8_t rx_buffer_id,
+        const ring_buffer_stats_s * const rb_stats,
+        const uint16_t protocol_errors )
+{
+}
+
+
+//
+void profile_begin(
+        const uint8_t stage )
+{
+}
+
+
+//
+void profile_end(
+        const uint8_t stage )
+{
+}
+
+
+//
+uint8_t publish_set_policy(
+        const uint16_t id,
+        const publish_policy_s * const policy )
+{
+    return 0;
+}
+
+
+// keeps the OBD1/OBD2 payloads, nothing stays referenced
+uint8_t publish_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    if( (id == HOBD_CAN_ID_OBD1) && (dlc == (uint8_t) sizeof(published_obd1)) )
+    {
+        memcpy( &published_obd1, data, dlc );
+        published_obd1_count += 1;
+    }
+    else if( (id == HOBD_CAN_ID_OBD2) && (dlc == (uint8_t) sizeof(published_obd2)) )
+    {
+        memcpy( &published_obd2, data, dlc );
+        published_obd2_count += 1;
+    }
+
+    return 0;
+}
+
+
+//
+uint8_t publish_is_due(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    return 1;
+}
+
+
+//
+void publish_suppress(
+        const uint8_t dlc )
+{
+}
+
+
+//
+void trace_parsed(
+        const uint8_t group,
+        const uint32_t * const rx_time_us )
+{
+}
+
+
+//
+void trace_publish_begin(
+        const uint8_t group )
+{
+}
+
+
+//
+void trace_publish_end(
+        const uint8_t group )
+{
+}
+
+
+//
+uint32_t time_get_ms( void )
+{
+    return loop_time;
+}
+
+
+//
+uint32_t time_get_us( void )
+{
+    return loop_time * 1000UL;
+}
+
+
+//
+uint32_t time_get_delta(
+        const uint32_t * const value,
+        const uint32_t * const now )
+{
+    return (*now) - (*value);
+}
+
+
+//
+uint32_t time_sync_get_time(
+        const uint32_t * const local_time )
+{
+    return (*local_time);
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+
+    // the subtype byte after a bad type or size looks like a query type
+    // byte, and table 209 like its size, the stall drops it
+    const expected_errors_s bad_header = { 1, 0, 1 };
+    const expected_errors_s bad_checksum = { 0, 1, 0 };
+    const expected_errors_s stalled = { 0, 0, 1 };
+    const expected_errors_s none = { 0, 0, 0 };
+
+    if( argc != 2 )
+    {
+        fprintf( stderr, "usage: %s <obd file>\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else if( (load_stream( argv[ 1 ] ) != 0) || (split_packets() != 0) )
+    {
+        fprintf( stderr, "%s: failed to read '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+        ret = EXIT_FAILURE;
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        test_clean_replay();
+
+        test_corruption( HOBD_TABLE_209, CORRUPT_TYPE, &bad_header );
+        test_corruption( HOBD_TABLE_209, CORRUPT_SIZE, &bad_header );
+        test_corruption( HOBD_TABLE_209, CORRUPT_CHECKSUM, &bad_checksum );
+        test_corruption( HOBD_TABLE_16, CORRUPT_CHECKSUM, &bad_checksum );
+        test_corruption( HOBD_TABLE_209, CORRUPT_STALL, &stalled );
+        test_corruption( HOBD_TABLE_16, CORRUPT_STALL, &stalled );
+        test_corruption( HOBD_TABLE_16, CORRUPT_GAP, &none );
+        test_corruption( HOBD_TABLE_209, CORRUPT_GAP, &none );
+
+        test_random_flips();
+
+        test_partial_response();
+
+        ret = sim_test_result( "obd-parser-test" );
+    }
+
+    free( packets );
+    free( stream_data );
+
+    return ret;
+}
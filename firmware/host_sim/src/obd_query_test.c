@@ -0,0 +1,733 @@
+/**
+ * @file obd_query_test.c
+ * @brief Host test of the OBD gateway query scheduler.
+ *
+ * Built with OBD_QUERY_ENABLE set. obd.c is included so the merged
+ * register ranges and the scheduler state can be checked directly, the
+ * queries are read back through the UART data register empty interrupt
+ * and the ECU responses are fed through the rx interrupt.
+ *
+ * The merged ranges must cover the table 16/209 field maps in
+ * QUERY_SCHEDULE order. After the wake-up and init command, the next
+ * query must be sent by the response that completes a valid checksum,
+ * before query_update runs, with table 209 taking priority once its
+ * interval has elapsed. A bad checksum or a response for another range
+ * must not, and a missing response must time out, be queried again and
+ * after OBD_QUERY_REINIT_TIMEOUTS go back to the wake-up and init.
+ *
+ * Usage: obd-query-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sim_test.h"
+
+#include "obd.c"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// wake-up and init command packets
+#define WAKE_UP_SIZE (sizeof(hobd_packet_header_s) + 1)
+#define INIT_SIZE (sizeof(hobd_init_command_s) + 1)
+
+
+//
+#define QUERY_SIZE (sizeof(hobd_table_query_s) + 1)
+
+
+// main loop pass
+// ms
+#define PASS_TIME (1UL)
+
+
+// first main loop time, past the table 209 interval
+// ms
+#define START_TIME (1000UL)
+
+
+//
+#if (OBD_QUERY_ENABLE == 0)
+#error "obd-query-test needs OBD_QUERY_ENABLE"
+#endif
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// main loop time
+// ms
+static uint32_t loop_time = 0;
+
+
+// last packet the UART sent, and its size
+static uint8_t tx_packet_data[ TX_BUFFER_SIZE ];
+static uint8_t tx_packet_len = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t drain_tx( void );
+
+
+//
+static void feed_bytes(
+        const uint8_t * const data,
+        const uint8_t len );
+
+
+//
+static uint8_t build_response(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t register_count,
+        uint8_t * const packet );
+
+
+//
+static uint8_t build_init_response(
+        uint8_t * const packet );
+
+
+//
+static void check_query(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t register_count );
+
+
+//
+static void check_init_sent( void );
+
+
+//
+static void answer_query( void );
+
+
+//
+static void start_queries( void );
+
+
+//
+static void test_query_ranges( void );
+
+
+//
+static void test_init( void );
+
+
+//
+static void test_pipelined_response( void );
+
+
+//
+static void test_priority( void );
+
+
+//
+static void test_bad_response( void );
+
+
+//
+static void test_response_timeout( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// runs the data register empty interrupt until the packet is out
+// returns the number of bytes sent
+static uint8_t drain_tx( void )
+{
+    tx_packet_len = 0;
+
+    while( (obd_uart_tx_busy()) && (tx_packet_len < TX_BUFFER_SIZE) )
+    {
+        UART_UDRE_INTERRUPT();
+
+        tx_packet_data[ tx_packet_len ] = UART_DATA;
+        tx_packet_len += 1;
+    }
+
+    return tx_packet_len;
+}
+
+
+// bytes go to the rx buffer only, process_buffer parses them
+static void feed_bytes(
+        const uint8_t * const data,
+        const uint8_t len )
+{
+    uint8_t idx = 0;
+
+    for( idx = 0; idx < len; idx += 1 )
+    {
+        UART_UCSRA = 0;
+        UART_DATA = data[ idx ];
+        UART_RX_INTERRUPT();
+    }
+}
+
+
+// registers hold their offset
+static uint8_t build_response(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t register_count,
+        uint8_t * const packet )
+{
+    uint8_t idx = 0;
+
+    hobd_table_response_s * const response = (hobd_table_response_s*) packet;
+
+    const uint8_t size = (uint8_t) (sizeof(*response) + register_count + 1);
+
+    response->header.type = HOBD_PACKET_TYPE_RESPONSE;
+    response->header.size = size;
+    response->header.subtype = HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP;
+    response->table = table;
+    response->register_offset = register_offset;
+
+    for( idx = 0; idx < register_count; idx += 1 )
+    {
+        packet[ sizeof(*response) + idx ] = (uint8_t) (register_offset + idx);
+    }
+
+    packet[ size - 1 ] = obd_checksum( packet, size - 1 );
+
+    return size;
+}
+
+
+//
+static uint8_t build_init_response(
+        uint8_t * const packet )
+{
+    hobd_packet_header_s * const header = (hobd_packet_header_s*) packet;
+
+    const uint8_t size = (uint8_t) (sizeof(*header) + 1);
+
+    header->type = HOBD_PACKET_TYPE_RESPONSE;
+    header->size = size;
+    header->subtype = HOBD_PACKET_SUBTYPE_INIT_COMMAND;
+
+    packet[ size - 1 ] = obd_checksum( packet, size - 1 );
+
+    return size;
+}
+
+
+// the UART sent this table query, with a valid checksum
+static void check_query(
+        const uint8_t table,
+        const uint8_t register_offset,
+        const uint8_t register_count )
+{
+    const hobd_table_query_s * const query =
+            (const hobd_table_query_s*) tx_packet_data;
+
+    SIM_TEST_CHECK( tx_packet_len == QUERY_SIZE );
+    SIM_TEST_CHECK( query->header.type == HOBD_PACKET_TYPE_QUERY );
+    SIM_TEST_CHECK( query->header.size == QUERY_SIZE );
+    SIM_TEST_CHECK( query->header.subtype == HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP );
+    SIM_TEST_CHECK( query->table == table );
+    SIM_TEST_CHECK( query->register_offset == register_offset );
+    SIM_TEST_CHECK( query->register_cnt == register_count );
+    SIM_TEST_CHECK( obd_checksum( tx_packet_data, tx_packet_len ) == 0 );
+}
+
+
+// the UART sent the wake-up and init command packets
+static void check_init_sent( void )
+{
+    const hobd_packet_header_s * const wake_up =
+            (const hobd_packet_header_s*) &tx_packet_data[ 0 ];
+
+    const hobd_init_command_s * const init =
+            (const hobd_init_command_s*) &tx_packet_data[ WAKE_UP_SIZE ];
+
+    SIM_TEST_CHECK( tx_packet_len == (WAKE_UP_SIZE + INIT_SIZE) );
+    SIM_TEST_CHECK( wake_up->type == HOBD_PACKET_TYPE_WAKE_UP );
+    SIM_TEST_CHECK( wake_up->size == WAKE_UP_SIZE );
+    SIM_TEST_CHECK( wake_up->subtype == HOBD_PACKET_SUBTYPE_WAKE_UP );
+    SIM_TEST_CHECK( obd_checksum( &tx_packet_data[ 0 ], WAKE_UP_SIZE ) == 0 );
+    SIM_TEST_CHECK( init->header.type == HOBD_PACKET_TYPE_QUERY );
+    SIM_TEST_CHECK( init->header.size == INIT_SIZE );
+    SIM_TEST_CHECK( init->header.subtype == HOBD_PACKET_SUBTYPE_INIT_COMMAND );
+    SIM_TEST_CHECK( init->data == HOBD_INIT_COMMAND_DATA );
+    SIM_TEST_CHECK( obd_checksum( &tx_packet_data[ WAKE_UP_SIZE ], INIT_SIZE ) == 0 );
+}
+
+
+// the ECU answers the last query one pass later
+static void answer_query( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+
+    const hobd_table_query_s * const query =
+            (const hobd_table_query_s*) tx_packet_data;
+
+    const uint8_t size = build_response(
+            query->table,
+            query->register_offset,
+            query->register_cnt,
+            packet );
+
+    loop_time += PASS_TIME;
+    feed_bytes( packet, size );
+    (void) obd_update();
+    (void) drain_tx();
+}
+
+
+// through the wake-up and init command to the first table query,
+// obd_init leaves the rx counters
+static void start_queries( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+
+    (void) obd_init();
+
+    rx_count_table_16 = 0;
+    rx_count_table_209 = 0;
+
+    loop_time = START_TIME;
+    (void) obd_update();
+    (void) drain_tx();
+    check_init_sent();
+
+    loop_time += PASS_TIME;
+    feed_bytes( packet, build_init_response( packet ) );
+    (void) obd_update();
+    (void) drain_tx();
+}
+
+
+// fewest ranges covering the field maps, queries close the gaps
+static void test_query_ranges( void )
+{
+    uint8_t idx = 0;
+    uint8_t range = 0;
+
+    (void) obd_init();
+
+    // 209: gear and engine_on, the reserved registers cost less than a
+    // second query; 16: engine_rpm through fuel_injectors
+    SIM_TEST_CHECK( query_range_count == 2 );
+
+    SIM_TEST_CHECK( query_ranges[ 0 ].table == HOBD_TABLE_209 );
+    SIM_TEST_CHECK( query_ranges[ 0 ].register_offset == offsetof(hobd_table_209_s, gear) );
+    SIM_TEST_CHECK( query_ranges[ 0 ].register_cnt == sizeof(hobd_table_209_s) );
+    SIM_TEST_CHECK( query_ranges[ 0 ].interval == OBD_QUERY_INTERVAL_TABLE_209 );
+
+    SIM_TEST_CHECK( query_ranges[ 1 ].table == HOBD_TABLE_16 );
+    SIM_TEST_CHECK( query_ranges[ 1 ].register_offset == offsetof(hobd_table_16_s, engine_rpm) );
+    SIM_TEST_CHECK( query_ranges[ 1 ].register_cnt == sizeof(hobd_table_16_s) );
+    SIM_TEST_CHECK( query_ranges[ 1 ].interval == OBD_QUERY_INTERVAL_TABLE_16 );
+
+    // every field is in exactly one range of its table
+    for( idx = 0; idx < REGISTER_FIELD_COUNT; idx += 1 )
+    {
+        const register_field_s * const field = &REGISTER_FIELDS[ idx ];
+        uint8_t covered = 0;
+
+        for( range = 0; range < query_range_count; range += 1 )
+        {
+            if(
+                    (query_ranges[ range ].table == field->table)
+                    && (field->offset >= query_ranges[ range ].register_offset)
+                    && ((field->offset + field->size)
+                        <= (query_ranges[ range ].register_offset + query_ranges[ range ].register_cnt)) )
+            {
+                covered += 1;
+            }
+        }
+
+        SIM_TEST_CHECK( covered == 1 );
+    }
+
+    // a response holds every range
+    for( range = 0; range < query_range_count; range += 1 )
+    {
+        SIM_TEST_CHECK( (sizeof(hobd_table_response_s) + query_ranges[ range ].register_cnt + 1) <= HOBD_PACKET_SIZE_MAX );
+    }
+}
+
+
+//
+static void test_init( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+
+    (void) obd_init();
+
+    loop_time = START_TIME;
+    (void) obd_update();
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_INIT );
+    (void) drain_tx();
+    check_init_sent();
+
+    // no response, wake-up and init again
+    loop_time += OBD_QUERY_RESPONSE_TIMEOUT - PASS_TIME;
+    (void) obd_update();
+    SIM_TEST_CHECK( drain_tx() == 0 );
+
+    loop_time += PASS_TIME;
+    (void) obd_update();
+    (void) drain_tx();
+    check_init_sent();
+    SIM_TEST_CHECK( scheduler.response_timeout_count == 1 );
+
+    // init response, table 209 is due first
+    loop_time += PASS_TIME;
+    feed_bytes( packet, build_init_response( packet ) );
+    (void) obd_update();
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_RESPONSE );
+    (void) drain_tx();
+    check_query( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s) );
+}
+
+
+// the checksum byte sends the next query from process_buffer
+static void test_pipelined_response( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+    uint8_t size = 0;
+    uint32_t now = 0;
+
+    start_queries();
+    check_query( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s) );
+
+    size = build_response( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s), packet );
+
+    now = loop_time + PASS_TIME;
+
+    // all but the checksum
+    feed_bytes( packet, size - 1 );
+    (void) process_buffer( &now );
+    SIM_TEST_CHECK( obd_uart_tx_busy() == 0 );
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_RESPONSE );
+
+    feed_bytes( &packet[ size - 1 ], 1 );
+    (void) process_buffer( &now );
+    SIM_TEST_CHECK( obd_uart_tx_busy() != 0 );
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_RESPONSE );
+    SIM_TEST_CHECK( scheduler.tx_time == now );
+
+    (void) drain_tx();
+    check_query( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s) );
+
+    // the response was still decoded
+    SIM_TEST_CHECK( rx_count_table_209 == 1 );
+}
+
+
+// table 16 back to back, table 209 first once its interval elapsed
+static void test_priority( void )
+{
+    uint32_t last_209 = 0;
+    uint16_t count_209 = 0;
+    uint16_t count_16 = 0;
+    uint16_t idx = 0;
+
+    start_queries();
+    check_query( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s) );
+    last_209 = loop_time;
+    count_209 = 1;
+
+    for( idx = 0; idx < 2000; idx += 1 )
+    {
+        const hobd_table_query_s * const query =
+                (const hobd_table_query_s*) tx_packet_data;
+
+        answer_query();
+
+        SIM_TEST_CHECK( tx_packet_len == QUERY_SIZE );
+
+        if( query->table == HOBD_TABLE_209 )
+        {
+            // the query goes out with the response that made it due
+            SIM_TEST_CHECK( (loop_time - last_209) == OBD_QUERY_INTERVAL_TABLE_209 );
+
+            last_209 = loop_time;
+            count_209 += 1;
+        }
+        else
+        {
+            SIM_TEST_CHECK( (loop_time - last_209) < OBD_QUERY_INTERVAL_TABLE_209 );
+
+            count_16 += 1;
+        }
+    }
+
+    SIM_TEST_CHECK( count_209 == (uint16_t) (1 + (2000 / OBD_QUERY_INTERVAL_TABLE_209)) );
+    SIM_TEST_CHECK( (count_209 + count_16) == 2001 );
+    SIM_TEST_CHECK( scheduler.response_timeout_count == 0 );
+    SIM_TEST_CHECK( parser.checksum_error_count == 0 );
+}
+
+
+// neither a bad checksum nor another range's response send a query
+static void test_bad_response( void )
+{
+    uint8_t packet[ HOBD_PACKET_SIZE_MAX ];
+    uint8_t size = 0;
+
+    start_queries();
+    check_query( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s) );
+
+    size = build_response( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s), packet );
+    packet[ size - 1 ] ^= 0x01;
+
+    loop_time += PASS_TIME;
+    feed_bytes( packet, size );
+    (void) obd_update();
+    SIM_TEST_CHECK( drain_tx() == 0 );
+    SIM_TEST_CHECK( parser.checksum_error_count == 1 );
+
+    size = build_response( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s), packet );
+
+    loop_time += PASS_TIME;
+    feed_bytes( packet, size );
+    (void) obd_update();
+    SIM_TEST_CHECK( drain_tx() == 0 );
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_RESPONSE );
+
+    // times out from the query, table 16 is next
+    loop_time = scheduler.tx_time + OBD_QUERY_RESPONSE_TIMEOUT;
+    (void) obd_update();
+    (void) drain_tx();
+    check_query( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s) );
+    SIM_TEST_CHECK( scheduler.response_timeout_count == 1 );
+}
+
+
+// queried again on a timeout, wake-up and init after a run of them
+static void test_response_timeout( void )
+{
+    uint8_t idx = 0;
+
+    start_queries();
+    check_query( HOBD_TABLE_209, 0, sizeof(hobd_table_209_s) );
+    answer_query();
+    check_query( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s) );
+
+    // one timeout, then a response clears the run
+    loop_time += OBD_QUERY_RESPONSE_TIMEOUT;
+    (void) obd_update();
+    (void) drain_tx();
+    check_query( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s) );
+    SIM_TEST_CHECK( scheduler.timeout_count == 1 );
+
+    answer_query();
+    SIM_TEST_CHECK( scheduler.timeout_count == 0 );
+    check_query( HOBD_TABLE_16, 0, sizeof(hobd_table_16_s) );
+
+    for( idx = 1; idx < OBD_QUERY_REINIT_TIMEOUTS; idx += 1 )
+    {
+        loop_time += OBD_QUERY_RESPONSE_TIMEOUT - PASS_TIME;
+        (void) obd_update();
+        SIM_TEST_CHECK( drain_tx() == 0 );
+
+        loop_time += PASS_TIME;
+        (void) obd_update();
+        (void) drain_tx();
+        SIM_TEST_CHECK( scheduler.timeout_count == idx );
+        SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_RESPONSE );
+    }
+
+    // the last of the run goes back to the wake-up and init
+    loop_time += OBD_QUERY_RESPONSE_TIMEOUT;
+    (void) obd_update();
+    (void) drain_tx();
+    check_init_sent();
+    SIM_TEST_CHECK( scheduler.state == QUERY_STATE_WAIT_INIT );
+    SIM_TEST_CHECK( scheduler.timeout_count == 0 );
+    SIM_TEST_CHECK( scheduler.response_timeout_count == (1 + OBD_QUERY_REINIT_TIMEOUTS) );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+// uart_drv.c is not linked, obd_init selects the OBD UART
+uint8_t uart_selected = 0;
+
+
+//
+void diagnostics_set_warn(
+        const uint16_t warn )
+{
+}
+
+
+//
+uint16_t diagnostics_get_warn( void )
+{
+    return 0;
+}
+
+
+//
+void diagnostics_clear_warn(
+        const uint16_t warn )
+{
+}
+
+
+//
+void diagnostics_set_rx_stats(
+        const uint8_t rx_buffer_id,
+        const ring_buffer_stats_s * const rb_stats,
+        const uint16_t protocol_errors )
+{
+}
+
+
+//
+void profile_begin(
+        const uint8_t stage )
+{
+}
+
+
+//
+void profile_end(
+        const uint8_t stage )
+{
+}
+
+
+//
+uint8_t publish_set_policy(
+        const uint16_t id,
+        const publish_policy_s * const policy )
+{
+    return 0;
+}
+
+
+//
+uint8_t publish_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    return 0;
+}
+
+
+//
+uint8_t publish_is_due(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    return 1;
+}
+
+
+//
+void publish_suppress(
+        const uint8_t dlc )
+{
+}
+
+
+//
+void trace_parsed(
+        const uint8_t group,
+        const uint32_t * const rx_time_us )
+{
+}
+
+
+//
+void trace_publish_begin(
+        const uint8_t group )
+{
+}
+
+
+//
+void trace_publish_end(
+        const uint8_t group )
+{
+}
+
+
+//
+uint32_t time_get_ms( void )
+{
+    return loop_time;
+}
+
+
+//
+uint32_t time_get_us( void )
+{
+    return loop_time * 1000UL;
+}
+
+
+//
+uint32_t time_get_delta(
+        const uint32_t * const value,
+        const uint32_t * const now )
+{
+    return (*now) - (*value);
+}
+
+
+//
+uint32_t time_sync_get_time(
+        const uint32_t * const local_time )
+{
+    return (*local_time);
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    test_query_ranges();
+    test_init();
+    test_pipelined_response();
+    test_priority();
+    test_bad_response();
+    test_response_timeout();
+
+    return sim_test_result( "obd-query-test" );
+}
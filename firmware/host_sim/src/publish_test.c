@@ -0,0 +1,580 @@
+/**
+ * @file publish_test.c
+ * @brief Host test of the gateway publish policies.
+ *
+ * The IMU gateway publish.c runs against a stubbed canbus.c and a test
+ * driven ms clock. Frames go through publish_send_ref and each check is
+ * whether they reached canbus_send_ref.
+ *
+ * Covers ON_CHANGE against the last published frame, with and without
+ * a deadband, each deadband signal type including the signed and
+ * unsigned wrap, the min/max interval interplay, a dropped frame not
+ * counting as published, command validation and the stats frame load.
+ *
+ * Usage: publish-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "time.h"
+#include "canbus.h"
+#include "publish.h"
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// policy IDs, PUBLISH_POLICY_COUNT of them can have a policy
+#define TEST_ID_A (0x101)
+#define TEST_ID_B (0x102)
+#define TEST_ID_C (0x103)
+
+
+// ID without a policy
+#define TEST_ID_FREE (0x1F0)
+
+
+// nominal 8 byte frame size without stuffing bits, see publish.c
+#define FRAME_BITS_8 (47UL + 64UL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// test clock
+// ms
+static uint32_t now_ms = 0;
+
+
+// canbus_send_ref fails while set
+static uint8_t tx_fail = 0;
+
+
+// frames given to canbus_send_ref
+static uint16_t tx_count = 0;
+
+
+// last stats frame given to canbus_send
+static hobd_publish_stats_s stats_frame;
+static uint16_t stats_count = 0;
+static uint16_t stats_id = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t send_frame(
+        const uint16_t id,
+        const uint8_t * const data );
+
+
+//
+static uint8_t send_signal(
+        const uint16_t id,
+        const uint8_t offset,
+        const uint32_t value );
+
+
+//
+static void set_policy(
+        const uint16_t id,
+        const uint8_t mode,
+        const uint8_t type,
+        const uint16_t deadband,
+        const uint16_t min_interval,
+        const uint16_t max_interval );
+
+
+//
+static void test_on_change_frame( void );
+
+
+//
+static void test_deadband_drift( void );
+
+
+//
+static void test_deadband_types( void );
+
+
+//
+static void test_intervals( void );
+
+
+//
+static void test_dropped_frame( void );
+
+
+//
+static void test_commands( void );
+
+
+//
+static void test_stats( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// returns non-zero if the frame reached the CAN queue
+static uint8_t send_frame(
+        const uint16_t id,
+        const uint8_t * const data )
+{
+    const uint16_t count = tx_count;
+
+    (void) publish_send_ref( id, CANBUS_DATA_MAX, data, NULL );
+
+    return (tx_count != count) ? 1 : 0;
+}
+
+
+// little endian value at offset, the other bytes are constant
+static uint8_t send_signal(
+        const uint16_t id,
+        const uint8_t offset,
+        const uint32_t value )
+{
+    uint8_t data[ CANBUS_DATA_MAX ];
+    uint8_t idx = 0;
+
+    memset( data, 0xA5, sizeof(data) );
+
+    for( idx = 0; (idx < 4) && ((offset + idx) < CANBUS_DATA_MAX); idx += 1 )
+    {
+        data[ offset + idx ] = (uint8_t) (value >> (8 * idx));
+    }
+
+    return send_frame( id, data );
+}
+
+
+//
+static void set_policy(
+        const uint16_t id,
+        const uint8_t mode,
+        const uint8_t type,
+        const uint16_t deadband,
+        const uint16_t min_interval,
+        const uint16_t max_interval )
+{
+    publish_policy_s policy;
+
+    memset( &policy, 0, sizeof(policy) );
+
+    policy.mode = mode;
+    policy.deadband_type = type;
+    policy.deadband_offset = 2;
+    policy.deadband = deadband;
+    policy.min_interval = min_interval;
+    policy.max_interval = max_interval;
+
+    SIM_TEST_CHECK( publish_set_policy( id, &policy ) == 0 );
+}
+
+
+// whole frame compare, against the last published frame
+static void test_on_change_frame( void )
+{
+    uint8_t data[ CANBUS_DATA_MAX ];
+
+    publish_init();
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_NONE, 0, 0, 0 );
+
+    memset( data, 0, sizeof(data) );
+
+    // first frame is always published
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    // any byte counts
+    data[ 7 ] = 1;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    // swapped bytes are a change
+    data[ 0 ] = 1;
+    data[ 7 ] = 0;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+
+    // the deadband compare needs a non-zero deadband
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_U8, 0, 0, 0 );
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    data[ 5 ] = 1;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    // no policy, always published
+    SIM_TEST_CHECK( send_frame( TEST_ID_FREE, data ) == 1 );
+    SIM_TEST_CHECK( send_frame( TEST_ID_FREE, data ) == 1 );
+}
+
+
+// slow drift crosses the deadband of the last published value
+static void test_deadband_drift( void )
+{
+    publish_init();
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_U16, 10, 0, 0 );
+
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1000 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1004 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1008 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1012 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1003 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 1002 ) == 1 );
+
+    // bytes outside the signal are ignored
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x00FF03EA ) == 0 );
+}
+
+
+// a step of deadband publishes, one less does not
+static void test_deadband_types( void )
+{
+    publish_init();
+
+    // U8
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_U8, 5, 0, 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 250 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 254 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 255 ) == 1 );
+    // unsigned, 255 to 0 is a step of 255
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0 ) == 1 );
+
+    // S8, -2 then around zero
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_S8, 5, 0, 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0xFE ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x02 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x03 ) == 1 );
+    // signed, 127 to -128 is a step of 255, not 1
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x7F ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x80 ) == 1 );
+
+    // U16
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_U16, 300, 0, 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 65280 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 64981 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 64980 ) == 1 );
+    // unsigned, 65535 to 0 is a step of 65535
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 65535 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0 ) == 1 );
+
+    // S16, -100 then around zero
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_S16, 300, 0, 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0xFF9C ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 199 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 200 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x7FFF ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x8000 ) == 1 );
+
+    // S32, -500 then around zero
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_S32, 1000, 0, 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, (uint32_t) -500L ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 499 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 500 ) == 1 );
+    // the difference does not fit an int32_t
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x7FFFFFFFUL ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x80000000UL ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x800003E7UL ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0x7FFFFFFFUL ) == 1 );
+}
+
+
+//
+static void test_intervals( void )
+{
+    uint8_t data[ CANBUS_DATA_MAX ];
+
+    memset( data, 0, sizeof(data) );
+
+    publish_init();
+
+    // min interval holds back a change, max interval refreshes a value
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_NONE, 0, 100, 500 );
+
+    now_ms = 1000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+
+    data[ 0 ] = 1;
+    now_ms = 1099;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    now_ms = 1100;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+
+    now_ms = 1599;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    now_ms = 1600;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    now_ms = 1601;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    // ALWAYS is rate limited too
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ALWAYS, HOBD_PUBLISH_DEADBAND_NONE, 0, 100, 0 );
+    now_ms = 2000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    now_ms = 2050;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    now_ms = 2100;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+
+    // a zero max interval never refreshes
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_NONE, 0, 0, 0 );
+    now_ms = 3000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    now_ms = 60000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    // DISABLED ignores the max interval
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_DISABLED, HOBD_PUBLISH_DEADBAND_NONE, 0, 0, 100 );
+    now_ms = 70000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    now_ms = 80000;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    SIM_TEST_CHECK( publish_is_due( TEST_ID_A, CANBUS_DATA_MAX, data ) == 0 );
+
+    // the clock wraps
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_NONE, 0, 100, 500 );
+    now_ms = 0xFFFFFFF0UL;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+    data[ 0 ] = 2;
+    now_ms = 0x00000050UL;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+    now_ms = 0x00000054UL;
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 1 );
+
+    now_ms = 0;
+}
+
+
+// a frame the queue dropped is not the last published one
+static void test_dropped_frame( void )
+{
+    publish_init();
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_U8, 10, 0, 0 );
+
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 0 ) == 1 );
+
+    tx_fail = 1;
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 20 ) == 1 );
+    tx_fail = 0;
+
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 20 ) == 1 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 2, 25 ) == 0 );
+}
+
+
+//
+static void test_commands( void )
+{
+    hobd_command_s command;
+    uint8_t data[ CANBUS_DATA_MAX ];
+
+    memset( data, 0, sizeof(data) );
+
+    publish_init();
+
+    memset( &command, 0, sizeof(command) );
+    command.id = HOBD_COMMAND_ID_PUBLISH_MODE;
+    command.data_0 = TEST_ID_A;
+
+    // unknown mode
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( 3, 0, HOBD_PUBLISH_DEADBAND_NONE, 0 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_DATA );
+
+    // unknown deadband type
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( HOBD_PUBLISH_MODE_ON_CHANGE, 1, 6, 0 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_DATA );
+
+    // signal past the end of the frame
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( HOBD_PUBLISH_MODE_ON_CHANGE, 1, HOBD_PUBLISH_DEADBAND_S16, 7 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_DATA );
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( HOBD_PUBLISH_MODE_ON_CHANGE, 1, HOBD_PUBLISH_DEADBAND_S32, 5 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_DATA );
+
+    // rejected commands claim no entry
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( HOBD_PUBLISH_MODE_ON_CHANGE, 1, HOBD_PUBLISH_DEADBAND_S32, 4 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_OK );
+
+    // max below min
+    command.id = HOBD_COMMAND_ID_PUBLISH_INTERVAL;
+    command.data_1 = HOBD_PUBLISH_INTERVAL_DATA( 200, 100 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_DATA );
+    command.data_1 = HOBD_PUBLISH_INTERVAL_DATA( 200, 0 );
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_OK );
+
+    // the interval command kept the mode
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 4, 0 ) == 1 );
+    now_ms = 500;
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 4, 0 ) == 0 );
+    SIM_TEST_CHECK( send_signal( TEST_ID_A, 4, 1 ) == 1 );
+    now_ms = 0;
+
+    command.id = HOBD_COMMAND_ID_TRACE;
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_INVALID_COMMAND );
+
+    // fill the IMU gateway's two entries, an existing ID keeps its entry
+    command.id = HOBD_COMMAND_ID_PUBLISH_MODE;
+    command.data_1 = HOBD_PUBLISH_MODE_DATA( HOBD_PUBLISH_MODE_DISABLED, 0, HOBD_PUBLISH_DEADBAND_NONE, 0 );
+
+    command.data_0 = TEST_ID_B;
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_OK );
+
+    command.data_0 = TEST_ID_C;
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_NO_RESOURCES );
+    SIM_TEST_CHECK( send_frame( TEST_ID_C, data ) == 1 );
+
+    command.data_0 = TEST_ID_A;
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_OK );
+    SIM_TEST_CHECK( send_frame( TEST_ID_A, data ) == 0 );
+
+    command.data_0 = CANBUS_ID_INVALID;
+    SIM_TEST_CHECK( publish_handle_command( &command ) == HOBD_RESPONSE_STATUS_NO_RESOURCES );
+}
+
+
+//
+static void test_stats( void )
+{
+    uint8_t data[ CANBUS_DATA_MAX ];
+    uint16_t idx = 0;
+
+    memset( data, 0, sizeof(data) );
+
+    now_ms = 10000;
+    publish_init();
+    set_policy( TEST_ID_A, HOBD_PUBLISH_MODE_ON_CHANGE, HOBD_PUBLISH_DEADBAND_NONE, 0, 0, 0 );
+
+    // 100 sent, 50 held back
+    for( idx = 0; idx < 150; idx += 1 )
+    {
+        data[ 0 ] = (uint8_t) ((idx < 100) ? idx : 99);
+        (void) send_frame( TEST_ID_A, data );
+    }
+
+    now_ms = 10999;
+    SIM_TEST_CHECK( publish_update() == 0 );
+    SIM_TEST_CHECK( stats_count == 0 );
+
+    now_ms = 11000;
+    SIM_TEST_CHECK( publish_update() == 0 );
+    SIM_TEST_CHECK( stats_count == 1 );
+    SIM_TEST_CHECK( stats_id == (uint16_t) (HOBD_CAN_ID_PUBLISH_STATS_BASE + NODE_ID) );
+    SIM_TEST_CHECK( stats_frame.sent_count == 100 );
+    SIM_TEST_CHECK( stats_frame.suppressed_count == 50 );
+
+    // 111 bit frames over 1 s at CAN_BAUDRATE kbit/s, in 0.01 percent
+    SIM_TEST_CHECK( stats_frame.sent_load ==
+            (uint16_t) ((100UL * FRAME_BITS_8 * 10000UL) / (CAN_BAUDRATE * 1000UL)) );
+    SIM_TEST_CHECK( stats_frame.saved_load ==
+            (uint16_t) ((50UL * FRAME_BITS_8 * 10000UL) / (CAN_BAUDRATE * 1000UL)) );
+    SIM_TEST_CHECK( stats_frame.sent_load == 222 );
+
+    // counters start over, a late update spreads over the longer interval
+    publish_suppress( CANBUS_DATA_MAX );
+    now_ms = 13000;
+    SIM_TEST_CHECK( publish_update() == 0 );
+    SIM_TEST_CHECK( stats_count == 2 );
+    SIM_TEST_CHECK( stats_frame.sent_count == 0 );
+    SIM_TEST_CHECK( stats_frame.suppressed_count == 1 );
+    SIM_TEST_CHECK( stats_frame.sent_load == 0 );
+    SIM_TEST_CHECK( stats_frame.saved_load ==
+            (uint16_t) ((FRAME_BITS_8 * 10000UL) / (CAN_BAUDRATE * 2000UL)) );
+
+    now_ms = 0;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+uint8_t canbus_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    tx_count += 1;
+
+    return tx_fail;
+}
+
+
+// keeps the stats frame
+uint8_t canbus_send(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    if( dlc == (uint8_t) sizeof(stats_frame) )
+    {
+        memcpy( &stats_frame, data, dlc );
+        stats_id = id;
+        stats_count += 1;
+    }
+
+    return 0;
+}
+
+
+//
+uint32_t time_get_ms( void )
+{
+    return now_ms;
+}
+
+
+//
+uint32_t time_get_delta(
+        const uint32_t * const value,
+        const uint32_t * const now )
+{
+    return (*now) - (*value);
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    test_on_change_frame();
+    test_deadband_drift();
+    test_deadband_types();
+    test_intervals();
+    test_dropped_frame();
+    test_commands();
+    test_stats();
+
+    return sim_test_result( "publish-test" );
+}
@@ -0,0 +1,687 @@
+/**
+ * @file ring_buffer_test.c
+ * @brief Host test and drain benchmark of the gateway ring buffer.
+ *
+ * Checks the byte and bulk API's of the IMU gateway ring_buffer.c against
+ * a plain FIFO model, on storage sizes either side of the 8 bit index
+ * range: spans and views split at the end of the storage, the full and
+ * empty boundaries, overflow, consume and high_water.
+ *
+ * Then times draining a stream through a buffer the size of the IMU rx
+ * buffer per byte with ring_buffer_getc and in bulk with ring_buffer_read
+ * and ring_buffer_peek_span/ring_buffer_consume.
+ *
+ * Usage: ring-buffer-test [megabytes]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <avr/io.h>
+
+#include "board.h"
+#include "ring_buffer.h"
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// largest storage tested, the most a 16 bit size allows
+#define STORAGE_SIZE_MAX (32768U)
+
+
+// random operations per storage size
+#define RANDOM_OP_COUNT (200000UL)
+
+
+//
+#define BENCH_MEGABYTES_DEFAULT (64UL)
+
+
+// storage of the drain benchmark, same as the IMU rx buffer
+#define BENCH_STORAGE_SIZE (512U)
+
+
+// bytes written per producer turn, about one main loop pass of Xsens
+// data at 115200 baud
+#define BENCH_CHUNK_SIZE (96U)
+
+
+// model of the buffer contents
+typedef struct
+{
+    //
+    //
+    uint8_t data[ STORAGE_SIZE_MAX ];
+    //
+    // index of the oldest byte
+    uint32_t start;
+    //
+    //
+    uint32_t count;
+    //
+    //
+    uint32_t capacity;
+    //
+    //
+    uint32_t overflow_count;
+    //
+    //
+    uint32_t high_water;
+} model_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static uint8_t storage[ STORAGE_SIZE_MAX ];
+
+
+//
+static model_s model;
+
+
+//
+static uint8_t scratch[ STORAGE_SIZE_MAX ];
+
+
+//
+static uint8_t next_byte = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static uint32_t random_below(
+        const uint32_t bound );
+
+
+//
+static void model_init(
+        const uint16_t size );
+
+
+//
+static void model_push(
+        const uint8_t data );
+
+
+//
+static uint8_t model_at(
+        const uint32_t offset );
+
+
+//
+static void model_pop(
+        const uint32_t len );
+
+
+//
+static void check_state(
+        volatile ring_buffer_s * const rb );
+
+
+//
+static void test_empty_full(
+        const uint16_t size );
+
+
+//
+static void test_wrap(
+        const uint16_t size );
+
+
+//
+static void test_random(
+        const uint16_t size );
+
+
+//
+static double bench_drain(
+        const uint8_t mode,
+        const unsigned long total,
+        uint32_t * const sum );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+//
+static uint32_t random_below(
+        const uint32_t bound )
+{
+    return (uint32_t) (((uint64_t) (uint32_t) rand() * bound) / ((uint64_t) RAND_MAX + 1));
+}
+
+
+//
+static void model_init(
+        const uint16_t size )
+{
+    model.start = 0;
+    model.count = 0;
+    model.capacity = (uint32_t) size - 1;
+    model.overflow_count = 0;
+    model.high_water = 0;
+}
+
+
+//
+static void model_push(
+        const uint8_t data )
+{
+    if( model.count == model.capacity )
+    {
+        model.overflow_count += 1;
+    }
+    else
+    {
+        model.data[ (model.start + model.count) % STORAGE_SIZE_MAX ] = data;
+        model.count += 1;
+
+        if( model.count > model.high_water )
+        {
+            model.high_water = model.count;
+        }
+    }
+}
+
+
+//
+static uint8_t model_at(
+        const uint32_t offset )
+{
+    return model.data[ (model.start + offset) % STORAGE_SIZE_MAX ];
+}
+
+
+//
+static void model_pop(
+        const uint32_t len )
+{
+    const uint32_t count = (len < model.count) ? len : model.count;
+
+    model.start = (model.start + count) % STORAGE_SIZE_MAX;
+    model.count -= count;
+}
+
+
+// available, stats and the view of the whole contents
+static void check_state(
+        volatile ring_buffer_s * const rb )
+{
+    uint32_t idx = 0;
+    uint8_t match = 1;
+    ring_buffer_view_s view;
+    ring_buffer_stats_s stats;
+
+    const uint8_t *span = NULL;
+
+    SIM_TEST_CHECK( ring_buffer_available( rb ) == model.count );
+
+    const uint16_t available = ring_buffer_peek_view( rb, &view );
+
+    SIM_TEST_CHECK( available == model.count );
+    SIM_TEST_CHECK( (uint32_t) view.len[ 0 ] + view.len[ 1 ] == model.count );
+    SIM_TEST_CHECK( (view.len[ 1 ] == 0) || (view.span[ 1 ] == rb->buffer) );
+
+    // the first span runs to the end of the storage at most
+    SIM_TEST_CHECK( (view.span[ 0 ] + view.len[ 0 ]) <= (rb->buffer + rb->mask + 1) );
+
+    for( idx = 0; idx < model.count; idx += 1 )
+    {
+        const uint8_t value = (idx < view.len[ 0 ])
+                ? view.span[ 0 ][ idx ]
+                : view.span[ 1 ][ idx - view.len[ 0 ] ];
+
+        if( value != model_at( idx ) )
+        {
+            match = 0;
+        }
+    }
+
+    SIM_TEST_CHECK( match != 0 );
+
+    SIM_TEST_CHECK( ring_buffer_peek_span( rb, &span ) == view.len[ 0 ] );
+    SIM_TEST_CHECK( span == view.span[ 0 ] );
+
+    ring_buffer_get_stats( rb, &stats );
+
+    SIM_TEST_CHECK( stats.capacity == model.capacity );
+    SIM_TEST_CHECK( stats.overflow_count == (uint16_t) model.overflow_count );
+    SIM_TEST_CHECK( stats.high_water == model.high_water );
+}
+
+
+//
+static void test_empty_full(
+        const uint16_t size )
+{
+    uint32_t idx = 0;
+    const uint8_t *span = NULL;
+    volatile ring_buffer_s rb;
+
+    ring_buffer_init( &rb, storage, size );
+    model_init( size );
+
+    // empty
+    SIM_TEST_CHECK( ring_buffer_getc( &rb ) == RING_BUFFER_NO_DATA );
+    SIM_TEST_CHECK( ring_buffer_peek( &rb ) == RING_BUFFER_NO_DATA );
+    SIM_TEST_CHECK( ring_buffer_read( &rb, scratch, size ) == 0 );
+    SIM_TEST_CHECK( ring_buffer_peek_span( &rb, &span ) == 0 );
+    ring_buffer_consume( &rb, 1 );
+    check_state( &rb );
+
+    // one short of full by bytes, then full in bulk
+    for( idx = 0; idx < (uint32_t) (size - 2); idx += 1 )
+    {
+        SIM_TEST_CHECK( ring_buffer_putc( next_byte, &rb ) == 0 );
+        model_push( next_byte );
+        next_byte += 1;
+    }
+
+    scratch[ 0 ] = next_byte;
+    scratch[ 1 ] = (uint8_t) (next_byte + 1);
+
+    // one fits, one overflows
+    SIM_TEST_CHECK( ring_buffer_write( scratch, 2, &rb ) == 1 );
+    model_push( scratch[ 0 ] );
+    model_push( scratch[ 1 ] );
+    next_byte += 2;
+
+    SIM_TEST_CHECK( rb.head != rb.tail );
+    SIM_TEST_CHECK( ring_buffer_available( &rb ) == (uint16_t) (size - 1) );
+    check_state( &rb );
+
+    // full, nothing is taken and the overflow is sticky
+    SIM_TEST_CHECK( ring_buffer_putc( 0xAA, &rb ) == RING_BUFFER_RX_OVERFLOW );
+    model_push( 0xAA );
+    SIM_TEST_CHECK( ring_buffer_write( scratch, size, &rb ) == 0 );
+
+    for( idx = 0; idx < size; idx += 1 )
+    {
+        model_push( scratch[ idx ] );
+    }
+
+    check_state( &rb );
+
+    SIM_TEST_CHECK( (ring_buffer_peek( &rb ) & RING_BUFFER_RX_OVERFLOW) != 0 );
+    SIM_TEST_CHECK( (ring_buffer_peek( &rb ) & 0xFF) == model_at( 0 ) );
+
+    // drain in one read, the bytes come back in order
+    SIM_TEST_CHECK( ring_buffer_read( &rb, scratch, STORAGE_SIZE_MAX ) == (uint16_t) (size - 1) );
+
+    for( idx = 0; idx < (uint32_t) (size - 1); idx += 1 )
+    {
+        if( scratch[ idx ] != model_at( idx ) )
+        {
+            SIM_TEST_CHECK( scratch[ idx ] == model_at( idx ) );
+            idx = size;
+        }
+    }
+
+    model_pop( size );
+    check_state( &rb );
+
+    SIM_TEST_CHECK( ring_buffer_getc( &rb ) == RING_BUFFER_NO_DATA );
+
+    // flush empties, the high water mark stays
+    SIM_TEST_CHECK( ring_buffer_write( scratch, 5, &rb ) == 5 );
+    ring_buffer_flush( &rb );
+    SIM_TEST_CHECK( ring_buffer_available( &rb ) == 0 );
+    check_state( &rb );
+}
+
+
+// spans and views split where the storage wraps
+static void test_wrap(
+        const uint16_t size )
+{
+    uint16_t idx = 0;
+    uint16_t offset = 0;
+    uint8_t data[ 8 ];
+    const uint8_t *span = NULL;
+    ring_buffer_view_s view;
+    volatile ring_buffer_s rb;
+
+    for( idx = 0; idx < sizeof(data); idx += 1 )
+    {
+        data[ idx ] = (uint8_t) (0xC0 + idx);
+    }
+
+    // read index 0 to 8 bytes short of the end
+    for( offset = 0; offset <= sizeof(data); offset += 1 )
+    {
+        ring_buffer_init( &rb, storage, size );
+
+        const uint16_t tail = (uint16_t) (size - offset);
+
+        // move both indices to the tail position
+        SIM_TEST_CHECK( ring_buffer_write( scratch, (uint16_t) (tail & rb.mask), &rb ) == (tail & rb.mask) );
+        ring_buffer_consume( &rb, (uint16_t) (tail & rb.mask) );
+
+        SIM_TEST_CHECK( rb.tail == (tail & rb.mask) );
+
+        SIM_TEST_CHECK( ring_buffer_write( data, sizeof(data), &rb ) == sizeof(data) );
+
+        const uint16_t first = (offset == 0) ? (uint16_t) sizeof(data) : MIN( offset, (uint16_t) sizeof(data) );
+
+        SIM_TEST_CHECK( ring_buffer_peek_span( &rb, &span ) == first );
+        SIM_TEST_CHECK( span == &storage[ tail & rb.mask ] );
+        SIM_TEST_CHECK( memcmp( span, data, first ) == 0 );
+
+        SIM_TEST_CHECK( ring_buffer_peek_view( &rb, &view ) == sizeof(data) );
+        SIM_TEST_CHECK( view.len[ 0 ] == first );
+        SIM_TEST_CHECK( view.len[ 1 ] == (sizeof(data) - first) );
+        SIM_TEST_CHECK( memcmp( view.span[ 1 ], &data[ first ], view.len[ 1 ] ) == 0 );
+
+        // consuming the first span leaves the rest at the start
+        ring_buffer_consume( &rb, first );
+
+        SIM_TEST_CHECK( ring_buffer_peek_span( &rb, &span ) == (sizeof(data) - first) );
+
+        if( first < sizeof(data) )
+        {
+            SIM_TEST_CHECK( span == storage );
+        }
+
+        // consume is clamped to what is there
+        ring_buffer_consume( &rb, size );
+
+        SIM_TEST_CHECK( ring_buffer_available( &rb ) == 0 );
+        SIM_TEST_CHECK( rb.head == rb.tail );
+
+        // a read across the end
+        ring_buffer_init( &rb, storage, size );
+        SIM_TEST_CHECK( ring_buffer_write( scratch, (uint16_t) (tail & rb.mask), &rb ) == (tail & rb.mask) );
+        ring_buffer_consume( &rb, (uint16_t) (tail & rb.mask) );
+        SIM_TEST_CHECK( ring_buffer_write( data, sizeof(data), &rb ) == sizeof(data) );
+
+        memset( scratch, 0, sizeof(data) );
+
+        SIM_TEST_CHECK( ring_buffer_read( &rb, scratch, sizeof(data) ) == sizeof(data) );
+        SIM_TEST_CHECK( memcmp( scratch, data, sizeof(data) ) == 0 );
+    }
+}
+
+
+// mixed producer and consumer calls against the model
+static void test_random(
+        const uint16_t size )
+{
+    unsigned long op = 0;
+    uint32_t idx = 0;
+    uint8_t match = 1;
+    volatile ring_buffer_s rb;
+
+    ring_buffer_init( &rb, storage, size );
+    model_init( size );
+
+    for( op = 0; op < RANDOM_OP_COUNT; op += 1 )
+    {
+        // lengths up to twice the storage, biased short
+        const uint32_t len = (random_below( 4 ) == 0)
+                ? random_below( 2U * size )
+                : random_below( 64 );
+
+        const uint32_t kind = random_below( 7 );
+
+        if( kind == 0 )
+        {
+            const uint16_t status = ring_buffer_putc( next_byte, &rb );
+
+            model_push( next_byte );
+            next_byte += 1;
+
+            if( (status == 0) != (model.overflow_count == 0) )
+            {
+                match = 0;
+            }
+        }
+        else if( kind <= 2 )
+        {
+            const uint16_t count = (uint16_t) MIN( len, (uint32_t) STORAGE_SIZE_MAX );
+            const uint32_t space = model.capacity - model.count;
+
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                scratch[ idx ] = next_byte;
+                next_byte += 1;
+            }
+
+            if( ring_buffer_write( scratch, count, &rb ) != MIN( (uint32_t) count, space ) )
+            {
+                match = 0;
+            }
+
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                model_push( scratch[ idx ] );
+            }
+        }
+        else if( kind == 3 )
+        {
+            const uint16_t value = ring_buffer_getc( &rb );
+
+            if( model.count == 0 )
+            {
+                match &= (value == RING_BUFFER_NO_DATA);
+            }
+            else
+            {
+                match &= ((value & 0xFF) == model_at( 0 ));
+                model_pop( 1 );
+            }
+        }
+        else if( kind == 4 )
+        {
+            const uint16_t count = (uint16_t) MIN( len, (uint32_t) STORAGE_SIZE_MAX );
+            const uint16_t copied = ring_buffer_read( &rb, scratch, count );
+
+            match &= (copied == MIN( (uint32_t) count, model.count ));
+
+            for( idx = 0; idx < copied; idx += 1 )
+            {
+                match &= (scratch[ idx ] == model_at( idx ));
+            }
+
+            model_pop( copied );
+        }
+        else if( kind == 5 )
+        {
+            const uint8_t *span = NULL;
+            const uint16_t run = ring_buffer_peek_span( &rb, &span );
+            const uint16_t count = (uint16_t) MIN( len, (uint32_t) run );
+
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                match &= (span[ idx ] == model_at( idx ));
+            }
+
+            ring_buffer_consume( &rb, count );
+            model_pop( count );
+        }
+        else
+        {
+            // consume past the end is clamped
+            ring_buffer_consume( &rb, (uint16_t) MIN( len, 0xFFFFUL ) );
+            model_pop( len );
+        }
+
+        if( (op % 1000) == 0 )
+        {
+            check_state( &rb );
+        }
+    }
+
+    check_state( &rb );
+
+    SIM_TEST_CHECK( match != 0 );
+}
+
+
+// mode 0 - getc per byte, 1 - read, 2 - peek_span and consume
+// ns per byte
+static double bench_drain(
+        const uint8_t mode,
+        const unsigned long total,
+        uint32_t * const sum )
+{
+    unsigned long produced = 0;
+    unsigned long drained = 0;
+    uint16_t idx = 0;
+    uint8_t chunk[ BENCH_CHUNK_SIZE ];
+    uint8_t dst[ BENCH_STORAGE_SIZE ];
+    volatile ring_buffer_s rb;
+
+    for( idx = 0; idx < BENCH_CHUNK_SIZE; idx += 1 )
+    {
+        chunk[ idx ] = (uint8_t) (idx * 7);
+    }
+
+    ring_buffer_init( &rb, storage, BENCH_STORAGE_SIZE );
+
+    (*sum) = 0;
+
+    const double start = get_time_ns();
+
+    while( drained < total )
+    {
+        // producer side, the ISR on the target
+        produced += ring_buffer_write( chunk, BENCH_CHUNK_SIZE, &rb );
+
+        if( mode == 0 )
+        {
+            uint16_t value = ring_buffer_getc( &rb );
+
+            while( value != RING_BUFFER_NO_DATA )
+            {
+                (*sum) += (uint8_t) value;
+                drained += 1;
+
+                value = ring_buffer_getc( &rb );
+            }
+        }
+        else if( mode == 1 )
+        {
+            const uint16_t count = ring_buffer_read( &rb, dst, sizeof(dst) );
+
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                (*sum) += dst[ idx ];
+            }
+
+            drained += count;
+        }
+        else
+        {
+            const uint8_t *span = NULL;
+            uint16_t count = ring_buffer_peek_span( &rb, &span );
+
+            while( count != 0 )
+            {
+                for( idx = 0; idx < count; idx += 1 )
+                {
+                    (*sum) += span[ idx ];
+                }
+
+                ring_buffer_consume( &rb, count );
+                drained += count;
+
+                count = ring_buffer_peek_span( &rb, &span );
+            }
+        }
+    }
+
+    const double end = get_time_ns();
+
+    SIM_TEST_CHECK( produced == drained );
+
+    return (end - start) / (double) drained;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    uint8_t idx = 0;
+    uint32_t sums[ 3 ];
+    double ns[ 3 ];
+    unsigned long megabytes = BENCH_MEGABYTES_DEFAULT;
+
+    const uint16_t sizes[] = { 16, 128, 256, 512, 1024, STORAGE_SIZE_MAX };
+
+    if( argc == 2 )
+    {
+        megabytes = strtoul( argv[ 1 ], NULL, 0 );
+    }
+
+    srand( 1 );
+
+    for( idx = 0; idx < (uint8_t) (sizeof(sizes) / sizeof(sizes[0])); idx += 1 )
+    {
+        test_empty_full( sizes[ idx ] );
+        test_wrap( sizes[ idx ] );
+        test_random( sizes[ idx ] );
+    }
+
+    for( idx = 0; idx < 3; idx += 1 )
+    {
+        ns[ idx ] = bench_drain( idx, megabytes * 1000000UL, &sums[ idx ] );
+    }
+
+    SIM_TEST_CHECK( sums[ 0 ] == sums[ 1 ] );
+    SIM_TEST_CHECK( sums[ 0 ] == sums[ 2 ] );
+
+    printf(
+            "ring-buffer-test: drain %lu MB through %u B, getc %.2f ns/byte, read %.2f ns/byte, peek_span %.2f ns/byte\n",
+            megabytes,
+            BENCH_STORAGE_SIZE,
+            ns[ 0 ],
+            ns[ 1 ],
+            ns[ 2 ] );
+
+    return sim_test_result( "ring-buffer-test" );
+}
@@ -0,0 +1,116 @@
+/**
+ * @file rtc_drv.c
+ * @brief Simulated RTC driver, replaces the BSP rtc_drv.c on the host.
+ *
+ * Counts milliseconds of virtual time instead of timer 2 compare
+ * interrupts. delay_ms advances the virtual clock.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "board.h"
+#include "rtc_drv.h"
+#include "sim.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+volatile uint32_t rtc_tics;
+
+
+//
+volatile uint32_t rtc_milliseconds;
+
+
+//
+BOOL rtc_running = OFF;
+
+
+// virtual time not yet counted as a tic
+// microseconds
+static uint32_t tic_remainder_us = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_rtc_service(
+        const uint32_t interval_us )
+{
+    if( rtc_running == ON )
+    {
+        const uint32_t elapsed_us = tic_remainder_us + interval_us;
+
+        rtc_tics += (elapsed_us / 1000UL);
+        rtc_milliseconds += (elapsed_us / 1000UL);
+
+        tic_remainder_us = (elapsed_us % 1000UL);
+    }
+}
+
+
+//
+void delay_ms(
+        uint16_t ms_count )
+{
+    sim_run( 1000UL * (uint32_t) ms_count );
+}
+
+
+//
+void rtc_int_init( void )
+{
+    disable_interrupt();
+
+    rtc_tics = 0;
+    rtc_milliseconds = 0;
+    tic_remainder_us = 0;
+
+    rtc_running = ON;
+
+    enable_interrupt();
+}
+
+
+//
+uint32_t rtc_get_ms( void )
+{
+    return rtc_milliseconds;
+}
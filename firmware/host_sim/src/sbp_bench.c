@@ -0,0 +1,491 @@
+/**
+ * @file sbp_bench.c
+ * @brief SBP framing benchmark.
+ *
+ * Replays a Piksi stream, as written by hobd-stream-gen, through the
+ * message types the IMU gateway handles, two ways:
+ *   - process - sbp_process with registered callbacks, one framing state
+ *     per call
+ *   - scan - sbp_scan with the gateway's dispatch table, fed in chunks
+ *     like the gateway's rx buffer drain
+ *
+ * Reports the host time per message for each and fails if they do not
+ * deliver the same messages.
+ *
+ * Usage: sbp-scan-bench <sbp file> [passes]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "libsbp/sbp.h"
+#include "libsbp/system.h"
+#include "libsbp/navigation.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define PASSES_DEFAULT (50UL)
+
+
+// callbacks registered with sbp_process
+#define CALLBACK_COUNT (7)
+
+
+// bytes per sbp_scan, about one 1 ms main loop pass at 115200 baud, and
+// whatever fits in the scanner
+#define SCAN_CHUNK_PASS (12U)
+#define SCAN_CHUNK_FULL (SBP_FRAME_LEN_MAX)
+
+
+//
+typedef struct
+{
+    //
+    //
+    const uint8_t *data;
+    //
+    //
+    uint32_t size;
+    //
+    // next byte to read
+    uint32_t pos;
+} stream_s;
+
+
+// delivered messages, kept so the decode is not optimized out
+typedef struct
+{
+    //
+    //
+    uint32_t count;
+    //
+    // sum of the message types, sender ID's and payload bytes
+    uint32_t sum;
+    //
+    //
+    uint32_t crc_errors;
+} delivered_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static delivered_s delivered;
+
+
+//
+static stream_s stream;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static void deliver(
+        const uint16_t msg_type,
+        const uint16_t sender_id,
+        const uint8_t len,
+        const uint8_t * const msg );
+
+
+//
+static void gps_time_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void pos_llh_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void vel_ned_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void baseline_ned_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void heading_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void dops_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+static void heartbeat_cb( u16 sender_id, u8 len, u8 msg[], void *context );
+
+
+//
+static u32 stream_read(
+        u8 *buff,
+        u32 n,
+        void *context );
+
+
+//
+static void replay_process( void );
+
+
+//
+static void replay_scan(
+        const uint16_t chunk );
+
+
+//
+static uint8_t load_stream(
+        const char * const path,
+        uint8_t ** const data,
+        uint32_t * const size );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// same as the IMU gateway dispatch table
+static const sbp_msg_dispatch_t DISPATCH_TABLE[ CALLBACK_COUNT ] =
+{
+    { SBP_MSG_GPS_TIME, &gps_time_cb, NULL },
+    { SBP_MSG_POS_LLH, &pos_llh_cb, NULL },
+    { SBP_MSG_VEL_NED, &vel_ned_cb, NULL },
+    { SBP_MSG_BASELINE_NED, &baseline_ned_cb, NULL },
+    { SBP_MSG_BASELINE_HEADING, &heading_cb, NULL },
+    { SBP_MSG_DOPS, &dops_cb, NULL },
+    { SBP_MSG_HEARTBEAT, &heartbeat_cb, NULL }
+};
+
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+//
+static void deliver(
+        const uint16_t msg_type,
+        const uint16_t sender_id,
+        const uint8_t len,
+        const uint8_t * const msg )
+{
+    uint8_t idx = 0;
+
+    delivered.count += 1;
+    delivered.sum += (uint32_t) msg_type + (uint32_t) sender_id;
+
+    for( idx = 0; idx < len; idx += 1 )
+    {
+        delivered.sum += msg[ idx ];
+    }
+}
+
+
+//
+static void gps_time_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_GPS_TIME, sender_id, len, msg );
+}
+
+
+//
+static void pos_llh_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_POS_LLH, sender_id, len, msg );
+}
+
+
+//
+static void vel_ned_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_VEL_NED, sender_id, len, msg );
+}
+
+
+//
+static void baseline_ned_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_BASELINE_NED, sender_id, len, msg );
+}
+
+
+//
+static void heading_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_BASELINE_HEADING, sender_id, len, msg );
+}
+
+
+//
+static void dops_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_DOPS, sender_id, len, msg );
+}
+
+
+//
+static void heartbeat_cb( u16 sender_id, u8 len, u8 msg[], void *context )
+{
+    deliver( SBP_MSG_HEARTBEAT, sender_id, len, msg );
+}
+
+
+//
+static u32 stream_read(
+        u8 *buff,
+        u32 n,
+        void *context )
+{
+    stream_s * const src = (stream_s*) context;
+
+    const u32 count = ((src->size - src->pos) < n) ? (src->size - src->pos) : n;
+
+    memcpy( buff, &src->data[ src->pos ], count );
+
+    src->pos += count;
+
+    return count;
+}
+
+
+// the gateway's framing before the scanner
+static void replay_process( void )
+{
+    uint8_t idx = 0;
+    sbp_state_t state;
+    sbp_msg_callbacks_node_t nodes[ CALLBACK_COUNT ];
+
+    sbp_state_init( &state );
+
+    for( idx = 0; idx < CALLBACK_COUNT; idx += 1 )
+    {
+        (void) sbp_register_callback(
+                &state,
+                DISPATCH_TABLE[ idx ].msg_type,
+                DISPATCH_TABLE[ idx ].cb,
+                NULL,
+                &nodes[ idx ] );
+    }
+
+    stream.pos = 0;
+
+    sbp_state_set_io_context( &state, &stream );
+
+    while( stream.pos < stream.size )
+    {
+        if( sbp_process( &state, &stream_read ) == SBP_CRC_ERROR )
+        {
+            delivered.crc_errors += 1;
+        }
+    }
+}
+
+
+//
+static void replay_scan(
+        const uint16_t chunk )
+{
+    uint8_t *dst = NULL;
+    sbp_scanner_t scanner;
+
+    sbp_scanner_init( &scanner, DISPATCH_TABLE, CALLBACK_COUNT );
+
+    stream.pos = 0;
+
+    while( stream.pos < stream.size )
+    {
+        const uint16_t space = sbp_scanner_space( &scanner, &dst );
+
+        const uint16_t copied = (uint16_t) stream_read(
+                dst,
+                (space < chunk) ? space : chunk,
+                &stream );
+
+        (void) sbp_scan( &scanner, copied );
+    }
+
+    delivered.crc_errors += scanner.n_crc_errors;
+}
+
+
+//
+static uint8_t load_stream(
+        const char * const path,
+        uint8_t ** const data,
+        uint32_t * const size )
+{
+    uint8_t ret = 1;
+    long file_size = 0;
+
+    FILE * const file = fopen( path, "rb" );
+
+    (*data) = NULL;
+    (*size) = 0;
+
+    if( file != NULL )
+    {
+        if( fseek( file, 0, SEEK_END ) == 0 )
+        {
+            file_size = ftell( file );
+        }
+
+        if( (file_size > 0) && (fseek( file, 0, SEEK_SET ) == 0) )
+        {
+            (*data) = malloc( (size_t) file_size );
+        }
+
+        if(
+                ((*data) != NULL)
+                && (fread( (*data), 1, (size_t) file_size, file ) == (size_t) file_size) )
+        {
+            (*size) = (uint32_t) file_size;
+
+            ret = 0;
+        }
+
+        (void) fclose( file );
+    }
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    uint8_t *data = NULL;
+    uint32_t size = 0;
+    unsigned long pass = 0;
+    unsigned long passes = PASSES_DEFAULT;
+    uint8_t mode = 0;
+    delivered_s results[ 3 ];
+    double ns[ 3 ];
+
+    if( (argc != 2) && (argc != 3) )
+    {
+        fprintf( stderr, "usage: %s <sbp file> [passes]\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else
+    {
+        if( argc == 3 )
+        {
+            passes = strtoul( argv[ 2 ], NULL, 0 );
+        }
+
+        if( (load_stream( argv[ 1 ], &data, &size ) != 0) || (passes == 0) )
+        {
+            fprintf( stderr, "%s: failed to read '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        stream.data = data;
+        stream.size = size;
+
+        // process, scan per main loop pass, scan the whole space
+        for( mode = 0; mode < 3; mode += 1 )
+        {
+            double start = 0.0;
+
+            // warm up, and the messages to compare
+            memset( &delivered, 0, sizeof(delivered) );
+
+            if( mode == 0 )
+            {
+                replay_process();
+            }
+            else
+            {
+                replay_scan( (mode == 1) ? SCAN_CHUNK_PASS : SCAN_CHUNK_FULL );
+            }
+
+            results[ mode ] = delivered;
+
+            start = get_time_ns();
+
+            for( pass = 0; pass < passes; pass += 1 )
+            {
+                if( mode == 0 )
+                {
+                    replay_process();
+                }
+                else
+                {
+                    replay_scan( (mode == 1) ? SCAN_CHUNK_PASS : SCAN_CHUNK_FULL );
+                }
+            }
+
+            ns[ mode ] = (get_time_ns() - start) / ((double) results[ mode ].count * (double) passes);
+        }
+
+        printf(
+                "sbp-scan-bench: %" PRIu32 " bytes, %" PRIu32 "/%" PRIu32 "/%" PRIu32 " messages, %" PRIu32 "/%" PRIu32 "/%" PRIu32 " CRC errors, %lu passes\n",
+                size,
+                results[ 0 ].count,
+                results[ 1 ].count,
+                results[ 2 ].count,
+                results[ 0 ].crc_errors,
+                results[ 1 ].crc_errors,
+                results[ 2 ].crc_errors,
+                passes );
+
+        printf(
+                "sbp-scan-bench: process %.1f ns/message, scan %u B %.1f ns/message (%.2fx), scan %u B %.1f ns/message (%.2fx)\n",
+                ns[ 0 ],
+                SCAN_CHUNK_PASS,
+                ns[ 1 ],
+                ns[ 0 ] / ns[ 1 ],
+                (unsigned int) SCAN_CHUNK_FULL,
+                ns[ 2 ],
+                ns[ 0 ] / ns[ 2 ] );
+
+        for( mode = 1; mode < 3; mode += 1 )
+        {
+            if(
+                    (results[ mode ].count != results[ 0 ].count)
+                    || (results[ mode ].sum != results[ 0 ].sum)
+                    || (results[ mode ].crc_errors != results[ 0 ].crc_errors) )
+            {
+                fprintf( stderr, "%s: process and scan delivered different messages\n", argv[ 0 ] );
+
+                ret = EXIT_FAILURE;
+            }
+        }
+
+        if( results[ 0 ].count == 0 )
+        {
+            fprintf( stderr, "%s: no messages in '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    free( data );
+
+    return ret;
+}
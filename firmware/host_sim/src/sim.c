@@ -0,0 +1,640 @@
+/**
+ * @file sim.c
+ * @brief Host side of the simulation: registers, virtual clock, files.
+ *
+ * Built without the target struct packing, the simulated BSP talks to
+ * this file through the scalar interface in sim.h only.
+ *
+ */
+
+
+
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <avr/io.h>
+
+#include "hobd.h"
+#include "sim.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+typedef struct
+{
+    //
+    //
+    const char *path;
+    //
+    // whole file, read up front so file I/O stays out of the profile
+    uint8_t *data;
+    //
+    //
+    size_t size;
+    //
+    // next byte to deliver
+    size_t pos;
+    //
+    //
+    uint64_t tx_count;
+    //
+    // transmitted bytes, NULL without a tx file
+    FILE *tx_file;
+} sim_uart_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    //
+    uint8_t data[ 8 ];
+} sim_can_frame_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// target registers
+#define SIM_REG8(name) volatile uint8_t name;
+#define SIM_REG16(name) volatile uint16_t name;
+#include "avr/sim_registers.h"
+#undef SIM_REG8
+#undef SIM_REG16
+
+
+//
+static sim_uart_s uarts[ SIM_UART_COUNT ];
+
+
+//
+static FILE *can_log = NULL;
+
+
+//
+static uint64_t can_tx_count = 0;
+
+
+// frames on their way to the node
+static sim_can_frame_s can_rx_queue[ SIM_CAN_RX_QUEUE_SIZE ];
+static uint8_t can_rx_head = 0;
+static uint8_t can_rx_count = 0;
+
+
+// time master, off without HOBD_SIM_TIME_SYNC_PPM
+static uint8_t time_sync_enabled = 0;
+static int32_t time_sync_ppm = 0;
+static uint16_t time_sync_sequence = 0;
+
+
+// microseconds
+static uint64_t next_time_sync_us = 0;
+
+
+// virtual clock
+// microseconds
+static uint64_t time_us = 0;
+
+
+// virtual time not yet handed to the peripherals
+// microseconds
+static uint32_t pending_us = 0;
+
+
+//
+static uint32_t step_us = SIM_STEP_US_DEFAULT;
+
+
+// zero runs until the inputs are drained
+// microseconds
+static uint64_t duration_us = 0;
+
+
+// microseconds
+static uint64_t drain_us = 0;
+
+
+//
+static uint64_t pass_count = 0;
+
+
+//
+static struct timespec wall_start;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void sim_init( void ) __attribute__((constructor));
+
+
+//
+static void sim_report( void );
+
+
+//
+static void load_uart(
+        const uint8_t uart,
+        const char * const env,
+        const char * const tx_env );
+
+
+//
+static uint32_t get_env_u32(
+        const char * const env,
+        const uint32_t default_value );
+
+
+//
+static uint8_t inputs_drained( void );
+
+
+//
+static void log_can_frame(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+//
+static void queue_can_rx(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+//
+static void queue_command(
+        const uint8_t command_id,
+        const uint16_t data_0,
+        const uint32_t data_1 );
+
+
+//
+static void update_time_master( void );
+
+
+//
+static double get_wall_time( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void sim_init( void )
+{
+    const char * const can_log_path = getenv( "HOBD_SIM_CAN_LOG" );
+
+    load_uart( 0, "HOBD_SIM_UART0", "HOBD_SIM_UART0_TX" );
+    load_uart( 1, "HOBD_SIM_UART1", "HOBD_SIM_UART1_TX" );
+
+    if( can_log_path != NULL )
+    {
+        can_log = fopen( can_log_path, "w" );
+
+        if( can_log == NULL )
+        {
+            fprintf( stderr, "sim: %s: %s\n", can_log_path, strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    step_us = get_env_u32( "HOBD_SIM_STEP_US", SIM_STEP_US_DEFAULT );
+
+    duration_us = 1000ULL * get_env_u32( "HOBD_SIM_DURATION_MS", 0 );
+
+    if( getenv( "HOBD_SIM_TIME_SYNC_PPM" ) != NULL )
+    {
+        time_sync_enabled = 1;
+        time_sync_ppm = (int32_t) strtol( getenv( "HOBD_SIM_TIME_SYNC_PPM" ), NULL, 0 );
+    }
+
+    if( (duration_us == 0) && (uarts[ 0 ].path == NULL) && (uarts[ 1 ].path == NULL) )
+    {
+        duration_us = 1000ULL * SIM_DURATION_MS_DEFAULT;
+    }
+
+    // interrupts are off out of reset
+    SREG = 0;
+
+    clock_gettime( CLOCK_MONOTONIC, &wall_start );
+
+    atexit( &sim_report );
+}
+
+
+//
+static void sim_report( void )
+{
+    uint8_t uart = 0;
+
+    const double wall = get_wall_time();
+    const double virtual_time = (double) time_us / 1.0e6;
+
+    fprintf(
+            stderr,
+            "%s: %.3f s simulated in %.3f s wall (%.1fx), %" PRIu64 " loop passes\n",
+            program_invocation_short_name,
+            virtual_time,
+            wall,
+            (wall > 0.0) ? (virtual_time / wall) : 0.0,
+            pass_count );
+
+    for( uart = 0; uart < SIM_UART_COUNT; uart += 1 )
+    {
+        if( uarts[ uart ].path != NULL )
+        {
+            fprintf(
+                    stderr,
+                    "%s: uart%u rx %zu bytes, %.0f bytes/s wall, tx %" PRIu64 " bytes\n",
+                    program_invocation_short_name,
+                    (unsigned int) uart,
+                    uarts[ uart ].pos,
+                    (wall > 0.0) ? ((double) uarts[ uart ].pos / wall) : 0.0,
+                    uarts[ uart ].tx_count );
+        }
+    }
+
+    fprintf(
+            stderr,
+            "%s: can tx %" PRIu64 " frames\n",
+            program_invocation_short_name,
+            can_tx_count );
+
+    if( can_log != NULL )
+    {
+        (void) fclose( can_log );
+        can_log = NULL;
+    }
+
+    for( uart = 0; uart < SIM_UART_COUNT; uart += 1 )
+    {
+        if( uarts[ uart ].tx_file != NULL )
+        {
+            (void) fclose( uarts[ uart ].tx_file );
+            uarts[ uart ].tx_file = NULL;
+        }
+    }
+}
+
+
+//
+static void load_uart(
+        const uint8_t uart,
+        const char * const env,
+        const char * const tx_env )
+{
+    sim_uart_s * const sim_uart = &uarts[ uart ];
+
+    const char * const tx_path = getenv( tx_env );
+
+    sim_uart->path = getenv( env );
+
+    if( tx_path != NULL )
+    {
+        sim_uart->tx_file = fopen( tx_path, "wb" );
+
+        if( sim_uart->tx_file == NULL )
+        {
+            fprintf( stderr, "sim: %s: %s\n", tx_path, strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    if( sim_uart->path != NULL )
+    {
+        FILE * const file = fopen( sim_uart->path, "rb" );
+
+        if( file == NULL )
+        {
+            fprintf( stderr, "sim: %s: %s\n", sim_uart->path, strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+
+        (void) fseek( file, 0, SEEK_END );
+        const long size = ftell( file );
+        (void) fseek( file, 0, SEEK_SET );
+
+        sim_uart->size = (size > 0) ? (size_t) size : 0;
+        sim_uart->data = malloc( sim_uart->size + 1 );
+
+        if( (sim_uart->data == NULL) || (fread( sim_uart->data, 1, sim_uart->size, file ) != sim_uart->size) )
+        {
+            fprintf( stderr, "sim: %s: read failed\n", sim_uart->path );
+            exit( EXIT_FAILURE );
+        }
+
+        (void) fclose( file );
+    }
+}
+
+
+//
+static uint32_t get_env_u32(
+        const char * const env,
+        const uint32_t default_value )
+{
+    uint32_t value = default_value;
+    const char * const str = getenv( env );
+
+    if( (str != NULL) && (str[ 0 ] != '\0') )
+    {
+        value = (uint32_t) strtoul( str, NULL, 0 );
+    }
+
+    return value;
+}
+
+
+//
+static uint8_t inputs_drained( void )
+{
+    uint8_t ret = 1;
+    uint8_t uart = 0;
+
+    for( uart = 0; uart < SIM_UART_COUNT; uart += 1 )
+    {
+        if( uarts[ uart ].pos < uarts[ uart ].size )
+        {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+
+//
+static void log_can_frame(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    uint8_t idx = 0;
+
+    if( can_log != NULL )
+    {
+        fprintf(
+                can_log,
+                "(%" PRIu64 ".%06" PRIu64 ") sim %03X#",
+                (uint64_t) (time_us / 1000000ULL),
+                (uint64_t) (time_us % 1000000ULL),
+                (unsigned int) id );
+
+        for( idx = 0; idx < dlc; idx += 1 )
+        {
+            fprintf( can_log, "%02X", (unsigned int) data[ idx ] );
+        }
+
+        fputc( '\n', can_log );
+    }
+}
+
+
+// dropped if the queue is full
+static void queue_can_rx(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    if( can_rx_count < SIM_CAN_RX_QUEUE_SIZE )
+    {
+        sim_can_frame_s * const frame =
+                &can_rx_queue[ (can_rx_head + can_rx_count) % SIM_CAN_RX_QUEUE_SIZE ];
+
+        frame->id = id;
+        frame->dlc = dlc;
+        memcpy( frame->data, data, dlc );
+
+        can_rx_count += 1;
+    }
+}
+
+
+// hobd_command_s, built byte by byte since this file has the host layout
+static void queue_command(
+        const uint8_t command_id,
+        const uint16_t data_0,
+        const uint32_t data_1 )
+{
+    const uint8_t data[ 8 ] =
+    {
+        command_id,
+        HOBD_COMMAND_KEY_BROADCAST,
+        (uint8_t) data_0,
+        (uint8_t) (data_0 >> 8),
+        (uint8_t) data_1,
+        (uint8_t) (data_1 >> 8),
+        (uint8_t) (data_1 >> 16),
+        (uint8_t) (data_1 >> 24)
+    };
+
+    queue_can_rx( HOBD_CAN_ID_COMMAND, (uint8_t) sizeof(data), data );
+}
+
+
+// the sync is received at the current virtual time, which is also its
+// master transmit time in the follow-up
+static void update_time_master( void )
+{
+    if( time_us >= next_time_sync_us )
+    {
+        const int64_t drift_us = ((int64_t) time_us * time_sync_ppm) / 1000000LL;
+
+        const uint32_t master_time =
+                (uint32_t) (SIM_TIME_SYNC_MASTER_OFFSET_US + time_us + (uint64_t) drift_us);
+
+        time_sync_sequence += 1;
+
+        queue_command( HOBD_COMMAND_ID_TIME_SYNC, time_sync_sequence, 0 );
+        queue_command( HOBD_COMMAND_ID_TIME_FOLLOW_UP, time_sync_sequence, master_time );
+
+        next_time_sync_us += (1000ULL * HOBD_CAN_TX_INTERVAL_TIME_SYNC);
+    }
+}
+
+
+// seconds since sim_init
+static double get_wall_time( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return (double) (now.tv_sec - wall_start.tv_sec)
+            + ((double) (now.tv_nsec - wall_start.tv_nsec) / 1.0e9);
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_poll( void )
+{
+    pass_count += 1;
+
+    sim_run( step_us );
+
+    if( duration_us != 0 )
+    {
+        if( time_us >= duration_us )
+        {
+            exit( EXIT_SUCCESS );
+        }
+    }
+    else if( inputs_drained() != 0 )
+    {
+        // let queued frames reach the bus
+        drain_us += step_us;
+
+        if( drain_us >= SIM_DRAIN_US )
+        {
+            exit( EXIT_SUCCESS );
+        }
+    }
+}
+
+
+//
+void sim_run(
+        const uint32_t interval_us )
+{
+    time_us += interval_us;
+    pending_us += interval_us;
+
+    sim_timer16_service( interval_us );
+
+    // peripherals catch up once interrupts are enabled
+    if( (SREG & _BV( SREG_I )) != 0 )
+    {
+        const uint32_t interval = pending_us;
+
+        pending_us = 0;
+
+        if( time_sync_enabled != 0 )
+        {
+            update_time_master();
+        }
+
+        sim_rtc_service( interval );
+        sim_uart_service( interval );
+        sim_can_service( interval );
+    }
+}
+
+
+//
+uint64_t sim_get_time_us( void )
+{
+    return time_us;
+}
+
+
+//
+int16_t sim_uart_read(
+        const uint8_t uart )
+{
+    int16_t ret = SIM_UART_NO_DATA;
+
+    if( uart < SIM_UART_COUNT )
+    {
+        sim_uart_s * const sim_uart = &uarts[ uart ];
+
+        if( sim_uart->pos < sim_uart->size )
+        {
+            ret = (int16_t) sim_uart->data[ sim_uart->pos ];
+            sim_uart->pos += 1;
+        }
+    }
+
+    return ret;
+}
+
+
+//
+void sim_uart_write(
+        const uint8_t uart,
+        const uint8_t data )
+{
+    if( uart < SIM_UART_COUNT )
+    {
+        uarts[ uart ].tx_count += 1;
+
+        if( uarts[ uart ].tx_file != NULL )
+        {
+            (void) fputc( (int) data, uarts[ uart ].tx_file );
+        }
+    }
+}
+
+
+//
+void sim_can_write(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    can_tx_count += 1;
+
+    log_can_frame( id, dlc, data );
+}
+
+
+//
+uint8_t sim_can_read(
+        uint16_t * const id,
+        uint8_t * const dlc,
+        uint8_t * const data )
+{
+    uint8_t ret = 1;
+
+    if( can_rx_count != 0 )
+    {
+        const sim_can_frame_s * const frame = &can_rx_queue[ can_rx_head ];
+
+        (*id) = frame->id;
+        (*dlc) = frame->dlc;
+        memcpy( data, frame->data, frame->dlc );
+
+        can_rx_head = (uint8_t) ((can_rx_head + 1) % SIM_CAN_RX_QUEUE_SIZE);
+        can_rx_count -= 1;
+
+        log_can_frame( *id, *dlc, data );
+
+        ret = 0;
+    }
+
+    return ret;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file sim_test.c
+ * @brief Target registers and check counts for the host unit tests.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <avr/io.h>
+
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// target registers
+#define SIM_REG8(name) volatile uint8_t name;
+#define SIM_REG16(name) volatile uint16_t name;
+#include "avr/sim_registers.h"
+#undef SIM_REG8
+#undef SIM_REG16
+
+
+//
+static unsigned long check_count = 0;
+
+
+//
+static unsigned long fail_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_test_check(
+        const uint8_t ok,
+        const char * const expr,
+        const char * const file,
+        const int line )
+{
+    check_count += 1;
+
+    if( ok == 0 )
+    {
+        fail_count += 1;
+
+        printf( "%s:%d: check failed: %s\n", file, line, expr );
+    }
+}
+
+
+//
+int sim_test_result(
+        const char * const name )
+{
+    printf(
+            "%s: %lu checks, %lu failed\n",
+            name,
+            check_count,
+            fail_count );
+
+    return (fail_count == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,483 @@
+/**
+ * @file stream_gen.c
+ * @brief Synthetic UART input for the gateway simulation.
+ *
+ * Writes back-to-back frames to stdout, enough to keep a 115200 baud line
+ * busy for the requested time:
+ *   - sbp - Piksi GPS messages handled by the IMU gateway
+ *   - xbus - Xsens MTData2 messages handled by the IMU gateway
+ *   - obd - Honda ECU table responses handled by the OBD gateway
+ *
+ * Usage: hobd-stream-gen <sbp|xbus|obd> <seconds>
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "libsbp/edc.h"
+#include "libsbp/sbp.h"
+#include "libsbp/navigation.h"
+#include "libsbp/system.h"
+#include "xbusdef.h"
+#include "xbusmessage.h"
+#include "hobd_uart.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define LINE_BAUDRATE (115200UL)
+
+
+// start, 8 data and stop bit
+#define BITS_PER_BYTE (10UL)
+
+
+// private to sbp.c
+#define SBP_PREAMBLE (0x55)
+
+
+
+//
+#define FRAME_SIZE_MAX (300)
+
+
+//
+typedef uint16_t (*frame_gen_cb)(
+        const uint32_t seq,
+        uint8_t * const frame );
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void put_u16_le(
+        uint8_t * const dst,
+        const uint16_t value );
+
+
+//
+static uint8_t put_u16_be(
+        uint8_t * const dst,
+        const uint16_t value );
+
+
+//
+static uint8_t put_u32_be(
+        uint8_t * const dst,
+        const uint32_t value );
+
+
+//
+static uint8_t put_float_be(
+        uint8_t * const dst,
+        const float value );
+
+
+//
+static uint16_t sbp_frame(
+        const uint16_t msg_type,
+        const void * const payload,
+        const uint8_t len,
+        uint8_t * const frame );
+
+
+//
+static uint16_t gen_sbp(
+        const uint32_t seq,
+        uint8_t * const frame );
+
+
+//
+static uint16_t gen_xbus(
+        const uint32_t seq,
+        uint8_t * const frame );
+
+
+//
+static uint16_t gen_obd(
+        const uint32_t seq,
+        uint8_t * const frame );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void put_u16_le(
+        uint8_t * const dst,
+        const uint16_t value )
+{
+    dst[ 0 ] = (uint8_t) (value & 0xFF);
+    dst[ 1 ] = (uint8_t) (value >> 8);
+}
+
+
+// returns the number of bytes written
+static uint8_t put_u16_be(
+        uint8_t * const dst,
+        const uint16_t value )
+{
+    dst[ 0 ] = (uint8_t) (value >> 8);
+    dst[ 1 ] = (uint8_t) (value & 0xFF);
+
+    return 2;
+}
+
+
+// returns the number of bytes written
+static uint8_t put_u32_be(
+        uint8_t * const dst,
+        const uint32_t value )
+{
+    (void) put_u16_be( &dst[ 0 ], (uint16_t) (value >> 16) );
+    (void) put_u16_be( &dst[ 2 ], (uint16_t) (value & 0xFFFF) );
+
+    return 4;
+}
+
+
+// returns the number of bytes written
+static uint8_t put_float_be(
+        uint8_t * const dst,
+        const float value )
+{
+    uint32_t raw;
+
+    memcpy( &raw, &value, sizeof(raw) );
+
+    return put_u32_be( dst, raw );
+}
+
+
+// returns the frame size
+static uint16_t sbp_frame(
+        const uint16_t msg_type,
+        const void * const payload,
+        const uint8_t len,
+        uint8_t * const frame )
+{
+    frame[ 0 ] = SBP_PREAMBLE;
+    put_u16_le( &frame[ 1 ], msg_type );
+    put_u16_le( &frame[ 3 ], SBP_SENDER_ID );
+    frame[ 5 ] = len;
+
+    memcpy( &frame[ SBP_HEADER_LEN ], payload, len );
+
+    // covers everything after the preamble
+    const uint16_t crc = crc16_ccitt( &frame[ 1 ], (u32) (SBP_HEADER_LEN - 1 + len), 0 );
+
+    put_u16_le( &frame[ SBP_HEADER_LEN + len ], crc );
+
+    return (uint16_t) (SBP_HEADER_LEN + len + SBP_CRC_LEN);
+}
+
+
+// one solution epoch is six messages
+static uint16_t gen_sbp(
+        const uint32_t seq,
+        uint8_t * const frame )
+{
+    uint16_t size = 0;
+
+    const uint32_t epoch = (seq / 6);
+    const u32 tow = 100UL * epoch;
+
+    if( (seq % 6) == 0 )
+    {
+        msg_gps_time_t msg;
+
+        msg.wn = 1900;
+        msg.tow = tow;
+        msg.ns = (s32) (epoch % 1000);
+        msg.flags = 0;
+
+        size = sbp_frame( SBP_MSG_GPS_TIME, &msg, (uint8_t) sizeof(msg), frame );
+    }
+    else if( (seq % 6) == 1 )
+    {
+        msg_pos_llh_t msg;
+        const double lat = 37.0 + (1.0e-7 * (double) epoch);
+        const double lon = -122.0 - (1.0e-7 * (double) epoch);
+        const double height = 20.0 + (0.001 * (double) (epoch % 100));
+
+        msg.tow = tow;
+        memcpy( &msg.lat, &lat, sizeof(msg.lat) );
+        memcpy( &msg.lon, &lon, sizeof(msg.lon) );
+        memcpy( &msg.height, &height, sizeof(msg.height) );
+        msg.h_accuracy = 0;
+        msg.v_accuracy = 0;
+        msg.n_sats = 9;
+        msg.flags = 1;
+
+        size = sbp_frame( SBP_MSG_POS_LLH, &msg, (uint8_t) sizeof(msg), frame );
+    }
+    else if( (seq % 6) == 2 )
+    {
+        msg_vel_ned_t msg;
+
+        msg.tow = tow;
+        msg.n = (s32) (epoch % 5000);
+        msg.e = -(s32) (epoch % 3000);
+        msg.d = 10;
+        msg.h_accuracy = 0;
+        msg.v_accuracy = 0;
+        msg.n_sats = 9;
+        msg.flags = 0;
+
+        size = sbp_frame( SBP_MSG_VEL_NED, &msg, (uint8_t) sizeof(msg), frame );
+    }
+    else if( (seq % 6) == 3 )
+    {
+        msg_baseline_ned_t msg;
+
+        msg.tow = tow;
+        msg.n = (s32) (10 * epoch);
+        msg.e = (s32) (20 * epoch);
+        msg.d = -5;
+        msg.h_accuracy = 0;
+        msg.v_accuracy = 0;
+        msg.n_sats = 9;
+        msg.flags = 1;
+
+        size = sbp_frame( SBP_MSG_BASELINE_NED, &msg, (uint8_t) sizeof(msg), frame );
+    }
+    else if( (seq % 6) == 4 )
+    {
+        msg_dops_t msg;
+
+        msg.tow = tow;
+        msg.gdop = (u16) (150 + ((epoch / 50) % 20));
+        msg.pdop = 120;
+        msg.tdop = 80;
+        msg.hdop = 90;
+        msg.vdop = 100;
+
+        size = sbp_frame( SBP_MSG_DOPS, &msg, (uint8_t) sizeof(msg), frame );
+    }
+    else
+    {
+        msg_heartbeat_t msg;
+
+        msg.flags = 0;
+
+        size = sbp_frame( SBP_MSG_HEARTBEAT, &msg, (uint8_t) sizeof(msg), frame );
+    }
+
+    return size;
+}
+
+
+// one MTData2 message with the data items the gateway decodes
+static uint16_t gen_xbus(
+        const uint32_t seq,
+        uint8_t * const frame )
+{
+    uint16_t size = 0;
+    uint16_t idx = 0;
+    uint8_t checksum = 0;
+    uint8_t data[ FRAME_SIZE_MAX ];
+
+    const float t = 0.01f * (float) seq;
+
+    // sample time fine, 10 kHz counter
+    size += put_u16_be( &data[ size ], XDI_SampleTimeFine );
+    data[ size++ ] = 4;
+    size += put_u32_be( &data[ size ], 100UL * seq );
+
+    // UTC time
+    size += put_u16_be( &data[ size ], XDI_UtcTime );
+    data[ size++ ] = 12;
+    size += put_u32_be( &data[ size ], 10000000UL * (seq % 100) );
+    size += put_u16_be( &data[ size ], 2017 );
+    data[ size++ ] = 6;
+    data[ size++ ] = 1;
+    data[ size++ ] = (uint8_t) ((seq / 360000) % 24);
+    data[ size++ ] = (uint8_t) ((seq / 6000) % 60);
+    data[ size++ ] = (uint8_t) ((seq / 100) % 60);
+    data[ size++ ] = 0x07;
+
+    // orientation
+    size += put_u16_be( &data[ size ], XDI_Quaternion );
+    data[ size++ ] = 16;
+    size += put_float_be( &data[ size ], 1.0f );
+    size += put_float_be( &data[ size ], 0.0f );
+    size += put_float_be( &data[ size ], 0.0f );
+    size += put_float_be( &data[ size ], 0.001f * t );
+
+    // rate of turn
+    size += put_u16_be( &data[ size ], XDI_RateOfTurn );
+    data[ size++ ] = 12;
+    size += put_float_be( &data[ size ], 0.01f );
+    size += put_float_be( &data[ size ], -0.02f );
+    size += put_float_be( &data[ size ], 0.5f );
+
+    // free acceleration
+    size += put_u16_be( &data[ size ], XDI_FreeAcceleration );
+    data[ size++ ] = 12;
+    size += put_float_be( &data[ size ], 0.1f );
+    size += put_float_be( &data[ size ], 0.2f );
+    size += put_float_be( &data[ size ], -0.05f );
+
+    // magnetic field
+    size += put_u16_be( &data[ size ], XDI_MagneticField );
+    data[ size++ ] = 12;
+    size += put_float_be( &data[ size ], 0.4f );
+    size += put_float_be( &data[ size ], 0.1f );
+    size += put_float_be( &data[ size ], -0.8f );
+
+    // position
+    size += put_u16_be( &data[ size ], XDI_LatLon );
+    data[ size++ ] = 8;
+    size += put_float_be( &data[ size ], 37.0f );
+    size += put_float_be( &data[ size ], -122.0f );
+
+    size += put_u16_be( &data[ size ], XDI_AltitudeEllipsoid );
+    data[ size++ ] = 4;
+    size += put_float_be( &data[ size ], 20.0f );
+
+    // velocity
+    size += put_u16_be( &data[ size ], XDI_VelocityXYZ );
+    data[ size++ ] = 12;
+    size += put_float_be( &data[ size ], 10.0f );
+    size += put_float_be( &data[ size ], 0.5f );
+    size += put_float_be( &data[ size ], 0.0f );
+
+    // status
+    size += put_u16_be( &data[ size ], XDI_StatusByte );
+    data[ size++ ] = 1;
+    data[ size++ ] = 0x07;
+
+    frame[ 0 ] = XBUS_PREAMBLE;
+    frame[ 1 ] = XBUS_MASTERDEVICE;
+    frame[ 2 ] = XMID_MtData2;
+    frame[ 3 ] = (uint8_t) size;
+    memcpy( &frame[ 4 ], data, size );
+
+    // everything after the preamble sums to zero
+    for( idx = 1; idx < (4 + size); idx += 1 )
+    {
+        checksum -= frame[ idx ];
+    }
+
+    frame[ 4 + size ] = checksum;
+
+    return (uint16_t) (4 + size + 1);
+}
+
+
+// alternates the table 209 and table 16 responses the gateway polls
+static uint16_t gen_obd(
+        const uint32_t seq,
+        uint8_t * const frame )
+{
+    uint8_t idx = 0;
+    uint8_t checksum = 0;
+
+    const uint8_t table = ((seq % 2) == 0) ? HOBD_TABLE_209 : HOBD_TABLE_16;
+    const uint8_t count = (table == HOBD_TABLE_209) ? 5 : 16;
+    const uint8_t size = (uint8_t) (sizeof(hobd_table_response_s) + count + 1);
+
+    frame[ 0 ] = HOBD_PACKET_TYPE_RESPONSE;
+    frame[ 1 ] = size;
+    frame[ 2 ] = HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP;
+    frame[ 3 ] = table;
+    frame[ 4 ] = 0;
+
+    for( idx = 0; idx < count; idx += 1 )
+    {
+        frame[ sizeof(hobd_table_response_s) + idx ] = (uint8_t) ((seq / 8) + (7 * idx));
+    }
+
+    for( idx = 0; idx < (size - 1); idx += 1 )
+    {
+        checksum -= frame[ idx ];
+    }
+
+    frame[ size - 1 ] = checksum;
+
+    return size;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    frame_gen_cb gen = NULL;
+    uint32_t seq = 0;
+    uint64_t written = 0;
+    uint8_t frame[ FRAME_SIZE_MAX ];
+
+    if( argc == 3 )
+    {
+        if( strcmp( argv[ 1 ], "sbp" ) == 0 )
+        {
+            gen = &gen_sbp;
+        }
+        else if( strcmp( argv[ 1 ], "xbus" ) == 0 )
+        {
+            gen = &gen_xbus;
+        }
+        else if( strcmp( argv[ 1 ], "obd" ) == 0 )
+        {
+            gen = &gen_obd;
+        }
+    }
+
+    if( gen == NULL )
+    {
+        fprintf( stderr, "usage: %s <sbp|xbus|obd> <seconds>\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else
+    {
+        const uint64_t total = (strtoull( argv[ 2 ], NULL, 0 ) * LINE_BAUDRATE) / BITS_PER_BYTE;
+
+        while( (written < total) && (ret == EXIT_SUCCESS) )
+        {
+            const uint16_t size = gen( seq, frame );
+
+            if( fwrite( frame, 1, size, stdout ) != size )
+            {
+                ret = EXIT_FAILURE;
+            }
+
+            written += size;
+            seq += 1;
+        }
+    }
+
+    return ret;
+}
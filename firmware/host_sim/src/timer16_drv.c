@@ -0,0 +1,232 @@
+/**
+ * @file timer16_drv.c
+ * @brief Simulated 16-bit timers, replaces the BSP timer16_drv.c on the host.
+ *
+ * Timer 1 and 3 count virtual time at the selected internal clock in
+ * normal mode, no compare or capture interrupts. Firmware code takes no
+ * virtual time, so intervals measured between two reads in the same main
+ * loop pass are zero.
+ *
+ * The overflow flags are owned by the simulation: a wrap sets TOVn, the
+ * overflow vector runs once per wrap as soon as TOIEn and interrupts are
+ * enabled, and a firmware write to clear the flag takes effect at the
+ * next step.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <avr/io.h>
+
+#include "board.h"
+#include "timer16_drv.h"
+#include "sim.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+typedef struct
+{
+    //
+    //
+    volatile uint8_t * const tccrb;
+    //
+    //
+    volatile uint16_t * const tcnt;
+    //
+    //
+    volatile uint8_t * const timsk;
+    //
+    //
+    volatile uint8_t * const tifr;
+    //
+    //
+    void (* const overflow_vector)( void );
+    //
+    // CPU cycles not yet counted as a timer tick
+    uint32_t remainder;
+    //
+    // wraps not yet serviced by the overflow vector
+    uint32_t overflows;
+} sim_timer16_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static sim_timer16_s timers[] =
+{
+    { &TCCR1B, &TCNT1, &TIMSK1, &TIFR1, &TIMER1_OVF_vect, 0, 0 },
+    { &TCCR3B, &TCNT3, &TIMSK3, &TIFR3, &TIMER3_OVF_vect, 0, 0 }
+};
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint32_t get_prescaler(
+        const uint8_t clock );
+
+
+//
+static void service_overflow(
+        sim_timer16_s * const timer );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// gateways without a timer overflow interrupt still link
+__attribute__((weak)) void TIMER1_OVF_vect( void )
+{
+}
+
+
+//
+__attribute__((weak)) void TIMER3_OVF_vect( void )
+{
+}
+
+
+// zero if the timer is stopped or externally clocked
+static uint32_t get_prescaler(
+        const uint8_t clock )
+{
+    uint32_t prescaler = 0;
+
+    if( clock == TIMER16_CLKIO_BY_1 )
+    {
+        prescaler = 1;
+    }
+    else if( clock == TIMER16_CLKIO_BY_8 )
+    {
+        prescaler = 8;
+    }
+    else if( clock == TIMER16_CLKIO_BY_64 )
+    {
+        prescaler = 64;
+    }
+    else if( clock == TIMER16_CLKIO_BY_256 )
+    {
+        prescaler = 256;
+    }
+    else if( clock == TIMER16_CLKIO_BY_1024 )
+    {
+        prescaler = 1024;
+    }
+
+    return prescaler;
+}
+
+
+// TOIE and TOV are bit 0 on both timers
+static void service_overflow(
+        sim_timer16_s * const timer )
+{
+    if(
+            (timer->overflows != 0)
+            && ((*timer->timsk & _BV( TOIE1 )) != 0)
+            && ((SREG & _BV( SREG_I )) != 0) )
+    {
+        while( timer->overflows != 0 )
+        {
+            timer->overflows -= 1;
+            timer->overflow_vector();
+        }
+    }
+
+    if( timer->overflows != 0 )
+    {
+        *timer->tifr |= _BV( TOV1 );
+    }
+    else
+    {
+        *timer->tifr &= (uint8_t) ~_BV( TOV1 );
+    }
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_timer16_service(
+        const uint32_t interval_us )
+{
+    uint8_t idx = 0;
+
+    for( idx = 0; idx < (uint8_t) (sizeof(timers) / sizeof(timers[ 0 ])); idx += 1 )
+    {
+        sim_timer16_s * const timer = &timers[ idx ];
+
+        const uint32_t prescaler = get_prescaler(
+                (uint8_t) ((*timer->tccrb & TIMER16_CLK_MASK) >> CS10) );
+
+        if( prescaler == 0 )
+        {
+            timer->remainder = 0;
+        }
+        else
+        {
+            // FOSC is in kHz
+            const uint64_t cycles =
+                    (uint64_t) timer->remainder + (((uint64_t) interval_us * FOSC) / 1000ULL);
+
+            const uint64_t count = (uint64_t) *timer->tcnt + (cycles / prescaler);
+
+            *timer->tcnt = (uint16_t) count;
+
+            timer->overflows += (uint32_t) (count >> 16);
+
+            timer->remainder = (uint32_t) (cycles % prescaler);
+        }
+
+        service_overflow( timer );
+    }
+}
+
+
+//
+uint16_t timer16_get_counter( void )
+{
+    uint16_t u16_temp;
+
+    u16_temp  =  Timer16_get_counter_low();
+    u16_temp |= (Timer16_get_counter_high() << 8 );
+
+    return u16_temp;
+}
+
+
+//
+uint16_t timer16_get_capture( void )
+{
+    uint16_t u16_temp;
+
+    u16_temp  =  Timer16_get_capture_low();
+    u16_temp |= (Timer16_get_capture_high() << 8 );
+
+    return u16_temp;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file uart_drv.c
+ * @brief Simulated UART driver, replaces the BSP uart_drv.c on the host.
+ *
+ * Once enabled, each UART receives its input file at the baud rate
+ * programmed into UBRRn/U2Xn, one byte per receive complete interrupt. While the data
+ * register empty interrupt is enabled, every call of its vector is taken
+ * as one byte written to UDRn.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "board.h"
+#include "uart_drv.h"
+#include "sim.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// start, 8 data and stop bit
+#define BITS_PER_BYTE (10UL)
+
+
+//
+#define US_PER_S (1000000ULL)
+
+
+//
+typedef struct
+{
+    //
+    //
+    volatile uint8_t *ucsra;
+    //
+    //
+    volatile uint8_t *ucsrb;
+    //
+    //
+    volatile uint8_t *ubrrh;
+    //
+    //
+    volatile uint8_t *ubrrl;
+    //
+    //
+    volatile uint8_t *udr;
+    //
+    //
+    void (*rx_vector)( void );
+    //
+    //
+    void (*udre_vector)( void );
+    //
+    // line time not yet used by a whole byte
+    // baud times microseconds
+    uint64_t rx_remainder;
+    //
+    // baud times microseconds
+    uint64_t tx_remainder;
+    //
+    // set once the gateway has enabled the UART
+    uint8_t connected;
+} sim_uart_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+uint8_t uart_selected;
+
+
+// BSP timer16_drv.h selection, defined with the UART driver like the BSP
+uint8_t timer16_selected;
+
+
+//
+static sim_uart_s uarts[ SIM_UART_COUNT ] =
+{
+    {
+        &UCSR0A,
+        &UCSR0B,
+        &UBRR0H,
+        &UBRR0L,
+        &UDR0,
+        &USART0_RX_vect,
+        &USART0_UDRE_vect,
+        0,
+        0,
+        0
+    },
+    {
+        &UCSR1A,
+        &UCSR1B,
+        &UBRR1H,
+        &UBRR1L,
+        &UDR1,
+        &USART1_RX_vect,
+        &USART1_UDRE_vect,
+        0,
+        0,
+        0
+    }
+};
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint32_t get_baudrate(
+        sim_uart_s * const sim_uart );
+
+
+//
+static uint32_t get_byte_count(
+        uint64_t * const remainder,
+        const uint32_t baudrate,
+        const uint32_t interval_us );
+
+
+//
+static void service_rx(
+        const uint8_t uart,
+        const uint32_t count );
+
+
+//
+static void service_tx(
+        const uint8_t uart,
+        const uint32_t count );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// gateways only define the vectors they use
+__attribute__((weak)) void USART0_RX_vect( void )
+{
+}
+
+
+// gateways only define the vectors they use
+__attribute__((weak)) void USART0_UDRE_vect( void )
+{
+}
+
+
+// gateways only define the vectors they use
+__attribute__((weak)) void USART1_RX_vect( void )
+{
+}
+
+
+// gateways only define the vectors they use
+__attribute__((weak)) void USART1_UDRE_vect( void )
+{
+}
+
+
+// zero until the UART is enabled for the first time
+static uint32_t get_baudrate(
+        sim_uart_s * const sim_uart )
+{
+    uint32_t baudrate = 0;
+
+    const uint32_t ubrr =
+            ((uint32_t) (*sim_uart->ubrrh) << 8) | (uint32_t) (*sim_uart->ubrrl);
+
+    const uint32_t divisor = ((*sim_uart->ucsra & _BV( U2X0 )) != 0) ? 8UL : 16UL;
+
+    if( ((*sim_uart->ucsrb) & (_BV( RXEN0 ) | _BV( TXEN0 ))) != 0 )
+    {
+        sim_uart->connected = 1;
+    }
+
+    if( sim_uart->connected != 0 )
+    {
+        baudrate = ((uint32_t) FOSC * 1000UL) / (divisor * (ubrr + 1));
+    }
+
+    return baudrate;
+}
+
+
+//
+static uint32_t get_byte_count(
+        uint64_t * const remainder,
+        const uint32_t baudrate,
+        const uint32_t interval_us )
+{
+    const uint64_t line_time =
+            (*remainder) + ((uint64_t) baudrate * (uint64_t) interval_us);
+
+    const uint64_t byte_time = BITS_PER_BYTE * US_PER_S;
+
+    (*remainder) = (line_time % byte_time);
+
+    return (uint32_t) (line_time / byte_time);
+}
+
+
+// bytes arrive whether the receiver is enabled or not
+static void service_rx(
+        const uint8_t uart,
+        const uint32_t count )
+{
+    uint32_t idx = 0;
+    sim_uart_s * const sim_uart = &uarts[ uart ];
+
+    for( idx = 0; idx < count; idx += 1 )
+    {
+        const int16_t data = sim_uart_read( uart );
+
+        if( data == SIM_UART_NO_DATA )
+        {
+            break;
+        }
+
+        if( ((*sim_uart->ucsrb) & _BV( RXEN0 )) != 0 )
+        {
+            (*sim_uart->udr) = (uint8_t) data;
+            (*sim_uart->ucsra) |= _BV( RXC0 );
+
+            if( ((*sim_uart->ucsrb) & _BV( RXCIE0 )) != 0 )
+            {
+                sim_uart->rx_vector();
+
+                (*sim_uart->ucsra) &= (uint8_t) ~_BV( RXC0 );
+            }
+        }
+    }
+}
+
+
+//
+static void service_tx(
+        const uint8_t uart,
+        const uint32_t count )
+{
+    uint32_t idx = 0;
+    sim_uart_s * const sim_uart = &uarts[ uart ];
+
+    (*sim_uart->ucsra) |= _BV( UDRE0 );
+
+    for( idx = 0; idx < count; idx += 1 )
+    {
+        const uint8_t enabled = _BV( TXEN0 ) | _BV( UDRIE0 );
+
+        if( ((*sim_uart->ucsrb) & enabled) != enabled )
+        {
+            break;
+        }
+
+        sim_uart->udre_vector();
+
+        sim_uart_write( uart, (*sim_uart->udr) );
+    }
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void sim_uart_service(
+        const uint32_t interval_us )
+{
+    uint8_t uart = 0;
+
+    for( uart = 0; uart < SIM_UART_COUNT; uart += 1 )
+    {
+        sim_uart_s * const sim_uart = &uarts[ uart ];
+
+        const uint32_t baudrate = get_baudrate( sim_uart );
+
+        if( baudrate != 0 )
+        {
+            service_rx(
+                    uart,
+                    get_byte_count( &sim_uart->rx_remainder, baudrate, interval_us ) );
+
+            service_tx(
+                    uart,
+                    get_byte_count( &sim_uart->tx_remainder, baudrate, interval_us ) );
+        }
+    }
+}
+
+
+//
+uint8_t uart_set_baudrate(
+        uint32_t baudrate )
+{
+    uint8_t ret = 0;
+
+    if( baudrate != 0 )
+    {
+        Uart_set_ubrr( baudrate );
+
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+// idle line
+BOOL uart_rx_get_3_data( void )
+{
+    return 1;
+}
+
+
+// idle line
+BOOL uart_rx_get_data( void )
+{
+    return 1;
+}
@@ -0,0 +1,479 @@
+/**
+ * @file xbus_bench.c
+ * @brief MTData2 decode benchmark.
+ *
+ * Decodes the messages of an Xbus stream, as written by hobd-stream-gen,
+ * with the data items the IMU gateway uses, two ways:
+ *   - lookup - one XbusMessage_getDataItem per data identifier, each
+ *     scanning the payload from the start
+ *   - dispatch - one XbusMessage_dispatchDataItems walk over the payload
+ *
+ * Reports the host time per message for each.
+ *
+ * Usage: xbus-dispatch-bench <xbus file> [passes]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "xbusdef.h"
+#include "xbusmessage.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define PASSES_DEFAULT (200UL)
+
+
+// header is the preamble, bus ID, message ID and length
+#define XBUS_HEADER_SIZE (4)
+
+
+//
+#define XBUS_CHECKSUM_SIZE (1)
+
+
+// decoded items, kept so the decode is not optimized out
+typedef struct
+{
+    uint32_t sample_time;
+    XsGpsSol gps_sol;
+    XsUtcTime utc_time;
+    float quat[ 4 ];
+    float gyro[ 3 ];
+    float accel[ 3 ];
+    float magf[ 3 ];
+    float lat_lon[ 2 ];
+    float height;
+    float vel[ 3 ];
+    uint8_t status_byte;
+    uint32_t found;
+} decoded_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static decoded_s decoded;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static void decode_item(
+        void * const item,
+        const enum XsDataIdentifier id,
+        const uint8_t * const data,
+        const uint8_t size );
+
+
+//
+static void sample_time_cb( uint8_t const * data, uint8_t size, void * context );
+static void gps_sol_cb( uint8_t const * data, uint8_t size, void * context );
+static void utc_time_cb( uint8_t const * data, uint8_t size, void * context );
+static void quat_cb( uint8_t const * data, uint8_t size, void * context );
+static void gyro_cb( uint8_t const * data, uint8_t size, void * context );
+static void accel_cb( uint8_t const * data, uint8_t size, void * context );
+static void magf_cb( uint8_t const * data, uint8_t size, void * context );
+static void lat_lon_cb( uint8_t const * data, uint8_t size, void * context );
+static void height_cb( uint8_t const * data, uint8_t size, void * context );
+static void vel_cb( uint8_t const * data, uint8_t size, void * context );
+static void status_byte_cb( uint8_t const * data, uint8_t size, void * context );
+
+
+//
+static void decode_lookup(
+        const struct XbusMessage * const message );
+
+
+//
+static void decode_dispatch(
+        const struct XbusMessage * const message );
+
+
+//
+static uint32_t load_messages(
+        const char * const path,
+        uint8_t ** const stream,
+        struct XbusMessage ** const messages );
+
+
+//
+static double run(
+        void (*decode)( const struct XbusMessage * const message ),
+        const struct XbusMessage * const messages,
+        const uint32_t count,
+        const unsigned long passes );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// same order as the IMU gateway dispatch table
+static const struct XbusDataItemDispatch DISPATCH_TABLE[] =
+{
+    { XDI_SampleTimeFine, &sample_time_cb },
+    { XDI_GpsSol, &gps_sol_cb },
+    { XDI_UtcTime, &utc_time_cb },
+    { XDI_Quaternion, &quat_cb },
+    { XDI_RateOfTurn, &gyro_cb },
+    { XDI_FreeAcceleration, &accel_cb },
+    { XDI_MagneticField, &magf_cb },
+    { XDI_LatLon, &lat_lon_cb },
+    { XDI_AltitudeEllipsoid, &height_cb },
+    { XDI_VelocityXYZ, &vel_cb },
+    { XDI_StatusByte, &status_byte_cb }
+};
+
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+//
+static void decode_item(
+        void * const item,
+        const enum XsDataIdentifier id,
+        const uint8_t * const data,
+        const uint8_t size )
+{
+    if( XbusMessage_readDataItem( item, id, data, size ) )
+    {
+        decoded.found += 1;
+    }
+}
+
+
+//
+static void sample_time_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( &decoded.sample_time, XDI_SampleTimeFine, data, size );
+}
+
+
+//
+static void gps_sol_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( &decoded.gps_sol, XDI_GpsSol, data, size );
+}
+
+
+//
+static void utc_time_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( &decoded.utc_time, XDI_UtcTime, data, size );
+}
+
+
+//
+static void quat_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.quat, XDI_Quaternion, data, size );
+}
+
+
+//
+static void gyro_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.gyro, XDI_RateOfTurn, data, size );
+}
+
+
+//
+static void accel_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.accel, XDI_FreeAcceleration, data, size );
+}
+
+
+//
+static void magf_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.magf, XDI_MagneticField, data, size );
+}
+
+
+//
+static void lat_lon_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.lat_lon, XDI_LatLon, data, size );
+}
+
+
+//
+static void height_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( &decoded.height, XDI_AltitudeEllipsoid, data, size );
+}
+
+
+//
+static void vel_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( decoded.vel, XDI_VelocityXYZ, data, size );
+}
+
+
+//
+static void status_byte_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    decode_item( &decoded.status_byte, XDI_StatusByte, data, size );
+}
+
+
+// the gateway's decode before the dispatch table
+static void decode_lookup(
+        const struct XbusMessage * const message )
+{
+    uint8_t idx = 0;
+
+    void * const items[] =
+    {
+        &decoded.sample_time,
+        &decoded.gps_sol,
+        &decoded.utc_time,
+        decoded.quat,
+        decoded.gyro,
+        decoded.accel,
+        decoded.magf,
+        decoded.lat_lon,
+        &decoded.height,
+        decoded.vel,
+        &decoded.status_byte
+    };
+
+    for( idx = 0; idx < (uint8_t) (sizeof(items) / sizeof(items[0])); idx += 1 )
+    {
+        if( XbusMessage_getDataItem( items[ idx ], DISPATCH_TABLE[ idx ].id, message ) )
+        {
+            decoded.found += 1;
+        }
+    }
+}
+
+
+//
+static void decode_dispatch(
+        const struct XbusMessage * const message )
+{
+    (void) XbusMessage_dispatchDataItems(
+            message,
+            DISPATCH_TABLE,
+            (uint8_t) (sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0])),
+            NULL );
+}
+
+
+// MTData2 messages with a short length field, as hobd-stream-gen writes
+// them, checksums are not checked
+static uint32_t load_messages(
+        const char * const path,
+        uint8_t ** const stream,
+        struct XbusMessage ** const messages )
+{
+    uint32_t count = 0;
+    long size = 0;
+    long offset = 0;
+
+    FILE * const file = fopen( path, "rb" );
+
+    (*stream) = NULL;
+    (*messages) = NULL;
+
+    if( file != NULL )
+    {
+        if( fseek( file, 0, SEEK_END ) == 0 )
+        {
+            size = ftell( file );
+        }
+
+        if( (size > 0) && (fseek( file, 0, SEEK_SET ) == 0) )
+        {
+            (*stream) = malloc( (size_t) size );
+
+            // no message is smaller than a header and checksum
+            (*messages) = calloc(
+                    (size_t) (size / (XBUS_HEADER_SIZE + XBUS_CHECKSUM_SIZE)) + 1,
+                    sizeof(**messages) );
+        }
+
+        if(
+                ((*stream) != NULL)
+                && ((*messages) != NULL)
+                && (fread( (*stream), 1, (size_t) size, file ) == (size_t) size) )
+        {
+            while( (offset + XBUS_HEADER_SIZE) <= size )
+            {
+                const uint8_t * const header = &(*stream)[ offset ];
+                const long length = (long) header[ 3 ];
+
+                if(
+                        (header[ 0 ] != XBUS_PREAMBLE)
+                        || (header[ 1 ] != XBUS_MASTERDEVICE)
+                        || (header[ 3 ] == XBUS_EXTENDED_LENGTH) )
+                {
+                    offset += 1;
+                }
+                else if( (offset + XBUS_HEADER_SIZE + length + XBUS_CHECKSUM_SIZE) > size )
+                {
+                    offset = size;
+                }
+                else
+                {
+                    if( header[ 2 ] == XMID_MtData2 )
+                    {
+                        (*messages)[ count ].mid = XMID_MtData2;
+                        (*messages)[ count ].length = (uint16_t) length;
+                        (*messages)[ count ].data = (void*) &header[ XBUS_HEADER_SIZE ];
+
+                        count += 1;
+                    }
+
+                    offset += (XBUS_HEADER_SIZE + length + XBUS_CHECKSUM_SIZE);
+                }
+            }
+        }
+
+        (void) fclose( file );
+    }
+
+    return count;
+}
+
+
+// ns per message
+static double run(
+        void (*decode)( const struct XbusMessage * const message ),
+        const struct XbusMessage * const messages,
+        const uint32_t count,
+        const unsigned long passes )
+{
+    unsigned long pass = 0;
+    uint32_t idx = 0;
+
+    const double start = get_time_ns();
+
+    for( pass = 0; pass < passes; pass += 1 )
+    {
+        for( idx = 0; idx < count; idx += 1 )
+        {
+            decode( &messages[ idx ] );
+        }
+    }
+
+    const double end = get_time_ns();
+
+    return (end - start) / ((double) count * (double) passes);
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    uint8_t *stream = NULL;
+    struct XbusMessage *messages = NULL;
+    uint32_t count = 0;
+    unsigned long passes = PASSES_DEFAULT;
+
+    if( (argc != 2) && (argc != 3) )
+    {
+        fprintf( stderr, "usage: %s <xbus file> [passes]\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else
+    {
+        if( argc == 3 )
+        {
+            passes = strtoul( argv[ 2 ], NULL, 0 );
+        }
+
+        count = load_messages( argv[ 1 ], &stream, &messages );
+
+        if( (count == 0) || (passes == 0) )
+        {
+            fprintf( stderr, "%s: no MTData2 messages in '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        // warm up, and the item counts to check both decode the same
+        decoded.found = 0;
+        run( &decode_lookup, messages, count, 1 );
+        const uint32_t lookup_found = decoded.found;
+
+        decoded.found = 0;
+        run( &decode_dispatch, messages, count, 1 );
+        const uint32_t dispatch_found = decoded.found;
+
+        const double lookup_ns = run( &decode_lookup, messages, count, passes );
+        const double dispatch_ns = run( &decode_dispatch, messages, count, passes );
+
+        printf(
+                "xbus-dispatch-bench: %" PRIu32 " messages, %" PRIu32 "/%" PRIu32 " items decoded, %lu passes\n",
+                count,
+                lookup_found,
+                dispatch_found,
+                passes );
+
+        printf(
+                "xbus-dispatch-bench: lookup %.1f ns/message, dispatch %.1f ns/message (%.2fx)\n",
+                lookup_ns,
+                dispatch_ns,
+                lookup_ns / dispatch_ns );
+
+        if( lookup_found != dispatch_found )
+        {
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    free( messages );
+    free( stream );
+
+    return ret;
+}
@@ -0,0 +1,664 @@
+/**
+ * @file xbus_dispatch_test.c
+ * @brief Host test of the MTData2 data identifier dispatch.
+ *
+ * Decodes every MTData2 message of an Xbus stream, as written by
+ * hobd-stream-gen, with the data items the IMU gateway uses, once with
+ * one XbusMessage_getDataItem per identifier and once with an
+ * XbusMessage_dispatchDataItems walk. Both must decode the same items to
+ * the same values.
+ *
+ * Hand built payloads cover what the stream does not: items too short
+ * for their identifier, unknown identifiers, and items or item headers
+ * cut off by the end of the payload, which end the walk.
+ *
+ * Usage: xbus-dispatch-test <xbus file>
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "xbusdef.h"
+#include "xbusmessage.h"
+#include "sim_test.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// header is the preamble, bus ID, message ID and length
+#define XBUS_HEADER_SIZE (4)
+
+
+//
+#define XBUS_CHECKSUM_SIZE (1)
+
+
+// item ID and size
+#define ITEM_HEADER_SIZE (3)
+
+
+// not a data identifier the library decodes
+#define UNKNOWN_ID (0x1234)
+
+
+//
+#define PAYLOAD_SIZE_MAX (255)
+
+
+// DISPATCH_TABLE entries, bit index of found_mask
+#define ITEM_SAMPLE_TIME (0)
+#define ITEM_GPS_SOL (1)
+#define ITEM_UTC_TIME (2)
+#define ITEM_QUAT (3)
+#define ITEM_GYRO (4)
+#define ITEM_ACCEL (5)
+#define ITEM_MAGF (6)
+#define ITEM_LAT_LON (7)
+#define ITEM_HEIGHT (8)
+#define ITEM_VEL (9)
+#define ITEM_STATUS_BYTE (10)
+#define ITEM_COUNT (11)
+
+
+//
+#define ITEM_BIT(item) ((uint16_t) (1U << (item)))
+
+
+// decoded items, zeroed before each message so they compare as bytes
+typedef struct
+{
+    uint32_t sample_time;
+    XsGpsSol gps_sol;
+    XsUtcTime utc_time;
+    float quat[ 4 ];
+    float gyro[ 3 ];
+    float accel[ 3 ];
+    float magf[ 3 ];
+    float lat_lon[ 2 ];
+    float height;
+    float vel[ 3 ];
+    uint8_t status_byte;
+    uint16_t found_mask;
+} decoded_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void *get_item(
+        decoded_s * const decoded,
+        const uint8_t item );
+
+
+//
+static void dispatch_item(
+        const uint8_t item,
+        uint8_t const * data,
+        uint8_t size,
+        void * context );
+
+
+//
+static void sample_time_cb( uint8_t const * data, uint8_t size, void * context );
+static void gps_sol_cb( uint8_t const * data, uint8_t size, void * context );
+static void utc_time_cb( uint8_t const * data, uint8_t size, void * context );
+static void quat_cb( uint8_t const * data, uint8_t size, void * context );
+static void gyro_cb( uint8_t const * data, uint8_t size, void * context );
+static void accel_cb( uint8_t const * data, uint8_t size, void * context );
+static void magf_cb( uint8_t const * data, uint8_t size, void * context );
+static void lat_lon_cb( uint8_t const * data, uint8_t size, void * context );
+static void height_cb( uint8_t const * data, uint8_t size, void * context );
+static void vel_cb( uint8_t const * data, uint8_t size, void * context );
+static void status_byte_cb( uint8_t const * data, uint8_t size, void * context );
+
+
+//
+static void decode_lookup(
+        const struct XbusMessage * const message,
+        decoded_s * const decoded );
+
+
+//
+static uint8_t decode_dispatch(
+        const struct XbusMessage * const message,
+        decoded_s * const decoded );
+
+
+//
+static uint16_t add_item(
+        uint8_t * const payload,
+        const uint16_t len,
+        const uint16_t id,
+        const uint8_t size );
+
+
+//
+static uint32_t load_messages(
+        const char * const path,
+        uint8_t ** const stream,
+        struct XbusMessage ** const messages );
+
+
+//
+static void test_stream(
+        const struct XbusMessage * const messages,
+        const uint32_t count );
+
+
+//
+static void test_short_item( void );
+
+
+//
+static void test_unknown_items( void );
+
+
+//
+static void test_truncated_item( void );
+
+
+//
+static void test_truncated_header( void );
+
+
+//
+static void test_empty( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// same order as the IMU gateway dispatch table, indexed by ITEM_*
+static const struct XbusDataItemDispatch DISPATCH_TABLE[ ITEM_COUNT ] =
+{
+    { XDI_SampleTimeFine, &sample_time_cb },
+    { XDI_GpsSol, &gps_sol_cb },
+    { XDI_UtcTime, &utc_time_cb },
+    { XDI_Quaternion, &quat_cb },
+    { XDI_RateOfTurn, &gyro_cb },
+    { XDI_FreeAcceleration, &accel_cb },
+    { XDI_MagneticField, &magf_cb },
+    { XDI_LatLon, &lat_lon_cb },
+    { XDI_AltitudeEllipsoid, &height_cb },
+    { XDI_VelocityXYZ, &vel_cb },
+    { XDI_StatusByte, &status_byte_cb }
+};
+
+
+//
+static void *get_item(
+        decoded_s * const decoded,
+        const uint8_t item )
+{
+    void * const items[ ITEM_COUNT ] =
+    {
+        &decoded->sample_time,
+        &decoded->gps_sol,
+        &decoded->utc_time,
+        decoded->quat,
+        decoded->gyro,
+        decoded->accel,
+        decoded->magf,
+        decoded->lat_lon,
+        &decoded->height,
+        decoded->vel,
+        &decoded->status_byte
+    };
+
+    return items[ item ];
+}
+
+
+//
+static void dispatch_item(
+        const uint8_t item,
+        uint8_t const * data,
+        uint8_t size,
+        void * context )
+{
+    decoded_s * const decoded = (decoded_s*) context;
+
+    if( XbusMessage_readDataItem( get_item( decoded, item ), DISPATCH_TABLE[ item ].id, data, size ) )
+    {
+        decoded->found_mask |= ITEM_BIT( item );
+    }
+}
+
+
+//
+static void sample_time_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_SAMPLE_TIME, data, size, context );
+}
+
+
+//
+static void gps_sol_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_GPS_SOL, data, size, context );
+}
+
+
+//
+static void utc_time_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_UTC_TIME, data, size, context );
+}
+
+
+//
+static void quat_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_QUAT, data, size, context );
+}
+
+
+//
+static void gyro_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_GYRO, data, size, context );
+}
+
+
+//
+static void accel_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_ACCEL, data, size, context );
+}
+
+
+//
+static void magf_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_MAGF, data, size, context );
+}
+
+
+//
+static void lat_lon_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_LAT_LON, data, size, context );
+}
+
+
+//
+static void height_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_HEIGHT, data, size, context );
+}
+
+
+//
+static void vel_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_VEL, data, size, context );
+}
+
+
+//
+static void status_byte_cb( uint8_t const * data, uint8_t size, void * context )
+{
+    dispatch_item( ITEM_STATUS_BYTE, data, size, context );
+}
+
+
+// the gateway's decode before the dispatch table
+static void decode_lookup(
+        const struct XbusMessage * const message,
+        decoded_s * const decoded )
+{
+    uint8_t item = 0;
+
+    memset( decoded, 0, sizeof(*decoded) );
+
+    for( item = 0; item < ITEM_COUNT; item += 1 )
+    {
+        if( XbusMessage_getDataItem( get_item( decoded, item ), DISPATCH_TABLE[ item ].id, message ) )
+        {
+            decoded->found_mask |= ITEM_BIT( item );
+        }
+    }
+}
+
+
+// returns non-zero if the whole payload was walked
+static uint8_t decode_dispatch(
+        const struct XbusMessage * const message,
+        decoded_s * const decoded )
+{
+    memset( decoded, 0, sizeof(*decoded) );
+
+    return XbusMessage_dispatchDataItems(
+            message,
+            DISPATCH_TABLE,
+            ITEM_COUNT,
+            decoded ) ? 1 : 0;
+}
+
+
+// big endian ID and size, then size bytes of item data
+static uint16_t add_item(
+        uint8_t * const payload,
+        const uint16_t len,
+        const uint16_t id,
+        const uint8_t size )
+{
+    uint8_t idx = 0;
+
+    payload[ len ] = (uint8_t) (id >> 8);
+    payload[ len + 1 ] = (uint8_t) (id & 0xFF);
+    payload[ len + 2 ] = size;
+
+    for( idx = 0; idx < size; idx += 1 )
+    {
+        payload[ len + ITEM_HEADER_SIZE + idx ] = (uint8_t) (len + idx + 1);
+    }
+
+    return (uint16_t) (len + ITEM_HEADER_SIZE + size);
+}
+
+
+// MTData2 messages with a short length field, as hobd-stream-gen writes
+// them, checksums are not checked
+static uint32_t load_messages(
+        const char * const path,
+        uint8_t ** const stream,
+        struct XbusMessage ** const messages )
+{
+    uint32_t count = 0;
+    long size = 0;
+    long offset = 0;
+
+    FILE * const file = fopen( path, "rb" );
+
+    (*stream) = NULL;
+    (*messages) = NULL;
+
+    if( file != NULL )
+    {
+        if( fseek( file, 0, SEEK_END ) == 0 )
+        {
+            size = ftell( file );
+        }
+
+        if( (size > 0) && (fseek( file, 0, SEEK_SET ) == 0) )
+        {
+            (*stream) = malloc( (size_t) size );
+
+            // no message is smaller than a header and checksum
+            (*messages) = calloc(
+                    (size_t) (size / (XBUS_HEADER_SIZE + XBUS_CHECKSUM_SIZE)) + 1,
+                    sizeof(**messages) );
+        }
+
+        if(
+                ((*stream) != NULL)
+                && ((*messages) != NULL)
+                && (fread( (*stream), 1, (size_t) size, file ) == (size_t) size) )
+        {
+            while( (offset + XBUS_HEADER_SIZE) <= size )
+            {
+                const uint8_t * const header = &(*stream)[ offset ];
+                const long length = (long) header[ 3 ];
+
+                if(
+                        (header[ 0 ] != XBUS_PREAMBLE)
+                        || (header[ 1 ] != XBUS_MASTERDEVICE)
+                        || (header[ 3 ] == XBUS_EXTENDED_LENGTH) )
+                {
+                    offset += 1;
+                }
+                else if( (offset + XBUS_HEADER_SIZE + length + XBUS_CHECKSUM_SIZE) > size )
+                {
+                    offset = size;
+                }
+                else
+                {
+                    if( header[ 2 ] == XMID_MtData2 )
+                    {
+                        (*messages)[ count ].mid = XMID_MtData2;
+                        (*messages)[ count ].length = (uint16_t) length;
+                        (*messages)[ count ].data = (void*) &header[ XBUS_HEADER_SIZE ];
+
+                        count += 1;
+                    }
+
+                    offset += (XBUS_HEADER_SIZE + length + XBUS_CHECKSUM_SIZE);
+                }
+            }
+        }
+
+        (void) fclose( file );
+    }
+
+    return count;
+}
+
+
+//
+static void test_stream(
+        const struct XbusMessage * const messages,
+        const uint32_t count )
+{
+    uint32_t idx = 0;
+    uint32_t mismatch_count = 0;
+    uint16_t found_any = 0;
+    decoded_s lookup;
+    decoded_s dispatch;
+
+    for( idx = 0; idx < count; idx += 1 )
+    {
+        decode_lookup( &messages[ idx ], &lookup );
+
+        if(
+                (decode_dispatch( &messages[ idx ], &dispatch ) == 0)
+                || (memcmp( &lookup, &dispatch, sizeof(lookup) ) != 0) )
+        {
+            mismatch_count += 1;
+        }
+
+        found_any |= dispatch.found_mask;
+    }
+
+    SIM_TEST_CHECK( count != 0 );
+    SIM_TEST_CHECK( mismatch_count == 0 );
+
+    // the generated stream has every item the gateway uses but GpsSol
+    SIM_TEST_CHECK( found_any == ((ITEM_BIT( ITEM_COUNT ) - 1) & ~ITEM_BIT( ITEM_GPS_SOL )) );
+}
+
+
+// a quaternion item with a rate of turn's size is skipped, the items
+// around it still decode
+static void test_short_item( void )
+{
+    uint8_t payload[ PAYLOAD_SIZE_MAX ];
+    uint16_t len = 0;
+    struct XbusMessage message;
+    decoded_s lookup;
+    decoded_s dispatch;
+
+    len = add_item( payload, len, XDI_SampleTimeFine, 4 );
+    len = add_item( payload, len, XDI_Quaternion, 12 );
+    len = add_item( payload, len, XDI_StatusByte, 1 );
+
+    message.mid = XMID_MtData2;
+    message.length = len;
+    message.data = payload;
+
+    decode_lookup( &message, &lookup );
+
+    SIM_TEST_CHECK( decode_dispatch( &message, &dispatch ) != 0 );
+    SIM_TEST_CHECK( dispatch.found_mask == (ITEM_BIT( ITEM_SAMPLE_TIME ) | ITEM_BIT( ITEM_STATUS_BYTE )) );
+    SIM_TEST_CHECK( memcmp( &lookup, &dispatch, sizeof(lookup) ) == 0 );
+}
+
+
+//
+static void test_unknown_items( void )
+{
+    uint8_t payload[ PAYLOAD_SIZE_MAX ];
+    uint16_t len = 0;
+    struct XbusMessage message;
+    decoded_s lookup;
+    decoded_s dispatch;
+
+    len = add_item( payload, len, UNKNOWN_ID, 5 );
+    len = add_item( payload, len, XDI_LatLon, 8 );
+    len = add_item( payload, len, UNKNOWN_ID, 0 );
+    len = add_item( payload, len, XDI_AltitudeEllipsoid, 4 );
+
+    message.mid = XMID_MtData2;
+    message.length = len;
+    message.data = payload;
+
+    decode_lookup( &message, &lookup );
+
+    SIM_TEST_CHECK( decode_dispatch( &message, &dispatch ) != 0 );
+    SIM_TEST_CHECK( dispatch.found_mask == (ITEM_BIT( ITEM_LAT_LON ) | ITEM_BIT( ITEM_HEIGHT )) );
+    SIM_TEST_CHECK( memcmp( &lookup, &dispatch, sizeof(lookup) ) == 0 );
+}
+
+
+// the walk stops at an item that runs past the payload, the items
+// before it are dispatched
+static void test_truncated_item( void )
+{
+    uint8_t payload[ PAYLOAD_SIZE_MAX ];
+    uint16_t len = 0;
+    struct XbusMessage message;
+    decoded_s dispatch;
+
+    len = add_item( payload, len, XDI_SampleTimeFine, 4 );
+    len = add_item( payload, len, XDI_Quaternion, 16 );
+
+    message.mid = XMID_MtData2;
+    message.length = (uint16_t) (len - 8);
+    message.data = payload;
+
+    SIM_TEST_CHECK( decode_dispatch( &message, &dispatch ) == 0 );
+    SIM_TEST_CHECK( dispatch.found_mask == ITEM_BIT( ITEM_SAMPLE_TIME ) );
+}
+
+
+//
+static void test_truncated_header( void )
+{
+    uint8_t payload[ PAYLOAD_SIZE_MAX ];
+    uint16_t len = 0;
+    struct XbusMessage message;
+    decoded_s dispatch;
+
+    len = add_item( payload, len, XDI_StatusByte, 1 );
+    len = add_item( payload, len, XDI_SampleTimeFine, 4 );
+
+    message.mid = XMID_MtData2;
+    message.length = (uint16_t) (len - 4 - 1);
+    message.data = payload;
+
+    SIM_TEST_CHECK( decode_dispatch( &message, &dispatch ) == 0 );
+    SIM_TEST_CHECK( dispatch.found_mask == ITEM_BIT( ITEM_STATUS_BYTE ) );
+}
+
+
+//
+static void test_empty( void )
+{
+    uint8_t payload[ 1 ] = { 0 };
+    struct XbusMessage message;
+    decoded_s dispatch;
+
+    message.mid = XMID_MtData2;
+    message.length = 0;
+    message.data = payload;
+
+    SIM_TEST_CHECK( decode_dispatch( &message, &dispatch ) != 0 );
+    SIM_TEST_CHECK( dispatch.found_mask == 0 );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    uint8_t *stream = NULL;
+    struct XbusMessage *messages = NULL;
+    uint32_t count = 0;
+
+    if( argc != 2 )
+    {
+        fprintf( stderr, "usage: %s <xbus file>\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else
+    {
+        count = load_messages( argv[ 1 ], &stream, &messages );
+
+        if( count == 0 )
+        {
+            fprintf( stderr, "%s: no MTData2 messages in '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        test_stream( messages, count );
+
+        test_short_item();
+
+        test_unknown_items();
+
+        test_truncated_item();
+
+        test_truncated_header();
+
+        test_empty();
+
+        ret = sim_test_result( "xbus-dispatch-test" );
+    }
+
+    free( messages );
+    free( stream );
+
+    return ret;
+}
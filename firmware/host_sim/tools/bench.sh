@@ -0,0 +1,35 @@
+#!/bin/bash
+#
+# Replays line rate streams into the simulated gateways and reports
+# the simulated time, wall time and bytes/s each gateway sustains, then
+# times the MTData2 decode on the Xsens stream and the SBP framing on the
+# Piksi stream.
+#
+# ./tools/bench.sh [seconds]
+#
+
+set -e
+
+SECONDS_OF_DATA=${1:-60}
+
+cd "$(dirname "$0")/.."
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+./bin/hobd-stream-gen xbus "$SECONDS_OF_DATA" > "$WORK_DIR/xbus.bin"
+./bin/hobd-stream-gen sbp "$SECONDS_OF_DATA" > "$WORK_DIR/sbp.bin"
+./bin/hobd-stream-gen obd "$SECONDS_OF_DATA" > "$WORK_DIR/obd.bin"
+
+HOBD_SIM_UART0="$WORK_DIR/xbus.bin" \
+HOBD_SIM_UART1="$WORK_DIR/sbp.bin" \
+HOBD_SIM_CAN_LOG="$WORK_DIR/imu-can.log" \
+./bin/imu-gateway-sim
+
+HOBD_SIM_UART1="$WORK_DIR/obd.bin" \
+HOBD_SIM_CAN_LOG="$WORK_DIR/obd-can.log" \
+./bin/obd-gateway-sim
+
+./bin/xbus-dispatch-bench "$WORK_DIR/xbus.bin"
+
+./bin/sbp-scan-bench "$WORK_DIR/sbp.bin"
@@ -0,0 +1,25 @@
+#!/bin/bash
+#
+# Runs the host unit tests, stops at the first failure. The OBD parser
+# and Xbus dispatch tests replay generated streams.
+#
+# ./tools/test.sh
+#
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+./bin/hobd-stream-gen obd 1 > "$WORK_DIR/obd.bin"
+./bin/hobd-stream-gen xbus 1 > "$WORK_DIR/xbus.bin"
+
+./bin/canbus-test
+./bin/ring-buffer-test
+./bin/crc-test
+./bin/obd-parser-test "$WORK_DIR/obd.bin"
+./bin/obd-query-test
+./bin/xbus-dispatch-test "$WORK_DIR/xbus.bin"
+./bin/publish-test
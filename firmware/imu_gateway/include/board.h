@@ -60,11 +60,11 @@ typedef uint8_t BOOL;
 
 
 //
-#define enable_interrupt() { asm ("sei"::) ; }
+#define enable_interrupt() { sei(); }
 
 
 //
-#define disable_interrupt() { asm ("cli"::) ; }
+#define disable_interrupt() { cli(); }
 
 
 //
@@ -88,6 +88,11 @@ typedef uint8_t BOOL;
 #define UART_BAUDRATE VARIABLE_UART_BAUDRATE
 
 
+// microsecond clock and profiler, free running 16-bit timer
+#define TIME_TIMER TIMER16_1
+#define TIME_TIMER_OVF_vect TIMER1_OVF_vect
+
+
 // RTC config
 #define USE_TIMER8 TIMER8_2
 #define RTC_TIMER (2)
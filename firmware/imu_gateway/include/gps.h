@@ -49,6 +49,11 @@
 #define GPS_FIX_WARN_TIMEOUT (5000UL)
 
 
+// unchanged on-change frames are still published this often
+// ms
+#define GPS_PUBLISH_REFRESH_INTERVAL (1000)
+
+
 
 
 // GPS message data group
@@ -67,6 +72,9 @@ typedef struct
         //
         //
         hobd_gps_time2_s time2;
+        //
+        //
+        hobd_gps_time_us_s time_us;
     } group_a;
     //
     // GPS_GROUP_B_READY
@@ -152,21 +160,21 @@ void gps_disable( void );
 void gps_enable( void );
 
 
-//
+// marks a group ready in the back buffer
 void gps_set_group_ready(
         const uint16_t group );
 
 
-//
+// clears a published group in the front buffer
 void gps_clear_group_ready(
         const uint16_t group );
 
 
-//
+// clears both buffers
 void gps_clear_all_group_ready( void );
 
 
-//
+// checks the front buffer
 uint8_t gps_is_group_ready(
         const uint16_t group );
 
@@ -38,6 +38,49 @@
 #define IMU_FIX_WARN_TIMEOUT (5000UL)
 
 
+// UART rx ring buffer storage, Xbus messages are parsed in place so it
+// must hold the largest one whole, power of 2
+#ifndef IMU_RX_BUFFER_SIZE
+#define IMU_RX_BUFFER_SIZE (512)
+#endif
+
+
+// orientation, rate of turn and acceleration frame encoding
+// HOBD_IMU_ENCODING_COMPACT halves their bus load
+#ifndef IMU_ENCODING
+#define IMU_ENCODING (HOBD_IMU_ENCODING_FULL)
+#endif
+
+
+// Xsens output rates at boot, HOBD_COMMAND_ID_IMU_OUTPUT_RATE changes
+// them at run time
+// Hz
+#ifndef IMU_OUTPUT_RATE_MOTION
+#define IMU_OUTPUT_RATE_MOTION (100)
+#endif
+
+#ifndef IMU_OUTPUT_RATE_NAV
+#define IMU_OUTPUT_RATE_NAV (20)
+#endif
+
+#ifndef IMU_OUTPUT_RATE_MAGF
+#define IMU_OUTPUT_RATE_MAGF (20)
+#endif
+
+#ifndef IMU_OUTPUT_RATE_TIME
+#define IMU_OUTPUT_RATE_TIME (4)
+#endif
+
+
+// wait for each Xsens configuration reply
+// ms
+#define IMU_CONFIG_TIMEOUT (500UL)
+
+
+// requests per configuration step before it is given up
+#define IMU_CONFIG_ATTEMPTS (3)
+
+
 
 
 // IMU message data group
@@ -53,6 +96,9 @@ typedef struct
         //
         //
         hobd_imu_sample_time_s sample_time;
+        //
+        //
+        hobd_imu_time_us_s time_us;
     } group_a;
     //
     // IMU_GROUP_B_READY
@@ -86,6 +132,9 @@ typedef struct
         //
         //
         hobd_imu_orient_quat2_s orient_quat2;
+        //
+        // HOBD_IMU_ENCODING_COMPACT
+        hobd_imu_compact_orient_quat_s compact_orient_quat;
     } group_d;
     //
     // IMU_GROUP_E_READY
@@ -97,6 +146,9 @@ typedef struct
         //
         //
         hobd_imu_rate_of_turn2_s rate_of_turn2;
+        //
+        // HOBD_IMU_ENCODING_COMPACT
+        hobd_imu_compact_rate_of_turn_s compact_rate_of_turn;
     } group_e;
     //
     // IMU_GROUP_F_READY
@@ -108,6 +160,9 @@ typedef struct
         //
         //
         hobd_imu_accel2_s accel2;
+        //
+        // HOBD_IMU_ENCODING_COMPACT
+        hobd_imu_compact_accel_s compact_accel;
     } group_f;
     //
     // IMU_GROUP_G_READY
@@ -164,21 +219,21 @@ void imu_disable( void );
 void imu_enable( void );
 
 
-//
+// marks a group ready in the back buffer
 void imu_set_group_ready(
         const uint16_t group );
 
 
-//
+// clears a published group in the front buffer
 void imu_clear_group_ready(
         const uint16_t group );
 
 
-//
+// clears both buffers
 void imu_clear_all_group_ready( void );
 
 
-//
+// checks the front buffer
 uint8_t imu_is_group_ready(
         const uint16_t group );
 
@@ -187,6 +242,12 @@ uint8_t imu_is_group_ready(
 uint8_t imu_update( void );
 
 
+// handles the HOBD_COMMAND_ID_IMU_OUTPUT_RATE command
+// returns a HOBD_RESPONSE_STATUS_*
+uint8_t imu_handle_command(
+        const hobd_command_s * const command );
+
+
 
 
 #endif	/* IMU_H */
@@ -33,6 +33,13 @@
 /** Return value indicating an error occured because an argument was NULL. */
 #define SBP_NULL_ERROR     -4
 
+/** Length of the SBP frame header: preamble, message type, sender ID and length. */
+#define SBP_HEADER_LEN      6
+/** Length of the SBP frame CRC. */
+#define SBP_CRC_LEN         2
+/** Length of the largest possible SBP frame. */
+#define SBP_FRAME_LEN_MAX   (SBP_HEADER_LEN + 255 + SBP_CRC_LEN)
+
 /** Default sender ID. Intended for messages sent from the host to the device. */
 #define SBP_SENDER_ID 0x42
 
@@ -70,6 +77,25 @@ typedef struct {
   sbp_msg_callbacks_node_t* sbp_msg_callbacks_head;
 } sbp_state_t;
 
+/** Message type dispatch table entry, used by sbp_scan. */
+typedef struct {
+  u16 msg_type;                        /**< Message ID associated with callback. */
+  sbp_msg_callback_t cb;               /**< Pointer to callback function. */
+  void *context;                       /**< Pointer to a context */
+} sbp_msg_dispatch_t;
+
+/** State structure for scanning whole spans of SBP frames. */
+typedef struct {
+  u16 n_buff;                          /**< Number of unscanned bytes in buff. */
+  u16 n_frames;                        /**< Frames received with a valid CRC. */
+  u16 n_crc_errors;                    /**< Frames dropped due to a CRC error. */
+  u16 crc;                             /**< CRC accumulated over the partial frame in buff. */
+  u16 crc_len;                         /**< Bytes after the preamble already in crc. */
+  u8 table_len;                        /**< Number of entries in table. */
+  const sbp_msg_dispatch_t *table;     /**< Message type dispatch table. */
+  u8 buff[SBP_FRAME_LEN_MAX];          /**< Unscanned bytes, at most one partial frame is kept. */
+} sbp_scanner_t;
+
 /** \} */
 
 s8 sbp_register_callback(sbp_state_t* s, u16 msg_type, sbp_msg_callback_t cb, void* context,
@@ -79,6 +105,9 @@ void sbp_clear_callbacks(sbp_state_t* s);
 void sbp_state_init(sbp_state_t *s);
 void sbp_state_set_io_context(sbp_state_t *s, void* context);
 s8 sbp_process(sbp_state_t *s, u32 (*read)(u8 *buff, u32 n, void* context));
+void sbp_scanner_init(sbp_scanner_t *s, const sbp_msg_dispatch_t *table, u8 table_len);
+u16 sbp_scanner_space(sbp_scanner_t *s, u8 **buff);
+s8 sbp_scan(sbp_scanner_t *s, u16 n);
 s8 sbp_send_message(sbp_state_t *s, u16 msg_type, u16 sender_id, u8 len, u8 *payload,
                     u32 (*write)(u8 *buff, u32 n, void* context));
 
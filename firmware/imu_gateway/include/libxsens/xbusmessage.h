@@ -108,6 +108,32 @@ struct XbusMessage
 	void* data;
 };
 
+/*!
+ * \brief Bytes in up to two parts, the second continues the first, as in a
+ * ring buffer that wraps.
+ */
+struct XbusSpan
+{
+	/*! \brief Start of each part. */
+	uint8_t const* part[2];
+	/*! \brief Length of each part in bytes, the second may be 0. */
+	uint16_t length[2];
+};
+
+/*!
+ * \brief An Xbus message with its raw payload left in place in the receive
+ * buffer.
+ */
+struct XbusMessageView
+{
+	/*! \brief The message ID of the message. */
+	enum XsMessageId mid;
+	/*! \brief The length of the payload in bytes. */
+	uint16_t length;
+	/*! \brief The raw payload. */
+	struct XbusSpan data;
+};
+
 /*!
  * \brief Output configuration structure.
  */
@@ -159,8 +185,39 @@ typedef struct
 } XsGpsSol;
 
 
+/*!
+ * \brief Most bytes of a data item split across the parts of a view passed
+ * to its callback, enough for every item XbusMessage_readDataItem reads.
+ */
+#define XBUS_SPLIT_ITEM_SIZE_MAX (16)
+
+/*!
+ * \brief Data item callback, called with the raw big endian item data.
+ * \param data Pointer to the item data, after the identifier and size.
+ * \param size Size of the item data in bytes.
+ * \param context Context given to XbusMessage_dispatchDataItems.
+ */
+typedef void (*XbusDataItemCallback)(uint8_t const* data, uint8_t size, void* context);
+
+/*!
+ * \brief Data identifier dispatch table entry, used by
+ * XbusMessage_dispatchDataItems.
+ */
+struct XbusDataItemDispatch
+{
+	/*! \brief Data identifier associated with the callback. */
+	enum XsDataIdentifier id;
+	/*! \brief Pointer to the callback function. */
+	XbusDataItemCallback cb;
+};
+
 size_t XbusMessage_format(uint8_t* raw, struct XbusMessage const* message, enum XbusLowLevelFormat format);
 bool XbusMessage_getDataItem(void* item, enum XsDataIdentifier id, struct XbusMessage const* message);
+bool XbusMessage_readDataItem(void* item, enum XsDataIdentifier id, uint8_t const* data, uint8_t size);
+bool XbusMessage_dispatchDataItems(struct XbusMessage const* message, struct XbusDataItemDispatch const* table, uint8_t tableLen, void* context);
+bool XbusMessage_dispatchViewDataItems(struct XbusMessageView const* message, struct XbusDataItemDispatch const* table, uint8_t tableLen, void* context);
+uint8_t XbusMessage_spanByte(struct XbusSpan const* span, uint16_t offset);
+void XbusMessage_subSpan(struct XbusSpan* out, struct XbusSpan const* span, uint16_t offset, uint16_t length);
 
 #ifdef __cplusplus
 }
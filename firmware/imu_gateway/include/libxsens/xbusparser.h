@@ -92,6 +92,40 @@ struct XbusParser
 };
 
 
+/*!
+ * \brief Xbus scanner state, parses messages in place in a buffer that
+ * keeps the unconsumed bytes, such as a ring buffer.
+ */
+struct XbusScanner
+{
+	/*!
+	 * \brief Handle a received message.
+	 *
+	 * \note The payload is only valid until the scanned bytes are
+	 * consumed.
+	 */
+	void (*handleMessage)(struct XbusMessageView const* message);
+	/*!
+	 * \brief Largest payload accepted, a longer message could never be
+	 * held whole by the buffer.
+	 */
+	uint16_t maxLength;
+	/*!
+	 * \brief Bytes of the partial message at the start of the span already
+	 * summed into the checksum.
+	 */
+	uint16_t scanned;
+	/*! \brief Checksum of the scanned bytes after the preamble. */
+	uint8_t checksum;
+	/*! \brief Messages received with a valid checksum. */
+	uint16_t messages;
+	/*! \brief Messages dropped due to a checksum error. */
+	uint16_t checksumErrors;
+	/*! \brief Messages dropped for being longer than maxLength. */
+	uint16_t lengthErrors;
+};
+
+
 size_t XbusParser_mem(void);
 struct XbusParser* XbusParser_create(struct XbusParserCallback const* callback);
 void XbusParser_destroy(struct XbusParser* parser);
@@ -100,6 +134,10 @@ struct XbusParser* XbusParser_init(void* parserMem, struct XbusParserCallback co
 void XbusParser_parseByte(struct XbusParser* parser, uint8_t byte);
 void XbusParser_parseBuffer(struct XbusParser* parser, uint8_t const* buf, size_t bufSize);
 
+void XbusScanner_init(struct XbusScanner* scanner, void (*handleMessage)(struct XbusMessageView const* message), uint16_t maxLength);
+void XbusScanner_reset(struct XbusScanner* scanner);
+uint16_t XbusScanner_scan(struct XbusScanner* scanner, struct XbusSpan const* span);
+
 #ifdef __cplusplus
 }
 #endif // extern "C"
@@ -18,12 +18,11 @@
 
 
 
-//
+// storage size of buffers without their own, must be a power of 2, may
+// exceed 256
+#ifndef RING_BUFFER_SIZE
 #define RING_BUFFER_SIZE (128)
-
-
-//
-#define RING_BUFFER_MASK (RING_BUFFER_SIZE - 1)
+#endif
 
 
 // framing error from UART
@@ -46,31 +45,73 @@
 
 //
 typedef struct
+{
+    //
+    // bytes dropped because the buffer was full
+    uint16_t overflow_count;
+    //
+    // UART framing errors
+    uint16_t frame_error_count;
+    //
+    // UART data overrun errors
+    uint16_t overrun_count;
+    //
+    // most bytes held at once
+    uint16_t high_water;
+    //
+    // most bytes the buffer can hold, one less than its storage size
+    uint16_t capacity;
+} ring_buffer_stats_s;
+
+
+// bytes at the read index, the second span is the part wrapped to the
+// start of the storage
+typedef struct
 {
     //
     //
-    uint8_t head;
+    const uint8_t *span[ 2 ];
     //
     //
-    uint8_t tail;
+    uint16_t len[ 2 ];
+} ring_buffer_view_s;
+
+
+//
+typedef struct
+{
+    //
+    // next index to write
+    uint16_t head;
     //
+    // next index to read
+    uint16_t tail;
     //
+    // sticky error bits, upper byte of RING_BUFFER_*_ERROR/OVERFLOW
     uint8_t error;
     //
     //
-    uint8_t buffer[ RING_BUFFER_SIZE ];
+    ring_buffer_stats_s stats;
+    //
+    // storage size minus one
+    uint16_t mask;
+    //
+    // storage given to ring_buffer_init
+    uint8_t *buffer;
 } ring_buffer_s;
 
 
 
 
-//
+// size must be a power of 2
 void ring_buffer_init(
-        volatile ring_buffer_s * const rb );
+        volatile ring_buffer_s * const rb,
+        uint8_t * const storage,
+        const uint16_t size );
 
 
 //
-uint8_t ring_buffer_available(
+uint16_t ring_buffer_available(
         volatile ring_buffer_s * const rb );
 
 
@@ -85,6 +126,12 @@ uint16_t ring_buffer_putc(
         volatile ring_buffer_s * const rb );
 
 
+// error is one of RING_BUFFER_FRAME_ERROR/RING_BUFFER_OVERRUN_ERROR
+void ring_buffer_set_error(
+        const uint16_t error,
+        volatile ring_buffer_s * const rb );
+
+
 //
 uint16_t ring_buffer_getc(
         volatile ring_buffer_s * const rb );
@@ -95,6 +142,44 @@ uint16_t ring_buffer_peek(
         volatile ring_buffer_s * const rb );
 
 
+// returns the number of bytes written, the rest are counted as overflow
+uint16_t ring_buffer_write(
+        const uint8_t * const src,
+        const uint16_t len,
+        volatile ring_buffer_s * const rb );
+
+
+// returns the number of bytes copied into dst
+uint16_t ring_buffer_read(
+        volatile ring_buffer_s * const rb,
+        uint8_t * const dst,
+        const uint16_t len );
+
+
+// returns the number of contiguous bytes at span, nothing is consumed
+uint16_t ring_buffer_peek_span(
+        volatile ring_buffer_s * const rb,
+        const uint8_t ** const span );
+
+
+// returns the number of bytes in view, nothing is consumed
+uint16_t ring_buffer_peek_view(
+        volatile ring_buffer_s * const rb,
+        ring_buffer_view_s * const view );
+
+
+// drops len bytes, used after ring_buffer_peek_span/ring_buffer_peek_view
+void ring_buffer_consume(
+        volatile ring_buffer_s * const rb,
+        const uint16_t len );
+
+
+//
+void ring_buffer_get_stats(
+        volatile ring_buffer_s * const rb,
+        ring_buffer_stats_s * const stats );
+
+
 
 
 #endif	/* RING_BUFFER_H */
@@ -2,6 +2,22 @@
  * @file canbus.c
  * @brief TODO.
  *
+ * Frames are queued and loaded into any free MOB. The CAN transmit
+ * complete interrupt releases MOB's and refills them from the queue, so
+ * sending never waits on the bus.
+ *
+ * canbus_send copies the payload into the queue. canbus_send_ref queues a
+ * reference instead, the payload is copied straight into the MOB when it
+ * is loaded and the caller's reference count is released at that point.
+ *
+ * Frames queued while a transmit mark is set carry it into their MOB, the
+ * transmit complete interrupt reports each marked frame to the tx done
+ * callback.
+ *
+ * Each rx filter keeps one MOB armed for its CAN ID. The CAN receive
+ * interrupt copies the frame into the receive queue, stamped with the us
+ * clock, and re-arms the filter.
+ *
  */
 
 
@@ -10,9 +26,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <inttypes.h>
 
 #include "board.h"
+#include "can_drv.h"
 #include "can_lib.h"
 #include "time.h"
 #include "canbus.h"
@@ -24,6 +42,56 @@
 // static global types/macros
 // *****************************************************
 
+//
+#define TX_QUEUE_MASK (CANBUS_TX_QUEUE_SIZE - 1)
+
+
+//
+#define RX_QUEUE_MASK (CANBUS_RX_QUEUE_SIZE - 1)
+
+
+// interrupt on transmit complete, receive complete and MOB errors
+#define CAN_INTERRUPTS_ENABLE ((1 << ENIT) | (1 << ENTX) | (1 << ENRX) | (1 << ENERR))
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    // copied payload, used when ref_count is NULL
+    uint8_t data[ NB_DATA_MAX ];
+    //
+    // referenced payload
+    const uint8_t *ref;
+    //
+    // released once the payload is loaded into a MOB
+    volatile uint8_t *ref_count;
+    //
+    // CANBUS_TX_MARK_NONE if not marked
+    uint8_t mark;
+} tx_frame_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    // MOB descriptor, status is MOB_PENDING while armed
+    st_cmd_t cmd;
+    //
+    // received payload
+    uint8_t data[ NB_DATA_MAX ];
+} rx_filter_s;
+
 
 
 
@@ -31,6 +99,61 @@
 // static global data
 // *****************************************************
 
+// frames waiting for a free MOB
+static volatile tx_frame_s tx_queue[ CANBUS_TX_QUEUE_SIZE ];
+
+
+// next queue entry to write, main loop only
+static volatile uint8_t tx_head = 0;
+
+
+// next queue entry to load into a MOB
+static volatile uint8_t tx_tail = 0;
+
+
+// MOB descriptors, one per MOB handle
+static st_cmd_t tx_mobs[ NB_MOB ];
+
+
+// transmit mark of the frame in each MOB
+static uint8_t tx_mob_marks[ NB_MOB ];
+
+
+// mark given to newly queued frames, main loop only
+static uint8_t tx_mark = CANBUS_TX_MARK_NONE;
+
+
+// frames queued with tx_mark, main loop only
+static uint8_t tx_mark_count = 0;
+
+
+//
+static volatile canbus_tx_done_f tx_done_callback = NULL;
+
+
+//
+static rx_filter_s rx_filters[ CANBUS_RX_FILTER_COUNT ];
+
+
+//
+static uint8_t rx_filter_count = 0;
+
+
+// received frames waiting for canbus_recv
+static volatile canbus_frame_s rx_queue[ CANBUS_RX_QUEUE_SIZE ];
+
+
+// next queue entry to write, interrupt only
+static volatile uint8_t rx_head = 0;
+
+
+// next queue entry to read, main loop only
+static volatile uint8_t rx_tail = 0;
+
+
+//
+static volatile canbus_stats_s canbus_stats;
+
 
 
 
@@ -38,6 +161,35 @@
 // static declarations
 // *****************************************************
 
+//
+static void tx_service_mobs( void );
+
+
+//
+static void tx_fill_mobs( void );
+
+
+//
+static uint8_t rx_arm(
+        rx_filter_s * const filter );
+
+
+//
+static void rx_service_mobs( void );
+
+
+//
+static void record_drop(
+        const uint16_t id );
+
+
+//
+static uint8_t tx_enqueue(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count );
+
 
 
 
@@ -45,6 +197,269 @@
 // static definitions
 // *****************************************************
 
+//
+ISR( CANIT_vect )
+{
+    const uint8_t page_saved = CANPAGE;
+
+    // release completed MOB's
+    tx_service_mobs();
+
+    // take received frames, re-arm rx filters before the transmit
+    // queue claims the free MOB's
+    rx_service_mobs();
+
+    // refill them from the queue
+    tx_fill_mobs();
+
+    CANPAGE = page_saved;
+}
+
+
+// interrupts must be disabled
+static void tx_service_mobs( void )
+{
+    uint8_t mob = 0;
+
+    for( mob = 0; mob < NB_MOB; mob += 1 )
+    {
+        if( tx_mobs[ mob ].status == MOB_PENDING )
+        {
+            // frees the MOB if the transmit is done
+            const uint8_t status = can_get_status( &tx_mobs[ mob ] );
+
+            if( status == CAN_STATUS_COMPLETED )
+            {
+                canbus_stats.tx_count += 1;
+
+                if( (tx_mob_marks[ mob ] != CANBUS_TX_MARK_NONE) && (tx_done_callback != NULL) )
+                {
+                    tx_done_callback( tx_mob_marks[ mob ] );
+                }
+            }
+            else if( status == CAN_STATUS_ERROR )
+            {
+                canbus_stats.tx_error_count += 1;
+            }
+        }
+    }
+}
+
+
+// interrupts must be disabled
+static void tx_fill_mobs( void )
+{
+    uint8_t status = CAN_CMD_ACCEPTED;
+    st_cmd_t cmd;
+
+    while( (tx_tail != tx_head) && (status == CAN_CMD_ACCEPTED) )
+    {
+        const uint8_t idx = tx_tail;
+
+        // zero state
+        cmd.status = 0;
+        cmd.ctrl.rtr = 0;
+        cmd.ctrl.ide = 0;
+
+        // construct canlib command
+        cmd.id.std = tx_queue[ idx ].id;
+        cmd.dlc = tx_queue[ idx ].dlc;
+
+        if( tx_queue[ idx ].ref_count == NULL )
+        {
+            cmd.pt_data = (uint8_t*) tx_queue[ idx ].data;
+        }
+        else
+        {
+            cmd.pt_data = (uint8_t*) tx_queue[ idx ].ref;
+        }
+
+        // command type - send data
+        cmd.cmd = CMD_TX_DATA;
+
+        // data is copied into the MOB when accepted
+        status = can_cmd( &cmd );
+
+        if( status == CAN_CMD_ACCEPTED )
+        {
+            tx_mobs[ cmd.handle ] = cmd;
+            tx_mob_marks[ cmd.handle ] = tx_queue[ idx ].mark;
+
+            // payload now lives in the MOB
+            if( tx_queue[ idx ].ref_count != NULL )
+            {
+                (*tx_queue[ idx ].ref_count) -= 1;
+            }
+
+            tx_tail = ((idx + 1) & TX_QUEUE_MASK);
+        }
+    }
+}
+
+
+// interrupts must be disabled
+static uint8_t rx_arm(
+        rx_filter_s * const filter )
+{
+    // zero state
+    filter->cmd.status = 0;
+    filter->cmd.ctrl.rtr = 0;
+    filter->cmd.ctrl.ide = 0;
+
+    // exact match on the standard ID
+    filter->cmd.id.std = filter->id;
+    filter->cmd.dlc = NB_DATA_MAX;
+    filter->cmd.pt_data = filter->data;
+    filter->cmd.cmd = CMD_RX_DATA_MASKED;
+
+    return can_cmd( &filter->cmd );
+}
+
+
+// interrupts must be disabled
+static void rx_service_mobs( void )
+{
+    uint8_t idx = 0;
+    uint8_t byte = 0;
+
+    for( idx = 0; idx < rx_filter_count; idx += 1 )
+    {
+        rx_filter_s * const filter = &rx_filters[ idx ];
+
+        if( filter->cmd.status == MOB_PENDING )
+        {
+            // frees the MOB if a frame was received
+            const uint8_t status = can_get_status( &filter->cmd );
+
+            if( status == CAN_STATUS_COMPLETED )
+            {
+                const uint8_t head = rx_head;
+                const uint8_t next_head = ((head + 1) & RX_QUEUE_MASK);
+
+                if( next_head == rx_tail )
+                {
+                    canbus_stats.rx_overflow_count += 1;
+                }
+                else
+                {
+                    rx_queue[ head ].id = filter->cmd.id.std;
+                    rx_queue[ head ].dlc = MIN( filter->cmd.dlc, (uint8_t) NB_DATA_MAX );
+                    rx_queue[ head ].rx_time = time_get_us();
+
+                    for( byte = 0; byte < rx_queue[ head ].dlc; byte += 1 )
+                    {
+                        rx_queue[ head ].data[ byte ] = filter->data[ byte ];
+                    }
+
+                    rx_head = next_head;
+
+                    canbus_stats.rx_count += 1;
+                }
+            }
+        }
+
+        // re-arm, retried on the next interrupt if no MOB is free
+        if( filter->cmd.status != MOB_PENDING )
+        {
+            (void) rx_arm( filter );
+        }
+    }
+}
+
+
+// interrupts must be disabled
+static void record_drop(
+        const uint16_t id )
+{
+    uint8_t idx = 0;
+    uint8_t recorded = 0;
+
+    canbus_stats.queue_full_count += 1;
+
+    for( idx = 0; (idx < CANBUS_DROP_ID_COUNT) && (recorded == 0); idx += 1 )
+    {
+        if( canbus_stats.drops[ idx ].id == id )
+        {
+            canbus_stats.drops[ idx ].count += 1;
+            recorded = 1;
+        }
+        else if( canbus_stats.drops[ idx ].id == CANBUS_ID_INVALID )
+        {
+            // first drop of this ID, claim the entry
+            canbus_stats.drops[ idx ].id = id;
+            canbus_stats.drops[ idx ].count = 1;
+            recorded = 1;
+        }
+    }
+
+    if( recorded == 0 )
+    {
+        canbus_stats.drop_other_count += 1;
+    }
+}
+
+
+// interrupts must be disabled
+static uint8_t tx_enqueue(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    uint8_t ret = 0;
+    uint8_t idx = 0;
+
+    const uint8_t head = tx_head;
+    const uint8_t next_head = ((head + 1) & TX_QUEUE_MASK);
+
+    if( next_head == tx_tail )
+    {
+        // queue is full, drop the frame
+        record_drop( id );
+
+        ret = 1;
+    }
+    else
+    {
+        tx_queue[ head ].id = id;
+        tx_queue[ head ].dlc = dlc;
+        tx_queue[ head ].ref = data;
+        tx_queue[ head ].ref_count = ref_count;
+        tx_queue[ head ].mark = tx_mark;
+
+        if( ref_count == NULL )
+        {
+            for( idx = 0; idx < dlc; idx += 1 )
+            {
+                tx_queue[ head ].data[ idx ] = data[ idx ];
+            }
+        }
+        else
+        {
+            (*ref_count) += 1;
+        }
+
+        tx_head = next_head;
+
+        if( tx_mark != CANBUS_TX_MARK_NONE )
+        {
+            tx_mark_count += 1;
+        }
+
+        const uint8_t pending = ((next_head - tx_tail) & TX_QUEUE_MASK);
+
+        if( pending > canbus_stats.queue_high_water )
+        {
+            canbus_stats.queue_high_water = pending;
+        }
+    }
+
+    // load any free MOB's, the interrupt handles the rest
+    tx_fill_mobs();
+
+    return ret;
+}
+
 
 
 
@@ -56,6 +471,7 @@
 uint8_t canbus_init( void )
 {
     uint8_t ret = 0;
+    uint8_t idx = 0;
 
     // wait for CAN to initialize or wdt will reset
     while( can_init( 0 ) == 0 )
@@ -63,6 +479,42 @@ uint8_t canbus_init( void )
         ret = 1;
     }
 
+    disable_interrupt();
+
+    tx_head = 0;
+    tx_tail = 0;
+    rx_head = 0;
+    rx_tail = 0;
+    rx_filter_count = 0;
+
+    memset( tx_mobs, 0, sizeof(tx_mobs) );
+    memset( tx_mob_marks, 0, sizeof(tx_mob_marks) );
+
+    tx_mark = CANBUS_TX_MARK_NONE;
+    tx_mark_count = 0;
+
+    canbus_stats.tx_count = 0;
+    canbus_stats.tx_error_count = 0;
+    canbus_stats.queue_full_count = 0;
+    canbus_stats.queue_high_water = 0;
+    canbus_stats.drop_other_count = 0;
+    canbus_stats.rx_count = 0;
+    canbus_stats.rx_overflow_count = 0;
+
+    for( idx = 0; idx < CANBUS_DROP_ID_COUNT; idx += 1 )
+    {
+        canbus_stats.drops[ idx ].id = CANBUS_ID_INVALID;
+        canbus_stats.drops[ idx ].count = 0;
+    }
+
+    // MOB interrupts, the interrupt types are enabled below
+    CANIE2 = 0xFF;
+    CANIE1 = 0x7F;
+
+    CANGIE = CAN_INTERRUPTS_ENABLE;
+
+    enable_interrupt();
+
     return ret;
 }
 
@@ -73,49 +525,193 @@ uint8_t canbus_send(
         const uint8_t dlc,
         const uint8_t * const data )
 {
-    uint8_t ret = 0;
-    uint8_t status = 0;
-    st_cmd_t cmd;
+    disable_interrupt();
 
-    // zero state
-    cmd.status = 0;
-    cmd.ctrl.rtr = 0;
-    cmd.ctrl.ide = 0;
+    const uint8_t ret = tx_enqueue(
+            id,
+            dlc,
+            data,
+            NULL );
 
-    // construct canlib command
-    cmd.id.std = id;
-    cmd.dlc = dlc;
-    cmd.pt_data = (uint8_t*) data;
+    enable_interrupt();
+
+    return ret;
+}
 
-    // command type - send data
-    cmd.cmd = CMD_TX_DATA;
 
-    // send the data to an available MOB
-    do
+//
+uint8_t canbus_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    disable_interrupt();
+
+    const uint8_t ret = tx_enqueue(
+            id,
+            dlc,
+            data,
+            ref_count );
+
+    enable_interrupt();
+
+    return ret;
+}
+
+
+//
+void canbus_set_tx_mark(
+        const uint8_t mark )
+{
+    tx_mark = mark;
+    tx_mark_count = 0;
+}
+
+
+//
+uint8_t canbus_get_tx_mark_count( void )
+{
+    return tx_mark_count;
+}
+
+
+//
+void canbus_set_tx_done_callback(
+        const canbus_tx_done_f callback )
+{
+    disable_interrupt();
+
+    tx_done_callback = callback;
+
+    enable_interrupt();
+}
+
+
+//
+uint8_t canbus_add_rx_filter(
+        const uint16_t id )
+{
+    uint8_t ret = 0;
+
+    disable_interrupt();
+
+    if( rx_filter_count >= CANBUS_RX_FILTER_COUNT )
     {
-        status = can_cmd( &cmd );
+        ret = 1;
     }
-    while( status != CAN_CMD_ACCEPTED );
+    else
+    {
+        rx_filter_s * const filter = &rx_filters[ rx_filter_count ];
+
+        memset( filter, 0, sizeof(*filter) );
 
-    // wait for completion
-    do
+        filter->id = id;
+
+        rx_filter_count += 1;
+
+        // a refused filter is armed by the next CAN interrupt
+        (void) rx_arm( filter );
+    }
+
+    enable_interrupt();
+
+    return ret;
+}
+
+
+//
+uint8_t canbus_recv(
+        canbus_frame_s * const frame )
+{
+    uint8_t ret = 0;
+    uint8_t byte = 0;
+
+    disable_interrupt();
+
+    const uint8_t tail = rx_tail;
+
+    if( tail == rx_head )
+    {
+        ret = 1;
+    }
+    else
     {
-        status = can_get_status( &cmd );
+        frame->id = rx_queue[ tail ].id;
+        frame->dlc = rx_queue[ tail ].dlc;
+        frame->rx_time = rx_queue[ tail ].rx_time;
 
-        if( status == CAN_STATUS_ERROR )
+        for( byte = 0; byte < frame->dlc; byte += 1 )
         {
-            // set error
-            ret = 1;
-
-            // force return now
-            status = CAN_STATUS_COMPLETED;
+            frame->data[ byte ] = rx_queue[ tail ].data[ byte ];
         }
+
+        rx_tail = ((tail + 1) & RX_QUEUE_MASK);
     }
-    while( status != CAN_STATUS_COMPLETED );
 
-    // clear status
-    cmd.status = 0;
-    cmd.cmd = 0;
+    enable_interrupt();
 
     return ret;
 }
+
+
+//
+uint8_t canbus_get_tx_pending( void )
+{
+    disable_interrupt();
+
+    const uint8_t pending = ((tx_head - tx_tail) & TX_QUEUE_MASK);
+
+    enable_interrupt();
+
+    return pending;
+}
+
+
+//
+void canbus_get_stats(
+        canbus_stats_s * const stats )
+{
+    uint8_t idx = 0;
+
+    disable_interrupt();
+
+    stats->tx_count = canbus_stats.tx_count;
+    stats->tx_error_count = canbus_stats.tx_error_count;
+    stats->queue_full_count = canbus_stats.queue_full_count;
+    stats->queue_high_water = canbus_stats.queue_high_water;
+    stats->drop_other_count = canbus_stats.drop_other_count;
+    stats->rx_count = canbus_stats.rx_count;
+    stats->rx_overflow_count = canbus_stats.rx_overflow_count;
+
+    for( idx = 0; idx < CANBUS_DROP_ID_COUNT; idx += 1 )
+    {
+        stats->drops[ idx ].id = canbus_stats.drops[ idx ].id;
+        stats->drops[ idx ].count = canbus_stats.drops[ idx ].count;
+    }
+
+    enable_interrupt();
+}
+
+
+//
+uint16_t canbus_get_drop_count(
+        const uint16_t id )
+{
+    uint8_t idx = 0;
+    uint16_t count = 0;
+
+    disable_interrupt();
+
+    for( idx = 0; idx < CANBUS_DROP_ID_COUNT; idx += 1 )
+    {
+        if( canbus_stats.drops[ idx ].id == id )
+        {
+            count = canbus_stats.drops[ idx ].count;
+        }
+    }
+
+    enable_interrupt();
+
+    return count;
+}
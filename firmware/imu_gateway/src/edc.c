@@ -12,6 +12,16 @@
 
 #include "libsbp/edc.h"
 
+#ifdef BUILD_TARGET_AVR
+#include <avr/pgmspace.h>
+/* Keep the table in flash, it would otherwise take 512 bytes of SRAM. */
+#define CRC16TAB_ATTR PROGMEM
+#define CRC16TAB_READ(i) pgm_read_word(&crc16tab[(i)])
+#else
+#define CRC16TAB_ATTR
+#define CRC16TAB_READ(i) (crc16tab[(i)])
+#endif
+
 /** \defgroup edc Error Detection and Correction
  * Error detection and correction functions.
  * \{ */
@@ -21,7 +31,7 @@
  * \{ */
 
 /* CRC16 implementation acording to CCITT standards */
-static const u16 crc16tab[256] = {
+static const u16 crc16tab[256] CRC16TAB_ATTR = {
   0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
   0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
   0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
@@ -65,6 +75,10 @@ static const u16 crc16tab[256] = {
  * Mask 0x11021, not reversed, not XOR'd
  * (there are several slight variants on the CCITT CRC-16).
  *
+ * The CRC can be accumulated incrementally by passing the result of the
+ * previous call as `crc`, starting from 0. Splitting the data across calls
+ * gives the same result as a single call over all of it.
+ *
  * \param buf Array of data to calculate CRC for
  * \param len Length of data array
  * \param crc Initial CRC value
@@ -74,7 +88,7 @@ static const u16 crc16tab[256] = {
 u16 crc16_ccitt(const u8 *buf, u32 len, u16 crc)
 {
   for (u32 i = 0; i < len; i++)
-    crc = (crc << 8) ^ crc16tab[((crc >> 8) ^ *buf++) & 0x00FF];
+    crc = (crc << 8) ^ CRC16TAB_READ(((crc >> 8) ^ *buf++) & 0x00FF);
   return crc;
 }
 
@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <inttypes.h>
@@ -24,6 +25,10 @@
 #include "ring_buffer.h"
 #include "time.h"
 #include "canbus.h"
+#include "publish.h"
+#include "profile.h"
+#include "trace.h"
+#include "time_sync.h"
 #include "diagnostics.h"
 #include "gps.h"
 
@@ -58,28 +63,35 @@
 
 // UART rx ring buffer
 static volatile ring_buffer_s rx_buffer;
+static uint8_t rx_buffer_storage[ RING_BUFFER_SIZE ];
 
 
-// SBP state
-static sbp_state_t sbp_state;
+// SBP frame scanner, holds at most one partial frame between updates
+static sbp_scanner_t sbp_scanner;
 
 
-// GPS message/data state
-static gps_data_s gps_data;
+// GPS message/data state, double buffered
+static gps_data_s gps_data[ 2 ];
+
+
+// parsers write into the back buffer
+static gps_data_s *back_data = &gps_data[ 0 ];
+
+
+// published groups are read from the front buffer
+static gps_data_s *front_data = &gps_data[ 1 ];
+
+
+// queued CAN frames still referencing the front buffer
+static volatile uint8_t front_ref_count = 0;
 
 
 // last rx GPS time
 static uint32_t last_rx_gps_time = 0;
 
 
-// SBP callback nodes
-static sbp_msg_callbacks_node_t heartbeat_callback_node;
-static sbp_msg_callbacks_node_t gps_time_node;
-static sbp_msg_callbacks_node_t dops_node;
-static sbp_msg_callbacks_node_t pos_llh_node;
-static sbp_msg_callbacks_node_t baseline_ned_node;
-static sbp_msg_callbacks_node_t vel_ned_node;
-static sbp_msg_callbacks_node_t heading_node;
+// start of the current rx buffer pass on the us clock, for tracing
+static uint32_t rx_pass_time_us = 0;
 
 
 
@@ -92,13 +104,6 @@ static sbp_msg_callbacks_node_t heading_node;
 static void hw_init( void );
 
 
-// prototype defined by libsbp
-static uint32_t sbp_read_function(
-        uint8_t *buff,
-        uint32_t buff_len,
-        void *context );
-
-
 // callback prototypes are defined by libsbp
 static void heartbeat_callback(
         uint16_t sender_id,
@@ -155,6 +160,18 @@ static void heading_callback(
         void *context );
 
 
+//
+static void swap_data_buffers( void );
+
+
+//
+static uint8_t process_buffer( void );
+
+
+//
+static void update_rx_stats( void );
+
+
 //
 static uint8_t publish_group_a( void );
 static uint8_t publish_group_b( void );
@@ -182,8 +199,16 @@ ISR( UART_RX_INTERRUPT )
     const uint8_t status  = UART_UCSRA;
     const uint8_t data = UART_DATA;
 
-    // read error status
-    rx_buffer.error = (status & (_BV(FE1) | _BV(DOR1)) );
+    // record UART errors, counted separately from the data
+    if( (status & _BV(FE1)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_FRAME_ERROR, &rx_buffer );
+    }
+
+    if( (status & _BV(DOR1)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_OVERRUN_ERROR, &rx_buffer );
+    }
 
     // push data into the rx buffer, error is updated with return status
     (void) ring_buffer_putc(
@@ -207,32 +232,6 @@ static void hw_init( void )
 }
 
 
-//
-static uint32_t sbp_read_function(
-        uint8_t *buff,
-        uint32_t buff_len,
-        void *context )
-{
-    uint32_t idx = 0;
-
-    for( idx = 0; idx < buff_len; idx += 1 )
-    {
-        const uint16_t data = ring_buffer_getc( &rx_buffer );
-
-        if( data == RING_BUFFER_NO_DATA )
-        {
-            break;
-        }
-        else
-        {
-            buff[ idx ] = (uint8_t) (data & 0xFF);
-        }
-    }
-
-    return idx;
-}
-
-
 //
 static void heartbeat_callback(
         uint16_t sender_id,
@@ -285,13 +284,18 @@ static void gps_time_callback(
 
     const msg_gps_time_t * const gps_time = (const msg_gps_time_t*) msg;
 
+    const uint32_t rx_time_us = time_get_us();
+
     last_rx_gps_time = time_get_ms();
 
-    gps_data.group_a.time1.rx_time = last_rx_gps_time;
-    gps_data.group_a.time1.time_of_week = gps_time->tow;
-    gps_data.group_a.time2.week_number = gps_time->wn;
-    gps_data.group_a.time2.residual = gps_time->ns;
-    gps_data.group_a.time2.flags = gps_time->flags;
+    back_data->group_a.time1.rx_time = last_rx_gps_time;
+    back_data->group_a.time1.time_of_week = gps_time->tow;
+    back_data->group_a.time2.week_number = gps_time->wn;
+    back_data->group_a.time2.residual = gps_time->ns;
+    back_data->group_a.time2.flags = gps_time->flags;
+
+    back_data->group_a.time_us.rx_time_us = rx_time_us;
+    back_data->group_a.time_us.sync_time_us = time_sync_get_time( &rx_time_us );
 
     // clear GPS fix warn
     diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_NO_GPS_FIX );
@@ -311,12 +315,12 @@ static void dops_callback(
 
     const msg_dops_t * const dops = (const msg_dops_t*) msg;
 
-    gps_data.group_f.dop1.time_of_week = dops->tow;
-    gps_data.group_f.dop1.gdop = dops->gdop;
-    gps_data.group_f.dop1.pdop = dops->pdop;
-    gps_data.group_f.dop2.tdop = dops->tdop;
-    gps_data.group_f.dop2.hdop = dops->hdop;
-    gps_data.group_f.dop2.vdop = dops->vdop;
+    back_data->group_f.dop1.time_of_week = dops->tow;
+    back_data->group_f.dop1.gdop = dops->gdop;
+    back_data->group_f.dop1.pdop = dops->pdop;
+    back_data->group_f.dop2.tdop = dops->tdop;
+    back_data->group_f.dop2.hdop = dops->hdop;
+    back_data->group_f.dop2.vdop = dops->vdop;
 
     gps_set_group_ready( GPS_GROUP_F_READY );
 }
@@ -333,23 +337,23 @@ static void pos_llh_callback(
 
     const msg_pos_llh_t * const pos_llh = (const msg_pos_llh_t*) msg;
 
-    gps_data.group_b.pos_llh1.time_of_week = pos_llh->tow;
-    gps_data.group_b.pos_llh1.num_sats = pos_llh->n_sats;
-    gps_data.group_b.pos_llh1.fix_mode = (0x03 & pos_llh->flags);
-    gps_data.group_b.pos_llh1.height_mode = (pos_llh->flags >> 2) & 0x01;
-    gps_data.group_b.pos_llh1.flags = (pos_llh->flags >> 3) & 0x1F;
+    back_data->group_b.pos_llh1.time_of_week = pos_llh->tow;
+    back_data->group_b.pos_llh1.num_sats = pos_llh->n_sats;
+    back_data->group_b.pos_llh1.fix_mode = (0x03 & pos_llh->flags);
+    back_data->group_b.pos_llh1.height_mode = (pos_llh->flags >> 2) & 0x01;
+    back_data->group_b.pos_llh1.flags = (pos_llh->flags >> 3) & 0x1F;
     memcpy(
-            &gps_data.group_b.pos_llh2.latitude,
+            &back_data->group_b.pos_llh2.latitude,
             &pos_llh->lat,
-            sizeof(gps_data.group_b.pos_llh2.latitude) );
+            sizeof(back_data->group_b.pos_llh2.latitude) );
     memcpy(
-            &gps_data.group_b.pos_llh3.longitude,
+            &back_data->group_b.pos_llh3.longitude,
             &pos_llh->lon,
-            sizeof(gps_data.group_b.pos_llh3.longitude) );
+            sizeof(back_data->group_b.pos_llh3.longitude) );
     memcpy(
-            &gps_data.group_b.pos_llh4.height,
+            &back_data->group_b.pos_llh4.height,
             &pos_llh->height,
-            sizeof(gps_data.group_b.pos_llh4.height) );
+            sizeof(back_data->group_b.pos_llh4.height) );
 
     gps_set_group_ready( GPS_GROUP_B_READY );
 }
@@ -366,13 +370,13 @@ static void baseline_ned_callback(
 
     const msg_baseline_ned_t * const baseline_ned = (const msg_baseline_ned_t*) msg;
 
-    gps_data.group_c.baseline_ned1.time_of_week = baseline_ned->tow;
-    gps_data.group_c.baseline_ned1.num_sats = baseline_ned->n_sats;
-    gps_data.group_c.baseline_ned1.fix_mode = (0x03 & baseline_ned->flags);
-    gps_data.group_c.baseline_ned1.flags = (baseline_ned->flags >> 2) & 0x3F;
-    gps_data.group_c.baseline_ned2.north = baseline_ned->n;
-    gps_data.group_c.baseline_ned2.east = baseline_ned->e;
-    gps_data.group_c.baseline_ned3.down = baseline_ned->d;
+    back_data->group_c.baseline_ned1.time_of_week = baseline_ned->tow;
+    back_data->group_c.baseline_ned1.num_sats = baseline_ned->n_sats;
+    back_data->group_c.baseline_ned1.fix_mode = (0x03 & baseline_ned->flags);
+    back_data->group_c.baseline_ned1.flags = (baseline_ned->flags >> 2) & 0x3F;
+    back_data->group_c.baseline_ned2.north = baseline_ned->n;
+    back_data->group_c.baseline_ned2.east = baseline_ned->e;
+    back_data->group_c.baseline_ned3.down = baseline_ned->d;
 
     gps_set_group_ready( GPS_GROUP_C_READY );
 }
@@ -389,12 +393,12 @@ static void vel_ned_callback(
 
     const msg_vel_ned_t * const vel_ned = (const msg_vel_ned_t*) msg;
 
-    gps_data.group_d.vel_ned1.time_of_week = vel_ned->tow;
-    gps_data.group_d.vel_ned1.num_sats = vel_ned->n_sats;
-    gps_data.group_d.vel_ned1.flags = vel_ned->flags;
-    gps_data.group_d.vel_ned2.north = vel_ned->n;
-    gps_data.group_d.vel_ned2.east = vel_ned->e;
-    gps_data.group_d.vel_ned3.down = vel_ned->d;
+    back_data->group_d.vel_ned1.time_of_week = vel_ned->tow;
+    back_data->group_d.vel_ned1.num_sats = vel_ned->n_sats;
+    back_data->group_d.vel_ned1.flags = vel_ned->flags;
+    back_data->group_d.vel_ned2.north = vel_ned->n;
+    back_data->group_d.vel_ned2.east = vel_ned->e;
+    back_data->group_d.vel_ned3.down = vel_ned->d;
 
     gps_set_group_ready( GPS_GROUP_D_READY );
 }
@@ -411,29 +415,150 @@ static void heading_callback(
 
     const msg_baseline_heading_t * const heading = (const msg_baseline_heading_t*) msg;
 
-    gps_data.group_e.heading1.time_of_week = heading->tow;
-    gps_data.group_e.heading1.heading = heading->heading;
-    gps_data.group_e.heading2.num_sats = heading->n_sats;
-    gps_data.group_e.heading2.flags = heading->flags;
+    back_data->group_e.heading1.time_of_week = heading->tow;
+    back_data->group_e.heading1.heading = heading->heading;
+    back_data->group_e.heading2.num_sats = heading->n_sats;
+    back_data->group_e.heading2.flags = heading->flags;
 
     gps_set_group_ready( GPS_GROUP_E_READY );
 }
 
 
+// SBP message type dispatch table
+static const sbp_msg_dispatch_t SBP_DISPATCH_TABLE[] =
+{
+    { SBP_MSG_GPS_TIME, &gps_time_callback, NULL },
+    { SBP_MSG_POS_LLH, &pos_llh_callback, NULL },
+    { SBP_MSG_VEL_NED, &vel_ned_callback, NULL },
+    { SBP_MSG_BASELINE_NED, &baseline_ned_callback, NULL },
+    { SBP_MSG_BASELINE_HEADING, &heading_callback, NULL },
+    { SBP_MSG_DOPS, &dops_callback, NULL },
+    { SBP_MSG_HEARTBEAT, &heartbeat_callback, NULL }
+};
+
+
+// DOP changes slowly, publish GDOP steps of 0.01 and refresh otherwise
+static const publish_policy_s DOP1_PUBLISH_POLICY =
+{
+    HOBD_PUBLISH_MODE_ON_CHANGE,
+    HOBD_PUBLISH_DEADBAND_U16,
+    (uint8_t) offsetof( hobd_gps_dop1_s, gdop ),
+    1,
+    0,
+    GPS_PUBLISH_REFRESH_INTERVAL
+};
+
+
+//
+static const publish_policy_s DOP2_PUBLISH_POLICY =
+{
+    HOBD_PUBLISH_MODE_ON_CHANGE,
+    HOBD_PUBLISH_DEADBAND_NONE,
+    0,
+    0,
+    0,
+    GPS_PUBLISH_REFRESH_INTERVAL
+};
+
+
+// moves everything in the rx buffer into the scanner and dispatches
+// all complete frames
+static uint8_t process_buffer( void )
+{
+    uint8_t ret = 0;
+    uint8_t *dst = NULL;
+    uint16_t copied = 0;
+
+    rx_pass_time_us = time_get_us();
+
+    do
+    {
+        const uint16_t space = sbp_scanner_space( &sbp_scanner, &dst );
+
+        // bulk copy, single head/tail snapshot
+        copied = ring_buffer_read(
+                &rx_buffer,
+                dst,
+                space );
+
+        if( copied != 0 )
+        {
+            // callbacks are called from sbp_scan
+            profile_begin( HOBD_PROFILE_STAGE_GPS_PARSE );
+
+            const int8_t sbp_status = sbp_scan(
+                    &sbp_scanner,
+                    copied );
+
+            profile_end( HOBD_PROFILE_STAGE_GPS_PARSE );
+
+            if( sbp_status == SBP_CRC_ERROR )
+            {
+                ret = 1;
+                DEBUG_PRINTF( "process_buffer : sbp_scan %d\n", sbp_status );
+            }
+        }
+    }
+    while( copied != 0 );
+
+    return ret;
+}
+
+
+//
+static void update_rx_stats( void )
+{
+    ring_buffer_stats_s rb_stats;
+
+    ring_buffer_get_stats(
+            &rx_buffer,
+            &rb_stats );
+
+    diagnostics_set_rx_stats(
+            HOBD_RX_BUFFER_ID_GPS,
+            &rb_stats,
+            sbp_scanner.n_crc_errors );
+}
+
+
+// swap in the back buffer once it has ready groups and the front buffer
+// is no longer referenced by the CAN transmit queue
+static void swap_data_buffers( void )
+{
+    if( (back_data->ready_groups != GPS_GROUP_NONE_READY) && (front_ref_count == 0) )
+    {
+        gps_data_s * const ready_data = back_data;
+
+        back_data = front_data;
+        front_data = ready_data;
+
+        back_data->ready_groups = GPS_GROUP_NONE_READY;
+    }
+}
+
+
 //
 static uint8_t publish_group_a( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_TIME1,
-            (uint8_t) sizeof(gps_data.group_a.time1),
-            (const uint8_t *) &gps_data.group_a.time1 );
+            (uint8_t) sizeof(front_data->group_a.time1),
+            (const uint8_t *) &front_data->group_a.time1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_TIME2,
-            (uint8_t) sizeof(gps_data.group_a.time2),
-            (const uint8_t *) &gps_data.group_a.time2 );
+            (uint8_t) sizeof(front_data->group_a.time2),
+            (const uint8_t *) &front_data->group_a.time2,
+            &front_ref_count );
+
+    ret |= publish_send_ref(
+            HOBD_CAN_ID_GPS_TIME_US,
+            (uint8_t) sizeof(front_data->group_a.time_us),
+            (const uint8_t *) &front_data->group_a.time_us,
+            &front_ref_count );
 
     return ret;
 }
@@ -444,25 +569,29 @@ static uint8_t publish_group_b( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_POS_LLH1,
-            (uint8_t) sizeof(gps_data.group_b.pos_llh1),
-            (const uint8_t *) &gps_data.group_b.pos_llh1 );
+            (uint8_t) sizeof(front_data->group_b.pos_llh1),
+            (const uint8_t *) &front_data->group_b.pos_llh1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_POS_LLH2,
-            (uint8_t) sizeof(gps_data.group_b.pos_llh2),
-            (const uint8_t *) &gps_data.group_b.pos_llh2 );
+            (uint8_t) sizeof(front_data->group_b.pos_llh2),
+            (const uint8_t *) &front_data->group_b.pos_llh2,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_POS_LLH3,
-            (uint8_t) sizeof(gps_data.group_b.pos_llh3),
-            (const uint8_t *) &gps_data.group_b.pos_llh3 );
+            (uint8_t) sizeof(front_data->group_b.pos_llh3),
+            (const uint8_t *) &front_data->group_b.pos_llh3,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_POS_LLH4,
-            (uint8_t) sizeof(gps_data.group_b.pos_llh4),
-            (const uint8_t *) &gps_data.group_b.pos_llh4 );
+            (uint8_t) sizeof(front_data->group_b.pos_llh4),
+            (const uint8_t *) &front_data->group_b.pos_llh4,
+            &front_ref_count );
 
     return ret;
 }
@@ -473,20 +602,23 @@ static uint8_t publish_group_c( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_BASELINE_NED1,
-            (uint8_t) sizeof(gps_data.group_c.baseline_ned1),
-            (const uint8_t *) &gps_data.group_c.baseline_ned1 );
+            (uint8_t) sizeof(front_data->group_c.baseline_ned1),
+            (const uint8_t *) &front_data->group_c.baseline_ned1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_BASELINE_NED2,
-            (uint8_t) sizeof(gps_data.group_c.baseline_ned2),
-            (const uint8_t *) &gps_data.group_c.baseline_ned2 );
+            (uint8_t) sizeof(front_data->group_c.baseline_ned2),
+            (const uint8_t *) &front_data->group_c.baseline_ned2,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_BASELINE_NED3,
-            (uint8_t) sizeof(gps_data.group_c.baseline_ned3),
-            (const uint8_t *) &gps_data.group_c.baseline_ned3 );
+            (uint8_t) sizeof(front_data->group_c.baseline_ned3),
+            (const uint8_t *) &front_data->group_c.baseline_ned3,
+            &front_ref_count );
 
     return ret;
 }
@@ -497,20 +629,23 @@ static uint8_t publish_group_d( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_VEL_NED1,
-            (uint8_t) sizeof(gps_data.group_d.vel_ned1),
-            (const uint8_t *) &gps_data.group_d.vel_ned1 );
+            (uint8_t) sizeof(front_data->group_d.vel_ned1),
+            (const uint8_t *) &front_data->group_d.vel_ned1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_VEL_NED2,
-            (uint8_t) sizeof(gps_data.group_d.vel_ned2),
-            (const uint8_t *) &gps_data.group_d.vel_ned2 );
+            (uint8_t) sizeof(front_data->group_d.vel_ned2),
+            (const uint8_t *) &front_data->group_d.vel_ned2,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_VEL_NED3,
-            (uint8_t) sizeof(gps_data.group_d.vel_ned3),
-            (const uint8_t *) &gps_data.group_d.vel_ned3 );
+            (uint8_t) sizeof(front_data->group_d.vel_ned3),
+            (const uint8_t *) &front_data->group_d.vel_ned3,
+            &front_ref_count );
 
     return ret;
 }
@@ -521,15 +656,17 @@ static uint8_t publish_group_e( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_HEADING1,
-            (uint8_t) sizeof(gps_data.group_e.heading1),
-            (const uint8_t *) &gps_data.group_e.heading1 );
+            (uint8_t) sizeof(front_data->group_e.heading1),
+            (const uint8_t *) &front_data->group_e.heading1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_HEADING2,
-            (uint8_t) sizeof(gps_data.group_e.heading2),
-            (const uint8_t *) &gps_data.group_e.heading2 );
+            (uint8_t) sizeof(front_data->group_e.heading2),
+            (const uint8_t *) &front_data->group_e.heading2,
+            &front_ref_count );
 
     return ret;
 }
@@ -540,15 +677,17 @@ static uint8_t publish_group_f( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_DOP1,
-            (uint8_t) sizeof(gps_data.group_f.dop1),
-            (const uint8_t *) &gps_data.group_f.dop1 );
+            (uint8_t) sizeof(front_data->group_f.dop1),
+            (const uint8_t *) &front_data->group_f.dop1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_GPS_DOP2,
-            (uint8_t) sizeof(gps_data.group_f.dop2),
-            (const uint8_t *) &gps_data.group_f.dop2 );
+            (uint8_t) sizeof(front_data->group_f.dop2),
+            (const uint8_t *) &front_data->group_f.dop2,
+            &front_ref_count );
 
     return ret;
 }
@@ -587,67 +726,26 @@ static void update_gps_fix_timeout(
 uint8_t gps_init( void )
 {
     uint8_t ret = 0;
-    int8_t sbp_status = 0;
-
-    memset( &gps_data, 0, sizeof(gps_data) );
-
-    ring_buffer_init( &rx_buffer );
-
-    sbp_state_init( &sbp_state );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_HEARTBEAT,
-            &heartbeat_callback,
-            NULL,
-            &heartbeat_callback_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_GPS_TIME,
-            &gps_time_callback,
-            NULL,
-            &gps_time_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_DOPS,
-            &dops_callback,
-            NULL,
-            &dops_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_POS_LLH,
-            &pos_llh_callback,
-            NULL,
-            &pos_llh_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_BASELINE_NED,
-            &baseline_ned_callback,
-            NULL,
-            &baseline_ned_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_VEL_NED,
-            &vel_ned_callback,
-            NULL,
-            &vel_ned_node );
-
-    sbp_status |= sbp_register_callback(
-            &sbp_state,
-            SBP_MSG_BASELINE_HEADING,
-            &heading_callback,
-            NULL,
-            &heading_node );
-
-    if( sbp_status != SBP_OK )
-    {
-        ret = 1;
-    }
+
+    memset( gps_data, 0, sizeof(gps_data) );
+
+    ring_buffer_init(
+            &rx_buffer,
+            rx_buffer_storage,
+            (uint16_t) sizeof(rx_buffer_storage) );
+
+    sbp_scanner_init(
+            &sbp_scanner,
+            SBP_DISPATCH_TABLE,
+            (uint8_t) (sizeof(SBP_DISPATCH_TABLE) / sizeof(SBP_DISPATCH_TABLE[0])) );
+
+    ret |= publish_set_policy(
+            HOBD_CAN_ID_GPS_DOP1,
+            &DOP1_PUBLISH_POLICY );
+
+    ret |= publish_set_policy(
+            HOBD_CAN_ID_GPS_DOP2,
+            &DOP2_PUBLISH_POLICY );
 
     //
     hw_init();
@@ -688,7 +786,10 @@ void gps_enable( void )
 void gps_set_group_ready(
         const uint16_t group )
 {
-    gps_data.ready_groups |= group;
+    back_data->ready_groups |= group;
+
+    // called once a message is parsed
+    trace_parsed( HOBD_TRACE_GROUP_GPS, &rx_pass_time_us );
 }
 
 
@@ -696,14 +797,15 @@ void gps_set_group_ready(
 void gps_clear_group_ready(
         const uint16_t group )
 {
-    gps_data.ready_groups &= ~group;
+    front_data->ready_groups &= ~group;
 }
 
 
 //
 void gps_clear_all_group_ready( void )
 {
-    gps_data.ready_groups = GPS_GROUP_NONE_READY;
+    back_data->ready_groups = GPS_GROUP_NONE_READY;
+    front_data->ready_groups = GPS_GROUP_NONE_READY;
 }
 
 
@@ -711,7 +813,7 @@ void gps_clear_all_group_ready( void )
 uint8_t gps_is_group_ready(
         const uint16_t group )
 {
-    return ((gps_data.ready_groups & group) == 0) ? 0 : 1;
+    return ((front_data->ready_groups & group) == 0) ? 0 : 1;
 }
 
 
@@ -720,24 +822,23 @@ uint8_t gps_update( void )
 {
     uint8_t ret = 0;
 
-    // process any available data in the rx buffer, callbacks are called from
+    // scan all available data in the rx buffer, callbacks are called from
     // this context
-    const int8_t sbp_status = sbp_process(
-            &sbp_state,
-            &sbp_read_function );
-
-    if(
-            (sbp_status != SBP_OK)
-            && (sbp_status != SBP_OK_CALLBACK_EXECUTED)
-            && (sbp_status != SBP_OK_CALLBACK_UNDEFINED) )
-    {
-        ret = 1;
-        DEBUG_PRINTF( "gps_enable : sbp_process %d\n", sbp_status );
-    }
+    profile_begin( HOBD_PROFILE_STAGE_GPS_PROCESS_BUFFER );
+    ret = process_buffer();
+    profile_end( HOBD_PROFILE_STAGE_GPS_PROCESS_BUFFER );
+
+    // swap in newly ready groups
+    swap_data_buffers();
 
     // check for any ready groups
-    if( gps_data.ready_groups != GPS_GROUP_NONE_READY )
+    if( front_data->ready_groups != GPS_GROUP_NONE_READY )
     {
+        profile_begin( HOBD_PROFILE_STAGE_GPS_PUBLISH );
+
+        // all ready groups are traced as one
+        trace_publish_begin( HOBD_TRACE_GROUP_GPS );
+
         // handle groups in order/priority
         if( gps_is_group_ready( GPS_GROUP_A_READY ) != 0 )
         {
@@ -775,6 +876,10 @@ uint8_t gps_update( void )
             gps_clear_group_ready( GPS_GROUP_F_READY );
         }
 
+        trace_publish_end( HOBD_TRACE_GROUP_GPS );
+
+        profile_end( HOBD_PROFILE_STAGE_GPS_PUBLISH );
+
         if( ret != 0 )
         {
             diagnostics_set_warn( HOBD_HEARTBEAT_WARN_CANBUS );
@@ -787,5 +892,8 @@ uint8_t gps_update( void )
     // update GPS fix status/warning
     update_gps_fix_timeout( &now );
 
+    // rx buffer stats for the diagnostics heartbeat
+    update_rx_stats();
+
     return ret;
 }
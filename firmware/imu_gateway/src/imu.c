@@ -23,6 +23,10 @@
 #include "ring_buffer.h"
 #include "time.h"
 #include "canbus.h"
+#include "publish.h"
+#include "profile.h"
+#include "trace.h"
+#include "time_sync.h"
 #include "diagnostics.h"
 #include "imu.h"
 
@@ -33,8 +37,24 @@
 // static global types/macros
 // *****************************************************
 
-//
-#define XBUS_BUFFER_SIZE (512)
+// largest Xbus payload a full rx buffer holds whole, behind an extended
+// length header and the checksum
+#define XBUS_LENGTH_MAX (IMU_RX_BUFFER_SIZE - 1 - 6 - 1)
+
+
+// largest Xbus message sent, the output configuration
+#define TX_BUFFER_SIZE (64)
+
+
+// data identifiers handle_message_cb parses
+#define OUTPUT_CONFIG_COUNT (11)
+
+
+// Xsens configuration, one request and reply per step
+#define CONFIG_STEP_GOTO_CONFIG (0)
+#define CONFIG_STEP_SET_OUTPUT (1)
+#define CONFIG_STEP_GOTO_MEASUREMENT (2)
+#define CONFIG_STEP_DONE (3)
 
 
 //
@@ -48,6 +68,7 @@
 #define UART_UCSRB UCSR0B
 #define UART_UCSRC UCSR0C
 #define UART_DATA UDR0
+#define UART_UDRE_INTERRUPT USART0_UDRE_vect
 
 
 //
@@ -55,7 +76,31 @@
 
 
 //
-#define imu_uart_disable() (UART_UCSRB &= ~(_BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0)))
+#define imu_uart_disable() (UART_UCSRB &= ~(_BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0) | _BV(UDRIE0)))
+
+
+//
+#define imu_uart_tx_busy() ((UART_UCSRB & _BV(UDRIE0)) != 0)
+
+
+//
+#define imu_uart_tx_start() (UART_UCSRB |= _BV(UDRIE0))
+
+
+//
+#define imu_uart_tx_stop() (UART_UCSRB &= ~_BV(UDRIE0))
+
+
+// MTData2 message receive times, the dispatch context
+typedef struct
+{
+    //
+    // ms
+    uint32_t rx_timestamp;
+    //
+    // us
+    uint32_t rx_time_us;
+} rx_context_s;
 
 
 
@@ -66,24 +111,92 @@
 
 // UART rx ring buffer
 static volatile ring_buffer_s rx_buffer;
+static uint8_t rx_buffer_storage[ IMU_RX_BUFFER_SIZE ];
+
+
+// Xbus scanner state, messages are handled in place in rx_buffer
+static struct XbusScanner xbus_scanner;
+
+
+// IMU message/data state, double buffered
+static imu_data_s imu_data[ 2 ];
 
 
-// Xbus parser state
-static struct XbusParser xbus_parser;
+// parsers write into the back buffer
+static imu_data_s *back_data = &imu_data[ 0 ];
 
 
-// Xbux static buffer
-static uint8_t xbus_buffer[ XBUS_BUFFER_SIZE ];
+// published groups are read from the front buffer
+static imu_data_s *front_data = &imu_data[ 1 ];
 
 
-// IMU message/data state
-static imu_data_s imu_data;
+// queued CAN frames still referencing the front buffer
+static volatile uint8_t front_ref_count = 0;
 
 
 // last rx status byte time
 static uint32_t last_rx_status_time = 0;
 
 
+// start of the current rx buffer pass on the us clock, for tracing
+static uint32_t rx_pass_time_us = 0;
+
+
+// last GPS fix state from the status byte, carried across buffer swaps
+static uint8_t status_gps_fix = 0;
+
+
+// MTData2 messages with a data item running past the payload
+static uint16_t protocol_errors = 0;
+
+
+// UART tx message, sent from the data register empty interrupt
+static volatile uint8_t tx_buffer[ TX_BUFFER_SIZE ];
+static volatile uint8_t tx_len = 0;
+static volatile uint8_t tx_idx = 0;
+
+
+// output rate of each data identifier handle_message_cb parses
+static const struct OutputConfiguration DEFAULT_OUTPUT_CONFIG[ OUTPUT_CONFIG_COUNT ] =
+{
+    { XDI_SampleTimeFine, HOBD_IMU_OUTPUT_RATE_ALL },
+    { XDI_StatusByte, HOBD_IMU_OUTPUT_RATE_ALL },
+    { XDI_GpsSol, IMU_OUTPUT_RATE_TIME },
+    { XDI_UtcTime, IMU_OUTPUT_RATE_TIME },
+    { XDI_Quaternion, IMU_OUTPUT_RATE_MOTION },
+    { XDI_RateOfTurn, IMU_OUTPUT_RATE_MOTION },
+    { XDI_FreeAcceleration, IMU_OUTPUT_RATE_MOTION },
+    { XDI_MagneticField, IMU_OUTPUT_RATE_MAGF },
+    { XDI_LatLon, IMU_OUTPUT_RATE_NAV },
+    { XDI_AltitudeEllipsoid, IMU_OUTPUT_RATE_NAV },
+    { XDI_VelocityXYZ, IMU_OUTPUT_RATE_NAV }
+};
+
+
+//
+static struct OutputConfiguration output_config[ OUTPUT_CONFIG_COUNT ];
+
+
+// CONFIG_STEP_*
+static uint8_t config_step = CONFIG_STEP_DONE;
+
+
+// requests sent for the current step
+static uint8_t config_attempts = 0;
+
+
+// set while the current step's request waits for its reply
+static uint8_t config_sent = 0;
+
+
+// set if a step was given up since the configuration started
+static uint8_t config_failed = 0;
+
+
+// ms
+static uint32_t config_sent_time = 0;
+
+
 
 
 // *****************************************************
@@ -94,16 +207,44 @@ static uint32_t last_rx_status_time = 0;
 static void hw_init( void );
 
 
+//
+static uint8_t tx_message(
+        const struct XbusMessage * const message );
+
+
+//
+static uint8_t send_config_request( void );
+
+
+//
+static void set_config_step(
+        const uint8_t step );
+
+
+//
+static void start_config( void );
+
+
+//
+static void update_config(
+        const uint32_t * const now );
+
+
+//
+static void handle_config_reply(
+        const struct XbusMessageView * const message );
+
+
 //
 static uint8_t process_buffer( void );
 
 
 //
-static void *xbus_alloc_cb( size_t size );
+static void update_rx_stats( void );
 
 
 //
-static void xbus_free_cb( void const * buffer );
+static void swap_data_buffers( void );
 
 
 //
@@ -118,68 +259,92 @@ static uint8_t publish_group_i( void );
 static uint8_t publish_group_j( void );
 
 
+//
+static int16_t to_compact(
+        const float value,
+        const float scale );
+
+
 //
 static void parse_sample_time_fine(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_gps_sol_time(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_utc_time(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_orient_quat(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_rate_of_turn(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_free_accel(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_magf(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_pos_ll(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_pos_h(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_vel_ned(
-        const struct XbusMessage * const message );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void parse_status_byte(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp );
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context );
 
 
 //
 static void handle_message_cb(
-        struct XbusMessage const * message );
+        struct XbusMessageView const * message );
 
 
 //
@@ -200,8 +365,16 @@ ISR( UART_RX_INTERRUPT )
     const uint8_t status  = UART_UCSRA;
     const uint8_t data = UART_DATA;
 
-    // read error status
-    rx_buffer.error = (status & (_BV(FE0) | _BV(DOR0)) );
+    // record UART errors, counted separately from the data
+    if( (status & _BV(FE0)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_FRAME_ERROR, &rx_buffer );
+    }
+
+    if( (status & _BV(DOR0)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_OVERRUN_ERROR, &rx_buffer );
+    }
 
     // push data into the rx buffer, error is updated with return status
     (void) ring_buffer_putc(
@@ -210,6 +383,22 @@ ISR( UART_RX_INTERRUPT )
 }
 
 
+//
+ISR( UART_UDRE_INTERRUPT )
+{
+    if( tx_idx < tx_len )
+    {
+        UART_DATA = tx_buffer[ tx_idx ];
+        tx_idx += 1;
+    }
+
+    if( tx_idx >= tx_len )
+    {
+        imu_uart_tx_stop();
+    }
+}
+
+
 //
 static void hw_init( void )
 {
@@ -225,49 +414,251 @@ static void hw_init( void )
 }
 
 
-//
-static uint8_t process_buffer( void )
+// non-blocking, the message is formatted and sent by the UART interrupt
+static uint8_t tx_message(
+        const struct XbusMessage * const message )
 {
     uint8_t ret = 0;
+    uint8_t idx = 0;
+    uint8_t raw[ TX_BUFFER_SIZE ];
+
+    if( imu_uart_tx_busy() )
+    {
+        ret = 1;
+    }
+    else
+    {
+        const size_t len = XbusMessage_format(
+                raw,
+                message,
+                XLLF_Uart );
+
+        for( idx = 0; idx < (uint8_t) len; idx += 1 )
+        {
+            tx_buffer[ idx ] = raw[ idx ];
+        }
+
+        tx_idx = 0;
+        tx_len = (uint8_t) len;
+
+        imu_uart_tx_start();
+    }
+
+    return ret;
+}
 
-    const uint16_t data = ring_buffer_getc( &rx_buffer );
 
-    if( data != RING_BUFFER_NO_DATA )
+// returns non-zero if the UART is still busy with the last message
+static uint8_t send_config_request( void )
+{
+    uint8_t ret = 0;
+    uint8_t idx = 0;
+    struct XbusMessage message;
+    struct OutputConfiguration enabled[ OUTPUT_CONFIG_COUNT ];
+
+    message.length = 0;
+    message.data = NULL;
+
+    if( config_step == CONFIG_STEP_GOTO_CONFIG )
+    {
+        message.mid = XMID_GotoConfig;
+    }
+    else if( config_step == CONFIG_STEP_SET_OUTPUT )
+    {
+        message.mid = XMID_SetOutputConfig;
+        message.data = enabled;
+
+        // data identifiers turned off are left out
+        for( idx = 0; idx < OUTPUT_CONFIG_COUNT; idx += 1 )
+        {
+            if( output_config[ idx ].freq != HOBD_IMU_OUTPUT_RATE_OFF )
+            {
+                enabled[ message.length ] = output_config[ idx ];
+                message.length += 1;
+            }
+        }
+    }
+    else
     {
-        XbusParser_parseByte( &xbus_parser, (uint8_t) (data & 0xFF) );
+        message.mid = XMID_GotoMeasurement;
     }
 
+    ret = tx_message( &message );
+
     return ret;
 }
 
 
 //
-static void *xbus_alloc_cb( size_t size )
+static void set_config_step(
+        const uint8_t step )
 {
-    void *memory = NULL;
+    config_step = step;
+    config_attempts = 0;
+    config_sent = 0;
 
-#ifdef BUILD_TYPE_DEBUG
-    if( size > sizeof(xbus_buffer) )
+    if( (config_step == CONFIG_STEP_DONE) && (config_failed == 0) )
     {
-        diagnostics_set_error( HOBD_HEARTBEAT_ERROR_IMU_RX_OVERFLOW );
+        diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_IMU_CONFIG );
     }
+}
+
+
+// the warning stays set until every step has been acknowledged
+static void start_config( void )
+{
+    config_failed = 0;
+
+    diagnostics_set_warn( HOBD_HEARTBEAT_WARN_IMU_CONFIG );
 
-    memory = (void*) &xbus_buffer[0];
-#else
-    if( size <= sizeof(xbus_buffer) )
+    set_config_step( CONFIG_STEP_GOTO_CONFIG );
+}
+
+
+// a step given up after IMU_CONFIG_ATTEMPTS moves on, leaving
+// configuration mode is still attempted if the output was not set
+static void update_config(
+        const uint32_t * const now )
+{
+    if( config_step != CONFIG_STEP_DONE )
     {
-        memory = (void*) &xbus_buffer[0];
+        if( config_sent == 0 )
+        {
+            if( send_config_request() == 0 )
+            {
+                config_sent = 1;
+                config_sent_time = (*now);
+                config_attempts += 1;
+            }
+        }
+        else
+        {
+            const uint32_t delta = time_get_delta(
+                    &config_sent_time,
+                    now );
+
+            if( delta >= IMU_CONFIG_TIMEOUT )
+            {
+                config_sent = 0;
+
+                if( config_attempts >= IMU_CONFIG_ATTEMPTS )
+                {
+                    config_failed = 1;
+
+                    if( config_step == CONFIG_STEP_SET_OUTPUT )
+                    {
+                        set_config_step( CONFIG_STEP_GOTO_MEASUREMENT );
+                    }
+                    else
+                    {
+                        set_config_step( CONFIG_STEP_DONE );
+                    }
+                }
+            }
+        }
     }
-#endif
+}
 
-    return memory;
+
+// the Xsens echoes the output configuration it applied, its contents are
+// not checked
+static void handle_config_reply(
+        const struct XbusMessageView * const message )
+{
+    if( config_sent != 0 )
+    {
+        if(
+                (config_step == CONFIG_STEP_GOTO_CONFIG)
+                && (message->mid == XMID_GotoConfigAck) )
+        {
+            set_config_step( CONFIG_STEP_SET_OUTPUT );
+        }
+        else if(
+                (config_step == CONFIG_STEP_SET_OUTPUT)
+                && (message->mid == XMID_OutputConfig) )
+        {
+            set_config_step( CONFIG_STEP_GOTO_MEASUREMENT );
+        }
+        else if(
+                (config_step == CONFIG_STEP_GOTO_MEASUREMENT)
+                && (message->mid == XMID_GotoMeasurementAck) )
+        {
+            set_config_step( CONFIG_STEP_DONE );
+        }
+    }
+}
+
+
+// messages are handled in place, the bytes up to a partial message are
+// consumed after the scan
+static uint8_t process_buffer( void )
+{
+    uint8_t ret = 0;
+    ring_buffer_view_s view;
+    struct XbusSpan span;
+
+    rx_pass_time_us = time_get_us();
+
+    const uint16_t length_errors = xbus_scanner.lengthErrors;
+
+    if( ring_buffer_peek_view( &rx_buffer, &view ) != 0 )
+    {
+        span.part[ 0 ] = view.span[ 0 ];
+        span.length[ 0 ] = view.len[ 0 ];
+        span.part[ 1 ] = view.span[ 1 ];
+        span.length[ 1 ] = view.len[ 1 ];
+
+        // callbacks are called from this context
+        const uint16_t scanned = XbusScanner_scan(
+                &xbus_scanner,
+                &span );
+
+        ring_buffer_consume(
+                &rx_buffer,
+                scanned );
+    }
+
+    // a message that would not fit the rx buffer
+    if( xbus_scanner.lengthErrors != length_errors )
+    {
+        diagnostics_set_error( HOBD_HEARTBEAT_ERROR_IMU_RX_OVERFLOW );
+    }
+
+    return ret;
 }
 
 
 //
-static void xbus_free_cb( void const * buffer )
+static void update_rx_stats( void )
 {
-    // do nothing to our static buffer
+    ring_buffer_stats_s rb_stats;
+
+    ring_buffer_get_stats(
+            &rx_buffer,
+            &rb_stats );
+
+    diagnostics_set_rx_stats(
+            HOBD_RX_BUFFER_ID_IMU,
+            &rb_stats,
+            protocol_errors
+                + xbus_scanner.checksumErrors
+                + xbus_scanner.lengthErrors );
+}
+
+
+// swap in the back buffer once it has ready groups and the front buffer
+// is no longer referenced by the CAN transmit queue
+static void swap_data_buffers( void )
+{
+    if( (back_data->ready_groups != IMU_GROUP_NONE_READY) && (front_ref_count == 0) )
+    {
+        imu_data_s * const ready_data = back_data;
+
+        back_data = front_data;
+        front_data = ready_data;
+
+        back_data->ready_groups = IMU_GROUP_NONE_READY;
+    }
 }
 
 
@@ -276,10 +667,17 @@ static uint8_t publish_group_a( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_SAMPLE_TIME,
-            (uint8_t) sizeof(imu_data.group_a.sample_time),
-            (const uint8_t *) &imu_data.group_a.sample_time );
+            (uint8_t) sizeof(front_data->group_a.sample_time),
+            (const uint8_t *) &front_data->group_a.sample_time,
+            &front_ref_count );
+
+    ret |= publish_send_ref(
+            HOBD_CAN_ID_IMU_TIME_US,
+            (uint8_t) sizeof(front_data->group_a.time_us),
+            (const uint8_t *) &front_data->group_a.time_us,
+            &front_ref_count );
 
     return ret;
 }
@@ -290,15 +688,17 @@ static uint8_t publish_group_b( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_TIME1,
-            (uint8_t) sizeof(imu_data.group_b.time1),
-            (const uint8_t *) &imu_data.group_b.time1 );
+            (uint8_t) sizeof(front_data->group_b.time1),
+            (const uint8_t *) &front_data->group_b.time1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_TIME2,
-            (uint8_t) sizeof(imu_data.group_b.time2),
-            (const uint8_t *) &imu_data.group_b.time2 );
+            (uint8_t) sizeof(front_data->group_b.time2),
+            (const uint8_t *) &front_data->group_b.time2,
+            &front_ref_count );
 
     return ret;
 }
@@ -309,15 +709,17 @@ static uint8_t publish_group_c( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_UTC_TIME1,
-            (uint8_t) sizeof(imu_data.group_c.utc_time1),
-            (const uint8_t *) &imu_data.group_c.utc_time1 );
+            (uint8_t) sizeof(front_data->group_c.utc_time1),
+            (const uint8_t *) &front_data->group_c.utc_time1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_UTC_TIME2,
-            (uint8_t) sizeof(imu_data.group_c.utc_time2),
-            (const uint8_t *) &imu_data.group_c.utc_time2 );
+            (uint8_t) sizeof(front_data->group_c.utc_time2),
+            (const uint8_t *) &front_data->group_c.utc_time2,
+            &front_ref_count );
 
     return ret;
 }
@@ -328,15 +730,28 @@ static uint8_t publish_group_d( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_ORIENT_QUAT1,
-            (uint8_t) sizeof(imu_data.group_d.orient_quat1),
-            (const uint8_t *) &imu_data.group_d.orient_quat1 );
-
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_ORIENT_QUAT2,
-            (uint8_t) sizeof(imu_data.group_d.orient_quat2),
-            (const uint8_t *) &imu_data.group_d.orient_quat2 );
+    if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT,
+                (uint8_t) sizeof(front_data->group_d.compact_orient_quat),
+                (const uint8_t *) &front_data->group_d.compact_orient_quat,
+                &front_ref_count );
+    }
+    else
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_ORIENT_QUAT1,
+                (uint8_t) sizeof(front_data->group_d.orient_quat1),
+                (const uint8_t *) &front_data->group_d.orient_quat1,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_ORIENT_QUAT2,
+                (uint8_t) sizeof(front_data->group_d.orient_quat2),
+                (const uint8_t *) &front_data->group_d.orient_quat2,
+                &front_ref_count );
+    }
 
     return ret;
 }
@@ -347,15 +762,28 @@ static uint8_t publish_group_e( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_RATE_OF_TURN1,
-            (uint8_t) sizeof(imu_data.group_e.rate_of_turn1),
-            (const uint8_t *) &imu_data.group_e.rate_of_turn1 );
-
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_RATE_OF_TURN2,
-            (uint8_t) sizeof(imu_data.group_e.rate_of_turn2),
-            (const uint8_t *) &imu_data.group_e.rate_of_turn2 );
+    if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN,
+                (uint8_t) sizeof(front_data->group_e.compact_rate_of_turn),
+                (const uint8_t *) &front_data->group_e.compact_rate_of_turn,
+                &front_ref_count );
+    }
+    else
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_RATE_OF_TURN1,
+                (uint8_t) sizeof(front_data->group_e.rate_of_turn1),
+                (const uint8_t *) &front_data->group_e.rate_of_turn1,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_RATE_OF_TURN2,
+                (uint8_t) sizeof(front_data->group_e.rate_of_turn2),
+                (const uint8_t *) &front_data->group_e.rate_of_turn2,
+                &front_ref_count );
+    }
 
     return ret;
 }
@@ -366,15 +794,28 @@ static uint8_t publish_group_f( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_ACCEL1,
-            (uint8_t) sizeof(imu_data.group_f.accel1),
-            (const uint8_t *) &imu_data.group_f.accel1 );
-
-    ret |= canbus_send(
-            HOBD_CAN_ID_IMU_ACCEL2,
-            (uint8_t) sizeof(imu_data.group_f.accel2),
-            (const uint8_t *) &imu_data.group_f.accel2 );
+    if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_COMPACT_ACCEL,
+                (uint8_t) sizeof(front_data->group_f.compact_accel),
+                (const uint8_t *) &front_data->group_f.compact_accel,
+                &front_ref_count );
+    }
+    else
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_ACCEL1,
+                (uint8_t) sizeof(front_data->group_f.accel1),
+                (const uint8_t *) &front_data->group_f.accel1,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_IMU_ACCEL2,
+                (uint8_t) sizeof(front_data->group_f.accel2),
+                (const uint8_t *) &front_data->group_f.accel2,
+                &front_ref_count );
+    }
 
     return ret;
 }
@@ -385,15 +826,17 @@ static uint8_t publish_group_g( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_MAGF1,
-            (uint8_t) sizeof(imu_data.group_g.magf1),
-            (const uint8_t *) &imu_data.group_g.magf1 );
+            (uint8_t) sizeof(front_data->group_g.magf1),
+            (const uint8_t *) &front_data->group_g.magf1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_MAGF2,
-            (uint8_t) sizeof(imu_data.group_g.magf2),
-            (const uint8_t *) &imu_data.group_g.magf2 );
+            (uint8_t) sizeof(front_data->group_g.magf2),
+            (const uint8_t *) &front_data->group_g.magf2,
+            &front_ref_count );
 
     return ret;
 }
@@ -404,10 +847,11 @@ static uint8_t publish_group_h( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_POS_LLH1,
-            (uint8_t) sizeof(imu_data.group_h.pos_llh1),
-            (const uint8_t *) &imu_data.group_h.pos_llh1 );
+            (uint8_t) sizeof(front_data->group_h.pos_llh1),
+            (const uint8_t *) &front_data->group_h.pos_llh1,
+            &front_ref_count );
 
     return ret;
 }
@@ -418,10 +862,11 @@ static uint8_t publish_group_i( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_POS_LLH2,
-            (uint8_t) sizeof(imu_data.group_i.pos_llh2),
-            (const uint8_t *) &imu_data.group_i.pos_llh2 );
+            (uint8_t) sizeof(front_data->group_i.pos_llh2),
+            (const uint8_t *) &front_data->group_i.pos_llh2,
+            &front_ref_count );
 
     return ret;
 }
@@ -432,38 +877,77 @@ static uint8_t publish_group_j( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_VEL_NED1,
-            (uint8_t) sizeof(imu_data.group_j.vel_ned1),
-            (const uint8_t *) &imu_data.group_j.vel_ned1 );
+            (uint8_t) sizeof(front_data->group_j.vel_ned1),
+            (const uint8_t *) &front_data->group_j.vel_ned1,
+            &front_ref_count );
 
-    ret |= canbus_send(
+    ret |= publish_send_ref(
             HOBD_CAN_ID_IMU_VEL_NED2,
-            (uint8_t) sizeof(imu_data.group_j.vel_ned2),
-            (const uint8_t *) &imu_data.group_j.vel_ned2 );
+            (uint8_t) sizeof(front_data->group_j.vel_ned2),
+            (const uint8_t *) &front_data->group_j.vel_ned2,
+            &front_ref_count );
 
     return ret;
 }
 
 
+// scaled, rounded and saturated to the int16_t range
+static int16_t to_compact(
+        const float value,
+        const float scale )
+{
+    int16_t compact = 0;
+
+    const float scaled = (value * scale);
+
+    if( isnan( scaled ) != 0 )
+    {
+        compact = 0;
+    }
+    else if( scaled >= (float) INT16_MAX )
+    {
+        compact = INT16_MAX;
+    }
+    else if( scaled <= (float) INT16_MIN )
+    {
+        compact = INT16_MIN;
+    }
+    else
+    {
+        compact = (int16_t) lround( (double) scaled );
+    }
+
+    return compact;
+}
+
+
 //
 static void parse_sample_time_fine(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
+    const rx_context_s * const rx = (const rx_context_s*) context;
+
     uint32_t sample_time;
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             &sample_time,
             XDI_SampleTimeFine,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_sample_time_fine\n" );
 
-        imu_data.group_a.sample_time.rx_time = (*rx_timestamp);
-        imu_data.group_a.sample_time.sample_time = sample_time;
+        back_data->group_a.sample_time.rx_time = rx->rx_timestamp;
+        back_data->group_a.sample_time.sample_time = sample_time;
+
+        back_data->group_a.time_us.rx_time_us = rx->rx_time_us;
+        back_data->group_a.time_us.sync_time_us = time_sync_get_time( &rx->rx_time_us );
 
         imu_set_group_ready( IMU_GROUP_A_READY );
     }
@@ -472,26 +956,30 @@ static void parse_sample_time_fine(
 
 //
 static void parse_gps_sol_time(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
+    const rx_context_s * const rx = (const rx_context_s*) context;
+
     XsGpsSol gps_sol;
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             &gps_sol,
             XDI_GpsSol,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_gps_sol_time\n" );
 
-        imu_data.group_b.time1.rx_time = (*rx_timestamp);
-        imu_data.group_b.time1.week_number = gps_sol.week;
-        imu_data.group_b.time1.gps_fix_type = gps_sol.gps_fix;
-        imu_data.group_b.time1.flags = gps_sol.flags;
-        imu_data.group_b.time2.time_of_week = gps_sol.tow;
-        imu_data.group_b.time2.residual = gps_sol.residual;
+        back_data->group_b.time1.rx_time = rx->rx_timestamp;
+        back_data->group_b.time1.week_number = gps_sol.week;
+        back_data->group_b.time1.gps_fix_type = gps_sol.gps_fix;
+        back_data->group_b.time1.flags = gps_sol.flags;
+        back_data->group_b.time2.time_of_week = gps_sol.tow;
+        back_data->group_b.time2.residual = gps_sol.residual;
 
         imu_set_group_ready( IMU_GROUP_B_READY );
     }
@@ -500,29 +988,34 @@ static void parse_gps_sol_time(
 
 //
 static void parse_utc_time(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
+    const rx_context_s * const rx = (const rx_context_s*) context;
+
     XsUtcTime utc_time;
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             &utc_time,
             XDI_UtcTime,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_utc_time\n" );
 
-        imu_data.group_c.utc_time1.rx_time = (*rx_timestamp);
-        imu_data.group_c.utc_time1.flags = (utc_time.flags & 0x7F);
-        imu_data.group_c.utc_time1.year = utc_time.year;
-        imu_data.group_c.utc_time1.month = utc_time.month;
-        imu_data.group_c.utc_time2.day = utc_time.day;
-        imu_data.group_c.utc_time2.hour = utc_time.hour;
-        imu_data.group_c.utc_time2.min = utc_time.min;
-        imu_data.group_c.utc_time2.sec = utc_time.sec;
-        imu_data.group_c.utc_time2.nanosec = utc_time.nanosec;
+        back_data->group_c.utc_time1.rx_time = rx->rx_timestamp;
+        back_data->group_c.utc_time1.flags = (utc_time.flags & 0x7F);
+        back_data->group_c.utc_time1.year = utc_time.year;
+        back_data->group_c.utc_time1.month = utc_time.month;
+        back_data->group_c.utc_time1.gps_fix = status_gps_fix;
+        back_data->group_c.utc_time2.day = utc_time.day;
+        back_data->group_c.utc_time2.hour = utc_time.hour;
+        back_data->group_c.utc_time2.min = utc_time.min;
+        back_data->group_c.utc_time2.sec = utc_time.sec;
+        back_data->group_c.utc_time2.nanosec = utc_time.nanosec;
 
         imu_set_group_ready( IMU_GROUP_C_READY );
     }
@@ -531,23 +1024,36 @@ static void parse_utc_time(
 
 //
 static void parse_orient_quat(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float quat[4];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             quat,
             XDI_Quaternion,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_orient_quat\n" );
 
-        imu_data.group_d.orient_quat1.q1 = quat[ 0 ];
-        imu_data.group_d.orient_quat1.q2 = quat[ 1 ];
-        imu_data.group_d.orient_quat2.q3 = quat[ 2 ];
-        imu_data.group_d.orient_quat2.q4 = quat[ 3 ];
+        if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+        {
+            back_data->group_d.compact_orient_quat.q1 = to_compact( quat[ 0 ], HOBD_IMU_COMPACT_QUAT_SCALE );
+            back_data->group_d.compact_orient_quat.q2 = to_compact( quat[ 1 ], HOBD_IMU_COMPACT_QUAT_SCALE );
+            back_data->group_d.compact_orient_quat.q3 = to_compact( quat[ 2 ], HOBD_IMU_COMPACT_QUAT_SCALE );
+            back_data->group_d.compact_orient_quat.q4 = to_compact( quat[ 3 ], HOBD_IMU_COMPACT_QUAT_SCALE );
+        }
+        else
+        {
+            back_data->group_d.orient_quat1.q1 = quat[ 0 ];
+            back_data->group_d.orient_quat1.q2 = quat[ 1 ];
+            back_data->group_d.orient_quat2.q3 = quat[ 2 ];
+            back_data->group_d.orient_quat2.q4 = quat[ 3 ];
+        }
 
         imu_set_group_ready( IMU_GROUP_D_READY );
     }
@@ -556,22 +1062,35 @@ static void parse_orient_quat(
 
 //
 static void parse_rate_of_turn(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float gryo[3];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             gryo,
             XDI_RateOfTurn,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_rate_of_turn\n" );
 
-        imu_data.group_e.rate_of_turn1.x = gryo[ 0 ];
-        imu_data.group_e.rate_of_turn1.y = gryo[ 1 ];
-        imu_data.group_e.rate_of_turn2.z = gryo[ 2 ];
+        if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+        {
+            back_data->group_e.compact_rate_of_turn.version = HOBD_IMU_COMPACT_VERSION;
+            back_data->group_e.compact_rate_of_turn.x = to_compact( gryo[ 0 ], HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+            back_data->group_e.compact_rate_of_turn.y = to_compact( gryo[ 1 ], HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+            back_data->group_e.compact_rate_of_turn.z = to_compact( gryo[ 2 ], HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+        }
+        else
+        {
+            back_data->group_e.rate_of_turn1.x = gryo[ 0 ];
+            back_data->group_e.rate_of_turn1.y = gryo[ 1 ];
+            back_data->group_e.rate_of_turn2.z = gryo[ 2 ];
+        }
 
         imu_set_group_ready( IMU_GROUP_E_READY );
     }
@@ -580,22 +1099,35 @@ static void parse_rate_of_turn(
 
 //
 static void parse_free_accel(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float accel[3];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             accel,
             XDI_FreeAcceleration,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_free_accel\n" );
 
-        imu_data.group_f.accel1.x = accel[ 0 ];
-        imu_data.group_f.accel1.y = accel[ 1 ];
-        imu_data.group_f.accel2.z = accel[ 2 ];
+        if( IMU_ENCODING == HOBD_IMU_ENCODING_COMPACT )
+        {
+            back_data->group_f.compact_accel.version = HOBD_IMU_COMPACT_VERSION;
+            back_data->group_f.compact_accel.x = to_compact( accel[ 0 ], HOBD_IMU_COMPACT_ACCEL_SCALE );
+            back_data->group_f.compact_accel.y = to_compact( accel[ 1 ], HOBD_IMU_COMPACT_ACCEL_SCALE );
+            back_data->group_f.compact_accel.z = to_compact( accel[ 2 ], HOBD_IMU_COMPACT_ACCEL_SCALE );
+        }
+        else
+        {
+            back_data->group_f.accel1.x = accel[ 0 ];
+            back_data->group_f.accel1.y = accel[ 1 ];
+            back_data->group_f.accel2.z = accel[ 2 ];
+        }
 
         imu_set_group_ready( IMU_GROUP_F_READY );
     }
@@ -604,22 +1136,25 @@ static void parse_free_accel(
 
 //
 static void parse_magf(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float magf[3];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             magf,
             XDI_MagneticField,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_magf\n" );
 
-        imu_data.group_g.magf1.x = magf[ 0 ];
-        imu_data.group_g.magf1.y = magf[ 1 ];
-        imu_data.group_g.magf2.z = magf[ 2 ];
+        back_data->group_g.magf1.x = magf[ 0 ];
+        back_data->group_g.magf1.y = magf[ 1 ];
+        back_data->group_g.magf2.z = magf[ 2 ];
 
         imu_set_group_ready( IMU_GROUP_G_READY );
     }
@@ -628,21 +1163,24 @@ static void parse_magf(
 
 //
 static void parse_pos_ll(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float lat_lon[2];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             lat_lon,
             XDI_LatLon,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_pos_ll\n" );
 
-        imu_data.group_h.pos_llh1.latitude = lat_lon[ 0 ];
-        imu_data.group_h.pos_llh1.longitude = lat_lon[ 1 ];
+        back_data->group_h.pos_llh1.latitude = lat_lon[ 0 ];
+        back_data->group_h.pos_llh1.longitude = lat_lon[ 1 ];
 
         imu_set_group_ready( IMU_GROUP_H_READY );
     }
@@ -651,20 +1189,23 @@ static void parse_pos_ll(
 
 //
 static void parse_pos_h(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float height;
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             &height,
             XDI_AltitudeEllipsoid,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_pos_h\n" );
 
-        imu_data.group_i.pos_llh2.height = height;
+        back_data->group_i.pos_llh2.height = height;
 
         imu_set_group_ready( IMU_GROUP_I_READY );
     }
@@ -673,22 +1214,25 @@ static void parse_pos_h(
 
 //
 static void parse_vel_ned(
-        const struct XbusMessage * const message )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
     float vel[3];
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             vel,
             XDI_VelocityXYZ,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_vel_ned\n" );
 
-        imu_data.group_j.vel_ned1.north = vel[ 0 ];
-        imu_data.group_j.vel_ned1.east = vel[ 1 ];
-        imu_data.group_j.vel_ned2.down = vel[ 2 ];
+        back_data->group_j.vel_ned1.north = vel[ 0 ];
+        back_data->group_j.vel_ned1.east = vel[ 1 ];
+        back_data->group_j.vel_ned2.down = vel[ 2 ];
 
         imu_set_group_ready( IMU_GROUP_J_READY );
     }
@@ -697,30 +1241,36 @@ static void parse_vel_ned(
 
 //
 static void parse_status_byte(
-        const struct XbusMessage * const message,
-        const uint32_t * const rx_timestamp )
+        const uint8_t * const data,
+        const uint8_t size,
+        void * const context )
 {
+    const rx_context_s * const rx = (const rx_context_s*) context;
+
     uint8_t status_byte = 0;
 
-    const uint8_t status = XbusMessage_getDataItem(
+    const uint8_t status = XbusMessage_readDataItem(
             &status_byte,
             XDI_StatusByte,
-            message );
+            data,
+            size );
 
     if( status != 0 )
     {
         DEBUG_PUTS( "imu_status\n" );
 
-        last_rx_status_time = (*rx_timestamp);
+        last_rx_status_time = rx->rx_timestamp;
 
         if( (status_byte & XS_STATUS_BIT_GPS_FIX) == 0 )
         {
-            imu_data.group_c.utc_time1.gps_fix = 0;
+            status_gps_fix = 0;
+            back_data->group_c.utc_time1.gps_fix = status_gps_fix;
             diagnostics_set_warn( HOBD_HEARTBEAT_WARN_NO_IMU_FIX );
         }
         else
         {
-            imu_data.group_c.utc_time1.gps_fix = 1;
+            status_gps_fix = 1;
+            back_data->group_c.utc_time1.gps_fix = status_gps_fix;
             diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_NO_IMU_FIX );
         }
 
@@ -736,47 +1286,59 @@ static void parse_status_byte(
 }
 
 
+// MTData2 data identifier dispatch table
+static const struct XbusDataItemDispatch XBUS_DISPATCH_TABLE[] =
+{
+    { XDI_SampleTimeFine, &parse_sample_time_fine },
+    { XDI_GpsSol, &parse_gps_sol_time },
+    { XDI_UtcTime, &parse_utc_time },
+    { XDI_Quaternion, &parse_orient_quat },
+    { XDI_RateOfTurn, &parse_rate_of_turn },
+    { XDI_FreeAcceleration, &parse_free_accel },
+    { XDI_MagneticField, &parse_magf },
+    { XDI_LatLon, &parse_pos_ll },
+    { XDI_AltitudeEllipsoid, &parse_pos_h },
+    { XDI_VelocityXYZ, &parse_vel_ned },
+    { XDI_StatusByte, &parse_status_byte }
+};
+
+
 //
 static void handle_message_cb(
-        struct XbusMessage const * message )
+        struct XbusMessageView const * message )
 {
-    const uint32_t rx_timestamp = time_get_ms();
+    rx_context_s rx;
 
-    if( message->length > (uint16_t) sizeof(xbus_buffer) )
+    rx.rx_timestamp = time_get_ms();
+    rx.rx_time_us = time_get_us();
+
+    if( message->mid != XMID_MtData2 )
     {
-        diagnostics_set_error( HOBD_HEARTBEAT_ERROR_IMU_RX_OVERFLOW );
+        handle_config_reply( message );
     }
-    else if( message->data != NULL )
+    else
     {
-        parse_sample_time_fine(
-                (const struct XbusMessage *) message,
-                &rx_timestamp );
-
-        parse_gps_sol_time(
-                (const struct XbusMessage *) message,
-                &rx_timestamp );
-
-        parse_utc_time(
-                (const struct XbusMessage *) message,
-                &rx_timestamp );
-
-        parse_orient_quat( (const struct XbusMessage *) message );
-
-        parse_rate_of_turn( (const struct XbusMessage *) message );
+        profile_begin( HOBD_PROFILE_STAGE_IMU_PARSE );
 
-        parse_free_accel( (const struct XbusMessage *) message );
+        // one pass over the data items, those before a truncated item
+        // are still used
+        const uint8_t status = XbusMessage_dispatchViewDataItems(
+                message,
+                XBUS_DISPATCH_TABLE,
+                (uint8_t) (sizeof(XBUS_DISPATCH_TABLE) / sizeof(XBUS_DISPATCH_TABLE[0])),
+                &rx );
 
-        parse_magf( (const struct XbusMessage *) message );
-
-        parse_pos_ll( (const struct XbusMessage *) message );
-
-        parse_pos_h( (const struct XbusMessage *) message );
+        if( status == 0 )
+        {
+            protocol_errors += 1;
+        }
 
-        parse_vel_ned( (const struct XbusMessage *) message );
+        profile_end( HOBD_PROFILE_STAGE_IMU_PARSE );
 
-        parse_status_byte(
-                (const struct XbusMessage *) message,
-                &rx_timestamp );
+        if( back_data->ready_groups != IMU_GROUP_NONE_READY )
+        {
+            trace_parsed( HOBD_TRACE_GROUP_IMU, &rx_pass_time_us );
+        }
     }
 }
 
@@ -815,28 +1377,31 @@ uint8_t imu_init( void )
 {
     uint8_t ret = 0;
 
-    memset( &imu_data, 0, sizeof(imu_data) );
+    memset( imu_data, 0, sizeof(imu_data) );
 
-    ring_buffer_init( &rx_buffer );
+    memcpy( output_config, DEFAULT_OUTPUT_CONFIG, sizeof(output_config) );
 
-    const struct XbusParserCallback xbus_callbacks =
-    {
-        .allocateBuffer = &xbus_alloc_cb,
-        .deallocateBuffer = &xbus_free_cb,
-        .handleMessage = &handle_message_cb
-    };
+    ring_buffer_init(
+            &rx_buffer,
+            rx_buffer_storage,
+            (uint16_t) sizeof(rx_buffer_storage) );
 
-    (void) XbusParser_init(
-            (void*) &xbus_parser,
-            &xbus_callbacks );
+    XbusScanner_init(
+            &xbus_scanner,
+            &handle_message_cb,
+            XBUS_LENGTH_MAX );
 
     hw_init();
 
     // clear all ready groups
     imu_clear_all_group_ready();
 
-    // flush rx buffer
+    // flush rx buffer, along with the partial message scanned
     ring_buffer_flush( &rx_buffer );
+    XbusScanner_reset( &xbus_scanner );
+
+    // sent from imu_update
+    start_config();
 
     return ret;
 }
@@ -848,16 +1413,18 @@ void imu_disable( void )
     // disable UART
     imu_uart_disable();
 
-    // flush rx buffer
+    // flush rx buffer, along with the partial message scanned
     ring_buffer_flush( &rx_buffer );
+    XbusScanner_reset( &xbus_scanner );
 }
 
 
 //
 void imu_enable( void )
 {
-    // flush rx buffer
+    // flush rx buffer, along with the partial message scanned
     ring_buffer_flush( &rx_buffer );
+    XbusScanner_reset( &xbus_scanner );
 
     // enable UART
     imu_uart_enable();
@@ -868,7 +1435,7 @@ void imu_enable( void )
 void imu_set_group_ready(
         const uint16_t group )
 {
-    imu_data.ready_groups |= group;
+    back_data->ready_groups |= group;
 }
 
 
@@ -876,14 +1443,15 @@ void imu_set_group_ready(
 void imu_clear_group_ready(
         const uint16_t group )
 {
-    imu_data.ready_groups &= ~group;
+    front_data->ready_groups &= ~group;
 }
 
 
 //
 void imu_clear_all_group_ready( void )
 {
-    imu_data.ready_groups = IMU_GROUP_NONE_READY;
+    back_data->ready_groups = IMU_GROUP_NONE_READY;
+    front_data->ready_groups = IMU_GROUP_NONE_READY;
 }
 
 
@@ -891,7 +1459,7 @@ void imu_clear_all_group_ready( void )
 uint8_t imu_is_group_ready(
         const uint16_t group )
 {
-    return ((imu_data.ready_groups & group) == 0) ? 0 : 1;
+    return ((front_data->ready_groups & group) == 0) ? 0 : 1;
 }
 
 
@@ -902,11 +1470,21 @@ uint8_t imu_update( void )
 
     // process any available data in the rx buffer, callbacks are called from
     // this context
+    profile_begin( HOBD_PROFILE_STAGE_IMU_PROCESS_BUFFER );
     ret = process_buffer();
+    profile_end( HOBD_PROFILE_STAGE_IMU_PROCESS_BUFFER );
+
+    // swap in newly ready groups
+    swap_data_buffers();
 
     // check for any ready groups
-    if( imu_data.ready_groups != IMU_GROUP_NONE_READY )
+    if( front_data->ready_groups != IMU_GROUP_NONE_READY )
     {
+        profile_begin( HOBD_PROFILE_STAGE_IMU_PUBLISH );
+
+        // all groups of a message are traced as one
+        trace_publish_begin( HOBD_TRACE_GROUP_IMU );
+
         // handle groups in order/priority
         if( imu_is_group_ready( IMU_GROUP_A_READY ) != 0 )
         {
@@ -967,6 +1545,10 @@ uint8_t imu_update( void )
             ret |= publish_group_j();
             imu_clear_group_ready( IMU_GROUP_J_READY );
         }
+
+        trace_publish_end( HOBD_TRACE_GROUP_IMU );
+
+        profile_end( HOBD_PROFILE_STAGE_IMU_PUBLISH );
     }
 
     // get current time
@@ -975,5 +1557,47 @@ uint8_t imu_update( void )
     // update IMU fix status/warning
     update_imu_fix_timeout( &now );
 
+    // Xsens output configuration requests
+    update_config( &now );
+
+    // report rx buffer usage with the heartbeat
+    update_rx_stats();
+
+    return ret;
+}
+
+
+//
+uint8_t imu_handle_command(
+        const hobd_command_s * const command )
+{
+    uint8_t ret = HOBD_RESPONSE_STATUS_OK;
+    uint8_t idx = 0;
+    struct OutputConfiguration *entry = NULL;
+
+    for( idx = 0; (idx < OUTPUT_CONFIG_COUNT) && (entry == NULL); idx += 1 )
+    {
+        if( (uint16_t) output_config[ idx ].dtype == command->data_0 )
+        {
+            entry = &output_config[ idx ];
+        }
+    }
+
+    if( command->id != HOBD_COMMAND_ID_IMU_OUTPUT_RATE )
+    {
+        ret = HOBD_RESPONSE_STATUS_INVALID_COMMAND;
+    }
+    else if( (entry == NULL) || (command->data_1 > HOBD_IMU_OUTPUT_RATE_ALL) )
+    {
+        ret = HOBD_RESPONSE_STATUS_INVALID_DATA;
+    }
+    else
+    {
+        entry->freq = (uint16_t) command->data_1;
+
+        // restarts a configuration in progress
+        start_config();
+    }
+
     return ret;
 }
@@ -31,6 +31,11 @@
 #include "time.h"
 #include "canbus.h"
 #include "diagnostics.h"
+#include "publish.h"
+#include "command.h"
+#include "profile.h"
+#include "trace.h"
+#include "time_sync.h"
 #include "gps.h"
 #include "imu.h"
 
@@ -95,6 +100,9 @@ static void init( void )
     //
     rtc_int_init();
 
+    // us clock, also the profiler and trace timer
+    time_init();
+
     // enable interrupts
     enable_interrupt();
 
@@ -104,6 +112,21 @@ static void init( void )
     //
     diagnostics_init();
 
+    // before the modules register their publish policies
+    publish_init();
+
+    //
+    profile_init();
+
+    // after canbus_init, traces are counted in the CAN interrupt
+    trace_init();
+
+    // after diagnostics_init, reports through the heartbeat
+    time_sync_init();
+
+    //
+    const uint8_t command_status = command_init();
+
     // init GPS UART/module
     const uint8_t gps_status = gps_init();
 
@@ -116,6 +139,9 @@ static void init( void )
 #else
     // init IMU UART/module
     const uint8_t imu_status = imu_init();
+
+    // after command_init, the IMU output rates are set over CAN
+    command_set_node_handler( &imu_handle_command );
 #endif
 
     // enable interrupts
@@ -131,6 +157,13 @@ static void init( void )
         DEBUG_PUTS( "init : canbus_init fail\n" );
     }
 
+    //
+    if( command_status != 0 )
+    {
+        diagnostics_set_error( HOBD_HEARTBEAT_ERROR_CANBUS );
+        DEBUG_PUTS( "init : command_init fail\n" );
+    }
+
     //
     if( gps_status != 0 )
     {
@@ -190,6 +223,8 @@ int main( void )
         // reset watchdog
         wdt_reset();
 
+        profile_begin( HOBD_PROFILE_STAGE_MAIN_LOOP );
+
         // process any incoming GPS data, and potentially publish ready CAN frames
         const uint8_t gps_status = gps_update();
 
@@ -208,8 +243,40 @@ int main( void )
             diagnostics_set_warn( HOBD_HEARTBEAT_WARN_IMUBUS );
         }
 
+        // handle received commands
+        profile_begin( HOBD_PROFILE_STAGE_COMMAND );
+        const uint8_t command_status = command_update();
+        profile_end( HOBD_PROFILE_STAGE_COMMAND );
+
+        // sync state after any follow-up the commands carried
+        time_sync_update();
+
+        // send the publish stats frame when due
+        profile_begin( HOBD_PROFILE_STAGE_PUBLISH_STATS );
+        const uint8_t publish_status = publish_update();
+        profile_end( HOBD_PROFILE_STAGE_PUBLISH_STATS );
+
+        // send the stage timing table when due
+        const uint8_t profile_status = profile_update();
+
+        // send the trace frames of completed publishes
+        const uint8_t trace_status = trace_update();
+
+        if(
+                (command_status != 0)
+                || (publish_status != 0)
+                || (profile_status != 0)
+                || (trace_status != 0) )
+        {
+            diagnostics_set_warn( HOBD_HEARTBEAT_WARN_CANBUS );
+        }
+
         //
+        profile_begin( HOBD_PROFILE_STAGE_DIAGNOSTICS );
         diagnostics_update();
+        profile_end( HOBD_PROFILE_STAGE_DIAGNOSTICS );
+
+        profile_end( HOBD_PROFILE_STAGE_MAIN_LOOP );
     }
 
    return 0;
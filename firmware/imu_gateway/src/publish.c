@@ -0,0 +1,607 @@
+/**
+ * @file publish.c
+ * @brief TODO.
+ *
+ * Per CAN ID publish policy, applied in front of the CAN transmit queue.
+ * ON_CHANGE frames are compared against the last frame that was actually
+ * published, so slow drift still crosses the deadband eventually.
+ *
+ * Only the compared value of the last published frame is kept: the
+ * deadband signal, or a hash of the frame without a deadband.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "time.h"
+#include "canbus.h"
+#include "publish.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// nominal standard frame size without stuffing bits
+#define FRAME_BITS(dlc) (47UL + (8UL * (uint32_t) (dlc)))
+
+
+// 32-bit FNV-1a
+#define HASH_OFFSET_BASIS (2166136261UL)
+#define HASH_PRIME (16777619UL)
+
+
+//
+typedef struct
+{
+    //
+    // CANBUS_ID_INVALID if unused
+    uint16_t id;
+    //
+    //
+    publish_policy_s policy;
+    //
+    // set once a frame has been published
+    uint8_t published;
+    //
+    // get_change_value of the last published frame
+    uint32_t last_value;
+    //
+    //
+    uint32_t last_tx_time;
+} policy_entry_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t sent_count;
+    //
+    //
+    uint16_t suppressed_count;
+    //
+    //
+    uint32_t sent_bits;
+    //
+    //
+    uint32_t saved_bits;
+} publish_counters_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static const uint16_t CAN_ID_PUBLISH_STATS =
+        (uint16_t) (HOBD_CAN_ID_PUBLISH_STATS_BASE + NODE_ID);
+
+
+//
+static policy_entry_s policies[ PUBLISH_POLICY_COUNT ];
+
+
+// current stats interval
+static publish_counters_s counters;
+
+
+//
+static uint32_t last_stats_tx_time = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static policy_entry_s *find_policy(
+        const uint16_t id );
+
+
+//
+static uint8_t is_policy_valid(
+        const publish_policy_s * const policy );
+
+
+//
+static int32_t get_deadband_signal(
+        const uint8_t type,
+        const uint8_t * const data );
+
+
+//
+static uint32_t get_change_value(
+        const publish_policy_s * const policy,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+//
+static uint8_t is_changed(
+        const policy_entry_s * const entry,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+//
+static uint8_t should_publish(
+        const policy_entry_s * const entry,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        const uint32_t * const now );
+
+
+//
+static uint16_t get_load(
+        const uint32_t bits,
+        const uint32_t interval );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static policy_entry_s *find_policy(
+        const uint16_t id )
+{
+    policy_entry_s *entry = NULL;
+    uint8_t idx = 0;
+
+    for( idx = 0; (idx < PUBLISH_POLICY_COUNT) && (entry == NULL); idx += 1 )
+    {
+        if( policies[ idx ].id == id )
+        {
+            entry = &policies[ idx ];
+        }
+    }
+
+    return entry;
+}
+
+
+//
+static uint8_t is_policy_valid(
+        const publish_policy_s * const policy )
+{
+    uint8_t ret = 1;
+    uint8_t size = 0;
+
+    if( policy->mode > HOBD_PUBLISH_MODE_ON_CHANGE )
+    {
+        ret = 0;
+    }
+
+    if( (policy->deadband_type == HOBD_PUBLISH_DEADBAND_U8) || (policy->deadband_type == HOBD_PUBLISH_DEADBAND_S8) )
+    {
+        size = 1;
+    }
+    else if( (policy->deadband_type == HOBD_PUBLISH_DEADBAND_U16) || (policy->deadband_type == HOBD_PUBLISH_DEADBAND_S16) )
+    {
+        size = 2;
+    }
+    else if( policy->deadband_type == HOBD_PUBLISH_DEADBAND_S32 )
+    {
+        size = 4;
+    }
+    else if( policy->deadband_type != HOBD_PUBLISH_DEADBAND_NONE )
+    {
+        ret = 0;
+    }
+
+    // deadband signal must fit in the frame
+    if( (policy->deadband_offset + size) > CANBUS_DATA_MAX )
+    {
+        ret = 0;
+    }
+
+    if( (policy->max_interval != 0) && (policy->max_interval < policy->min_interval) )
+    {
+        ret = 0;
+    }
+
+    return ret;
+}
+
+
+// little endian, as laid out in the hobd.h frames
+static int32_t get_deadband_signal(
+        const uint8_t type,
+        const uint8_t * const data )
+{
+    int32_t value = 0;
+
+    if( type == HOBD_PUBLISH_DEADBAND_U8 )
+    {
+        value = (int32_t) data[ 0 ];
+    }
+    else if( type == HOBD_PUBLISH_DEADBAND_S8 )
+    {
+        value = (int32_t) ((int8_t) data[ 0 ]);
+    }
+    else if( type == HOBD_PUBLISH_DEADBAND_U16 )
+    {
+        value = (int32_t) ((uint16_t) data[ 0 ] | ((uint16_t) data[ 1 ] << 8));
+    }
+    else if( type == HOBD_PUBLISH_DEADBAND_S16 )
+    {
+        value = (int32_t) ((int16_t) ((uint16_t) data[ 0 ] | ((uint16_t) data[ 1 ] << 8)));
+    }
+    else if( type == HOBD_PUBLISH_DEADBAND_S32 )
+    {
+        value = (int32_t) (
+                (uint32_t) data[ 0 ]
+                | ((uint32_t) data[ 1 ] << 8)
+                | ((uint32_t) data[ 2 ] << 16)
+                | ((uint32_t) data[ 3 ] << 24) );
+    }
+
+    return value;
+}
+
+
+// the deadband signal, or a hash of the whole frame without a deadband
+static uint32_t get_change_value(
+        const publish_policy_s * const policy,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    uint32_t value = HASH_OFFSET_BASIS;
+    uint8_t idx = 0;
+
+    if( (policy->deadband_type == HOBD_PUBLISH_DEADBAND_NONE) || (policy->deadband == 0) )
+    {
+        for( idx = 0; idx < dlc; idx += 1 )
+        {
+            value ^= (uint32_t) data[ idx ];
+            value *= HASH_PRIME;
+        }
+    }
+    else
+    {
+        value = (uint32_t) get_deadband_signal(
+                policy->deadband_type,
+                &data[ policy->deadband_offset ] );
+    }
+
+    return value;
+}
+
+
+//
+static uint8_t is_changed(
+        const policy_entry_s * const entry,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    uint8_t ret = 0;
+    const publish_policy_s * const policy = &entry->policy;
+
+    const uint32_t value = get_change_value( policy, dlc, data );
+
+    if( (policy->deadband_type == HOBD_PUBLISH_DEADBAND_NONE) || (policy->deadband == 0) )
+    {
+        ret = (value == entry->last_value) ? 0 : 1;
+    }
+    else
+    {
+        const int32_t last = (int32_t) entry->last_value;
+
+        const int32_t current = (int32_t) value;
+
+        // unsigned difference, a signed one overflows on S32 signals
+        const uint32_t change = (current >= last) ?
+                ((uint32_t) current - (uint32_t) last)
+                : ((uint32_t) last - (uint32_t) current);
+
+        ret = (change >= (uint32_t) policy->deadband) ? 1 : 0;
+    }
+
+    return ret;
+}
+
+
+//
+static uint8_t should_publish(
+        const policy_entry_s * const entry,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        const uint32_t * const now )
+{
+    uint8_t ret = 0;
+    const publish_policy_s * const policy = &entry->policy;
+
+    const uint32_t elapsed = time_get_delta(
+            &entry->last_tx_time,
+            now );
+
+    if( policy->mode == HOBD_PUBLISH_MODE_ALWAYS )
+    {
+        ret = 1;
+    }
+    else if( policy->mode == HOBD_PUBLISH_MODE_ON_CHANGE )
+    {
+        if( entry->published == 0 )
+        {
+            ret = 1;
+        }
+        else
+        {
+            ret = is_changed( entry, dlc, data );
+        }
+    }
+
+    // refresh unchanged values
+    if(
+            (policy->mode != HOBD_PUBLISH_MODE_DISABLED)
+            && (policy->max_interval != 0)
+            && (elapsed >= (uint32_t) policy->max_interval) )
+    {
+        ret = 1;
+    }
+
+    // rate limit
+    if( (entry->published != 0) && (elapsed < (uint32_t) policy->min_interval) )
+    {
+        ret = 0;
+    }
+
+    return ret;
+}
+
+
+// [0.01 percent] of the bus over interval ms
+static uint16_t get_load(
+        const uint32_t bits,
+        const uint32_t interval )
+{
+    uint32_t load = 0;
+
+    // kbit/s times ms is bits
+    const uint32_t capacity = ((uint32_t) CAN_BAUDRATE * interval) / 100UL;
+
+    if( capacity != 0 )
+    {
+        load = (bits * 100UL) / capacity;
+    }
+
+    return (uint16_t) MIN( load, 0xFFFFUL );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void publish_init( void )
+{
+    uint8_t idx = 0;
+
+    memset( policies, 0, sizeof(policies) );
+    memset( &counters, 0, sizeof(counters) );
+
+    for( idx = 0; idx < PUBLISH_POLICY_COUNT; idx += 1 )
+    {
+        policies[ idx ].id = CANBUS_ID_INVALID;
+    }
+
+    last_stats_tx_time = time_get_ms();
+}
+
+
+//
+uint8_t publish_set_policy(
+        const uint16_t id,
+        const publish_policy_s * const policy )
+{
+    uint8_t ret = 0;
+
+    policy_entry_s *entry = find_policy( id );
+
+    if( entry == NULL )
+    {
+        // claim an unused entry
+        entry = find_policy( CANBUS_ID_INVALID );
+    }
+
+    if( (entry == NULL) || (is_policy_valid( policy ) == 0) || (id == CANBUS_ID_INVALID) )
+    {
+        ret = 1;
+    }
+    else
+    {
+        entry->id = id;
+        entry->policy = (*policy);
+        entry->published = 0;
+    }
+
+    return ret;
+}
+
+
+//
+uint8_t publish_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count )
+{
+    uint8_t ret = 0;
+    uint8_t publish = 1;
+
+    policy_entry_s * const entry = find_policy( id );
+
+    const uint32_t now = time_get_ms();
+
+    if( entry != NULL )
+    {
+        publish = should_publish( entry, dlc, data, &now );
+    }
+
+    if( publish == 0 )
+    {
+        publish_suppress( dlc );
+    }
+    else
+    {
+        ret = canbus_send_ref(
+                id,
+                dlc,
+                data,
+                ref_count );
+
+        if( ret == 0 )
+        {
+            counters.sent_count += 1;
+            counters.sent_bits += FRAME_BITS( dlc );
+
+            if( entry != NULL )
+            {
+                entry->last_value = get_change_value( &entry->policy, dlc, data );
+                entry->last_tx_time = now;
+                entry->published = 1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+//
+uint8_t publish_is_due(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data )
+{
+    uint8_t ret = 1;
+
+    const policy_entry_s * const entry = find_policy( id );
+
+    const uint32_t now = time_get_ms();
+
+    if( entry != NULL )
+    {
+        ret = should_publish( entry, dlc, data, &now );
+    }
+
+    return ret;
+}
+
+
+//
+void publish_suppress(
+        const uint8_t dlc )
+{
+    counters.suppressed_count += 1;
+    counters.saved_bits += FRAME_BITS( dlc );
+}
+
+
+//
+uint8_t publish_handle_command(
+        const hobd_command_s * const command )
+{
+    uint8_t ret = HOBD_RESPONSE_STATUS_OK;
+    publish_policy_s policy;
+
+    const uint16_t id = command->data_0;
+
+    const policy_entry_s * const entry = find_policy( id );
+
+    // start from the current policy, or the implicit ALWAYS
+    if( entry != NULL )
+    {
+        policy = entry->policy;
+    }
+    else
+    {
+        memset( &policy, 0, sizeof(policy) );
+        policy.mode = HOBD_PUBLISH_MODE_ALWAYS;
+    }
+
+    if( command->id == HOBD_COMMAND_ID_PUBLISH_MODE )
+    {
+        policy.mode = HOBD_PUBLISH_MODE_DATA_MODE( command->data_1 );
+        policy.deadband = HOBD_PUBLISH_MODE_DATA_DEADBAND( command->data_1 );
+        policy.deadband_type = HOBD_PUBLISH_MODE_DATA_TYPE( command->data_1 );
+        policy.deadband_offset = HOBD_PUBLISH_MODE_DATA_OFFSET( command->data_1 );
+    }
+    else if( command->id == HOBD_COMMAND_ID_PUBLISH_INTERVAL )
+    {
+        policy.min_interval = HOBD_PUBLISH_INTERVAL_DATA_MIN( command->data_1 );
+        policy.max_interval = HOBD_PUBLISH_INTERVAL_DATA_MAX( command->data_1 );
+    }
+    else
+    {
+        ret = HOBD_RESPONSE_STATUS_INVALID_COMMAND;
+    }
+
+    if( ret == HOBD_RESPONSE_STATUS_OK )
+    {
+        if( is_policy_valid( &policy ) == 0 )
+        {
+            ret = HOBD_RESPONSE_STATUS_INVALID_DATA;
+        }
+        else if( publish_set_policy( id, &policy ) != 0 )
+        {
+            ret = HOBD_RESPONSE_STATUS_NO_RESOURCES;
+        }
+    }
+
+    return ret;
+}
+
+
+//
+uint8_t publish_update( void )
+{
+    uint8_t ret = 0;
+    hobd_publish_stats_s stats;
+
+    const uint32_t now = time_get_ms();
+
+    const uint32_t delta = time_get_delta(
+            &last_stats_tx_time,
+            &now );
+
+    if( delta >= (uint32_t) HOBD_CAN_TX_INTERVAL_PUBLISH_STATS )
+    {
+        stats.sent_count = counters.sent_count;
+        stats.suppressed_count = counters.suppressed_count;
+        stats.sent_load = get_load( counters.sent_bits, delta );
+        stats.saved_load = get_load( counters.saved_bits, delta );
+
+        ret = canbus_send(
+                CAN_ID_PUBLISH_STATS,
+                (uint8_t) sizeof(stats),
+                (const uint8_t*) &stats );
+
+        memset( &counters, 0, sizeof(counters) );
+
+        last_stats_tx_time = now;
+    }
+
+    return ret;
+}
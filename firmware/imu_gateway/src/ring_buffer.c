@@ -2,12 +2,16 @@
  * @file ring_buffer.c
  * @brief TODO.
  *
+ * Single producer, single consumer. Indices are 16 bit so each side
+ * takes one interrupt-safe snapshot of the other side's index per call.
+ *
  */
 
 
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <avr/io.h>
 #include <inttypes.h>
 
@@ -35,6 +39,16 @@
 // static declarations
 // *****************************************************
 
+//
+static uint16_t load_index(
+        volatile uint16_t * const index );
+
+
+//
+static void store_index(
+        volatile uint16_t * const index,
+        const uint16_t value );
+
 
 
 
@@ -42,6 +56,36 @@
 // static definitions
 // *****************************************************
 
+// safe from both ISR and main loop context
+static uint16_t load_index(
+        volatile uint16_t * const index )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    const uint16_t value = (*index);
+
+    SREG = sreg;
+
+    return value;
+}
+
+
+// safe from both ISR and main loop context
+static void store_index(
+        volatile uint16_t * const index,
+        const uint16_t value )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    (*index) = value;
+
+    SREG = sreg;
+}
+
 
 
 
@@ -51,21 +95,37 @@
 
 //
 void ring_buffer_init(
-        volatile ring_buffer_s * const rb )
+        volatile ring_buffer_s * const rb,
+        uint8_t * const storage,
+        const uint16_t size )
 {
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
     rb->head = 0;
     rb->tail = 0;
     rb->error = 0;
+    rb->stats.overflow_count = 0;
+    rb->stats.frame_error_count = 0;
+    rb->stats.overrun_count = 0;
+    rb->stats.high_water = 0;
+    rb->stats.capacity = (uint16_t) (size - 1);
+    rb->mask = (uint16_t) (size - 1);
+    rb->buffer = storage;
+
+    SREG = sreg;
 }
 
 
 //
-uint8_t ring_buffer_available(
+uint16_t ring_buffer_available(
         volatile ring_buffer_s * const rb )
 {
-    const uint16_t size = (RING_BUFFER_SIZE + rb->head - rb->tail) & RING_BUFFER_MASK;
+    const uint16_t head = load_index( &rb->head );
+    const uint16_t tail = load_index( &rb->tail );
 
-    return (uint8_t) size;
+    return (uint16_t) ((head - tail) & rb->mask);
 }
 
 
@@ -73,7 +133,7 @@ uint8_t ring_buffer_available(
 void ring_buffer_flush(
         volatile ring_buffer_s * const rb )
 {
-    rb->head = rb->tail;
+    store_index( &rb->tail, load_index( &rb->head ) );
 }
 
 
@@ -82,24 +142,54 @@ uint16_t ring_buffer_putc(
         const uint8_t data,
         volatile ring_buffer_s * const rb )
 {
+    const uint16_t head = rb->head;
+    const uint16_t tail = load_index( &rb->tail );
+
     // calculate new head index
-    const uint16_t new_head =  (uint16_t) (rb->head + 1) & RING_BUFFER_MASK;
+    const uint16_t new_head = (head + 1) & rb->mask;
 
-    if( new_head == (uint8_t) rb->tail )
+    if( new_head == tail )
     {
         // receive buffer overflow error
         rb->error |= (RING_BUFFER_RX_OVERFLOW >> 8);
+        rb->stats.overflow_count += 1;
     }
     else
     {
-        // store new index
-        rb->head = (uint8_t) new_head;
-
         // store received data in buffer
-        rb->buffer[ new_head ] = data;
+        rb->buffer[ head ] = data;
+
+        // publish new index
+        store_index( &rb->head, new_head );
+
+        const uint16_t used = (new_head - tail) & rb->mask;
+
+        if( used > rb->stats.high_water )
+        {
+            rb->stats.high_water = used;
+        }
+    }
+
+    return (uint16_t) (rb->error << 8);
+}
+
+
+//
+void ring_buffer_set_error(
+        const uint16_t error,
+        volatile ring_buffer_s * const rb )
+{
+    rb->error |= (uint8_t) (error >> 8);
+
+    if( (error & RING_BUFFER_FRAME_ERROR) != 0 )
+    {
+        rb->stats.frame_error_count += 1;
     }
 
-    return (uint8_t) (rb->error << 8);
+    if( (error & RING_BUFFER_OVERRUN_ERROR) != 0 )
+    {
+        rb->stats.overrun_count += 1;
+    }
 }
 
 
@@ -108,19 +198,17 @@ uint16_t ring_buffer_getc(
         volatile ring_buffer_s * const rb )
 {
     uint16_t ret = 0;
+    const uint16_t tail = rb->tail;
 
-    if( rb->head == rb->tail )
+    if( load_index( &rb->head ) == tail )
     {
         ret = RING_BUFFER_NO_DATA;
     }
     else
     {
-        // calculate new buffer index
-        const uint16_t new_tail = (uint16_t) (rb->tail + 1) & RING_BUFFER_MASK;
-
-        rb->tail = (uint8_t) new_tail;
+        const uint8_t rx_data = rb->buffer[ tail ];
 
-        const uint8_t rx_data = rb->buffer[ new_tail ];
+        store_index( &rb->tail, (tail + 1) & rb->mask );
 
         ret = (uint16_t) (rb->error << 8) + rx_data;
     }
@@ -134,20 +222,175 @@ uint16_t ring_buffer_peek(
         volatile ring_buffer_s * const rb )
 {
     uint16_t ret = 0;
+    const uint16_t tail = rb->tail;
 
-    if( rb->head == rb->tail )
+    if( load_index( &rb->head ) == tail )
     {
         ret = RING_BUFFER_NO_DATA;
     }
     else
     {
-        // calculate new buffer index
-        const uint16_t tmp_tail = (uint16_t) (rb->tail + 1) & RING_BUFFER_MASK;
-
-        const uint8_t rx_data = rb->buffer[ tmp_tail ];
+        const uint8_t rx_data = rb->buffer[ tail ];
 
         ret = (uint16_t) (rb->error << 8) + rx_data;
     }
 
     return ret;
 }
+
+
+//
+uint16_t ring_buffer_write(
+        const uint8_t * const src,
+        const uint16_t len,
+        volatile ring_buffer_s * const rb )
+{
+    uint16_t written = 0;
+    uint16_t head = rb->head;
+
+    // one snapshot of the consumer index
+    const uint16_t tail = load_index( &rb->tail );
+
+    // one slot is always left empty
+    const uint16_t space = (uint16_t) ((tail - head - 1) & rb->mask);
+
+    const uint16_t count = MIN( len, space );
+
+    while( written < count )
+    {
+        // contiguous run up to the end of the storage
+        const uint16_t run = MIN( (uint16_t) (count - written), (uint16_t) ((rb->mask + 1) - head) );
+
+        memcpy( (void*) &rb->buffer[ head ], &src[ written ], run );
+
+        written += run;
+        head = (head + run) & rb->mask;
+    }
+
+    if( count < len )
+    {
+        rb->error |= (RING_BUFFER_RX_OVERFLOW >> 8);
+        rb->stats.overflow_count += (len - count);
+    }
+
+    store_index( &rb->head, head );
+
+    const uint16_t used = (head - tail) & rb->mask;
+
+    if( used > rb->stats.high_water )
+    {
+        rb->stats.high_water = used;
+    }
+
+    return written;
+}
+
+
+//
+uint16_t ring_buffer_read(
+        volatile ring_buffer_s * const rb,
+        uint8_t * const dst,
+        const uint16_t len )
+{
+    uint16_t copied = 0;
+    uint16_t tail = rb->tail;
+
+    // one snapshot of the producer index
+    const uint16_t head = load_index( &rb->head );
+
+    const uint16_t available = (uint16_t) ((head - tail) & rb->mask);
+
+    const uint16_t count = MIN( len, available );
+
+    while( copied < count )
+    {
+        // contiguous run up to the end of the storage
+        const uint16_t run = MIN( (uint16_t) (count - copied), (uint16_t) ((rb->mask + 1) - tail) );
+
+        memcpy( &dst[ copied ], (const void*) &rb->buffer[ tail ], run );
+
+        copied += run;
+        tail = (tail + run) & rb->mask;
+    }
+
+    store_index( &rb->tail, tail );
+
+    return copied;
+}
+
+
+//
+uint16_t ring_buffer_peek_span(
+        volatile ring_buffer_s * const rb,
+        const uint8_t ** const span )
+{
+    const uint16_t tail = rb->tail;
+
+    // one snapshot of the producer index
+    const uint16_t head = load_index( &rb->head );
+
+    const uint16_t available = (uint16_t) ((head - tail) & rb->mask);
+
+    (*span) = (const uint8_t*) &rb->buffer[ tail ];
+
+    // stop at the end of the storage, the rest is at the start
+    return MIN( available, (uint16_t) ((rb->mask + 1) - tail) );
+}
+
+
+//
+uint16_t ring_buffer_peek_view(
+        volatile ring_buffer_s * const rb,
+        ring_buffer_view_s * const view )
+{
+    const uint16_t tail = rb->tail;
+    const uint16_t size = (uint16_t) (rb->mask + 1);
+
+    // one snapshot of the producer index
+    const uint16_t head = load_index( &rb->head );
+
+    const uint16_t available = (uint16_t) ((head - tail) & rb->mask);
+
+    view->span[ 0 ] = (const uint8_t*) &rb->buffer[ tail ];
+    view->len[ 0 ] = MIN( available, (uint16_t) (size - tail) );
+
+    view->span[ 1 ] = (const uint8_t*) &rb->buffer[ 0 ];
+    view->len[ 1 ] = (uint16_t) (available - view->len[ 0 ]);
+
+    return available;
+}
+
+
+//
+void ring_buffer_consume(
+        volatile ring_buffer_s * const rb,
+        const uint16_t len )
+{
+    const uint16_t tail = rb->tail;
+    const uint16_t head = load_index( &rb->head );
+
+    const uint16_t available = (uint16_t) ((head - tail) & rb->mask);
+
+    const uint16_t count = MIN( len, available );
+
+    store_index( &rb->tail, (tail + count) & rb->mask );
+}
+
+
+//
+void ring_buffer_get_stats(
+        volatile ring_buffer_s * const rb,
+        ring_buffer_stats_s * const stats )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    stats->overflow_count = rb->stats.overflow_count;
+    stats->frame_error_count = rb->stats.frame_error_count;
+    stats->overrun_count = rb->stats.overrun_count;
+    stats->high_water = rb->stats.high_water;
+    stats->capacity = rb->stats.capacity;
+
+    SREG = sreg;
+}
@@ -10,6 +10,8 @@
  * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
  */
 
+#include <string.h>
+
 #include "libsbp/edc.h"
 #include "libsbp/sbp.h"
 
@@ -395,6 +397,163 @@ s8 sbp_process(sbp_state_t *s, u32 (*read)(u8 *buff, u32 n, void *context))
   return SBP_OK;
 }
 
+/** Initialize an sbp_scanner_t.
+ *
+ * The dispatch table is looked up by message type for each valid frame, at
+ * most one entry is called per frame. The table is referenced, not copied.
+ *
+ * \param s sbp_scanner_t to initialize
+ * \param table Message type dispatch table
+ * \param table_len Number of entries in `table`
+ */
+void sbp_scanner_init(sbp_scanner_t *s, const sbp_msg_dispatch_t *table, u8 table_len)
+{
+  s->n_buff = 0;
+  s->n_frames = 0;
+  s->n_crc_errors = 0;
+  s->crc = 0;
+  s->crc_len = 0;
+  s->table_len = table_len;
+  s->table = table;
+}
+
+/** Get the free space at the end of the scanner's buffer.
+ *
+ * The caller copies up to the returned number of bytes into `buff` and then
+ * calls `sbp_scan` with the number of bytes copied. After a scan there is
+ * always room for at least one more byte.
+ *
+ * \param s sbp_scanner_t
+ * \param buff Set to where the next input bytes go
+ * \return Number of bytes that may be copied into `buff`
+ */
+u16 sbp_scanner_space(sbp_scanner_t *s, u8 **buff)
+{
+  *buff = &(s->buff[s->n_buff]);
+  return SBP_FRAME_LEN_MAX - s->n_buff;
+}
+
+/** Scan the buffered bytes for complete SBP frames.
+ *
+ * Unlike `sbp_process`, which advances one state per call, this handles
+ * every complete frame in the span at once. Frames are found by the
+ * preamble and the length field tells whether the whole frame is buffered.
+ * The CRC of a partial frame is accumulated as its bytes arrive and carried
+ * over to the next scan, so a completed frame only needs its newest bytes
+ * folded in before the check.
+ * Callbacks are passed a pointer into the scanner's buffer.
+ *
+ * On a CRC error the scan restarts one byte past the bad preamble. Any
+ * trailing partial frame is moved to the start of the buffer.
+ *
+ * \param s sbp_scanner_t
+ * \param n Number of bytes copied in after `sbp_scanner_space`
+ * \return `SBP_OK` (0) if no complete message was found,
+ *         `SBP_OK_CALLBACK_EXECUTED` (1) if at least one callback was executed,
+ *         `SBP_OK_CALLBACK_UNDEFINED` (2) if messages were decoded with no
+ *         associated callback, and `SBP_CRC_ERROR` (-2) if any frame in the
+ *         span had a CRC error.
+ */
+s8 sbp_scan(sbp_scanner_t *s, u16 n)
+{
+  s8 ret = SBP_OK;
+  u16 start = 0;
+
+  /* CRC carried over for the partial frame at the start of buff, a scan
+   * always leaves any partial frame there. */
+  u16 crc_len = s->crc_len;
+  u16 crc = s->crc;
+
+  /* Only set again if the scan ends on a partial frame, a frame starting
+   * in the next span must not pick up this one's CRC. */
+  s->n_buff += n;
+  s->crc = 0;
+  s->crc_len = 0;
+
+  while (start < s->n_buff) {
+    u8 *frame = &(s->buff[start]);
+    u16 avail = s->n_buff - start;
+
+    if (frame[0] != SBP_PREAMBLE) {
+      start++;
+      continue;
+    }
+
+    /* Until the length is known treat the frame as the largest possible. */
+    u16 frame_len = SBP_FRAME_LEN_MAX;
+    u16 crc_end = avail;
+
+    if (avail >= SBP_HEADER_LEN) {
+      frame_len = SBP_HEADER_LEN + frame[5] + SBP_CRC_LEN;
+      if (crc_end > frame_len - SBP_CRC_LEN)
+        crc_end = frame_len - SBP_CRC_LEN;
+    }
+
+    /* Accumulate the CRC over the type, sender, length and payload bytes
+     * that arrived since the last scan. */
+    if (crc_end > 1 + crc_len) {
+      crc = crc16_ccitt(&frame[1 + crc_len], crc_end - 1 - crc_len, crc);
+      crc_len = crc_end - 1;
+    }
+
+    if (avail < frame_len) {
+      s->crc = crc;
+      s->crc_len = crc_len;
+      break;
+    }
+
+    u8 msg_len = frame[5];
+
+    /* Little endian on the wire. */
+    u16 msg_type = frame[1] | ((u16)frame[2] << 8);
+    u16 sender_id = frame[3] | ((u16)frame[4] << 8);
+    u16 frame_crc = frame[SBP_HEADER_LEN + msg_len]
+                    | ((u16)frame[SBP_HEADER_LEN + msg_len + 1] << 8);
+
+    u8 crc_ok = (crc == frame_crc);
+
+    /* Next candidate frame starts a fresh CRC. */
+    crc = 0;
+    crc_len = 0;
+
+    if (!crc_ok) {
+      /* Not a frame, resync on the next preamble. */
+      s->n_crc_errors++;
+      ret = SBP_CRC_ERROR;
+      start++;
+      continue;
+    }
+
+    s->n_frames++;
+
+    u8 executed = 0;
+    for (u8 i = 0; i < s->table_len; i++) {
+      if (s->table[i].msg_type == msg_type) {
+        (*s->table[i].cb)(sender_id, msg_len, &frame[SBP_HEADER_LEN],
+                          s->table[i].context);
+        executed = 1;
+        break;
+      }
+    }
+
+    if (ret != SBP_CRC_ERROR) {
+      if (executed)
+        ret = SBP_OK_CALLBACK_EXECUTED;
+      else if (ret == SBP_OK)
+        ret = SBP_OK_CALLBACK_UNDEFINED;
+    }
+
+    start += frame_len;
+  }
+
+  /* Keep the partial frame, if any, for the next scan. */
+  s->n_buff -= start;
+  if (s->n_buff > 0 && start > 0)
+    memmove(s->buff, &(s->buff[start]), s->n_buff);
+
+  return ret;
+}
+
 /** Send SBP messages.
  * Takes an SBP message payload, type and sender ID then writes a message to
  * the output stream using the supplied `write` function with the correct
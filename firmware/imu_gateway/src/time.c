@@ -2,6 +2,12 @@
  * @file time.c
  * @brief TODO.
  *
+ * The ms clock is the RTC. The us clock is TIME_TIMER counting at CLKIO/8,
+ * extended to 32 bits by counting its overflows.
+ *
+ * The timer is read from interrupts, so every read disables them to keep
+ * the shared 16-bit TEMP register intact.
+ *
  */
 
 
@@ -10,9 +16,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <inttypes.h>
 
+#include "board.h"
+#include "timer16_drv.h"
 #include "rtc_drv.h"
+#include "hobd.h"
 #include "time.h"
 
 
@@ -22,6 +32,18 @@
 // static global types/macros
 // *****************************************************
 
+// timer clock must match HOBD_PROFILE_CYCLES_PER_TICK
+#define TIME_TIMER_CLOCK TIMER16_CLKIO_BY_8
+
+
+// two ticks per us at the 16 MHz gateway clock
+#define TICKS_PER_US_SHIFT (1)
+
+
+// a counter below this with the overflow flag set has wrapped since the
+// last serviced overflow
+#define TICKS_HALF_PERIOD (0x8000)
+
 
 
 
@@ -29,6 +51,9 @@
 // static global data
 // *****************************************************
 
+// TIME_TIMER overflows since time_init
+static volatile uint32_t timer_overflows = 0;
+
 
 
 
@@ -43,6 +68,12 @@
 // static definitions
 // *****************************************************
 
+//
+ISR( TIME_TIMER_OVF_vect )
+{
+    timer_overflows += 1;
+}
+
 
 
 
@@ -50,6 +81,27 @@
 // public definitions
 // *****************************************************
 
+//
+void time_init( void )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    timer_overflows = 0;
+
+    // free running, normal mode
+    Timer16_select( TIME_TIMER );
+    Timer16_set_waveform_mode( TIMER16_WGM_NORMAL );
+    Timer16_set_counter( 0 );
+    Timer16_clear_overflow_it();
+    Timer16_overflow_it_enable();
+    Timer16_set_clock( TIME_TIMER_CLOCK );
+
+    SREG = sreg;
+}
+
+
 //
 void time_sleep_ms(
         const uint16_t interval )
@@ -68,6 +120,48 @@ uint32_t time_get_ms( void )
 }
 
 
+//
+uint32_t time_get_us( void )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    Timer16_select( TIME_TIMER );
+
+    const uint16_t ticks = Timer16_get_counter();
+
+    uint32_t overflows = timer_overflows;
+
+    // overflow not serviced yet, interrupts are disabled
+    if( (Timer16_get_overflow_it() != 0) && (ticks < TICKS_HALF_PERIOD) )
+    {
+        overflows += 1;
+    }
+
+    SREG = sreg;
+
+    return ((overflows << (16 - TICKS_PER_US_SHIFT)) + (uint32_t) (ticks >> TICKS_PER_US_SHIFT));
+}
+
+
+//
+uint16_t time_get_ticks( void )
+{
+    const uint8_t sreg = SREG;
+
+    disable_interrupt();
+
+    Timer16_select( TIME_TIMER );
+
+    const uint16_t ticks = Timer16_get_counter();
+
+    SREG = sreg;
+
+    return ticks;
+}
+
+
 //
 uint32_t time_get_delta(
         const uint32_t * const value,
@@ -137,25 +137,25 @@ size_t XbusMessage_format(uint8_t* raw, struct XbusMessage const* message, enum
 /*!
  * \brief Get a pointer to the data corresponding to \a id.
  * \param id The data identifier to find in the message.
+ * \param itemSize Where to store the size of the data item.
  * \param data Pointer to the raw message payload.
  * \param dataLength The length of the payload in bytes.
  * \returns Pointer to data item, or NULL if the identifier is not present in
  * the message.
  */
-static uint8_t const* getPointerToData(enum XsDataIdentifier id, uint8_t const* data, uint16_t dataLength)
+static uint8_t const* getPointerToData(enum XsDataIdentifier id, uint8_t* itemSize, uint8_t const* data, uint16_t dataLength)
 {
 	uint8_t const* dptr = data;
 	while (dptr < data + dataLength)
 	{
 		uint16_t itemId;
-		uint8_t itemSize;
 		dptr = XbusUtility_readU16(&itemId, dptr);
-		dptr = XbusUtility_readU8(&itemSize, dptr);
+		dptr = XbusUtility_readU8(itemSize, dptr);
 
 		if (id == itemId)
 			return dptr;
 
-		dptr += itemSize;
+		dptr += *itemSize;
 	}
 	return NULL;
 }
@@ -174,81 +174,275 @@ static void readFloats(float* out, uint8_t const* raw, uint8_t floats)
 	}
 }
 
+/*!
+ * \brief Get the number of item data bytes read for \a id.
+ * \returns The size, or 0 if the identifier is not supported.
+ */
+static uint8_t dataItemSize(enum XsDataIdentifier id)
+{
+	switch (id)
+	{
+		case XDI_PacketCounter:
+			return sizeof(uint16_t);
+
+		case XDI_SampleTimeFine:
+		case XDI_StatusWord:
+			return sizeof(uint32_t);
+
+		case XDI_Quaternion:
+		case XDI_DeltaQ:
+			return 4 * sizeof(float);
+
+		case XDI_DeltaV:
+		case XDI_Acceleration:
+		case XDI_FreeAcceleration:
+		case XDI_RateOfTurn:
+		case XDI_MagneticField:
+		case XDI_VelocityXYZ:
+			return 3 * sizeof(float);
+
+		case XDI_LatLon:
+			return 2 * sizeof(float);
+
+		case XDI_AltitudeEllipsoid:
+			return sizeof(float);
+
+		case XDI_StatusByte:
+			return sizeof(uint8_t);
+
+		case XDI_UtcTime:
+			return 12;
+
+		case XDI_GpsSol:
+			return 12;
+
+		default:
+			return 0;
+	}
+}
+
+/*!
+ * \brief Read a data item of an XMID_MtData2 message payload.
+ * \param item Pointer to where to store the data.
+ * \param id The data identifier of the item.
+ * \param data Pointer to the raw item data, after the identifier and size.
+ * \param size The size of the raw item data in bytes.
+ * \returns true if the data item was read, false if the identifier is not
+ * supported or the item is too short for it.
+ */
+bool XbusMessage_readDataItem(void* item, enum XsDataIdentifier id, uint8_t const* data, uint8_t size)
+{
+	uint8_t const* raw = data;
+	const uint8_t itemSize = dataItemSize(id);
+
+	if ((itemSize == 0) || (size < itemSize))
+		return false;
+
+	switch (id)
+	{
+		case XDI_PacketCounter:
+			raw = XbusUtility_readU16(item, raw);
+			break;
+
+		case XDI_SampleTimeFine:
+		case XDI_StatusWord:
+			raw = XbusUtility_readU32(item, raw);
+			break;
+
+		case XDI_Quaternion:
+		case XDI_DeltaQ:
+			readFloats(item, raw, 4);
+			break;
+
+		case XDI_DeltaV:
+		case XDI_Acceleration:
+		case XDI_FreeAcceleration:
+		case XDI_RateOfTurn:
+		case XDI_MagneticField:
+		case XDI_VelocityXYZ:
+			readFloats(item, raw, 3);
+			break;
+
+		case XDI_LatLon:
+			readFloats(item, raw, 2);
+			break;
+
+		case XDI_AltitudeEllipsoid:
+			readFloats(item, raw, 1);
+			break;
+
+		case XDI_StatusByte:
+			raw = XbusUtility_readU8(item, raw);
+			break;
+
+		case XDI_UtcTime:
+			raw = XbusUtility_readU32( &((XsUtcTime*) item)->nanosec, raw );
+			raw = XbusUtility_readU16( &((XsUtcTime*) item)->year, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->month, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->day, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->hour, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->min, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->sec, raw );
+			raw = XbusUtility_readU8( &((XsUtcTime*) item)->flags, raw );
+			break;
+
+		case XDI_GpsSol:
+			raw = XbusUtility_readU32( &((XsGpsSol*) item)->tow, raw );
+			raw = XbusUtility_readU32( (uint32_t*) &((XsGpsSol*) item)->residual, raw );
+			raw = XbusUtility_readU16( &((XsGpsSol*) item)->week, raw );
+			raw = XbusUtility_readU8( &((XsGpsSol*) item)->gps_fix, raw );
+			raw = XbusUtility_readU8( &((XsGpsSol*) item)->flags, raw );
+			break;
+
+		default:
+			return false;
+	}
+	return true;
+}
+
 /*!
  * \brief Get a data item from an XMID_MtData2 Xbus message.
  * \param item Pointer to where to store the data.
  * \param id The data identifier to get.
  * \param message The message to read the data item from.
  * \returns true if the data item is found in the message, else false.
+ *
+ * \note Each call scans the payload from the start, use
+ * XbusMessage_dispatchDataItems to decode several items of a message.
  */
 bool XbusMessage_getDataItem(void* item, enum XsDataIdentifier id, struct XbusMessage const* message)
 {
-	uint8_t const* raw = getPointerToData(id, message->data, message->length);
+	uint8_t itemSize = 0;
+	uint8_t const* raw = getPointerToData(id, &itemSize, message->data, message->length);
 	if (raw)
 	{
-		switch (id)
-		{
-			case XDI_PacketCounter:
-				raw = XbusUtility_readU16(item, raw);
-				break;
+		return XbusMessage_readDataItem(item, id, raw, itemSize);
+	}
+	else
+	{
+		return false;
+	}
+}
 
-			case XDI_SampleTimeFine:
-			case XDI_StatusWord:
-				raw = XbusUtility_readU32(item, raw);
-				break;
+/*!
+ * \brief Get the byte at \a offset of a span.
+ */
+uint8_t XbusMessage_spanByte(struct XbusSpan const* span, uint16_t offset)
+{
+	if (offset < span->length[0])
+		return span->part[0][offset];
+	else
+		return span->part[1][offset - span->length[0]];
+}
 
-			case XDI_Quaternion:
-			case XDI_DeltaQ:
-				readFloats(item, raw, 4);
-				break;
+/*!
+ * \brief Get the \a length bytes at \a offset of a span as a span.
+ */
+void XbusMessage_subSpan(struct XbusSpan* out, struct XbusSpan const* span, uint16_t offset, uint16_t length)
+{
+	if (offset >= span->length[0])
+	{
+		out->part[0] = span->part[1] + (offset - span->length[0]);
+		out->length[0] = length;
+		out->part[1] = NULL;
+		out->length[1] = 0;
+	}
+	else if ((span->length[0] - offset) >= length)
+	{
+		out->part[0] = span->part[0] + offset;
+		out->length[0] = length;
+		out->part[1] = NULL;
+		out->length[1] = 0;
+	}
+	else
+	{
+		out->part[0] = span->part[0] + offset;
+		out->length[0] = span->length[0] - offset;
+		out->part[1] = span->part[1];
+		out->length[1] = length - out->length[0];
+	}
+}
 
-			case XDI_DeltaV:
-			case XDI_Acceleration:
-            case XDI_FreeAcceleration:
-			case XDI_RateOfTurn:
-			case XDI_MagneticField:
-            case XDI_VelocityXYZ:
-				readFloats(item, raw, 3);
-				break;
+/*!
+ * \brief Walk the data items of an XMID_MtData2 Xbus message once, calling
+ * the dispatch table entry of each item's identifier.
+ * \param message The message to walk.
+ * \param table Data identifier dispatch table, at most one entry is
+ * called per item.
+ * \param tableLen Number of entries in \a table.
+ * \param context Passed to the callbacks.
+ * \returns true if the whole payload was walked, false if an item runs past
+ * the end of the payload. Items before it have been dispatched.
+ */
+bool XbusMessage_dispatchDataItems(struct XbusMessage const* message, struct XbusDataItemDispatch const* table, uint8_t tableLen, void* context)
+{
+	struct XbusMessageView view;
 
-            case XDI_LatLon:
-				readFloats(item, raw, 2);
-				break;
+	view.mid = message->mid;
+	view.length = message->length;
+	view.data.part[0] = message->data;
+	view.data.length[0] = message->length;
+	view.data.part[1] = NULL;
+	view.data.length[1] = 0;
 
-            case XDI_AltitudeEllipsoid:
-				readFloats(item, raw, 1);
-				break;
+	return XbusMessage_dispatchViewDataItems(&view, table, tableLen, context);
+}
 
-            case XDI_StatusByte:
-                raw = XbusUtility_readU8(item, raw);
-                break;
-
-            case XDI_UtcTime:
-                raw = XbusUtility_readU32( &((XsUtcTime*) item)->nanosec, raw );
-                raw = XbusUtility_readU16( &((XsUtcTime*) item)->year, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->month, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->day, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->hour, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->min, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->sec, raw );
-                raw = XbusUtility_readU8( &((XsUtcTime*) item)->flags, raw );
-                break;
-
-            case XDI_GpsSol:
-                raw = XbusUtility_readU32( &((XsGpsSol*) item)->tow, raw );
-                raw = XbusUtility_readU32( (uint32_t*) &((XsGpsSol*) item)->residual, raw );
-                raw = XbusUtility_readU16( &((XsGpsSol*) item)->week, raw );
-                raw = XbusUtility_readU8( &((XsGpsSol*) item)->gps_fix, raw );
-                raw = XbusUtility_readU8( &((XsGpsSol*) item)->flags, raw );
-				break;
+/*!
+ * \brief XbusMessage_dispatchDataItems for a message left in place.
+ *
+ * Items within one part of the payload are passed in place. An item split
+ * across the parts is copied, its callback gets at most
+ * XBUS_SPLIT_ITEM_SIZE_MAX bytes of it.
+ */
+bool XbusMessage_dispatchViewDataItems(struct XbusMessageView const* message, struct XbusDataItemDispatch const* table, uint8_t tableLen, void* context)
+{
+	struct XbusSpan const* span = &message->data;
+	uint16_t offset = 0;
+	uint8_t split[XBUS_SPLIT_ITEM_SIZE_MAX];
 
-			default:
-				return false;
-		}
-		return true;
-	}
-	else
+	while (offset < message->length)
 	{
-		return false;
+		if ((message->length - offset) < 3)
+			return false;
+
+		const uint16_t itemId = ((uint16_t)XbusMessage_spanByte(span, offset) << 8)
+				| XbusMessage_spanByte(span, offset + 1);
+		const uint8_t itemSize = XbusMessage_spanByte(span, offset + 2);
+
+		offset += 3;
+
+		if ((message->length - offset) < itemSize)
+			return false;
+
+		for (uint8_t i = 0; i < tableLen; ++i)
+		{
+			if (table[i].id == itemId)
+			{
+				if ((offset + itemSize) <= span->length[0])
+				{
+					table[i].cb(span->part[0] + offset, itemSize, context);
+				}
+				else if (offset >= span->length[0])
+				{
+					table[i].cb(span->part[1] + (offset - span->length[0]), itemSize, context);
+				}
+				else
+				{
+					const uint8_t size = (itemSize < sizeof(split)) ? itemSize : sizeof(split);
+
+					for (uint8_t j = 0; j < size; ++j)
+					{
+						split[j] = XbusMessage_spanByte(span, offset + j);
+					}
+
+					table[i].cb(split, size, context);
+				}
+				break;
+			}
+		}
+
+		offset += itemSize;
 	}
+	return true;
 }
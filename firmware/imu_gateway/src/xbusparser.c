@@ -267,3 +267,156 @@ void XbusParser_parseBuffer(struct XbusParser* parser, uint8_t const* buf, size_
 	}
 }
 
+/*!
+ * \brief Initializes an XbusScanner.
+ * \param scanner The scanner to initialize.
+ * \param handleMessage Called for each message received with a valid
+ * checksum.
+ * \param maxLength Largest payload accepted, the buffer scanned must be
+ * able to hold a whole message of this length.
+ */
+void XbusScanner_init(struct XbusScanner* scanner, void (*handleMessage)(struct XbusMessageView const* message), uint16_t maxLength)
+{
+	scanner->handleMessage = handleMessage;
+	scanner->maxLength = maxLength;
+	scanner->scanned = 0;
+	scanner->checksum = 0;
+	scanner->messages = 0;
+	scanner->checksumErrors = 0;
+	scanner->lengthErrors = 0;
+}
+
+/*!
+ * \brief Drops the partial message carried over, for when the scanned
+ * buffer is flushed.
+ */
+void XbusScanner_reset(struct XbusScanner* scanner)
+{
+	scanner->scanned = 0;
+	scanner->checksum = 0;
+}
+
+/*!
+ * \brief Sum the bytes of a span from \a from up to \a to.
+ */
+static uint8_t sumSpan(struct XbusSpan const* span, uint16_t from, uint16_t to)
+{
+	uint8_t sum = 0;
+	uint16_t base = 0;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		const uint16_t end = base + span->length[i];
+
+		if ((from < to) && (from < end))
+		{
+			uint8_t const* dptr = span->part[i] + (from - base);
+			uint8_t const* const dend = span->part[i] + (((to < end) ? to : end) - base);
+
+			from += (uint16_t)(dend - dptr);
+
+			while (dptr < dend)
+			{
+				sum += *dptr++;
+			}
+		}
+
+		base = end;
+	}
+
+	return sum;
+}
+
+/*!
+ * \brief Parse the messages in a span of received data in place.
+ *
+ * Each byte is summed into the checksum once, a partial message at the end
+ * is carried over to the next scan. The handleMessage() callback is called
+ * for every complete message with a valid checksum, its payload points into
+ * the span. Checksum errors and oversized messages resync one byte past
+ * their preamble.
+ *
+ * \returns The number of bytes to consume, up to the start of a partial
+ * message. The next scan must start where this one left off.
+ */
+uint16_t XbusScanner_scan(struct XbusScanner* scanner, struct XbusSpan const* span)
+{
+	const uint16_t total = span->length[0] + span->length[1];
+	uint16_t offset = 0;
+
+	while (offset < total)
+	{
+		const uint16_t left = total - offset;
+
+		if (XbusMessage_spanByte(span, offset) != XBUS_PREAMBLE)
+		{
+			scanner->scanned = 0;
+			++offset;
+			continue;
+		}
+
+		// preamble, bus ID, message ID and length
+		if (left < 4)
+			break;
+
+		uint16_t length = XbusMessage_spanByte(span, offset + 3);
+		uint16_t headerSize = 4;
+
+		if (length == XBUS_EXTENDED_LENGTH)
+		{
+			if (left < 6)
+				break;
+
+			length = ((uint16_t)XbusMessage_spanByte(span, offset + 4) << 8)
+					| XbusMessage_spanByte(span, offset + 5);
+			headerSize = 6;
+		}
+
+		if (length > scanner->maxLength)
+		{
+			++scanner->lengthErrors;
+			scanner->scanned = 0;
+			++offset;
+			continue;
+		}
+
+		const uint16_t messageSize = headerSize + length + 1;
+		const uint16_t available = (left < messageSize) ? left : messageSize;
+
+		// the preamble is not part of the checksum
+		if (scanner->scanned == 0)
+		{
+			scanner->checksum = 0;
+			scanner->scanned = 1;
+		}
+
+		scanner->checksum += sumSpan(span, offset + scanner->scanned, offset + available);
+		scanner->scanned = available;
+
+		if (available < messageSize)
+			break;
+
+		if (scanner->checksum == 0)
+		{
+			struct XbusMessageView message;
+
+			message.mid = (enum XsMessageId)XbusMessage_spanByte(span, offset + 2);
+			message.length = length;
+			XbusMessage_subSpan(&message.data, span, offset + headerSize, length);
+
+			++scanner->messages;
+			scanner->handleMessage(&message);
+
+			offset += messageSize;
+		}
+		else
+		{
+			++scanner->checksumErrors;
+			++offset;
+		}
+
+		scanner->scanned = 0;
+	}
+
+	return offset;
+}
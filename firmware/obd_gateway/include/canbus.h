@@ -18,17 +18,166 @@
 
 
 
+// must be a power of 2, holds one less
+// with the 15 MOB's up to 30 frames are in flight, 16 B of SRAM per entry
+#define CANBUS_TX_QUEUE_SIZE (16)
+
+
+// number of CAN ID's with their own drop counter
+#define CANBUS_DROP_ID_COUNT (8)
+
+
 //
-uint8_t canbus_init( void );
+#define CANBUS_ID_INVALID (0xFFFF)
+
+
+// number of CAN ID's that can be received, each uses one MOB
+#define CANBUS_RX_FILTER_COUNT (2)
+
+
+// must be a power of 2
+#define CANBUS_RX_QUEUE_SIZE (8)
+
+
+//
+#define CANBUS_DATA_MAX (8)
+
+
+// frames queued while no transmit mark is set
+#define CANBUS_TX_MARK_NONE (0)
+
+
+
+
+// called from the CAN interrupt when a marked frame was transmitted
+typedef void (*canbus_tx_done_f)(
+        const uint8_t mark );
+
+
+//
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint16_t count;
+} canbus_drop_s;
 
 
 //
+typedef struct
+{
+    //
+    //
+    uint16_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    //
+    uint8_t data[ CANBUS_DATA_MAX ];
+    //
+    // received frames only, us clock in the receive interrupt
+    uint32_t rx_time;
+} canbus_frame_s;
+
+
+//
+typedef struct
+{
+    //
+    // frames transmitted on the bus
+    uint16_t tx_count;
+    //
+    // frames aborted due to a MOB error
+    uint16_t tx_error_count;
+    //
+    // frames dropped because the transmit queue was full
+    uint16_t queue_full_count;
+    //
+    // most frames waiting in the transmit queue at once
+    uint8_t queue_high_water;
+    //
+    // per CAN ID drop counters
+    canbus_drop_s drops[ CANBUS_DROP_ID_COUNT ];
+    //
+    // drops of CAN ID's that did not fit in the drops table
+    uint16_t drop_other_count;
+    //
+    // frames received through the rx filters
+    uint16_t rx_count;
+    //
+    // frames dropped because the receive queue was full
+    uint16_t rx_overflow_count;
+} canbus_stats_s;
+
+
+
+
+//
+uint8_t canbus_init( void );
+
+
+// non-blocking, data is copied into the transmit queue
+// returns non-zero if the frame was dropped
 uint8_t canbus_send(
         const uint16_t id,
         const uint8_t dlc,
         const uint8_t * const data );
 
 
+// non-blocking, data is referenced until it is loaded into a MOB
+// ref_count is incremented when queued and decremented once loaded,
+// data must not change while it is non-zero
+// returns non-zero if the frame was dropped
+uint8_t canbus_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count );
+
+
+// frames queued from now on carry the mark, until it is set back to
+// CANBUS_TX_MARK_NONE, and the marked frame count restarts at zero
+void canbus_set_tx_mark(
+        const uint8_t mark );
+
+
+// frames queued since the current mark was set
+uint8_t canbus_get_tx_mark_count( void );
+
+
+// NULL disables the callback
+void canbus_set_tx_done_callback(
+        const canbus_tx_done_f callback );
+
+
+// receive frames with this ID, returns non-zero if no filter is left
+uint8_t canbus_add_rx_filter(
+        const uint16_t id );
+
+
+// non-blocking, returns non-zero if no frame was received
+uint8_t canbus_recv(
+        canbus_frame_s * const frame );
+
+
+//
+uint8_t canbus_get_tx_pending( void );
+
+
+//
+void canbus_get_stats(
+        canbus_stats_s * const stats );
+
+
+//
+uint16_t canbus_get_drop_count(
+        const uint16_t id );
+
+
 
 
 #endif	/* CAN_H */
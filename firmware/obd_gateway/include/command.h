@@ -0,0 +1,47 @@
+/**
+ * @file command.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef COMMAND_H
+#define	COMMAND_H
+
+
+
+
+#include <inttypes.h>
+
+#include "hobd.h"
+
+
+
+
+// handles the commands only one node knows
+// returns a HOBD_RESPONSE_STATUS_*
+typedef uint8_t (*command_node_handler_f)(
+        const hobd_command_s * const command );
+
+
+
+
+//
+uint8_t command_init( void );
+
+
+// NULL answers unknown commands with HOBD_RESPONSE_STATUS_INVALID_COMMAND
+void command_set_node_handler(
+        const command_node_handler_f handler );
+
+
+// handles received CAN frames, answers commands addressed to this node
+// returns non-zero if a response was dropped
+uint8_t command_update( void );
+
+
+
+
+#endif	/* COMMAND_H */
@@ -15,12 +15,19 @@
 
 #include <inttypes.h>
 
+#include "hobd.h"
+#include "ring_buffer.h"
+
 
 
 //
 #define DIAGNOSTICS_CLEAR_SET_NONE (0x0000)
 
 
+// number of UART rx buffers reported with the heartbeat
+#define DIAGNOSTICS_RX_STATS_COUNT (1)
+
+
 // ms
 #define DIAGNOSTICS_WARN_SET_CLEAR_INTERVAL (5000UL)
 
@@ -77,6 +84,19 @@ void diagnostics_clear_error(
 void diagnostics_set_warn_timeout_bits( void );
 
 
+// latest statistics for a UART rx buffer, sent with the next heartbeat
+// protocol_errors are parser errors (framing, checksum, timeout)
+void diagnostics_set_rx_stats(
+        const uint8_t rx_buffer_id,
+        const ring_buffer_stats_s * const rb_stats,
+        const uint16_t protocol_errors );
+
+
+// latest time sync status, sent with the next heartbeat
+void diagnostics_set_time_sync(
+        const hobd_time_sync_s * const sync );
+
+
 //
 void diagnostics_update( void );
 
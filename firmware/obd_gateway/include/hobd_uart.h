@@ -17,7 +17,8 @@
  *     - expect {0x02, 0x04, 0x00, 0xFA}
  *
  * Checksum:
- * @todo - checksum notes.
+ *   - last byte of the packet
+ *   - the sum of all packet bytes, including the checksum, is zero (mod 256)
  *
  */
 
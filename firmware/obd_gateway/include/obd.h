@@ -30,6 +30,42 @@
 #define OBD_RX_WARN_TIMEOUT (5000UL)
 
 
+// max gap between bytes of one packet
+// ms
+#define OBD_RX_BYTE_TIMEOUT (50UL)
+
+
+// set to 1 to poll the ECU, the default only listens to another tester's
+// traffic, polling needs the duplexer built with KLINE_TX_ENABLE
+#ifndef OBD_QUERY_ENABLE
+#define OBD_QUERY_ENABLE (0)
+#endif
+
+
+// table 16 (RPM/TPS/...) is queried whenever nothing else is due
+// ms
+#define OBD_QUERY_INTERVAL_TABLE_16 (0UL)
+
+
+// table 209 (gear/engine on) at 2 Hz
+// ms
+#define OBD_QUERY_INTERVAL_TABLE_209 (500UL)
+
+
+// max time to wait for a query response
+// ms
+#define OBD_QUERY_RESPONSE_TIMEOUT (100UL)
+
+
+// consecutive response timeouts before the ECU is initialized again
+#define OBD_QUERY_REINIT_TIMEOUTS (5)
+
+
+// unchanged on-change frames are still published this often
+// ms
+#define OBD_PUBLISH_REFRESH_INTERVAL (1000)
+
+
 
 
 // OBD message data group
@@ -47,6 +83,9 @@ typedef struct
         hobd_obd_time_s time;
         //
         //
+        hobd_obd_time_us_s time_us;
+        //
+        //
         hobd_obd1_s obd1;
         //
         //
@@ -61,6 +100,9 @@ typedef struct
         hobd_obd_time_s time;
         //
         //
+        hobd_obd_time_us_s time_us;
+        //
+        //
         hobd_obd3_s obd3;
     } group_b;
 } obd_data_s;
@@ -80,21 +122,21 @@ void obd_disable( void );
 void obd_enable( void );
 
 
-//
+// marks a group ready in the back buffer
 void obd_set_group_ready(
         const uint16_t group );
 
 
-//
+// clears a published group in the front buffer
 void obd_clear_group_ready(
         const uint16_t group );
 
 
-//
+// clears both buffers
 void obd_clear_all_group_ready( void );
 
 
-//
+// checks the front buffer
 uint8_t obd_is_group_ready(
         const uint16_t group );
 
@@ -0,0 +1,45 @@
+/**
+ * @file profile.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef PROFILE_H
+#define	PROFILE_H
+
+
+
+
+#include <inttypes.h>
+
+#include "hobd.h"
+
+
+
+
+//
+void profile_init( void );
+
+
+// starts timing a HOBD_PROFILE_STAGE_*, stages may nest
+void profile_begin(
+        const uint8_t stage );
+
+
+// adds the time since profile_begin to the stage's table entry
+void profile_end(
+        const uint8_t stage );
+
+
+// sends the table when due, a few stages per call, each stage starts a
+// new interval once sent
+// returns non-zero if a frame was dropped
+uint8_t profile_update( void );
+
+
+
+
+#endif	/* PROFILE_H */
@@ -0,0 +1,107 @@
+/**
+ * @file publish.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef PUBLISH_H
+#define	PUBLISH_H
+
+
+
+
+#include <inttypes.h>
+
+#include "hobd.h"
+
+
+
+
+// number of CAN ID's with their own publish policy, sized to the default
+// policies (OBD3), a command for any other ID gets
+// HOBD_RESPONSE_STATUS_NO_RESOURCES
+#ifndef PUBLISH_POLICY_COUNT
+#define PUBLISH_POLICY_COUNT (1)
+#endif
+
+
+
+
+//
+typedef struct
+{
+    //
+    // HOBD_PUBLISH_MODE_*
+    uint8_t mode;
+    //
+    // HOBD_PUBLISH_DEADBAND_*
+    uint8_t deadband_type;
+    //
+    // byte offset of the deadband signal in the frame
+    uint8_t deadband_offset;
+    //
+    // min change of the deadband signal that is published
+    uint16_t deadband;
+    //
+    // min time between publishes
+    // ms
+    uint16_t min_interval;
+    //
+    // publish at least this often when updated, zero disables
+    // ms
+    uint16_t max_interval;
+} publish_policy_s;
+
+
+
+
+//
+void publish_init( void );
+
+
+// sets the policy of a CAN ID, ID's without one are always published
+// returns non-zero if the policy is invalid or no entry is left
+uint8_t publish_set_policy(
+        const uint16_t id,
+        const publish_policy_s * const policy );
+
+
+// same contract as canbus_send_ref, returns zero if the frame was queued
+// or held back by its policy
+uint8_t publish_send_ref(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data,
+        volatile uint8_t * const ref_count );
+
+
+// returns non-zero if publish_send_ref would queue the frame now
+uint8_t publish_is_due(
+        const uint16_t id,
+        const uint8_t dlc,
+        const uint8_t * const data );
+
+
+// counts a frame the caller held back, e.g. a group's time frame when
+// none of the group's data frames are due
+void publish_suppress(
+        const uint8_t dlc );
+
+
+// handles the HOBD_COMMAND_ID_PUBLISH_* commands
+// returns a HOBD_RESPONSE_STATUS_*
+uint8_t publish_handle_command(
+        const hobd_command_s * const command );
+
+
+// sends the stats frame on its interval
+// returns non-zero if the frame was dropped
+uint8_t publish_update( void );
+
+
+
+
+#endif	/* PUBLISH_H */
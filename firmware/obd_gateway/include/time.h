@@ -18,6 +18,10 @@
 
 
 
+// starts the microsecond clock
+void time_init( void );
+
+
 //
 void time_sleep_ms(
         const uint16_t interval );
@@ -27,7 +31,17 @@ void time_sleep_ms(
 uint32_t time_get_ms( void );
 
 
-//
+// wraps every 71.6 minutes
+// safe from both ISR and main loop context
+uint32_t time_get_us( void );
+
+
+// free running timer, see HOBD_PROFILE_TICK_NS
+// safe from both ISR and main loop context
+uint16_t time_get_ticks( void );
+
+
+// works for both ms and us times
 uint32_t time_get_delta(
         const uint32_t * const value,
         const uint32_t * const now );
@@ -0,0 +1,71 @@
+/**
+ * @file time_sync.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef TIME_SYNC_H
+#define	TIME_SYNC_H
+
+
+
+
+#include <inttypes.h>
+
+#include "hobd.h"
+
+
+
+
+// follow-ups missed before the node is in holdover
+// ms
+#define TIME_SYNC_TIMEOUT (3UL * HOBD_CAN_TX_INTERVAL_TIME_SYNC)
+
+
+// larger errors step the clock instead of steering it
+// microseconds
+#define TIME_SYNC_STEP_US (1000L)
+
+
+// errors at or below this count towards the lock
+// microseconds
+#define TIME_SYNC_LOCK_US (50L)
+
+
+// consecutive follow-ups within TIME_SYNC_LOCK_US to lock
+#define TIME_SYNC_LOCK_COUNT (4)
+
+
+// drift estimates are clamped to +/- this, beyond any crystal
+// parts per million
+#define TIME_SYNC_DRIFT_MAX_PPM (500L)
+
+
+
+
+//
+void time_sync_init( void );
+
+
+// takes the HOBD_COMMAND_ID_TIME_SYNC/HOBD_COMMAND_ID_TIME_FOLLOW_UP
+// broadcasts, rx_time is the us clock when the frame was received
+void time_sync_handle_command(
+        const hobd_command_s * const command,
+        const uint32_t * const rx_time );
+
+
+// us clock time in the master time base, unchanged until the first sync
+uint32_t time_sync_get_time(
+        const uint32_t * const local_time );
+
+
+// holdover timeout, status for the heartbeat
+void time_sync_update( void );
+
+
+
+
+#endif	/* TIME_SYNC_H */
@@ -0,0 +1,65 @@
+/**
+ * @file trace.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+
+
+
+#include <inttypes.h>
+
+#include "hobd.h"
+
+
+
+
+// tracing state at boot, HOBD_COMMAND_ID_TRACE changes it at run time
+#ifndef TRACE_DEFAULT
+#define TRACE_DEFAULT (HOBD_TRACE_DISABLED)
+#endif
+
+
+
+
+//
+void trace_init( void );
+
+
+// handles the HOBD_COMMAND_ID_TRACE command
+// returns a HOBD_RESPONSE_STATUS_*
+uint8_t trace_handle_command(
+        const hobd_command_s * const command );
+
+
+// the group's data was parsed from bytes received at rx_time_us, the
+// latest parse before a publish is the one traced
+void trace_parsed(
+        const uint8_t group,
+        const uint32_t * const rx_time_us );
+
+
+// frames queued until trace_publish_end belong to the group's trace
+void trace_publish_begin(
+        const uint8_t group );
+
+
+//
+void trace_publish_end(
+        const uint8_t group );
+
+
+// sends the trace frames of groups whose frames were all transmitted
+// returns non-zero if a frame was dropped
+uint8_t trace_update( void );
+
+
+
+
+#endif	/* TRACE_H */
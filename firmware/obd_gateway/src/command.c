@@ -0,0 +1,157 @@
+/**
+ * @file command.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "canbus.h"
+#include "publish.h"
+#include "trace.h"
+#include "time_sync.h"
+#include "command.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static command_node_handler_f node_handler = NULL;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t handle_command(
+        const hobd_command_s * const command,
+        const uint32_t * const rx_time );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// rx_time is the us clock when the frame was received
+static uint8_t handle_command(
+        const hobd_command_s * const command,
+        const uint32_t * const rx_time )
+{
+    uint8_t ret = 0;
+    hobd_response_s response;
+
+    // broadcasts are not answered, every node would respond at once
+    if( command->key == HOBD_COMMAND_KEY_BROADCAST )
+    {
+        if(
+                (command->id == HOBD_COMMAND_ID_TIME_SYNC)
+                || (command->id == HOBD_COMMAND_ID_TIME_FOLLOW_UP) )
+        {
+            time_sync_handle_command( command, rx_time );
+        }
+    }
+    // commands are addressed by node ID
+    else if( command->key == NODE_ID )
+    {
+        response.cmd_id = command->id;
+        response.key = NODE_ID;
+        response.data_0 = command->data_0;
+
+        if(
+                (command->id == HOBD_COMMAND_ID_PUBLISH_MODE)
+                || (command->id == HOBD_COMMAND_ID_PUBLISH_INTERVAL) )
+        {
+            response.data_1 = (uint32_t) publish_handle_command( command );
+        }
+        else if( command->id == HOBD_COMMAND_ID_TRACE )
+        {
+            response.data_1 = (uint32_t) trace_handle_command( command );
+        }
+        else if( node_handler != NULL )
+        {
+            response.data_1 = (uint32_t) node_handler( command );
+        }
+        else
+        {
+            response.data_1 = HOBD_RESPONSE_STATUS_INVALID_COMMAND;
+        }
+
+        ret = canbus_send(
+                HOBD_CAN_ID_RESPONSE,
+                (uint8_t) sizeof(response),
+                (const uint8_t*) &response );
+    }
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+uint8_t command_init( void )
+{
+    node_handler = NULL;
+
+    return canbus_add_rx_filter( HOBD_CAN_ID_COMMAND );
+}
+
+
+//
+void command_set_node_handler(
+        const command_node_handler_f handler )
+{
+    node_handler = handler;
+}
+
+
+//
+uint8_t command_update( void )
+{
+    uint8_t ret = 0;
+    canbus_frame_s frame;
+
+    while( canbus_recv( &frame ) == 0 )
+    {
+        if(
+                (frame.id == HOBD_CAN_ID_COMMAND)
+                && (frame.dlc == (uint8_t) sizeof(hobd_command_s)) )
+        {
+            hobd_command_s command;
+
+            memcpy( &command, frame.data, sizeof(command) );
+
+            ret |= handle_command( &command, &frame.rx_time );
+        }
+    }
+
+    return ret;
+}
@@ -16,6 +16,7 @@
 #include "hobd.h"
 #include "time.h"
 #include "canbus.h"
+#include "ring_buffer.h"
 #include "diagnostics.h"
 
 
@@ -83,6 +84,24 @@ static const uint16_t CAN_ID_HEARTBEAT =
         (uint16_t) (HOBD_CAN_ID_HEARTBEAT_BASE + NODE_ID);
 
 
+//
+static const uint16_t CAN_ID_RX_STATS =
+        (uint16_t) (HOBD_CAN_ID_RX_STATS_BASE + NODE_ID);
+
+
+// rx buffer statistics, unused entries have an invalid rx_buffer_id
+static hobd_rx_stats_s rx_stats[ DIAGNOSTICS_RX_STATS_COUNT ];
+
+
+//
+static const uint16_t CAN_ID_TIME_SYNC =
+        (uint16_t) (HOBD_CAN_ID_TIME_SYNC_BASE + NODE_ID);
+
+
+//
+static hobd_time_sync_s time_sync;
+
+
 //
 static const uint32_t led_blink_intervals[] =
 {
@@ -127,6 +146,8 @@ static void send_heartbeat(
         const uint32_t * const now,
         const uint8_t send_now )
 {
+    uint8_t idx = 0;
+
     // get time since last publish
     const uint32_t delta = time_get_delta(
             &last_tx_heartbeat,
@@ -142,10 +163,28 @@ static void send_heartbeat(
         hobd_heartbeat.counter += 1;
 
         // publish
-        const uint8_t ret = canbus_send(
+        uint8_t ret = canbus_send(
                 CAN_ID_HEARTBEAT,
                 (uint8_t) sizeof(hobd_heartbeat),
                 (const uint8_t*) &hobd_heartbeat );
+
+        // publish rx buffer statistics along with the heartbeat
+        for( idx = 0; idx < DIAGNOSTICS_RX_STATS_COUNT; idx += 1 )
+        {
+            if( rx_stats[ idx ].rx_buffer_id != HOBD_RX_BUFFER_ID_INVALID )
+            {
+                ret |= canbus_send(
+                        CAN_ID_RX_STATS,
+                        (uint8_t) sizeof(rx_stats[ idx ]),
+                        (const uint8_t*) &rx_stats[ idx ] );
+            }
+        }
+
+        ret |= canbus_send(
+                CAN_ID_TIME_SYNC,
+                (uint8_t) sizeof(time_sync),
+                (const uint8_t*) &time_sync );
+
         if( ret != 0 )
         {
             diagnostics_set_warn( HOBD_HEARTBEAT_WARN_CANBUS );
@@ -256,6 +295,9 @@ void diagnostics_init( void )
 
     memset( &warning_states, 0, sizeof(warning_states) );
 
+    memset( &rx_stats, 0, sizeof(rx_stats) );
+    memset( &time_sync, 0, sizeof(time_sync) );
+
     led_off();
 }
 
@@ -354,6 +396,48 @@ void diagnostics_set_warn_timeout_bits( void )
 }
 
 
+//
+void diagnostics_set_rx_stats(
+        const uint8_t rx_buffer_id,
+        const ring_buffer_stats_s * const rb_stats,
+        const uint16_t protocol_errors )
+{
+    uint8_t idx = 0;
+    uint8_t stored = 0;
+
+    for( idx = 0; (idx < DIAGNOSTICS_RX_STATS_COUNT) && (stored == 0); idx += 1 )
+    {
+        // same buffer or first unused entry
+        if(
+                (rx_stats[ idx ].rx_buffer_id == rx_buffer_id)
+                || (rx_stats[ idx ].rx_buffer_id == HOBD_RX_BUFFER_ID_INVALID) )
+        {
+            hobd_rx_stats_s * const stats = &rx_stats[ idx ];
+
+            stats->rx_buffer_id = rx_buffer_id;
+            stats->high_water = rb_stats->high_water;
+
+            stats->high_water_percent = (uint8_t) ((100UL * rb_stats->high_water) / rb_stats->capacity);
+            stats->overflow_count = rb_stats->overflow_count;
+            stats->error_count =
+                    rb_stats->frame_error_count
+                    + rb_stats->overrun_count
+                    + protocol_errors;
+
+            stored = 1;
+        }
+    }
+}
+
+
+//
+void diagnostics_set_time_sync(
+        const hobd_time_sync_s * const sync )
+{
+    time_sync = (*sync);
+}
+
+
 //
 void diagnostics_update( void )
 {
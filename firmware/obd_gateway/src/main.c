@@ -31,6 +31,11 @@
 #include "time.h"
 #include "canbus.h"
 #include "diagnostics.h"
+#include "publish.h"
+#include "command.h"
+#include "profile.h"
+#include "trace.h"
+#include "time_sync.h"
 #include "obd.h"
 
 
@@ -94,6 +99,9 @@ static void init( void )
     //
     rtc_int_init();
 
+    // us clock, also the profiler and trace timer
+    time_init();
+
     // enable interrupts
     enable_interrupt();
 
@@ -103,6 +111,21 @@ static void init( void )
     //
     diagnostics_init();
 
+    // before the modules register their publish policies
+    publish_init();
+
+    //
+    profile_init();
+
+    // after canbus_init, traces are counted in the CAN interrupt
+    trace_init();
+
+    // after diagnostics_init, reports through the heartbeat
+    time_sync_init();
+
+    //
+    const uint8_t command_status = command_init();
+
     // init OBD UART/module
     const uint8_t obd_status = obd_init();
 
@@ -125,6 +148,13 @@ static void init( void )
         DEBUG_PUTS( "init : canbus_init fail\n" );
     }
 
+    //
+    if( command_status != 0 )
+    {
+        diagnostics_set_error( HOBD_HEARTBEAT_ERROR_CANBUS );
+        DEBUG_PUTS( "init : command_init fail\n" );
+    }
+
     //
     if( obd_status != 0 )
     {
@@ -171,6 +201,8 @@ int main( void )
         // reset watchdog
         wdt_reset();
 
+        profile_begin( HOBD_PROFILE_STAGE_MAIN_LOOP );
+
         // process any incoming OBD data, and potentially publish ready CAN frames
         const uint8_t obd_status = obd_update();
 
@@ -180,8 +212,40 @@ int main( void )
             diagnostics_set_warn( HOBD_HEARTBEAT_WARN_OBDBUS );
         }
 
+        // handle received commands
+        profile_begin( HOBD_PROFILE_STAGE_COMMAND );
+        const uint8_t command_status = command_update();
+        profile_end( HOBD_PROFILE_STAGE_COMMAND );
+
+        // sync state after any follow-up the commands carried
+        time_sync_update();
+
+        // send the publish stats frame when due
+        profile_begin( HOBD_PROFILE_STAGE_PUBLISH_STATS );
+        const uint8_t publish_status = publish_update();
+        profile_end( HOBD_PROFILE_STAGE_PUBLISH_STATS );
+
+        // send the stage timing table when due
+        const uint8_t profile_status = profile_update();
+
+        // send the trace frames of completed publishes
+        const uint8_t trace_status = trace_update();
+
+        if(
+                (command_status != 0)
+                || (publish_status != 0)
+                || (profile_status != 0)
+                || (trace_status != 0) )
+        {
+            diagnostics_set_warn( HOBD_HEARTBEAT_WARN_CANBUS );
+        }
+
         //
+        profile_begin( HOBD_PROFILE_STAGE_DIAGNOSTICS );
         diagnostics_update();
+        profile_end( HOBD_PROFILE_STAGE_DIAGNOSTICS );
+
+        profile_end( HOBD_PROFILE_STAGE_MAIN_LOOP );
     }
 
    return 0;
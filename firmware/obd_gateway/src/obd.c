@@ -11,6 +11,7 @@
 #include <string.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include <math.h>
 
@@ -21,6 +22,10 @@
 #include "ring_buffer.h"
 #include "time.h"
 #include "canbus.h"
+#include "publish.h"
+#include "profile.h"
+#include "trace.h"
+#include "time_sync.h"
 #include "diagnostics.h"
 #include "hobd_uart.h"
 #include "obd.h"
@@ -32,8 +37,64 @@
 // static global types/macros
 // *****************************************************
 
+// holds one packet
+#define OBD_BUFFER_SIZE (HOBD_PACKET_SIZE_MAX)
+
+
+// waiting for a packet type byte
+#define PARSER_STATE_TYPE (0)
+
+
+// waiting for the packet size byte
+#define PARSER_STATE_SIZE (1)
+
+
+// reading the rest of the packet, up to and including the checksum
+#define PARSER_STATE_DATA (2)
+
+
+// wake-up and init command packets back to back
+#define TX_BUFFER_SIZE (16)
+
+
+// ECU needs the wake-up and init command packets
+#define QUERY_STATE_INIT (0)
+
+
+// waiting for the init command response
+#define QUERY_STATE_WAIT_INIT (1)
+
+
+// nothing outstanding, next query goes out when one is due
+#define QUERY_STATE_IDLE (2)
+
+
+// waiting for a table response
+#define QUERY_STATE_WAIT_RESPONSE (3)
+
+
+// bytes added by an extra query/response pair, register ranges closer than
+// this are cheaper to fetch in one query
+#define QUERY_MERGE_GAP (sizeof(hobd_table_query_s) + 1 + sizeof(hobd_table_response_s) + 1)
+
+
 //
-#define OBD_BUFFER_SIZE (512)
+#define FIELD_SIZE(type, field) (sizeof(((type*) 0)->field))
+
+
+// field map entry for a member of a hobd_table_*_s
+#define REGISTER_FIELD(table, type, field) \
+    { table, (uint8_t) offsetof(type, field), (uint8_t) FIELD_SIZE(type, field) }
+
+
+// copies a hobd_table_16_s member out of a response
+#define COPY_TABLE_16(response, field, dst) \
+    copy_register( response, offsetof(hobd_table_16_s, field), FIELD_SIZE(hobd_table_16_s, field), dst )
+
+
+// copies a hobd_table_209_s member out of a response
+#define COPY_TABLE_209(response, field, dst) \
+    copy_register( response, offsetof(hobd_table_209_s, field), FIELD_SIZE(hobd_table_209_s, field), dst )
 
 
 // UART bridge is on UART1
@@ -42,6 +103,7 @@
 #define UART_UCSRB UCSR1B
 #define UART_UCSRC UCSR1C
 #define UART_DATA UDR1
+#define UART_UDRE_INTERRUPT USART1_UDRE_vect
 
 
 //
@@ -49,7 +111,126 @@
 
 
 //
-#define obd_uart_disable() (UART_UCSRB &= ~(_BV(RXEN1) | _BV(TXEN1) | _BV(RXCIE1)))
+#define obd_uart_disable() (UART_UCSRB &= ~(_BV(RXEN1) | _BV(TXEN1) | _BV(RXCIE1) | _BV(UDRIE1)))
+
+
+//
+#define obd_uart_tx_busy() ((UART_UCSRB & _BV(UDRIE1)) != 0)
+
+
+//
+#define obd_uart_tx_start() (UART_UCSRB |= _BV(UDRIE1))
+
+
+//
+#define obd_uart_tx_stop() (UART_UCSRB &= ~_BV(UDRIE1))
+
+
+//
+typedef struct
+{
+    //
+    // PARSER_STATE_*
+    uint8_t state;
+    //
+    // packet bytes stored in obd_buffer
+    uint8_t idx;
+    //
+    // running sum of the packet bytes, zero for a valid packet
+    uint8_t checksum;
+    //
+    // set while discarding bytes that do not start a packet
+    uint8_t resync;
+    //
+    // time the packet type byte was read
+    uint32_t rx_timestamp;
+    //
+    // rx_timestamp on the us clock
+    uint32_t rx_time_us;
+    //
+    // time the last packet byte was read
+    uint32_t last_byte_time;
+    //
+    // bad packet type or size
+    uint16_t framing_error_count;
+    //
+    // packets dropped due to a checksum mismatch
+    uint16_t checksum_error_count;
+    //
+    // partial packets dropped after OBD_RX_BYTE_TIMEOUT
+    uint16_t timeout_count;
+} packet_parser_s;
+
+
+// table register decoded into a CAN frame
+typedef struct
+{
+    //
+    // HOBD_TABLE_*
+    uint8_t table;
+    //
+    // register offset within the table
+    uint8_t offset;
+    //
+    // number of registers
+    uint8_t size;
+} register_field_s;
+
+
+// query schedule entry
+typedef struct
+{
+    //
+    // HOBD_TABLE_*
+    uint8_t table;
+    //
+    // min time between queries, zero queries as often as the line allows
+    // ms
+    uint32_t interval;
+} query_entry_s;
+
+
+// register range query built from the field map
+typedef struct
+{
+    //
+    // HOBD_TABLE_*
+    uint8_t table;
+    //
+    //
+    uint8_t register_offset;
+    //
+    //
+    uint8_t register_cnt;
+    //
+    // from the query schedule entry
+    // ms
+    uint32_t interval;
+    //
+    //
+    uint32_t last_tx_time;
+} query_range_s;
+
+
+//
+typedef struct
+{
+    //
+    // QUERY_STATE_*
+    uint8_t state;
+    //
+    // query_ranges index of the outstanding query
+    uint8_t entry;
+    //
+    // response timeouts since the last response
+    uint8_t timeout_count;
+    //
+    // time the outstanding packet was sent
+    uint32_t tx_time;
+    //
+    // total response timeouts
+    uint16_t response_timeout_count;
+} query_scheduler_s;
 
 
 
@@ -60,10 +241,23 @@
 
 // UART rx ring buffer
 static volatile ring_buffer_s rx_buffer;
+static uint8_t rx_buffer_storage[ RING_BUFFER_SIZE ];
+
+
+// OBD message/data state, double buffered
+static obd_data_s obd_data[ 2 ];
+
 
+// parsers write into the back buffer
+static obd_data_s *back_data = &obd_data[ 0 ];
 
-// GPS message/data state
-static obd_data_s obd_data;
+
+// published groups are read from the front buffer
+static obd_data_s *front_data = &obd_data[ 1 ];
+
+
+// queued CAN frames still referencing the front buffer
+static volatile uint8_t front_ref_count = 0;
 
 
 // last rx time
@@ -74,6 +268,84 @@ static uint32_t last_rx_time = 0;
 static uint8_t obd_buffer[ OBD_BUFFER_SIZE ];
 
 
+// OBD packet parser state
+static packet_parser_s parser;
+
+
+// registers used by the CAN frames, sorted by table then offset,
+// the reserved registers are not queried unless a merge spans them
+static const register_field_s REGISTER_FIELDS[] =
+{
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, engine_rpm ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, tps_volt ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, tps_percent ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, ect_volt ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, ect_temp ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, iat_volt ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, iat_temp ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, map_volt ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, map_pressure ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, battery_volt ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, wheel_speed ),
+    REGISTER_FIELD( HOBD_TABLE_16, hobd_table_16_s, fuel_injectors ),
+    REGISTER_FIELD( HOBD_TABLE_209, hobd_table_209_s, gear ),
+    REGISTER_FIELD( HOBD_TABLE_209, hobd_table_209_s, engine_on )
+};
+
+
+//
+#define REGISTER_FIELD_COUNT (sizeof(REGISTER_FIELDS) / sizeof(REGISTER_FIELDS[0]))
+
+
+// table queries in priority order, a query is sent when its interval has
+// elapsed and no query above it is due
+static const query_entry_s QUERY_SCHEDULE[] =
+{
+    {
+        HOBD_TABLE_209,
+        OBD_QUERY_INTERVAL_TABLE_209
+    },
+    {
+        HOBD_TABLE_16,
+        OBD_QUERY_INTERVAL_TABLE_16
+    }
+};
+
+
+//
+#define QUERY_SCHEDULE_COUNT (sizeof(QUERY_SCHEDULE) / sizeof(QUERY_SCHEDULE[0]))
+
+
+// merged register ranges in QUERY_SCHEDULE order, at most one per field
+static query_range_s query_ranges[ REGISTER_FIELD_COUNT ];
+
+
+//
+static uint8_t query_range_count = 0;
+
+
+// query scheduler state
+static query_scheduler_s scheduler;
+
+
+// UART tx packet, sent from the data register empty interrupt
+static volatile uint8_t tx_buffer[ TX_BUFFER_SIZE ];
+static volatile uint8_t tx_len = 0;
+static volatile uint8_t tx_idx = 0;
+
+
+// gear/engine on rarely change
+static const publish_policy_s OBD3_PUBLISH_POLICY =
+{
+    HOBD_PUBLISH_MODE_ON_CHANGE,
+    HOBD_PUBLISH_DEADBAND_NONE,
+    0,
+    0,
+    0,
+    OBD_PUBLISH_REFRESH_INTERVAL
+};
+
+
 // OBD rx packet counters
 static uint16_t rx_count_table_16 = 0;
 static uint16_t rx_count_table_209 = 0;
@@ -94,6 +366,10 @@ static void update_rx_timeout(
         const uint32_t * const now );
 
 
+//
+static void swap_data_buffers( void );
+
+
 //
 static uint8_t publish_group_a( void );
 
@@ -102,26 +378,84 @@ static uint8_t publish_group_a( void );
 static uint8_t publish_group_b( void );
 
 
+//
+static void parser_reset( void );
+
+
+//
+static uint8_t is_packet_type(
+        const uint8_t type );
+
+
+//
+static void parser_feed(
+        const uint8_t data,
+        const uint32_t * const now );
+
+
+//
+static void handle_packet( void );
+
+
 //
 static uint8_t obd_checksum(
         const uint8_t * const buffer,
-        const uint16_t len );
+        const uint8_t len );
 
 
 //
-static uint8_t obd_packet_type(
-        const uint8_t * const buffer,
-        const uint16_t len );
+static uint8_t tx_packet(
+        const uint8_t * const data,
+        const uint8_t len );
+
+
+//
+static void build_query_ranges( void );
+
+
+//
+static uint8_t query_send_init(
+        const uint32_t * const now );
+
+
+//
+static uint8_t query_send_next(
+        const uint32_t * const now );
+
+
+//
+static void query_handle_response(
+        const hobd_packet_header_s * const header,
+        const uint32_t * const now );
+
+
+//
+static uint8_t query_update(
+        const uint32_t * const now );
+
+
+//
+static uint8_t process_buffer(
+        const uint32_t * const now );
 
 
 //
-static uint8_t process_buffer( void );
+static void update_rx_stats( void );
+
+
+//
+static uint8_t copy_register(
+        const hobd_table_response_s * const response,
+        const uint8_t offset,
+        const uint8_t size,
+        void * const dst );
 
 
 //
 static void parse_response(
         const hobd_table_response_s * const response,
-        const uint32_t * const rx_timestamp );
+        const uint32_t * const rx_timestamp,
+        const uint32_t * const rx_time_us );
 
 
 
@@ -137,8 +471,16 @@ ISR( UART_RX_INTERRUPT )
     const uint8_t status  = UART_UCSRA;
     const uint8_t data = UART_DATA;
 
-    // read error status
-    rx_buffer.error = (status & (_BV(FE1) | _BV(DOR1)) );
+    // record UART errors, counted separately from the data
+    if( (status & _BV(FE1)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_FRAME_ERROR, &rx_buffer );
+    }
+
+    if( (status & _BV(DOR1)) != 0 )
+    {
+        ring_buffer_set_error( RING_BUFFER_OVERRUN_ERROR, &rx_buffer );
+    }
 
     // push data into the rx buffer, error is updated with return status
     (void) ring_buffer_putc(
@@ -147,6 +489,22 @@ ISR( UART_RX_INTERRUPT )
 }
 
 
+//
+ISR( UART_UDRE_INTERRUPT )
+{
+    if( tx_idx < tx_len )
+    {
+        UART_DATA = tx_buffer[ tx_idx ];
+        tx_idx += 1;
+    }
+
+    if( tx_idx >= tx_len )
+    {
+        obd_uart_tx_stop();
+    }
+}
+
+
 //
 static void hw_init( void )
 {
@@ -185,202 +543,592 @@ static void update_rx_timeout(
 }
 
 
-//
+// swap in the back buffer once it has ready groups and the front buffer
+// is no longer referenced by the CAN transmit queue
+// the new back buffer starts as a copy of the front one, a partial
+// response only overwrites the fields it covers
+static void swap_data_buffers( void )
+{
+    if( (back_data->ready_groups != OBD_GROUP_NONE_READY) && (front_ref_count == 0) )
+    {
+        obd_data_s * const ready_data = back_data;
+
+        back_data = front_data;
+        front_data = ready_data;
+
+        memcpy( back_data, front_data, sizeof(*back_data) );
+
+        back_data->ready_groups = OBD_GROUP_NONE_READY;
+    }
+}
+
+
+// the time frames only go out with at least one of the group's data
+// frames, otherwise the whole group is held back
 static uint8_t publish_group_a( void )
 {
     uint8_t ret = 0;
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_OBD_TIME,
-            (uint8_t) sizeof(obd_data.group_a.time),
-            (const uint8_t *) &obd_data.group_a.time );
+    const uint8_t due =
+            publish_is_due(
+                HOBD_CAN_ID_OBD1,
+                (uint8_t) sizeof(front_data->group_a.obd1),
+                (const uint8_t *) &front_data->group_a.obd1 )
+            | publish_is_due(
+                HOBD_CAN_ID_OBD2,
+                (uint8_t) sizeof(front_data->group_a.obd2),
+                (const uint8_t *) &front_data->group_a.obd2 );
+
+    if( due == 0 )
+    {
+        publish_suppress( (uint8_t) sizeof(front_data->group_a.time) );
+        publish_suppress( (uint8_t) sizeof(front_data->group_a.time_us) );
+        publish_suppress( (uint8_t) sizeof(front_data->group_a.obd1) );
+        publish_suppress( (uint8_t) sizeof(front_data->group_a.obd2) );
+    }
+    else
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD_TIME,
+                (uint8_t) sizeof(front_data->group_a.time),
+                (const uint8_t *) &front_data->group_a.time,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD_TIME_US,
+                (uint8_t) sizeof(front_data->group_a.time_us),
+                (const uint8_t *) &front_data->group_a.time_us,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD1,
+                (uint8_t) sizeof(front_data->group_a.obd1),
+                (const uint8_t *) &front_data->group_a.obd1,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD2,
+                (uint8_t) sizeof(front_data->group_a.obd2),
+                (const uint8_t *) &front_data->group_a.obd2,
+                &front_ref_count );
+    }
+
+    return ret;
+}
+
+
+// OBD3 is published on change, the time frames are held back with it
+static uint8_t publish_group_b( void )
+{
+    uint8_t ret = 0;
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_OBD1,
-            (uint8_t) sizeof(obd_data.group_a.obd1),
-            (const uint8_t *) &obd_data.group_a.obd1 );
+    const uint8_t due = publish_is_due(
+            HOBD_CAN_ID_OBD3,
+            (uint8_t) sizeof(front_data->group_b.obd3),
+            (const uint8_t *) &front_data->group_b.obd3 );
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_OBD2,
-            (uint8_t) sizeof(obd_data.group_a.obd2),
-            (const uint8_t *) &obd_data.group_a.obd2 );
+    if( due == 0 )
+    {
+        publish_suppress( (uint8_t) sizeof(front_data->group_b.time) );
+        publish_suppress( (uint8_t) sizeof(front_data->group_b.time_us) );
+        publish_suppress( (uint8_t) sizeof(front_data->group_b.obd3) );
+    }
+    else
+    {
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD_TIME,
+                (uint8_t) sizeof(front_data->group_b.time),
+                (const uint8_t *) &front_data->group_b.time,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD_TIME_US,
+                (uint8_t) sizeof(front_data->group_b.time_us),
+                (const uint8_t *) &front_data->group_b.time_us,
+                &front_ref_count );
+
+        ret |= publish_send_ref(
+                HOBD_CAN_ID_OBD3,
+                (uint8_t) sizeof(front_data->group_b.obd3),
+                (const uint8_t *) &front_data->group_b.obd3,
+                &front_ref_count );
+    }
 
     return ret;
 }
 
 
 //
-static uint8_t publish_group_b( void )
+static void parser_reset( void )
 {
-    uint8_t ret = 0;
+    parser.state = PARSER_STATE_TYPE;
+    parser.idx = 0;
+    parser.checksum = 0;
+}
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_OBD_TIME,
-            (uint8_t) sizeof(obd_data.group_b.time),
-            (const uint8_t *) &obd_data.group_b.time );
 
-    ret |= canbus_send(
-            HOBD_CAN_ID_OBD3,
-            (uint8_t) sizeof(obd_data.group_b.obd3),
-            (const uint8_t *) &obd_data.group_b.obd3 );
+// packet types seen on the K-line, queries are framed too so their
+// contents are never mistaken for the start of a response
+static uint8_t is_packet_type(
+        const uint8_t type )
+{
+    uint8_t ret = 0;
+
+    if(
+            (type == HOBD_PACKET_TYPE_RESPONSE)
+            || (type == HOBD_PACKET_TYPE_QUERY)
+            || (type == HOBD_PACKET_TYPE_WAKE_UP) )
+    {
+        ret = 1;
+    }
 
     return ret;
 }
 
 
+// consumes one byte, never waits for the next one
+static void parser_feed(
+        const uint8_t data,
+        const uint32_t * const now )
+{
+    // min size = 3 byte header plus 1 byte checksum
+    const uint8_t min_size = (uint8_t) (sizeof(hobd_packet_header_s) + 1);
+
+    // set if data can be a packet type byte
+    uint8_t type_candidate = 0;
+
+    if( parser.state == PARSER_STATE_TYPE )
+    {
+        type_candidate = 1;
+    }
+    else if( parser.state == PARSER_STATE_SIZE )
+    {
+        if( data >= min_size )
+        {
+            obd_buffer[ parser.idx ] = data;
+            parser.idx += 1;
+            parser.checksum += data;
+            parser.last_byte_time = (*now);
+            parser.state = PARSER_STATE_DATA;
+        }
+        else
+        {
+            // bad header, the size byte may start the next packet,
+            // otherwise it is counted with this error
+            parser.framing_error_count += 1;
+            parser.resync = 1;
+            parser_reset();
+
+            type_candidate = 1;
+        }
+    }
+    else if( parser.state == PARSER_STATE_DATA )
+    {
+        const hobd_packet_header_s * const header =
+                (const hobd_packet_header_s*) &obd_buffer[ 0 ];
+
+        obd_buffer[ parser.idx ] = data;
+        parser.idx += 1;
+        parser.checksum += data;
+        parser.last_byte_time = (*now);
+
+        if( parser.idx >= header->size )
+        {
+            // the checksum byte makes the sum of all bytes zero
+            if( parser.checksum == 0 )
+            {
+                handle_packet();
+            }
+            else
+            {
+                parser.checksum_error_count += 1;
+                DEBUG_PUTS( "obd_checksum_error\n" );
+            }
+
+            parser_reset();
+        }
+    }
+
+    if( type_candidate != 0 )
+    {
+        if( is_packet_type( data ) != 0 )
+        {
+            obd_buffer[ 0 ] = data;
+            parser.idx = 1;
+            parser.checksum = data;
+            parser.rx_timestamp = (*now);
+            parser.rx_time_us = time_get_us();
+            parser.last_byte_time = (*now);
+            parser.resync = 0;
+            parser.state = PARSER_STATE_SIZE;
+        }
+        else if( parser.resync == 0 )
+        {
+            // count each run of stray bytes once
+            parser.framing_error_count += 1;
+            parser.resync = 1;
+        }
+    }
+}
+
+
 //
+static void handle_packet( void )
+{
+    const hobd_packet_header_s * const header =
+            (const hobd_packet_header_s*) &obd_buffer[ 0 ];
+
+    // pipeline the next query before decoding this response
+    if( header->type == HOBD_PACKET_TYPE_RESPONSE )
+    {
+        query_handle_response(
+                header,
+                &parser.last_byte_time );
+    }
+
+    // process response types
+    if(
+            (header->type == HOBD_PACKET_TYPE_RESPONSE)
+            && (header->subtype == HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP)
+            && (header->size > (uint8_t) sizeof(hobd_table_response_s)) )
+    {
+        const hobd_table_response_s * const response =
+                (hobd_table_response_s*) &obd_buffer[ 0 ];
+
+        diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_NO_OBD_ECU );
+
+        profile_begin( HOBD_PROFILE_STAGE_OBD_PARSE );
+
+        parse_response(
+                response,
+                &parser.rx_timestamp,
+                &parser.rx_time_us );
+
+        profile_end( HOBD_PROFILE_STAGE_OBD_PARSE );
+    }
+}
+
+
+// checksum byte that makes the packet sum to zero
 static uint8_t obd_checksum(
         const uint8_t * const buffer,
-        const uint16_t len )
+        const uint8_t len )
 {
-    uint16_t cs = 0;
-    uint16_t idx = 0;
+    uint8_t cs = 0;
+    uint8_t idx = 0;
 
     for( idx = 0; idx < len; idx += 1 )
     {
-        cs += (uint16_t) buffer[ idx ];
+        cs += buffer[ idx ];
     }
 
-    if( cs > 0x0100 )
+    return (uint8_t) (0x00 - cs);
+}
+
+
+// non-blocking, the packet is copied and sent by the UART interrupt
+static uint8_t tx_packet(
+        const uint8_t * const data,
+        const uint8_t len )
+{
+    uint8_t ret = 0;
+    uint8_t idx = 0;
+
+    if( (obd_uart_tx_busy()) || (len > TX_BUFFER_SIZE) )
     {
-        cs = (0x0100 - (cs & 0x00FF));
+        ret = 1;
     }
     else
     {
-        cs = (0x0100 - cs);
+        for( idx = 0; idx < len; idx += 1 )
+        {
+            tx_buffer[ idx ] = data[ idx ];
+        }
+
+        tx_idx = 0;
+        tx_len = len;
+
+        obd_uart_tx_start();
     }
 
-    return (uint8_t) (cs & 0xFF);
+    return ret;
 }
 
 
-//
-static uint8_t obd_packet_type(
-        const uint8_t * const buffer,
-        const uint16_t len )
+// merges the field map into the fewest register range queries, a gap is
+// queried when that costs less than a separate query/response pair
+static void build_query_ranges( void )
 {
-    uint8_t packet_type = HOBD_PACKET_TYPE_INVALID;
-
-    const hobd_packet_header_s * const header =
-            (hobd_packet_header_s*) buffer;
+    uint8_t entry = 0;
+    uint8_t idx = 0;
 
-    // min size = 3 byte header plus 1 byte checksum
-    const uint16_t min_len = (uint16_t) (sizeof(*header) + 1);
+    query_range_count = 0;
 
-    // check packet length
-    if( (len >= min_len) && ((uint16_t) header->size >= min_len) && ((uint16_t) header->size <= len) )
+    for( entry = 0; entry < QUERY_SCHEDULE_COUNT; entry += 1 )
     {
-        // check packet type
-        if( header->type != HOBD_PACKET_TYPE_INVALID )
-        {
-            const uint8_t packet_checksum = buffer[ header->size - 1 ];
+        query_range_s *range = NULL;
 
-            // excludes the checksum byte
-            const uint8_t real_checksum = obd_checksum(
-                    buffer,
-                    (uint16_t) header->size - 1 );
+        for( idx = 0; idx < REGISTER_FIELD_COUNT; idx += 1 )
+        {
+            const register_field_s * const field = &REGISTER_FIELDS[ idx ];
 
-            // check checksum
-            if( packet_checksum == real_checksum )
+            if( field->table == QUERY_SCHEDULE[ entry ].table )
             {
-                // valid
-                packet_type = header->type;
+                const uint8_t field_end = field->offset + field->size;
+
+                if(
+                        (range != NULL)
+                        && (field->offset <= (range->register_offset + range->register_cnt + QUERY_MERGE_GAP)) )
+                {
+                    // extend the current range
+                    range->register_cnt =
+                            MAX( field_end, range->register_offset + range->register_cnt )
+                            - range->register_offset;
+                }
+                else
+                {
+                    // start a new range
+                    range = &query_ranges[ query_range_count ];
+                    query_range_count += 1;
+
+                    range->table = field->table;
+                    range->register_offset = field->offset;
+                    range->register_cnt = field->size;
+                    range->interval = QUERY_SCHEDULE[ entry ].interval;
+                    range->last_tx_time = 0;
+                }
             }
         }
     }
-
-    return packet_type;
 }
 
 
-//
-static uint8_t process_buffer( void )
+// the wake-up packet gets no response, the init command does
+static uint8_t query_send_init(
+        const uint32_t * const now )
 {
     uint8_t ret = 0;
-    uint32_t rx_timestamp = 0;
-    uint16_t rb_data = RING_BUFFER_NO_DATA;
+    uint8_t packet[ TX_BUFFER_SIZE ];
 
-    hobd_packet_header_s * const header =
-                (hobd_packet_header_s*) &obd_buffer[ 0 ];
+    hobd_packet_header_s * const wake_up =
+            (hobd_packet_header_s*) &packet[ 0 ];
 
-    // initialize header
-    header->type = HOBD_PACKET_TYPE_INVALID;
-    header->size = 0;
-    header->subtype = 0x00;
+    const uint8_t wake_up_size = (uint8_t) (sizeof(*wake_up) + 1);
 
-    if( ring_buffer_available( &rx_buffer ) != 0 )
+    hobd_init_command_s * const init =
+            (hobd_init_command_s*) &packet[ wake_up_size ];
+
+    const uint8_t init_size = (uint8_t) (sizeof(*init) + 1);
+
+    wake_up->type = HOBD_PACKET_TYPE_WAKE_UP;
+    wake_up->size = wake_up_size;
+    wake_up->subtype = HOBD_PACKET_SUBTYPE_WAKE_UP;
+    packet[ wake_up_size - 1 ] = obd_checksum(
+            &packet[ 0 ],
+            wake_up_size - 1 );
+
+    init->header.type = HOBD_PACKET_TYPE_QUERY;
+    init->header.size = init_size;
+    init->header.subtype = HOBD_PACKET_SUBTYPE_INIT_COMMAND;
+    init->data = HOBD_INIT_COMMAND_DATA;
+    packet[ wake_up_size + init_size - 1 ] = obd_checksum(
+            &packet[ wake_up_size ],
+            init_size - 1 );
+
+    ret = tx_packet(
+            &packet[ 0 ],
+            wake_up_size + init_size );
+
+    if( ret == 0 )
     {
-        // get the rx timestamp if we have data to process
-        rx_timestamp = time_get_ms();
+        scheduler.tx_time = (*now);
+        scheduler.state = QUERY_STATE_WAIT_INIT;
+    }
+
+    return ret;
+}
+
+
+// sends the highest priority query that is due
+static uint8_t query_send_next(
+        const uint32_t * const now )
+{
+    uint8_t ret = 0;
+    uint8_t idx = 0;
+    uint8_t entry = query_range_count;
+    uint8_t packet[ sizeof(hobd_table_query_s) + 1 ];
 
-        rb_data = ring_buffer_getc( &rx_buffer );
+    for( idx = 0; (idx < query_range_count) && (entry == query_range_count); idx += 1 )
+    {
+        const uint32_t delta = time_get_delta(
+                &query_ranges[ idx ].last_tx_time,
+                now );
 
-        if( rb_data != RING_BUFFER_NO_DATA )
+        if( delta >= query_ranges[ idx ].interval )
         {
-            header->type = (uint8_t) (rb_data & 0xFF);
+            entry = idx;
         }
     }
 
-    if( header->type == HOBD_PACKET_TYPE_RESPONSE )
-    {
-        // wait for next byte
-        while( ring_buffer_available( &rx_buffer ) == 0 );
-
-        rb_data = ring_buffer_getc( &rx_buffer );
+    scheduler.state = QUERY_STATE_IDLE;
 
-        if( rb_data != RING_BUFFER_NO_DATA )
+    if( entry < query_range_count )
+    {
+        hobd_table_query_s * const query =
+                (hobd_table_query_s*) &packet[ 0 ];
+
+        query->header.type = HOBD_PACKET_TYPE_QUERY;
+        query->header.size = (uint8_t) sizeof(packet);
+        query->header.subtype = HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP;
+        query->table = query_ranges[ entry ].table;
+        query->register_offset = query_ranges[ entry ].register_offset;
+        query->register_cnt = query_ranges[ entry ].register_cnt;
+        packet[ sizeof(packet) - 1 ] = obd_checksum(
+                &packet[ 0 ],
+                sizeof(packet) - 1 );
+
+        ret = tx_packet(
+                &packet[ 0 ],
+                (uint8_t) sizeof(packet) );
+
+        if( ret == 0 )
         {
-            header->size = (uint8_t) (rb_data & 0xFF);
+            query_ranges[ entry ].last_tx_time = (*now);
+
+            scheduler.entry = entry;
+            scheduler.tx_time = (*now);
+            scheduler.state = QUERY_STATE_WAIT_RESPONSE;
         }
+    }
+
+    return ret;
+}
+
 
-        // wait for next byte
-        while( ring_buffer_available( &rx_buffer ) == 0 );
+// called once a response checksum is validated
+static void query_handle_response(
+        const hobd_packet_header_s * const header,
+        const uint32_t * const now )
+{
+    if( OBD_QUERY_ENABLE != 0 )
+    {
+        const hobd_table_response_s * const response =
+                (const hobd_table_response_s*) header;
 
-        rb_data = ring_buffer_getc( &rx_buffer );
+        if(
+                (scheduler.state == QUERY_STATE_WAIT_INIT)
+                && (header->subtype == HOBD_PACKET_SUBTYPE_INIT_COMMAND) )
+        {
+            scheduler.timeout_count = 0;
 
-        if( rb_data != RING_BUFFER_NO_DATA )
+            (void) query_send_next( now );
+        }
+        else if(
+                (scheduler.state == QUERY_STATE_WAIT_RESPONSE)
+                && (header->subtype == HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP)
+                && (header->size > (uint8_t) sizeof(*response))
+                && (response->table == query_ranges[ scheduler.entry ].table)
+                && (response->register_offset == query_ranges[ scheduler.entry ].register_offset) )
         {
-            header->subtype = (uint8_t) (rb_data & 0xFF);
+            scheduler.timeout_count = 0;
+
+            (void) query_send_next( now );
         }
     }
+}
 
-    if(
-            (header->type == HOBD_PACKET_TYPE_RESPONSE) &&
-            (header->subtype == HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP) )
-    {
-        uint8_t idx = (uint8_t) sizeof(*header);
 
-        do
+//
+static uint8_t query_update(
+        const uint32_t * const now )
+{
+    uint8_t ret = 0;
+
+    if( OBD_QUERY_ENABLE != 0 )
+    {
+        if(
+                (scheduler.state == QUERY_STATE_WAIT_INIT)
+                || (scheduler.state == QUERY_STATE_WAIT_RESPONSE) )
         {
-            rb_data = ring_buffer_getc( &rx_buffer );
+            const uint32_t delta = time_get_delta(
+                    &scheduler.tx_time,
+                    now );
 
-            if( rb_data != RING_BUFFER_NO_DATA )
+            if( delta >= OBD_QUERY_RESPONSE_TIMEOUT )
             {
-                obd_buffer[ idx ] = (uint8_t) (rb_data & 0xFF);
-                idx += 1;
+                scheduler.response_timeout_count += 1;
+                scheduler.timeout_count += 1;
+
+                if(
+                        (scheduler.state == QUERY_STATE_WAIT_INIT)
+                        || (scheduler.timeout_count >= OBD_QUERY_REINIT_TIMEOUTS) )
+                {
+                    scheduler.timeout_count = 0;
+                    scheduler.state = QUERY_STATE_INIT;
+                }
+                else
+                {
+                    scheduler.state = QUERY_STATE_IDLE;
+                }
+
+                DEBUG_PUTS( "obd_query_timeout\n" );
             }
         }
-        while( idx < header->size );
 
-        // check if a valid packet
-        const uint8_t packet_type = obd_packet_type(
-                &obd_buffer[ 0 ],
-                (uint16_t) header->size );
+        if( scheduler.state == QUERY_STATE_INIT )
+        {
+            ret = query_send_init( now );
+        }
+        else if( scheduler.state == QUERY_STATE_IDLE )
+        {
+            ret = query_send_next( now );
+        }
+    }
+
+    return ret;
+}
+
+
+// feeds everything in the rx buffer through the packet parser
+static uint8_t process_buffer(
+        const uint32_t * const now )
+{
+    uint8_t ret = 0;
+    const uint8_t *span = NULL;
+    uint16_t processed = 0;
+    uint16_t idx = 0;
+
+    // at most two spans when the data wraps, bounded in case the UART
+    // keeps up with the parser
+    uint16_t len = ring_buffer_peek_span( &rx_buffer, &span );
 
-        // process response types
-        if( packet_type == HOBD_PACKET_TYPE_RESPONSE )
+    while( (len != 0) && (processed < RING_BUFFER_SIZE) )
+    {
+        for( idx = 0; idx < len; idx += 1 )
         {
-            if( header->subtype == HOBD_PACKET_SUBTYPE_TABLE_SUBGROUP )
-            {
-                const hobd_table_response_s * const response =
-                        (hobd_table_response_s*) &obd_buffer[ 0 ];
+            parser_feed( span[ idx ], now );
+        }
 
-                diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_NO_OBD_ECU );
+        ring_buffer_consume( &rx_buffer, len );
 
-                parse_response(
-                        response,
-                        &rx_timestamp );
-            }
+        processed += len;
+
+        len = ring_buffer_peek_span( &rx_buffer, &span );
+    }
+
+    // drop a partial packet if the ECU stopped mid-packet
+    if( parser.state != PARSER_STATE_TYPE )
+    {
+        const uint32_t delta = time_get_delta(
+                &parser.last_byte_time,
+                now );
+
+        if( delta >= OBD_RX_BYTE_TIMEOUT )
+        {
+            parser.timeout_count += 1;
+            parser_reset();
+
+            DEBUG_PUTS( "obd_rx_timeout\n" );
         }
     }
 
@@ -389,70 +1137,144 @@ static uint8_t process_buffer( void )
 
 
 //
-static void parse_response(
+static void update_rx_stats( void )
+{
+    ring_buffer_stats_s rb_stats;
+
+    ring_buffer_get_stats(
+            &rx_buffer,
+            &rb_stats );
+
+    const uint16_t protocol_errors =
+            parser.framing_error_count
+            + parser.checksum_error_count
+            + parser.timeout_count
+            + scheduler.response_timeout_count;
+
+    diagnostics_set_rx_stats(
+            HOBD_RX_BUFFER_ID_OBD,
+            &rb_stats,
+            protocol_errors );
+}
+
+
+// copies a register range if the response includes all of it,
+// responses may hold any part of a table
+static uint8_t copy_register(
         const hobd_table_response_s * const response,
-        const uint32_t * const rx_timestamp )
+        const uint8_t offset,
+        const uint8_t size,
+        void * const dst )
 {
+    uint8_t ret = 0;
+
     // number of bytes in the table response payload
     const uint8_t registers_size = (response->header.size - sizeof(*response) - 1);
 
-     if( response->table == HOBD_TABLE_16 )
-     {
-         if( registers_size >= (uint8_t) sizeof(hobd_table_16_s) )
-         {
-            DEBUG_PUTS( "obd_table_0x10(16)\n" );
+    const uint8_t first = response->register_offset;
+
+    if(
+            (offset >= first)
+            && ((uint16_t) offset + size <= (uint16_t) first + registers_size) )
+    {
+        const uint8_t * const registers =
+                &((const uint8_t*) response)[ sizeof(*response) ];
 
-            const hobd_table_16_s * const table_data =
-                    (hobd_table_16_s*) &((uint8_t*) response)[ sizeof(*response) ];
+        memcpy( dst, &registers[ offset - first ], size );
 
-            rx_count_table_16 += 1;
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+// decodes whichever fields the response covers, the rest keep their
+// last decoded value, see swap_data_buffers
+static void parse_response(
+        const hobd_table_response_s * const response,
+        const uint32_t * const rx_timestamp,
+        const uint32_t * const rx_time_us )
+{
+    uint8_t decoded = 0;
 
-            obd_data.group_a.time.rx_time = (*rx_timestamp);
-            obd_data.group_a.time.counter_1 = rx_count_table_16;
-            obd_data.group_a.time.counter_1 = rx_count_table_209;
+    if( response->table == HOBD_TABLE_16 )
+    {
+        DEBUG_PUTS( "obd_table_0x10(16)\n" );
+
+        obd_data_s * const data = back_data;
+
+        decoded |= COPY_TABLE_16( response, engine_rpm, &data->group_a.obd1.engine_rpm );
+        decoded |= COPY_TABLE_16( response, wheel_speed, &data->group_a.obd1.wheel_speed );
+        decoded |= COPY_TABLE_16( response, battery_volt, &data->group_a.obd1.battery_volt );
+        decoded |= COPY_TABLE_16( response, tps_volt, &data->group_a.obd1.tps_volt );
+        decoded |= COPY_TABLE_16( response, tps_percent, &data->group_a.obd1.tps_percent );
+
+        decoded |= COPY_TABLE_16( response, ect_volt, &data->group_a.obd2.ect_volt );
+        decoded |= COPY_TABLE_16( response, ect_temp, &data->group_a.obd2.ect_temp );
+        decoded |= COPY_TABLE_16( response, iat_volt, &data->group_a.obd2.iat_volt );
+        decoded |= COPY_TABLE_16( response, iat_temp, &data->group_a.obd2.iat_temp );
+        decoded |= COPY_TABLE_16( response, map_volt, &data->group_a.obd2.map_volt );
+        decoded |= COPY_TABLE_16( response, map_pressure, &data->group_a.obd2.map_pressure );
+        decoded |= COPY_TABLE_16( response, fuel_injectors, &data->group_a.obd2.fuel_injectors );
+
+        if( decoded != 0 )
+        {
+            rx_count_table_16 += 1;
 
-            obd_data.group_a.obd1.engine_rpm = table_data->engine_rpm;
-            obd_data.group_a.obd1.wheel_speed = table_data->wheel_speed;
-            obd_data.group_a.obd1.battery_volt = table_data->battery_volt;
-            obd_data.group_a.obd1.tps_volt = table_data->tps_volt;
-            obd_data.group_a.obd1.tps_percent = table_data->tps_percent;
+            data->group_a.time.rx_time = (*rx_timestamp);
+            data->group_a.time.counter_1 = rx_count_table_16;
+            data->group_a.time.counter_2 = rx_count_table_209;
 
-            obd_data.group_a.obd2.ect_volt = table_data->ect_volt;
-            obd_data.group_a.obd2.ect_temp = table_data->ect_temp;
-            obd_data.group_a.obd2.iat_volt = table_data->iat_volt;
-            obd_data.group_a.obd2.iat_temp = table_data->iat_temp;
-            obd_data.group_a.obd2.map_volt = table_data->map_volt;
-            obd_data.group_a.obd2.map_pressure = table_data->map_pressure;
-            obd_data.group_a.obd2.fuel_injectors = table_data->fuel_injectors;
+            data->group_a.time_us.rx_time_us = (*rx_time_us);
+            data->group_a.time_us.sync_time_us = time_sync_get_time( rx_time_us );
 
             last_rx_time = (*rx_timestamp);
 
             obd_set_group_ready( OBD_GROUP_A_READY );
-         }
-     }
-     else if( response->table == HOBD_TABLE_209 )
-     {
-         if( registers_size >= (uint8_t) sizeof(hobd_table_209_s) )
-         {
-            DEBUG_PUTS( "obd_table_0xD1(209)\n" );
 
-            const hobd_table_209_s * const table_data =
-                       (hobd_table_209_s*) &((uint8_t*) response)[ sizeof(*response) ];
+            trace_parsed( HOBD_TRACE_GROUP_OBD_TABLE_16, rx_time_us );
+        }
+    }
+    else if( response->table == HOBD_TABLE_209 )
+    {
+        DEBUG_PUTS( "obd_table_0xD1(209)\n" );
+
+        obd_data_s * const data = back_data;
+
+        // obd3 fields are bit-fields
+        uint8_t reg = 0;
+
+        if( COPY_TABLE_209( response, gear, &reg ) != 0 )
+        {
+            data->group_b.obd3.gear = reg;
+            decoded = 1;
+        }
+
+        if( COPY_TABLE_209( response, engine_on, &reg ) != 0 )
+        {
+            data->group_b.obd3.engine_on = reg;
+            decoded = 1;
+        }
 
+        if( decoded != 0 )
+        {
             rx_count_table_209 += 1;
 
-            obd_data.group_b.time.rx_time = (*rx_timestamp);
-            obd_data.group_b.time.counter_1 = rx_count_table_16;
-            obd_data.group_b.time.counter_1 = rx_count_table_209;
+            data->group_b.time.rx_time = (*rx_timestamp);
+            data->group_b.time.counter_1 = rx_count_table_16;
+            data->group_b.time.counter_2 = rx_count_table_209;
 
-            obd_data.group_b.obd3.engine_on = table_data->engine_on;
-            obd_data.group_b.obd3.gear = table_data->gear;
+            data->group_b.time_us.rx_time_us = (*rx_time_us);
+            data->group_b.time_us.sync_time_us = time_sync_get_time( rx_time_us );
 
             last_rx_time = (*rx_timestamp);
 
             obd_set_group_ready( OBD_GROUP_B_READY );
-         }
-     }
+
+            trace_parsed( HOBD_TRACE_GROUP_OBD_TABLE_209, rx_time_us );
+        }
+    }
 }
 
 
@@ -467,9 +1289,26 @@ uint8_t obd_init( void )
 {
     uint8_t ret = 0;
 
-    memset( &obd_data, 0, sizeof(obd_data) );
+    memset( obd_data, 0, sizeof(obd_data) );
+
+    ring_buffer_init(
+            &rx_buffer,
+            rx_buffer_storage,
+            (uint16_t) sizeof(rx_buffer_storage) );
+
+    memset( &parser, 0, sizeof(parser) );
 
-    ring_buffer_init( &rx_buffer );
+    parser_reset();
+
+    memset( &scheduler, 0, sizeof(scheduler) );
+
+    build_query_ranges();
+
+    ret |= publish_set_policy(
+            HOBD_CAN_ID_OBD3,
+            &OBD3_PUBLISH_POLICY );
+
+    scheduler.state = QUERY_STATE_INIT;
 
     hw_init();
 
@@ -500,6 +1339,12 @@ void obd_enable( void )
     // flush rx buffer
     ring_buffer_flush( &rx_buffer );
 
+    // drop any partial packet
+    parser_reset();
+
+    // ECU may have gone to sleep while disabled
+    scheduler.state = QUERY_STATE_INIT;
+
     // enable UART
     obd_uart_enable();
 }
@@ -509,7 +1354,7 @@ void obd_enable( void )
 void obd_set_group_ready(
         const uint16_t group )
 {
-    obd_data.ready_groups |= group;
+    back_data->ready_groups |= group;
 }
 
 
@@ -517,14 +1362,15 @@ void obd_set_group_ready(
 void obd_clear_group_ready(
         const uint16_t group )
 {
-    obd_data.ready_groups &= ~group;
+    front_data->ready_groups &= ~group;
 }
 
 
 //
 void obd_clear_all_group_ready( void )
 {
-    obd_data.ready_groups = OBD_GROUP_NONE_READY;
+    back_data->ready_groups = OBD_GROUP_NONE_READY;
+    front_data->ready_groups = OBD_GROUP_NONE_READY;
 }
 
 
@@ -532,7 +1378,7 @@ void obd_clear_all_group_ready( void )
 uint8_t obd_is_group_ready(
         const uint16_t group )
 {
-    return ((obd_data.ready_groups & group) == 0) ? 0 : 1;
+    return ((front_data->ready_groups & group) == 0) ? 0 : 1;
 }
 
 
@@ -541,31 +1387,50 @@ uint8_t obd_update( void )
 {
     uint8_t ret = 0;
 
-    // process any available data in the rx buffer
-    ret = process_buffer();
+    // get current time
+    const uint32_t now = time_get_ms();
+
+    // process any available data in the rx buffer, never waits for data
+    profile_begin( HOBD_PROFILE_STAGE_OBD_PROCESS_BUFFER );
+    ret = process_buffer( &now );
+    profile_end( HOBD_PROFILE_STAGE_OBD_PROCESS_BUFFER );
+
+    // send the next query if the last one was answered or timed out
+    ret |= query_update( &now );
+
+    // swap in newly ready groups
+    swap_data_buffers();
 
     // check for any ready groups
-    if( obd_data.ready_groups != OBD_GROUP_NONE_READY )
+    if( front_data->ready_groups != OBD_GROUP_NONE_READY )
     {
+        profile_begin( HOBD_PROFILE_STAGE_OBD_PUBLISH );
+
         // handle groups in order/priority
         if( obd_is_group_ready( OBD_GROUP_A_READY ) != 0 )
         {
+            trace_publish_begin( HOBD_TRACE_GROUP_OBD_TABLE_16 );
             ret |= publish_group_a();
+            trace_publish_end( HOBD_TRACE_GROUP_OBD_TABLE_16 );
             obd_clear_group_ready( OBD_GROUP_A_READY );
         }
 
         if( obd_is_group_ready( OBD_GROUP_B_READY ) != 0 )
         {
+            trace_publish_begin( HOBD_TRACE_GROUP_OBD_TABLE_209 );
             ret |= publish_group_b();
+            trace_publish_end( HOBD_TRACE_GROUP_OBD_TABLE_209 );
             obd_clear_group_ready( OBD_GROUP_B_READY );
         }
-    }
 
-    // get current time
-    const uint32_t now = time_get_ms();
+        profile_end( HOBD_PROFILE_STAGE_OBD_PUBLISH );
+    }
 
     // update rx timeout status/warning
     update_rx_timeout( &now );
 
+    // rx buffer stats for the diagnostics heartbeat
+    update_rx_stats();
+
     return ret;
 }
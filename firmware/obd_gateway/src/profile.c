@@ -0,0 +1,306 @@
+/**
+ * @file profile.c
+ * @brief TODO.
+ *
+ * Main loop stage timing on the time_get_ticks timer. Each stage keeps
+ * min/max/mean and a log4 histogram for the current interval, the table
+ * is sent and cleared every HOBD_CAN_TX_INTERVAL_PROFILE.
+ *
+ * Runs longer than one timer period (32 ms) wrap and are under-reported.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "time.h"
+#include "canbus.h"
+#include "profile.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define TICKS_PER_MS (FOSC / HOBD_PROFILE_CYCLES_PER_TICK)
+
+
+// stages sent per profile_update, two frames each, so a report does not
+// crowd the publish groups out of the transmit queue
+#define STAGES_PER_UPDATE (2)
+
+
+//
+typedef struct
+{
+    //
+    // timer value at profile_begin
+    uint16_t start;
+    //
+    //
+    uint16_t min;
+    //
+    //
+    uint16_t max;
+    //
+    // samples in the interval, saturates
+    uint16_t count;
+    //
+    // ticks
+    uint32_t sum;
+    //
+    //
+    uint16_t bins[ HOBD_PROFILE_HIST_BIN_COUNT ];
+} stage_entry_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static const uint16_t CAN_ID_PROFILE =
+        (uint16_t) (HOBD_CAN_ID_PROFILE_BASE + NODE_ID);
+
+
+//
+static const uint16_t CAN_ID_PROFILE_HIST =
+        (uint16_t) (HOBD_CAN_ID_PROFILE_HIST_BASE + NODE_ID);
+
+
+//
+static stage_entry_s stages[ HOBD_PROFILE_STAGE_COUNT ];
+
+
+//
+static uint32_t last_tx_time = 0;
+
+
+// next stage of the report being sent,
+// HOBD_PROFILE_STAGE_COUNT when there is none
+static uint8_t next_stage = HOBD_PROFILE_STAGE_COUNT;
+
+
+// interval of the report being sent
+// ms
+static uint32_t report_interval = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint8_t get_bin(
+        const uint16_t ticks );
+
+
+//
+static void clear_stage(
+        const uint8_t stage );
+
+
+//
+static uint8_t send_stage(
+        const uint8_t stage,
+        const uint32_t interval );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static uint8_t get_bin(
+        const uint16_t ticks )
+{
+    uint8_t bin = 0;
+    uint16_t value = (ticks >> HOBD_PROFILE_HIST_BIN_SHIFT);
+
+    while( (value != 0) && (bin < (HOBD_PROFILE_HIST_BIN_COUNT - 1)) )
+    {
+        value >>= HOBD_PROFILE_HIST_BIN_SHIFT;
+        bin += 1;
+    }
+
+    return bin;
+}
+
+
+// keeps the start time if the stage is running
+static void clear_stage(
+        const uint8_t stage )
+{
+    stage_entry_s * const entry = &stages[ stage ];
+
+    entry->min = 0xFFFF;
+    entry->max = 0;
+    entry->count = 0;
+    entry->sum = 0;
+
+    memset( entry->bins, 0, sizeof(entry->bins) );
+}
+
+
+//
+static uint8_t send_stage(
+        const uint8_t stage,
+        const uint32_t interval )
+{
+    uint8_t ret = 0;
+    uint8_t bin = 0;
+    hobd_profile_s profile;
+    hobd_profile_hist_s hist;
+
+    const stage_entry_s * const entry = &stages[ stage ];
+
+    const uint32_t capacity = (interval * TICKS_PER_MS) / 100UL;
+
+    profile.stage = stage;
+    profile.load = (uint8_t) MIN( (capacity == 0) ? 0 : (entry->sum / capacity), 100UL );
+    profile.min = entry->min;
+    profile.max = entry->max;
+    profile.mean = (uint16_t) MIN( entry->sum / entry->count, 0xFFFFUL );
+
+    hist.stage = stage;
+
+    for( bin = 0; bin < HOBD_PROFILE_HIST_BIN_COUNT; bin += 1 )
+    {
+        hist.bins[ bin ] = (uint8_t) (((uint32_t) entry->bins[ bin ] * 255UL) / entry->count);
+    }
+
+    ret = canbus_send(
+            CAN_ID_PROFILE,
+            (uint8_t) sizeof(profile),
+            (const uint8_t*) &profile );
+
+    ret |= canbus_send(
+            CAN_ID_PROFILE_HIST,
+            (uint8_t) sizeof(hist),
+            (const uint8_t*) &hist );
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void profile_init( void )
+{
+    uint8_t idx = 0;
+
+    for( idx = 0; idx < HOBD_PROFILE_STAGE_COUNT; idx += 1 )
+    {
+        clear_stage( idx );
+    }
+
+    next_stage = HOBD_PROFILE_STAGE_COUNT;
+
+    last_tx_time = time_get_ms();
+}
+
+
+//
+void profile_begin(
+        const uint8_t stage )
+{
+    if( stage < HOBD_PROFILE_STAGE_COUNT )
+    {
+        stages[ stage ].start = time_get_ticks();
+    }
+}
+
+
+//
+void profile_end(
+        const uint8_t stage )
+{
+    const uint16_t now = time_get_ticks();
+
+    if( stage < HOBD_PROFILE_STAGE_COUNT )
+    {
+        stage_entry_s * const entry = &stages[ stage ];
+
+        // unsigned subtraction handles a single wrap
+        const uint16_t ticks = (uint16_t) (now - entry->start);
+
+        if( entry->count != 0xFFFF )
+        {
+            entry->count += 1;
+            entry->sum += (uint32_t) ticks;
+            entry->bins[ get_bin( ticks ) ] += 1;
+
+            if( ticks < entry->min )
+            {
+                entry->min = ticks;
+            }
+
+            if( ticks > entry->max )
+            {
+                entry->max = ticks;
+            }
+        }
+    }
+}
+
+
+//
+uint8_t profile_update( void )
+{
+    uint8_t ret = 0;
+    uint8_t sent = 0;
+
+    const uint32_t now = time_get_ms();
+
+    const uint32_t delta = time_get_delta(
+            &last_tx_time,
+            &now );
+
+    if( (next_stage == HOBD_PROFILE_STAGE_COUNT) && (delta >= (uint32_t) HOBD_CAN_TX_INTERVAL_PROFILE) )
+    {
+        next_stage = 0;
+        report_interval = delta;
+
+        last_tx_time = now;
+    }
+
+    // each stage is cleared as it is sent, so its next interval starts
+    // the same number of passes after the next report starts
+    while( (next_stage < HOBD_PROFILE_STAGE_COUNT) && (sent < STAGES_PER_UPDATE) )
+    {
+        // only the stages this node runs
+        if( stages[ next_stage ].count != 0 )
+        {
+            ret |= send_stage( next_stage, report_interval );
+
+            sent += 1;
+        }
+
+        clear_stage( next_stage );
+
+        next_stage += 1;
+    }
+
+    return ret;
+}
@@ -0,0 +1,308 @@
+/**
+ * @file time_sync.c
+ * @brief TODO.
+ *
+ * Two-step synchronization to the time master. The sync broadcast is
+ * stamped with the us clock in the CAN receive interrupt, its follow-up
+ * carries the master time the sync was transmitted, together they give
+ * one local/master time pair per HOBD_CAN_TX_INTERVAL_TIME_SYNC.
+ *
+ * Master time is extrapolated from the last pair with the drift estimate.
+ * Each new pair is compared with that prediction: the error becomes the
+ * reported sync error, is folded into the drift estimate, and the
+ * reference moves to the new pair.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "time.h"
+#include "diagnostics.h"
+#include "time_sync.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// drift is kept as a fraction of the local rate in units of 2^-RATE_SHIFT
+#define RATE_SHIFT (32)
+
+
+//
+#define RATE_MAX ((int32_t) (((int64_t) TIME_SYNC_DRIFT_MAX_PPM << RATE_SHIFT) / 1000000L))
+
+
+// each pair corrects 1/2^GAIN_SHIFT of the drift it measures, once the
+// first estimate is in
+#define RATE_GAIN_SHIFT (2)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static hobd_time_sync_s status;
+
+
+// last sync broadcast waiting for its follow-up
+static uint8_t sync_valid = 0;
+static uint16_t sync_sequence = 0;
+static uint32_t sync_rx_time = 0;
+
+
+// reference pair, us clock and master time
+static uint32_t ref_local = 0;
+static uint32_t ref_master = 0;
+
+
+// master rate minus local rate, 2^-RATE_SHIFT
+static int32_t rate = 0;
+
+
+// set once rate has been measured since the last step
+static uint8_t rate_valid = 0;
+
+
+// consecutive follow-ups within TIME_SYNC_LOCK_US
+static uint8_t lock_count = 0;
+
+
+// ms
+static uint32_t last_follow_up = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static uint32_t to_master(
+        const uint32_t * const local_time );
+
+
+//
+static void step(
+        const uint32_t * const local_time,
+        const uint32_t * const master_time );
+
+
+//
+static void handle_follow_up(
+        const uint32_t * const local_time,
+        const uint32_t * const master_time );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// times before the reference work too, up to half the clock period away
+static uint32_t to_master(
+        const uint32_t * const local_time )
+{
+    const int32_t elapsed = (int32_t) ((*local_time) - ref_local);
+
+    const int32_t correction = (int32_t) (((int64_t) elapsed * rate) >> RATE_SHIFT);
+
+    return (ref_master + (uint32_t) elapsed + (uint32_t) correction);
+}
+
+
+// drift is kept, it is measured again from the next pair
+static void step(
+        const uint32_t * const local_time,
+        const uint32_t * const master_time )
+{
+    ref_local = (*local_time);
+    ref_master = (*master_time);
+
+    rate_valid = 0;
+    lock_count = 0;
+
+    status.state = HOBD_TIME_SYNC_STATE_LOCKING;
+}
+
+
+//
+static void handle_follow_up(
+        const uint32_t * const local_time,
+        const uint32_t * const master_time )
+{
+    int32_t error = 0;
+
+    if( status.state == HOBD_TIME_SYNC_STATE_NONE )
+    {
+        step( local_time, master_time );
+    }
+    else
+    {
+        const int32_t interval = (int32_t) ((*local_time) - ref_local);
+
+        error = (int32_t) ((*master_time) - to_master( local_time ));
+
+        if(
+                (interval <= 0)
+                || (error > TIME_SYNC_STEP_US)
+                || (error < -TIME_SYNC_STEP_US) )
+        {
+            step( local_time, master_time );
+        }
+        else
+        {
+            // drift left over from the estimate
+            int64_t rate_error = (((int64_t) error << RATE_SHIFT) / interval);
+
+            if( rate_valid != 0 )
+            {
+                rate_error /= (1L << RATE_GAIN_SHIFT);
+            }
+
+            rate_error += rate;
+
+            rate = (int32_t) MAX( MIN( rate_error, (int64_t) RATE_MAX ), -((int64_t) RATE_MAX) );
+            rate_valid = 1;
+
+            ref_local = (*local_time);
+            ref_master = (*master_time);
+
+            if( (error > TIME_SYNC_LOCK_US) || (error < -TIME_SYNC_LOCK_US) )
+            {
+                lock_count = 0;
+            }
+            else if( lock_count < TIME_SYNC_LOCK_COUNT )
+            {
+                lock_count += 1;
+            }
+
+            if( lock_count >= TIME_SYNC_LOCK_COUNT )
+            {
+                status.state = HOBD_TIME_SYNC_STATE_LOCKED;
+            }
+            else
+            {
+                status.state = HOBD_TIME_SYNC_STATE_LOCKING;
+            }
+        }
+    }
+
+    status.error = (int16_t) MAX( MIN( error, (int32_t) HOBD_TIME_SYNC_ERROR_MAX ), -((int32_t) HOBD_TIME_SYNC_ERROR_MAX) );
+    status.drift = (int32_t) (((int64_t) rate * 1000000000L) >> RATE_SHIFT);
+
+    last_follow_up = time_get_ms();
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void time_sync_init( void )
+{
+    memset( &status, 0, sizeof(status) );
+
+    status.state = HOBD_TIME_SYNC_STATE_NONE;
+
+    sync_valid = 0;
+    ref_local = 0;
+    ref_master = 0;
+    rate = 0;
+    rate_valid = 0;
+    lock_count = 0;
+    last_follow_up = time_get_ms();
+
+    time_sync_update();
+}
+
+
+//
+void time_sync_handle_command(
+        const hobd_command_s * const command,
+        const uint32_t * const rx_time )
+{
+    if( command->id == HOBD_COMMAND_ID_TIME_SYNC )
+    {
+        sync_sequence = command->data_0;
+        sync_rx_time = (*rx_time);
+        sync_valid = 1;
+    }
+    else if(
+            (command->id == HOBD_COMMAND_ID_TIME_FOLLOW_UP)
+            && (sync_valid != 0)
+            && (command->data_0 == sync_sequence) )
+    {
+        const uint32_t master_time = command->data_1;
+
+        sync_valid = 0;
+
+        status.sequence = (uint8_t) sync_sequence;
+
+        handle_follow_up( &sync_rx_time, &master_time );
+    }
+}
+
+
+//
+uint32_t time_sync_get_time(
+        const uint32_t * const local_time )
+{
+    uint32_t time = (*local_time);
+
+    if( status.state != HOBD_TIME_SYNC_STATE_NONE )
+    {
+        time = to_master( local_time );
+    }
+
+    return time;
+}
+
+
+//
+void time_sync_update( void )
+{
+    const uint32_t now = time_get_ms();
+
+    const uint32_t delta = time_get_delta(
+            &last_follow_up,
+            &now );
+
+    // keep extrapolating with the last estimate
+    if(
+            ((status.state == HOBD_TIME_SYNC_STATE_LOCKING) || (status.state == HOBD_TIME_SYNC_STATE_LOCKED))
+            && (delta >= TIME_SYNC_TIMEOUT) )
+    {
+        status.state = HOBD_TIME_SYNC_STATE_HOLDOVER;
+        lock_count = 0;
+    }
+
+    if( status.state == HOBD_TIME_SYNC_STATE_LOCKED )
+    {
+        diagnostics_clear_warn( HOBD_HEARTBEAT_WARN_NO_TIME_SYNC );
+    }
+    else
+    {
+        diagnostics_set_warn( HOBD_HEARTBEAT_WARN_NO_TIME_SYNC );
+    }
+
+    diagnostics_set_time_sync( &status );
+}
@@ -0,0 +1,377 @@
+/**
+ * @file trace.c
+ * @brief TODO.
+ *
+ * Publish group latency tracing. A traced publish marks its CAN frames,
+ * the CAN transmit complete interrupt counts them back in and the trace
+ * frame is sent once the last one is out.
+ *
+ * All times are on the us clock, the transmit done time is taken in the
+ * interrupt.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <inttypes.h>
+
+#include "board.h"
+#include "hobd.h"
+#include "time.h"
+#include "canbus.h"
+#include "trace.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// low sequence bits carried in the transmit mark, so frames of an older
+// trace of the group are not counted
+#define MARK_SEQUENCE_BITS (4)
+#define MARK_SEQUENCE_MASK ((1 << MARK_SEQUENCE_BITS) - 1)
+
+
+// zero is CANBUS_TX_MARK_NONE
+#define MAKE_MARK(group, sequence) \
+    ((uint8_t) (1 + (((group) << MARK_SEQUENCE_BITS) | ((sequence) & MARK_SEQUENCE_MASK))))
+
+
+//
+#define MARK_GROUP(mark) ((uint8_t) (((mark) - 1) >> MARK_SEQUENCE_BITS))
+
+
+// nothing in flight
+#define STATE_IDLE (0)
+
+
+// between trace_publish_begin and trace_publish_end
+#define STATE_QUEUEING (1)
+
+
+// waiting for the marked frames to be transmitted
+#define STATE_QUEUED (2)
+
+
+//
+typedef struct
+{
+    //
+    // set by trace_parsed, cleared when published
+    uint8_t parsed;
+    //
+    // latest parse
+    // us
+    uint32_t parsed_rx_time;
+    uint32_t parsed_time;
+    //
+    // STATE_*
+    uint8_t state;
+    //
+    //
+    uint8_t sequence;
+    //
+    // in flight trace
+    // us
+    uint32_t rx_time;
+    uint32_t parse_time;
+    uint32_t queue_time;
+    //
+    // marked frames queued
+    uint8_t queued_count;
+    //
+    // mark of the in flight trace, read by the interrupt
+    volatile uint8_t mark;
+    //
+    // marked frames transmitted
+    volatile uint8_t done_count;
+    //
+    // last transmit
+    // us
+    volatile uint32_t done_time;
+} group_entry_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static const uint16_t CAN_ID_TRACE =
+        (uint16_t) (HOBD_CAN_ID_TRACE_BASE + NODE_ID);
+
+
+//
+static group_entry_s groups[ HOBD_TRACE_GROUP_COUNT ];
+
+
+//
+static uint8_t enabled = HOBD_TRACE_DISABLED;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void tx_done_cb(
+        const uint8_t mark );
+
+
+//
+static void set_enabled(
+        const uint8_t state );
+
+
+//
+static uint16_t get_latency(
+        const uint32_t * const start,
+        const uint32_t * const end );
+
+
+//
+static uint8_t send_trace(
+        const uint8_t group,
+        const uint32_t * const done_time );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// called from the CAN interrupt
+static void tx_done_cb(
+        const uint8_t mark )
+{
+    const uint8_t group = MARK_GROUP( mark );
+
+    if( group < HOBD_TRACE_GROUP_COUNT )
+    {
+        group_entry_s * const entry = &groups[ group ];
+
+        if( entry->mark == mark )
+        {
+            entry->done_time = time_get_us();
+            entry->done_count += 1;
+        }
+    }
+}
+
+
+//
+static void set_enabled(
+        const uint8_t state )
+{
+    canbus_set_tx_done_callback( NULL );
+
+    memset( groups, 0, sizeof(groups) );
+
+    enabled = state;
+
+    if( enabled == HOBD_TRACE_ENABLED )
+    {
+        canbus_set_tx_done_callback( &tx_done_cb );
+    }
+}
+
+
+// saturates at HOBD_TRACE_LATENCY_MAX
+static uint16_t get_latency(
+        const uint32_t * const start,
+        const uint32_t * const end )
+{
+    const uint32_t latency = time_get_delta(
+            start,
+            end );
+
+    return (uint16_t) MIN( latency, (uint32_t) HOBD_TRACE_LATENCY_MAX );
+}
+
+
+//
+static uint8_t send_trace(
+        const uint8_t group,
+        const uint32_t * const done_time )
+{
+    hobd_trace_s trace;
+
+    const group_entry_s * const entry = &groups[ group ];
+
+    trace.group = group;
+    trace.sequence = entry->sequence;
+    trace.parse_latency = get_latency( &entry->rx_time, &entry->parse_time );
+    trace.queue_latency = get_latency( &entry->parse_time, &entry->queue_time );
+    trace.tx_latency = get_latency( &entry->queue_time, done_time );
+
+    return canbus_send(
+            CAN_ID_TRACE,
+            (uint8_t) sizeof(trace),
+            (const uint8_t*) &trace );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void trace_init( void )
+{
+    set_enabled( TRACE_DEFAULT );
+}
+
+
+//
+uint8_t trace_handle_command(
+        const hobd_command_s * const command )
+{
+    uint8_t ret = HOBD_RESPONSE_STATUS_OK;
+
+    if( command->id != HOBD_COMMAND_ID_TRACE )
+    {
+        ret = HOBD_RESPONSE_STATUS_INVALID_COMMAND;
+    }
+    else if( (command->data_1 != HOBD_TRACE_DISABLED) && (command->data_1 != HOBD_TRACE_ENABLED) )
+    {
+        ret = HOBD_RESPONSE_STATUS_INVALID_DATA;
+    }
+    else
+    {
+        set_enabled( (uint8_t) command->data_1 );
+    }
+
+    return ret;
+}
+
+
+//
+void trace_parsed(
+        const uint8_t group,
+        const uint32_t * const rx_time_us )
+{
+    if( (enabled == HOBD_TRACE_ENABLED) && (group < HOBD_TRACE_GROUP_COUNT) )
+    {
+        group_entry_s * const entry = &groups[ group ];
+
+        entry->parsed_rx_time = (*rx_time_us);
+        entry->parsed_time = time_get_us();
+        entry->parsed = 1;
+    }
+}
+
+
+//
+void trace_publish_begin(
+        const uint8_t group )
+{
+    if( (enabled == HOBD_TRACE_ENABLED) && (group < HOBD_TRACE_GROUP_COUNT) )
+    {
+        group_entry_s * const entry = &groups[ group ];
+
+        // not parsed since tracing was enabled
+        if( entry->parsed != 0 )
+        {
+            // an older trace still in flight is dropped, leaving a gap
+            // in the sequence numbers
+            entry->sequence += 1;
+            entry->rx_time = entry->parsed_rx_time;
+            entry->parse_time = entry->parsed_time;
+            entry->parsed = 0;
+
+            const uint8_t mark = MAKE_MARK( group, entry->sequence );
+
+            disable_interrupt();
+
+            entry->mark = mark;
+            entry->done_count = 0;
+
+            enable_interrupt();
+
+            entry->state = STATE_QUEUEING;
+
+            entry->queue_time = time_get_us();
+
+            canbus_set_tx_mark( mark );
+        }
+    }
+}
+
+
+//
+void trace_publish_end(
+        const uint8_t group )
+{
+    if( (enabled == HOBD_TRACE_ENABLED) && (group < HOBD_TRACE_GROUP_COUNT) )
+    {
+        group_entry_s * const entry = &groups[ group ];
+
+        if( entry->state == STATE_QUEUEING )
+        {
+            entry->queued_count = canbus_get_tx_mark_count();
+
+            canbus_set_tx_mark( CANBUS_TX_MARK_NONE );
+
+            if( entry->queued_count == 0 )
+            {
+                // everything was held back by publish policies, nothing
+                // to trace and the sequence number is reused
+                entry->sequence -= 1;
+                entry->state = STATE_IDLE;
+            }
+            else
+            {
+                entry->state = STATE_QUEUED;
+            }
+        }
+    }
+}
+
+
+//
+uint8_t trace_update( void )
+{
+    uint8_t ret = 0;
+    uint8_t idx = 0;
+    uint32_t done_time = 0;
+
+    if( enabled == HOBD_TRACE_ENABLED )
+    {
+        for( idx = 0; idx < HOBD_TRACE_GROUP_COUNT; idx += 1 )
+        {
+            group_entry_s * const entry = &groups[ idx ];
+
+            if( entry->state == STATE_QUEUED )
+            {
+                disable_interrupt();
+
+                const uint8_t done_count = entry->done_count;
+                done_time = entry->done_time;
+
+                enable_interrupt();
+
+                if( done_count >= entry->queued_count )
+                {
+                    ret |= send_trace( idx, &done_time );
+
+                    entry->state = STATE_IDLE;
+                }
+            }
+        }
+    }
+
+    return ret;
+}
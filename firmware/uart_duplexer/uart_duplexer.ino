@@ -41,6 +41,22 @@
 #define PIN_LED (13)
 
 
+// forward the OBD gateway's queries onto the K-line, needed with
+// OBD_QUERY_ENABLE, leave undefined to only listen, e.g. with another
+// tester attached
+//#define KLINE_TX_ENABLE
+
+
+// K-line wake-up pulse before the OBD gateway's init packets,
+// needs KLINE_TX_ENABLE
+//#define KLINE_WAKEUP_ON_STARTUP
+
+
+// ms
+#define KLINE_WAKEUP_LOW_TIME (70UL)
+#define KLINE_WAKEUP_HIGH_TIME (120UL)
+
+
 
 static bool led_state = false;
 
@@ -63,6 +79,9 @@ static SoftwareSerialWithHalfDuplex obd_serial(
 // static declarations
 // *****************************************************
 
+//
+static void kline_wakeup( void );
+
 
 
 
@@ -70,6 +89,18 @@ static SoftwareSerialWithHalfDuplex obd_serial(
 // static definitions
 // *****************************************************
 
+// pull the K-line low, then release it, before the serial port owns the pin
+static void kline_wakeup( void )
+{
+    pinMode( PIN_KLINE, OUTPUT );
+
+    digitalWrite( PIN_KLINE, LOW );
+    delay( KLINE_WAKEUP_LOW_TIME );
+
+    digitalWrite( PIN_KLINE, HIGH );
+    delay( KLINE_WAKEUP_HIGH_TIME );
+}
+
 
 
 
@@ -89,6 +120,10 @@ void setup( void )
 
     Serial.begin( UART_BAUDRATE );
 
+#if defined(KLINE_TX_ENABLE) && defined(KLINE_WAKEUP_ON_STARTUP)
+    kline_wakeup();
+#endif
+
     obd_serial.begin( OBD_BAUDRATE );
 }
 
@@ -105,4 +140,15 @@ void loop( void )
         led_state = !led_state;
         digitalWrite( PIN_LED, led_state );
     }
+
+#ifdef KLINE_TX_ENABLE
+    // queries from the OBD gateway, half duplex so this blocks reception
+    // for the byte time, the ECU only answers once the query is complete
+    if( Serial.available() != 0 )
+    {
+        const byte tx_byte = (byte) Serial.read();
+
+        obd_serial.write( tx_byte );
+    }
+#endif
 }
@@ -48,6 +48,27 @@ int can_read(
         can_frame_s * const frame );
 
 
+// blocks for up to timeout for the first frame, then reads the frames
+// already received without blocking, up to max_count
+// host timestamps come from one clock sample for the whole batch
+// returns the number of frames read
+unsigned long can_read_batch(
+        const can_handle_s handle,
+        can_frame_s * const frames,
+        const unsigned long max_count,
+        const timestamp_ms timeout );
+
+
+// blocks until the frame is on the bus or the timeout expires
+// returns non-zero on failure
+int can_write(
+        const can_handle_s handle,
+        const unsigned long id,
+        const unsigned long dlc,
+        const unsigned char * const data,
+        const timestamp_ms timeout );
+
+
 //
 can_handle_s can_replay_open(
         const char * const file );
@@ -65,6 +86,26 @@ int can_replay_read(
         can_frame_s * const frame );
 
 
+// native frame log replay, at the recorded rate from start_offset past
+// the first frame
+// ms
+can_handle_s can_log_open(
+        const char * const file,
+        const timestamp_ms start_offset );
+
+
+//
+void can_log_close(
+        const can_handle_s handle );
+
+
+//
+int can_log_read(
+        const can_handle_s handle,
+        const timestamp_ms timeout,
+        can_frame_s * const frame );
+
+
 
 
 #endif /* CAN_H */
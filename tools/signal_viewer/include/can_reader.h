@@ -0,0 +1,133 @@
+/**
+ * @file can_reader.h
+ * @brief TODO.
+ *
+ * CAN ingest thread. Frames from can_read/can_replay_read are pushed into
+ * a lock-free single-producer/single-consumer queue, the render thread
+ * pops them all before each redraw.
+ *
+ * The reader thread is the only user of the CAN handle once started, so
+ * the time sync master runs on it too. When recording, every frame read
+ * is also handed to the frame recorder, including ones dropped from the
+ * queue.
+ *
+ */
+
+
+
+
+#ifndef CAN_READER_H
+#define CAN_READER_H
+
+
+
+
+#include <pthread.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "can.h"
+#include "time_sync_master.h"
+#include "frame_recorder.h"
+
+
+
+
+// frames queued between redraws, must be a power of 2
+// a full 500 kbit bus is ~8 frames per ms
+#define CR_QUEUE_SIZE (4096UL)
+
+
+//
+#define CR_QUEUE_MASK (CR_QUEUE_SIZE - 1)
+
+
+// frame sources
+#define CR_SOURCE_CAN (0)
+#define CR_SOURCE_REPLAY (1)
+#define CR_SOURCE_LOG (2)
+
+
+// most frames taken from the CAN channel per read
+#define CR_READ_BATCH_SIZE (64UL)
+
+
+// longest a read blocks, bounds the time sync and stop latencies
+// ms
+#define CR_READ_TIMEOUT (5ULL)
+
+
+
+
+//
+typedef struct
+{
+    //
+    //
+    can_handle_s handle;
+    //
+    // CR_SOURCE_*
+    unsigned int source;
+    //
+    // act as the time master
+    unsigned int time_sync_enabled;
+    //
+    // only touched by the reader thread
+    tsm_state_s time_sync;
+    //
+    // NULL when not recording
+    fr_state_s *recorder;
+    //
+    //
+    pthread_t thread;
+    //
+    // cleared by cr_stop
+    int running;
+    //
+    // next slot the reader thread writes, only it stores
+    unsigned long head __attribute__((aligned(64)));
+    //
+    // next slot the render thread reads, only it stores
+    unsigned long tail __attribute__((aligned(64)));
+    //
+    // frames read, reader thread
+    unsigned long long rx_count;
+    //
+    // frames dropped on a full queue, reader thread
+    unsigned long long drop_count;
+    //
+    // most frames queued at once, reader thread
+    unsigned long high_water;
+    //
+    //
+    can_frame_s frames[ CR_QUEUE_SIZE ];
+} cr_state_s;
+
+
+
+
+// starts the reader thread on an open handle, recorder may be NULL
+// returns non-zero on failure
+int cr_start(
+        const can_handle_s handle,
+        const unsigned int source,
+        const unsigned int time_sync_enabled,
+        fr_state_s * const recorder,
+        cr_state_s * const state );
+
+
+// stops and joins the reader thread, the handle is left open
+void cr_stop(
+        cr_state_s * const state );
+
+
+// render thread only
+// returns zero if a frame was popped
+int cr_pop(
+        cr_state_s * const state,
+        can_frame_s * const frame );
+
+
+
+
+#endif /* CAN_READER_H */
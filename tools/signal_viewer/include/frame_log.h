@@ -0,0 +1,252 @@
+/**
+ * @file frame_log.h
+ * @brief TODO.
+ *
+ * Native CAN frame log, '.hlog'.
+ *
+ * A header, fixed-size frame records in the order they were received,
+ * then a time index with one entry per FL_INDEX_STRIDE records. The
+ * writer clamps record times so they never decrease, a host clock step
+ * back holds them at the last written time until the clock catches up,
+ * so seeks can binary search the records. The
+ * header is rewritten with the record count and index location when the
+ * writer is closed, a log that was never closed is still readable, its
+ * record count comes from the file size and seeks search all records.
+ *
+ * Host byte order, the magic doubles as the byte order check.
+ *
+ */
+
+
+
+
+#ifndef FRAME_LOG_H
+#define FRAME_LOG_H
+
+
+
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+
+
+
+
+//
+#define FL_MAGIC "HOBDLOG"
+
+
+//
+#define FL_VERSION (1UL)
+
+
+// records per time index entry
+#define FL_INDEX_STRIDE (1024ULL)
+
+
+//
+#define FL_FILE_EXTENSION ".hlog"
+
+
+
+
+// enforce 1 byte alignment, these are the file layouts
+#pragma pack(push)
+#pragma pack(1)
+
+
+//
+typedef struct
+{
+    //
+    // FL_MAGIC
+    char magic[ 8 ];
+    //
+    // FL_VERSION
+    uint32_t version;
+    //
+    // sizeof(fl_record_s)
+    uint32_t record_size;
+    //
+    // zero until the writer is closed
+    uint64_t record_count;
+    //
+    // file offset of the time index, zero until the writer is closed
+    uint64_t index_offset;
+    //
+    //
+    uint64_t index_count;
+    //
+    // FL_INDEX_STRIDE when written
+    uint64_t index_stride;
+    //
+    //
+    uint64_t reserved[ 2 ];
+} fl_header_s;
+
+
+//
+typedef struct
+{
+    //
+    // host time, never less than the previous record's
+    // ms
+    uint64_t rx_timestamp;
+    //
+    // interface time
+    // ms
+    uint64_t native_rx_timestamp;
+    //
+    //
+    uint32_t id;
+    //
+    //
+    uint8_t dlc;
+    //
+    //
+    uint8_t reserved[ 3 ];
+    //
+    //
+    uint8_t data[ 8 ];
+} fl_record_s;
+
+
+//
+typedef struct
+{
+    //
+    // rx_timestamp of the entry's first record
+    // ms
+    uint64_t rx_timestamp;
+    //
+    //
+    uint64_t record;
+} fl_index_entry_s;
+
+
+#pragma pack(pop)
+
+
+
+
+//
+typedef struct
+{
+    //
+    //
+    int fd;
+    //
+    //
+    const unsigned char *map;
+    //
+    //
+    unsigned long long map_size;
+    //
+    //
+    const fl_record_s *records;
+    //
+    //
+    unsigned long long record_count;
+    //
+    // NULL for a log that was never closed
+    const fl_index_entry_s *index;
+    //
+    //
+    unsigned long long index_count;
+    //
+    //
+    unsigned long long index_stride;
+} fl_reader_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    FILE *file;
+    //
+    //
+    unsigned long long record_count;
+    //
+    // grown as records are written
+    fl_index_entry_s *index;
+    //
+    //
+    unsigned long long index_count;
+    //
+    //
+    unsigned long long index_capacity;
+    //
+    // rx_timestamp of the last record written
+    // ms
+    uint64_t last_rx_timestamp;
+} fl_writer_s;
+
+
+
+
+//
+void fl_encode(
+        const can_frame_s * const frame,
+        fl_record_s * const record );
+
+
+// rx_timestamp_mono is left to the caller
+void fl_decode(
+        const fl_record_s * const record,
+        can_frame_s * const frame );
+
+
+// maps the whole log read-only
+// returns non-zero on failure
+int fl_open(
+        const char * const path,
+        fl_reader_s * const reader );
+
+
+//
+void fl_close(
+        fl_reader_s * const reader );
+
+
+// index of the first record at or after rx_timestamp, record_count if
+// there is none, O(log n)
+unsigned long long fl_seek(
+        const fl_reader_s * const reader,
+        const timestamp_ms rx_timestamp );
+
+
+// returns non-zero on failure
+int fl_writer_open(
+        const char * const path,
+        fl_writer_s * const writer );
+
+
+// rx_timestamp of the records is clamped in place, a failed write is
+// dropped whole, the log is left as it was after the last good write
+// returns non-zero on failure
+int fl_writer_write(
+        fl_writer_s * const writer,
+        fl_record_s * const records,
+        const unsigned long count );
+
+
+// pushes buffered records to the file
+// returns non-zero on failure
+int fl_writer_flush(
+        fl_writer_s * const writer );
+
+
+// writes the time index and header
+// returns non-zero on failure
+int fl_writer_close(
+        fl_writer_s * const writer );
+
+
+
+
+#endif /* FRAME_LOG_H */
@@ -0,0 +1,152 @@
+/**
+ * @file frame_recorder.h
+ * @brief TODO.
+ *
+ * Records received CAN frames to a native frame log, see frame_log.h.
+ *
+ * The CAN reader thread encodes frames into one of two record blocks, a
+ * block is handed to a writer thread once it is full or FR_FLUSH_INTERVAL
+ * old and the reader carries on in the other one. The reader never waits
+ * on the file, if the writer still owns the other block the frame is
+ * dropped and counted.
+ *
+ */
+
+
+
+
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+
+
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+
+
+
+
+// records per block
+// a full 500 kbit bus is ~8 frames per ms, ~2 s of frames
+#define FR_BLOCK_SIZE (16384UL)
+
+
+// longest a partial block waits before it is handed to the writer
+// ms
+#define FR_FLUSH_INTERVAL (200ULL)
+
+
+
+
+//
+typedef struct
+{
+    //
+    //
+    unsigned long long frame_count;
+    //
+    // frames not in the log, reader drops plus failed writes
+    unsigned long long drop_count;
+    //
+    // receive to on disk time of the oldest frame in the last block
+    // ms
+    timestamp_ms latency;
+    //
+    // ms
+    timestamp_ms max_latency;
+} fr_status_s;
+
+
+//
+typedef struct
+{
+    //
+    // only touched by the writer thread once started
+    fl_writer_s writer;
+    //
+    //
+    pthread_t thread;
+    //
+    // posted for each block handed to the writer
+    sem_t block_ready;
+    //
+    // cleared by fr_stop
+    int running;
+    //
+    // block the reader fills, reader thread
+    unsigned long active;
+    //
+    // set by the reader to hand a block to the writer, cleared by the
+    // writer to hand it back, the block and its count/start go with it
+    int block_busy[ 2 ];
+    //
+    //
+    unsigned long block_count[ 2 ];
+    //
+    // rx_timestamp_mono of each block's first frame
+    // ms
+    timestamp_ms block_start[ 2 ];
+    //
+    // frames taken into a block, reader thread
+    unsigned long long frame_count;
+    //
+    // frames dropped on a busy block, reader thread
+    unsigned long long drop_count;
+    //
+    // frames lost to failed writes, writer thread
+    unsigned long long write_drop_count;
+    //
+    // writer thread
+    // ms
+    timestamp_ms latency;
+    //
+    // writer thread
+    // ms
+    timestamp_ms max_latency;
+    //
+    //
+    fl_record_s blocks[ 2 ][ FR_BLOCK_SIZE ];
+} fr_state_s;
+
+
+
+
+// creates the log and starts the writer thread
+// returns non-zero on failure
+int fr_start(
+        const char * const path,
+        fr_state_s * const state );
+
+
+// writes the remaining frames, stops the writer thread and closes the log,
+// the reader thread must be stopped first
+void fr_stop(
+        fr_state_s * const state );
+
+
+// reader thread only, never blocks
+void fr_push(
+        const can_frame_s * const frame,
+        fr_state_s * const state );
+
+
+// reader thread only, hands over a partial block once it is
+// FR_FLUSH_INTERVAL old
+void fr_poll(
+        fr_state_s * const state );
+
+
+// any thread
+void fr_get_status(
+        const fr_state_s * const state,
+        fr_status_s * const status );
+
+
+
+
+#endif /* FRAME_RECORDER_H */
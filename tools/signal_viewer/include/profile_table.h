@@ -0,0 +1,114 @@
+/**
+ * @file profile_table.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef PROFILE_TABLE_H
+#define PROFILE_TABLE_H
+
+
+
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "signal_table_def.h"
+
+
+
+
+//
+#define PT_NODE_OBD_GATEWAY (0UL)
+#define PT_NODE_IMU_GATEWAY (1UL)
+#define PT_NODE_COUNT (2UL)
+
+
+
+
+//
+typedef struct
+{
+    //
+    // zero until a summary frame is received
+    timestamp_ms rx_time;
+    //
+    // last interval
+    hobd_profile_s profile;
+    //
+    // last interval
+    hobd_profile_hist_s hist;
+    //
+    // histogram frames accumulated in hist_sum
+    unsigned long long hist_count;
+    //
+    // bin shares summed over all received histogram frames
+    unsigned long long hist_sum[ HOBD_PROFILE_HIST_BIN_COUNT ];
+} pt_stage_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    unsigned long node_id;
+    //
+    //
+    char name[ 64 ];
+    //
+    //
+    pt_stage_s stages[ HOBD_PROFILE_STAGE_COUNT ];
+} pt_node_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    pt_node_s nodes[ PT_NODE_COUNT ];
+} pt_state_s;
+
+
+
+
+//
+void pt_init(
+        pt_state_s * const state );
+
+
+// consumes the profile and profile histogram frames of known nodes,
+// other frames are ignored
+void pt_process_can_frame(
+        const can_frame_s * const can_frame,
+        pt_state_s * const state );
+
+
+//
+const char *pt_get_stage_name(
+        const unsigned long stage );
+
+
+// share of the samples in the bin over the whole run, 0 to 1
+double pt_get_hist_share(
+        const pt_stage_s * const stage,
+        const unsigned long bin );
+
+
+// upper edge of the bin, the last bin has none
+// microseconds
+double pt_get_bin_edge_us(
+        const unsigned long bin );
+
+
+//
+double pt_ticks_to_us(
+        const unsigned long ticks );
+
+
+
+
+#endif /* PROFILE_TABLE_H */
@@ -17,6 +17,9 @@
 #include "can_frame.h"
 #include "config.h"
 #include "signal_table_def.h"
+#include "profile_table.h"
+#include "trace_table.h"
+#include "frame_recorder.h"
 
 
 
@@ -25,13 +28,32 @@
 #define ST_SIGNAL_COUNT (39UL)
 
 
+// most full encoding frames a compact IMU frame expands into
+#define ST_IMU_COMPACT_EXPAND_MAX (2UL)
+
+
+// size of the CAN ID map, one entry per standard 11-bit CAN ID
+#define ST_CAN_ID_COUNT (2048UL)
+
+
+// CAN ID map entries that are not a signal table index
+// no table and not decoded elsewhere, counted as unknown
+#define ST_CAN_ID_UNKNOWN (ST_SIGNAL_COUNT)
+// decoded outside the signal tables
+#define ST_CAN_ID_DECODED (ST_SIGNAL_COUNT + 1UL)
+// HOBD frame the viewer neither tables nor decodes
+#define ST_CAN_ID_KNOWN (ST_SIGNAL_COUNT + 2UL)
+
+
 //
 #define ST_PAGE_1 (0LU)
 #define ST_PAGE_2 (1UL)
 #define ST_PAGE_3 (2UL)
 #define ST_PAGE_4 (3UL)
 #define ST_PAGE_5 (4UL)
-#define ST_PAGE_COUNT (5UL)
+#define ST_PAGE_6 (5UL)
+#define ST_PAGE_7 (6UL)
+#define ST_PAGE_COUNT (7UL)
 
 
 
@@ -48,6 +70,28 @@ typedef struct
     //
     //
     signal_table_s signal_tables[ ST_SIGNAL_COUNT ];
+    //
+    // signal table index of each CAN ID, or ST_CAN_ID_UNKNOWN/ST_CAN_ID_DECODED/
+    // ST_CAN_ID_KNOWN, built by st_init
+    unsigned char can_id_map[ ST_CAN_ID_COUNT ];
+    //
+    // frames with an unknown CAN ID, including extended IDs
+    unsigned long long unknown_frame_count;
+    //
+    // CAN ID of the last unknown frame
+    unsigned long unknown_can_id;
+    //
+    // gateway main loop profiles, not a single frame per CAN ID
+    pt_state_s profile;
+    //
+    // gateway publish group latencies, not a single frame per CAN ID
+    tt_state_s trace;
+    //
+    // non-zero when frames are being recorded
+    unsigned int record_enabled;
+    //
+    // recorder counters, copied in by the main loop
+    fr_status_s record_status;
 } st_state_s;
 
 
@@ -64,12 +64,21 @@ typedef struct
         hobd_heartbeat_s heartbeat_imu_gateway;
         //
         //
+        hobd_time_sync_s time_sync_obd_gateway;
+        //
+        //
+        hobd_time_sync_s time_sync_imu_gateway;
+        //
+        //
         hobd_gps_time1_s gps_time1;
         //
         //
         hobd_gps_time2_s gps_time2;
         //
         //
+        hobd_gps_time_us_s gps_time_us;
+        //
+        //
         hobd_gps_dop1_s gps_dop1;
         //
         //
@@ -115,6 +124,9 @@ typedef struct
         hobd_imu_sample_time_s imu_sample_time;
         //
         //
+        hobd_imu_time_us_s imu_time_us;
+        //
+        //
         hobd_imu_time1_s imu_time1;
         //
         //
@@ -166,6 +178,9 @@ typedef struct
         hobd_obd_time_s obd_time;
         //
         //
+        hobd_obd_time_us_s obd_time_us;
+        //
+        //
         hobd_obd1_s obd1;
         //
         //
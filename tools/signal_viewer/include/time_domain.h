@@ -22,6 +22,10 @@
 typedef unsigned long long timestamp_ms;
 
 
+//
+typedef unsigned long long timestamp_us;
+
+
 
 
 /**
@@ -45,6 +49,13 @@ typedef unsigned long long timestamp_ms;
 #define NANO_TO_MILLI(time) (time / 1000000ULL)
 
 
+/**
+ * @brief Convert nanoseconds to microseconds. [unsigned long long]
+ *
+ */
+#define NANO_TO_MICRO(time) (time / 1000ULL)
+
+
 //
 #define DAY_SUNDAY (0)
 #define DAY_MONDAY (1)
@@ -72,6 +83,10 @@ timestamp_ms time_get_timestamp( void );
 timestamp_ms time_get_monotonic_timestamp( void );
 
 
+//
+timestamp_us time_get_monotonic_timestamp_us( void );
+
+
 //
 timestamp_ms time_get_since(
         const timestamp_ms const value );
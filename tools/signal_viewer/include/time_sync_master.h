@@ -0,0 +1,62 @@
+/**
+ * @file time_sync_master.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef TIME_SYNC_MASTER_H
+#define TIME_SYNC_MASTER_H
+
+
+
+
+#include "time_domain.h"
+#include "can.h"
+
+
+
+
+// time allowed for each sync frame to get on the bus
+#define TSM_TX_TIMEOUT (10ULL)
+
+
+
+
+//
+typedef struct
+{
+    //
+    // monotonic
+    timestamp_ms next_sync;
+    //
+    //
+    unsigned short sequence;
+    //
+    // sync/follow-up pairs sent
+    unsigned long long sync_count;
+    //
+    // pairs abandoned on a failed write
+    unsigned long long error_count;
+} tsm_state_s;
+
+
+
+
+//
+void tsm_init(
+        tsm_state_s * const state );
+
+
+// sends the next sync/follow-up pair once HOBD_CAN_TX_INTERVAL_TIME_SYNC
+// has passed, blocks for at most twice TSM_TX_TIMEOUT
+void tsm_update(
+        const can_handle_s handle,
+        tsm_state_s * const state );
+
+
+
+
+#endif /* TIME_SYNC_MASTER_H */
@@ -0,0 +1,144 @@
+/**
+ * @file trace_table.h
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#ifndef TRACE_TABLE_H
+#define TRACE_TABLE_H
+
+
+
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "signal_table_def.h"
+
+
+
+
+//
+#define TT_NODE_OBD_GATEWAY (0UL)
+#define TT_NODE_IMU_GATEWAY (1UL)
+#define TT_NODE_COUNT (2UL)
+
+
+// trace frames kept per group for the percentiles
+#define TT_WINDOW_SIZE (1024UL)
+
+
+//
+#define TT_LATENCY_PARSE (0UL)
+#define TT_LATENCY_QUEUE (1UL)
+#define TT_LATENCY_TX (2UL)
+#define TT_LATENCY_TOTAL (3UL)
+#define TT_LATENCY_COUNT (4UL)
+
+
+
+
+//
+typedef struct
+{
+    //
+    // microseconds
+    double p50;
+    //
+    // microseconds
+    double p90;
+    //
+    // microseconds
+    double p99;
+    //
+    // microseconds
+    double max;
+} tt_percentiles_s;
+
+
+//
+typedef struct
+{
+    //
+    // zero until a trace frame is received
+    timestamp_ms rx_time;
+    //
+    // last frame
+    hobd_trace_s trace;
+    //
+    // trace frames received
+    unsigned long long trace_count;
+    //
+    // traces missing from the sequence numbers
+    unsigned long long lost_count;
+    //
+    // samples held in the window
+    unsigned long sample_count;
+    //
+    // next sample to overwrite
+    unsigned long next_sample;
+    //
+    // microseconds
+    unsigned long samples[ TT_LATENCY_COUNT ][ TT_WINDOW_SIZE ];
+} tt_group_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    unsigned long node_id;
+    //
+    //
+    char name[ 64 ];
+    //
+    //
+    tt_group_s groups[ HOBD_TRACE_GROUP_COUNT ];
+} tt_node_s;
+
+
+//
+typedef struct
+{
+    //
+    //
+    tt_node_s nodes[ TT_NODE_COUNT ];
+} tt_state_s;
+
+
+
+
+//
+void tt_init(
+        tt_state_s * const state );
+
+
+// consumes the trace frames of known nodes, other frames are ignored
+void tt_process_can_frame(
+        const can_frame_s * const can_frame,
+        tt_state_s * const state );
+
+
+//
+const char *tt_get_group_name(
+        const unsigned long group );
+
+
+//
+const char *tt_get_latency_name(
+        const unsigned long latency );
+
+
+// nearest rank percentiles over the window, zero without samples
+void tt_get_percentiles(
+        const tt_group_s * const group,
+        const unsigned long latency,
+        tt_percentiles_s * const percentiles );
+
+
+
+
+#endif /* TRACE_TABLE_H */
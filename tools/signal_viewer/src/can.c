@@ -13,6 +13,7 @@
 #include <unistd.h>
 
 #include "canlib.h"
+#include "math_util.h"
 #include "time_domain.h"
 #include "can_frame.h"
 #include "can.h"
@@ -24,6 +25,9 @@
 // static global types/macros
 // *****************************************************
 
+// canlib timestamps are 32 bits of ms, the default timer resolution
+#define TSTAMP_MASK (0xFFFFFFFFULL)
+
 
 
 
@@ -38,6 +42,12 @@
 // static declarations
 // *****************************************************
 
+//
+static canStatus read_frame(
+        const canHandle handle,
+        const timestamp_ms timeout,
+        can_frame_s * const frame );
+
 
 
 
@@ -45,6 +55,53 @@
 // static definitions
 // *****************************************************
 
+// zero timeout returns immediately, the host timestamps are left to the
+// caller
+static canStatus read_frame(
+        const canHandle handle,
+        const timestamp_ms timeout,
+        can_frame_s * const frame )
+{
+    canStatus can_stat = canOK;
+    long msg_id = 0;
+    unsigned int msg_dlc = 0;
+    unsigned int msg_flag = 0;
+    unsigned long tstamp = 0;
+
+    if( timeout == 0 )
+    {
+        // returns immediately
+        can_stat = canRead(
+                handle,
+                &msg_id,
+                (void*) frame->data,
+                &msg_dlc,
+                &msg_flag,
+                &tstamp );
+    }
+    else
+    {
+        // read with timeout
+        can_stat = canReadWait(
+                handle,
+                &msg_id,
+                (void*) frame->data,
+                &msg_dlc,
+                &msg_flag,
+                &tstamp,
+                (unsigned long) timeout );
+    }
+
+    if( can_stat == canOK )
+    {
+        frame->native_rx_timestamp = (timestamp_ms) tstamp;
+        frame->id = (unsigned long) msg_id;
+        frame->dlc  = (unsigned long) msg_dlc;
+    }
+
+    return can_stat;
+}
+
 
 
 
@@ -131,44 +188,112 @@ int can_read(
 
     if( handle >= 0 )
     {
-        canStatus can_stat = canOK;
-        long msg_id = 0;
-        unsigned int msg_dlc = 0;
-        unsigned int msg_flag = 0;
-        unsigned long tstamp = 0;
+        const canStatus can_stat = read_frame(
+                (canHandle) handle,
+                timeout,
+                frame );
 
-        if( timeout == 0 )
+        if( can_stat == canOK )
         {
-            // returns immediately
-            can_stat = canRead(
-                    (canHandle) handle,
-                    &msg_id,
-                    (void*) frame->data,
-                    &msg_dlc,
-                    &msg_flag,
-                    &tstamp );
+            frame->rx_timestamp = time_get_timestamp();
+            frame->rx_timestamp_mono = time_get_monotonic_timestamp();
+
+            ret = 0;
         }
-        else
+    }
+
+    return ret;
+}
+
+
+//
+unsigned long can_read_batch(
+        const can_handle_s handle,
+        can_frame_s * const frames,
+        const unsigned long max_count,
+        const timestamp_ms timeout )
+{
+    unsigned long count = 0;
+
+    if( (handle >= 0) && (max_count != 0) )
+    {
+        // only the first read blocks
+        canStatus can_stat = read_frame(
+                (canHandle) handle,
+                timeout,
+                &frames[ 0 ] );
+
+        while( can_stat == canOK )
+        {
+            count += 1;
+
+            if( count < max_count )
+            {
+                can_stat = read_frame(
+                        (canHandle) handle,
+                        0,
+                        &frames[ count ] );
+            }
+            else
+            {
+                can_stat = canERR_NOMSG;
+            }
+        }
+
+        if( count != 0 )
+        {
+            // one host clock sample for the batch, taken after the last
+            // frame, each frame is back-dated by its hardware timestamp
+            // distance to the last one
+            const timestamp_ms rx_timestamp = time_get_timestamp();
+            const timestamp_ms rx_timestamp_mono = time_get_monotonic_timestamp();
+            const timestamp_ms last_tstamp = frames[ count - 1 ].native_rx_timestamp;
+
+            unsigned long idx = 0;
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                const timestamp_ms age = m_min(
+                        ((last_tstamp - frames[ idx ].native_rx_timestamp) & TSTAMP_MASK),
+                        rx_timestamp_mono );
+
+                frames[ idx ].rx_timestamp = (rx_timestamp - age);
+                frames[ idx ].rx_timestamp_mono = (rx_timestamp_mono - age);
+            }
+        }
+    }
+
+    return count;
+}
+
+
+//
+int can_write(
+        const can_handle_s handle,
+        const unsigned long id,
+        const unsigned long dlc,
+        const unsigned char * const data,
+        const timestamp_ms timeout )
+{
+    int ret = 1;
+
+    if( handle >= 0 )
+    {
+        canStatus can_stat = canWrite(
+                (canHandle) handle,
+                (long) id,
+                (void*) data,
+                (unsigned int) dlc,
+                0 );
+
+        if( can_stat == canOK )
         {
-            // read with timeout
-            can_stat = canReadWait(
+            can_stat = canWriteSync(
                     (canHandle) handle,
-                    &msg_id,
-                    (void*) frame->data,
-                    &msg_dlc,
-                    &msg_flag,
-                    &tstamp,
                     (unsigned long) timeout );
         }
 
         if( can_stat == canOK )
         {
-            frame->rx_timestamp = time_get_timestamp();
-            frame->rx_timestamp_mono = time_get_monotonic_timestamp();
-            frame->native_rx_timestamp = (timestamp_ms) tstamp;
-            frame->id = (unsigned long) msg_id;
-            frame->dlc  = (unsigned long) msg_dlc;
-
             ret = 0;
         }
     }
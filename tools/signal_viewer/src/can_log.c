@@ -0,0 +1,187 @@
+/**
+ * @file can_log.c
+ * @brief TODO.
+ *
+ * Replays a native frame log, see frame_log.h, at the rate it was
+ * recorded.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "math_util.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+#include "can.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static fl_reader_s reader;
+
+
+// next record to replay
+static unsigned long long next_record = 0;
+
+
+// recorded host time of the first replayed record
+// ms
+static timestamp_ms log_start = 0;
+
+
+// monotonic
+static timestamp_ms replay_start = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static timestamp_ms get_time_until_due(
+        const fl_record_s * const record );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// records from before a host clock step back are due at once
+static timestamp_ms get_time_until_due(
+        const fl_record_s * const record )
+{
+    timestamp_ms wait = 0;
+
+    const timestamp_ms elapsed = time_get_since_monotonic( replay_start );
+
+    if( (timestamp_ms) record->rx_timestamp > log_start )
+    {
+        const timestamp_ms due = ((timestamp_ms) record->rx_timestamp - log_start);
+
+        if( due > elapsed )
+        {
+            wait = (due - elapsed);
+        }
+    }
+
+    return wait;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+can_handle_s can_log_open(
+        const char * const file,
+        const timestamp_ms start_offset )
+{
+    can_handle_s handle = CAN_HANDLE_INVALID;
+
+    if( fl_open( file, &reader ) == 0 )
+    {
+        next_record = 0;
+
+        if( (start_offset != 0) && (reader.record_count != 0) )
+        {
+            next_record = fl_seek(
+                    &reader,
+                    (timestamp_ms) reader.records[ 0 ].rx_timestamp + start_offset );
+        }
+
+        if( next_record < reader.record_count )
+        {
+            log_start = (timestamp_ms) reader.records[ next_record ].rx_timestamp;
+        }
+
+        printf(
+                "log has %llu frames, replaying from frame %llu\n",
+                reader.record_count,
+                next_record );
+
+        replay_start = time_get_monotonic_timestamp();
+
+        handle = 1;
+    }
+
+    return handle;
+}
+
+
+//
+void can_log_close(
+        const can_handle_s handle )
+{
+    if( handle != CAN_HANDLE_INVALID )
+    {
+        fl_close( &reader );
+    }
+}
+
+
+//
+int can_log_read(
+        const can_handle_s handle,
+        const timestamp_ms timeout,
+        can_frame_s * const frame )
+{
+    int ret = 1;
+
+    if( (handle != CAN_HANDLE_INVALID) && (next_record < reader.record_count) )
+    {
+        const fl_record_s * const record = &reader.records[ next_record ];
+
+        timestamp_ms wait = get_time_until_due( record );
+
+        if( (wait != 0) && (timeout != 0) )
+        {
+            time_sleep_ms( m_min( wait, timeout ) );
+
+            wait = get_time_until_due( record );
+        }
+
+        if( wait == 0 )
+        {
+            fl_decode( record, frame );
+
+            frame->rx_timestamp_mono = time_get_monotonic_timestamp();
+
+            next_record += 1;
+
+            ret = 0;
+        }
+    }
+    else if( timeout != 0 )
+    {
+        // end of the log
+        time_sleep_ms( timeout );
+    }
+
+    return ret;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file can_reader.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "can.h"
+#include "time_sync_master.h"
+#include "frame_recorder.h"
+#include "can_reader.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void push_frame(
+        const can_frame_s * const frame,
+        cr_state_s * const state );
+
+
+//
+static void *reader_thread(
+        void *user_data );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// a full queue drops the new frame, the render thread owns the queued ones
+static void push_frame(
+        const can_frame_s * const frame,
+        cr_state_s * const state )
+{
+    const unsigned long head = state->head;
+    const unsigned long tail = __atomic_load_n( &state->tail, __ATOMIC_ACQUIRE );
+    const unsigned long count = (head - tail);
+
+    if( count >= CR_QUEUE_SIZE )
+    {
+        state->drop_count += 1;
+    }
+    else
+    {
+        state->frames[ head & CR_QUEUE_MASK ] = *frame;
+
+        // publish the frame
+        __atomic_store_n( &state->head, (head + 1), __ATOMIC_RELEASE );
+
+        if( (count + 1) > state->high_water )
+        {
+            state->high_water = (count + 1);
+        }
+    }
+}
+
+
+//
+static void *reader_thread(
+        void *user_data )
+{
+    cr_state_s * const state = (cr_state_s*) user_data;
+    sigset_t sig_set;
+
+    // control-c is for the main thread
+    (void) sigemptyset( &sig_set );
+    (void) sigaddset( &sig_set, SIGINT );
+    (void) pthread_sigmask( SIG_BLOCK, &sig_set, NULL );
+
+    while( __atomic_load_n( &state->running, __ATOMIC_ACQUIRE ) != 0 )
+    {
+        can_frame_s rx_frames[ CR_READ_BATCH_SIZE ];
+        unsigned long rx_count = 0;
+        unsigned long idx = 0;
+
+        if( state->time_sync_enabled != 0 )
+        {
+            tsm_update( state->handle, &state->time_sync );
+        }
+
+        if( state->source == CR_SOURCE_CAN )
+        {
+            rx_count = can_read_batch(
+                    state->handle,
+                    rx_frames,
+                    CR_READ_BATCH_SIZE,
+                    CR_READ_TIMEOUT );
+        }
+        else if( state->source == CR_SOURCE_LOG )
+        {
+            if( can_log_read( state->handle, CR_READ_TIMEOUT, &rx_frames[ 0 ] ) == 0 )
+            {
+                rx_count = 1;
+            }
+        }
+        else if( can_replay_read( state->handle, CR_READ_TIMEOUT, &rx_frames[ 0 ] ) == 0 )
+        {
+            rx_count = 1;
+        }
+
+        state->rx_count += rx_count;
+
+        for( idx = 0; idx < rx_count; idx += 1 )
+        {
+            push_frame( &rx_frames[ idx ], state );
+        }
+
+        if( state->recorder != NULL )
+        {
+            for( idx = 0; idx < rx_count; idx += 1 )
+            {
+                fr_push( &rx_frames[ idx ], state->recorder );
+            }
+
+            fr_poll( state->recorder );
+        }
+    }
+
+    return NULL;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+int cr_start(
+        const can_handle_s handle,
+        const unsigned int source,
+        const unsigned int time_sync_enabled,
+        fr_state_s * const recorder,
+        cr_state_s * const state )
+{
+    int ret = 0;
+
+    state->handle = handle;
+    state->source = source;
+    state->time_sync_enabled = time_sync_enabled;
+    state->recorder = recorder;
+    state->head = 0;
+    state->tail = 0;
+    state->rx_count = 0;
+    state->drop_count = 0;
+    state->high_water = 0;
+
+    tsm_init( &state->time_sync );
+
+    __atomic_store_n( &state->running, 1, __ATOMIC_RELEASE );
+
+    ret = pthread_create(
+            &state->thread,
+            NULL,
+            &reader_thread,
+            (void*) state );
+
+    if( ret != 0 )
+    {
+        printf( "failed to create CAN reader thread\n" );
+
+        __atomic_store_n( &state->running, 0, __ATOMIC_RELEASE );
+    }
+
+    return ret;
+}
+
+
+//
+void cr_stop(
+        cr_state_s * const state )
+{
+    if( __atomic_load_n( &state->running, __ATOMIC_ACQUIRE ) != 0 )
+    {
+        __atomic_store_n( &state->running, 0, __ATOMIC_RELEASE );
+
+        (void) pthread_join( state->thread, NULL );
+    }
+}
+
+
+//
+int cr_pop(
+        cr_state_s * const state,
+        can_frame_s * const frame )
+{
+    int ret = 1;
+
+    const unsigned long tail = state->tail;
+    const unsigned long head = __atomic_load_n( &state->head, __ATOMIC_ACQUIRE );
+
+    if( head != tail )
+    {
+        (*frame) = state->frames[ tail & CR_QUEUE_MASK ];
+
+        // hand the slot back to the reader thread
+        __atomic_store_n( &state->tail, (tail + 1), __ATOMIC_RELEASE );
+
+        ret = 0;
+    }
+
+    return ret;
+}
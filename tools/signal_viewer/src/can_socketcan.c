@@ -0,0 +1,470 @@
+/**
+ * @file can_socketcan.c
+ * @brief TODO.
+ *
+ * SocketCAN implementation of the can.h channel interface, built instead
+ * of can.c with 'make CAN_BACKEND=socketcan'.
+ *
+ * The channel system ID selects the interface, can<id> by default, the
+ * HOBD_CAN_IF_PREFIX environment variable replaces the 'can' prefix,
+ * so 'HOBD_CAN_IF_PREFIX=vcan hobd-signal-viewer 0' opens vcan0.
+ *
+ * Only standard data frames in the HOBD ID blocks pass the kernel
+ * filters. Frames are read with recvmmsg, native_rx_timestamp is the
+ * SO_TIMESTAMPING hardware timestamp when the interface provides one,
+ * the kernel software timestamp otherwise.
+ *
+ */
+
+
+
+
+// recvmmsg
+#define _GNU_SOURCE
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#include "hobd.h"
+#include "math_util.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "can.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// environment variable replacing the interface name prefix
+#define IF_PREFIX_ENV "HOBD_CAN_IF_PREFIX"
+
+
+//
+#define IF_PREFIX_DEFAULT "can"
+
+
+// most frames taken per recvmmsg call
+#define BATCH_MAX (64UL)
+
+
+// HOBD IDs are allocated in blocks of 16
+#define ID_BLOCK_MASK (0x7F0UL)
+
+
+// room for the SCM_TIMESTAMPING control message
+#define CMSG_BUFFER_SIZE (CMSG_SPACE(sizeof(struct scm_timestamping)))
+
+
+// index of the raw hardware time in scm_timestamping.ts
+#define TS_INDEX_SOFTWARE (0)
+#define TS_INDEX_HARDWARE (2)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+// first ID of each block in use
+static const unsigned long HOBD_ID_BLOCKS[] =
+{
+    HOBD_CAN_ID_HEARTBEAT_BASE,
+    HOBD_CAN_ID_COMMAND,
+    HOBD_CAN_ID_RX_STATS_BASE,
+    HOBD_CAN_ID_GPS_TIME1,
+    HOBD_CAN_ID_GPS_TIME_US,
+    HOBD_CAN_ID_IMU_SAMPLE_TIME,
+    HOBD_CAN_ID_IMU_MAGF2,
+    HOBD_CAN_ID_OBD_TIME,
+    HOBD_CAN_ID_PUBLISH_STATS_BASE,
+    HOBD_CAN_ID_PROFILE_BASE,
+    HOBD_CAN_ID_PROFILE_HIST_BASE,
+    HOBD_CAN_ID_TRACE_BASE,
+    HOBD_CAN_ID_TIME_SYNC_BASE
+};
+
+
+// receive buffers, channel reads all happen on the CAN reader thread
+static struct can_frame rx_frames[ BATCH_MAX ];
+static struct iovec rx_iovecs[ BATCH_MAX ];
+static struct mmsghdr rx_msgs[ BATCH_MAX ];
+static unsigned char rx_cmsgs[ BATCH_MAX ][ CMSG_BUFFER_SIZE ];
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static int set_filters(
+        const int sock );
+
+
+//
+static int set_timestamping(
+        const int sock );
+
+
+//
+static timestamp_ms get_native_timestamp(
+        struct msghdr * const msg );
+
+
+//
+static int wait_for(
+        const int sock,
+        const short events,
+        const timestamp_ms timeout );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// standard data frames in the HOBD ID blocks
+static int set_filters(
+        const int sock )
+{
+    struct can_filter filters[ sizeof(HOBD_ID_BLOCKS) / sizeof(HOBD_ID_BLOCKS[0]) ];
+    unsigned long idx = 0;
+
+    for( idx = 0; idx < (sizeof(HOBD_ID_BLOCKS) / sizeof(HOBD_ID_BLOCKS[0])); idx += 1 )
+    {
+        filters[ idx ].can_id = (canid_t) (HOBD_ID_BLOCKS[ idx ] & ID_BLOCK_MASK);
+        filters[ idx ].can_mask = (canid_t) (ID_BLOCK_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG);
+    }
+
+    return setsockopt(
+            sock,
+            SOL_CAN_RAW,
+            CAN_RAW_FILTER,
+            filters,
+            (socklen_t) sizeof(filters) );
+}
+
+
+// hardware timestamps are only reported by interfaces that have them
+static int set_timestamping(
+        const int sock )
+{
+    const int flags =
+            SOF_TIMESTAMPING_RX_HARDWARE
+            | SOF_TIMESTAMPING_RAW_HARDWARE
+            | SOF_TIMESTAMPING_RX_SOFTWARE
+            | SOF_TIMESTAMPING_SOFTWARE;
+
+    return setsockopt(
+            sock,
+            SOL_SOCKET,
+            SO_TIMESTAMPING,
+            &flags,
+            (socklen_t) sizeof(flags) );
+}
+
+
+// zero if the frame carried no timestamp
+static timestamp_ms get_native_timestamp(
+        struct msghdr * const msg )
+{
+    timestamp_ms timestamp = 0;
+    struct cmsghdr *cmsg = NULL;
+
+    for( cmsg = CMSG_FIRSTHDR( msg ); cmsg != NULL; cmsg = CMSG_NXTHDR( msg, cmsg ) )
+    {
+        if( (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPING) )
+        {
+            struct scm_timestamping stamps;
+
+            memcpy( &stamps, CMSG_DATA( cmsg ), sizeof(stamps) );
+
+            const struct timespec * const ts =
+                    ((stamps.ts[ TS_INDEX_HARDWARE ].tv_sec != 0) || (stamps.ts[ TS_INDEX_HARDWARE ].tv_nsec != 0))
+                    ? &stamps.ts[ TS_INDEX_HARDWARE ]
+                    : &stamps.ts[ TS_INDEX_SOFTWARE ];
+
+            timestamp = ((timestamp_ms) ts->tv_sec * 1000ULL) + ((timestamp_ms) ts->tv_nsec / 1000000ULL);
+        }
+    }
+
+    return timestamp;
+}
+
+
+// returns non-zero on timeout or failure
+static int wait_for(
+        const int sock,
+        const short events,
+        const timestamp_ms timeout )
+{
+    int ret = 1;
+    struct pollfd pfd;
+
+    pfd.fd = sock;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    if( poll( &pfd, 1, (int) timeout ) > 0 )
+    {
+        if( (pfd.revents & events) != 0 )
+        {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+can_handle_s can_open(
+        const unsigned long system_id )
+{
+    int sock = CAN_HANDLE_INVALID;
+    struct sockaddr_can addr;
+    char if_name[ IF_NAMESIZE ];
+    const char *if_prefix = getenv( IF_PREFIX_ENV );
+
+    if( if_prefix == NULL )
+    {
+        if_prefix = IF_PREFIX_DEFAULT;
+    }
+
+    snprintf(
+            if_name,
+            sizeof(if_name),
+            "%s%lu",
+            if_prefix,
+            system_id );
+
+    memset( &addr, 0, sizeof(addr) );
+
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = (int) if_nametoindex( if_name );
+
+    if( addr.can_ifindex == 0 )
+    {
+        printf( "failed to find CAN interface '%s'\n", if_name );
+    }
+    else
+    {
+        sock = socket( PF_CAN, SOCK_RAW, CAN_RAW );
+
+        if( sock < 0 )
+        {
+            printf( "failed to open CAN socket\n" );
+            sock = CAN_HANDLE_INVALID;
+        }
+    }
+
+    if( sock >= 0 )
+    {
+        if( set_filters( sock ) != 0 )
+        {
+            printf( "failed to set CAN filters\n" );
+            (void) close( sock );
+            sock = CAN_HANDLE_INVALID;
+        }
+    }
+
+    if( sock >= 0 )
+    {
+        // falls back to host receive timestamps
+        if( set_timestamping( sock ) != 0 )
+        {
+            printf( "failed to enable CAN timestamping on '%s'\n", if_name );
+        }
+
+        if( bind( sock, (struct sockaddr*) &addr, sizeof(addr) ) != 0 )
+        {
+            printf( "failed to bind CAN interface '%s'\n", if_name );
+            (void) close( sock );
+            sock = CAN_HANDLE_INVALID;
+        }
+    }
+
+    return (can_handle_s) sock;
+}
+
+
+//
+void can_close(
+        const can_handle_s handle )
+{
+    if( handle >= 0 )
+    {
+        (void) close( handle );
+    }
+}
+
+
+//
+int can_read(
+        const can_handle_s handle,
+        const timestamp_ms timeout,
+        can_frame_s * const frame )
+{
+    int ret = 1;
+
+    if( can_read_batch( handle, frame, 1, timeout ) == 1 )
+    {
+        ret = 0;
+    }
+
+    return ret;
+}
+
+
+// recvmmsg only checks its own timeout between datagrams, the wait for
+// the first frame is a poll
+unsigned long can_read_batch(
+        const can_handle_s handle,
+        can_frame_s * const frames,
+        const unsigned long max_count,
+        const timestamp_ms timeout )
+{
+    unsigned long count = 0;
+    int rx_count = 0;
+
+    const unsigned long batch_count = m_min( max_count, BATCH_MAX );
+
+    if( (handle >= 0) && (batch_count != 0) )
+    {
+        if( (timeout == 0) || (wait_for( handle, POLLIN, timeout ) == 0) )
+        {
+            unsigned long idx = 0;
+
+            for( idx = 0; idx < batch_count; idx += 1 )
+            {
+                rx_iovecs[ idx ].iov_base = &rx_frames[ idx ];
+                rx_iovecs[ idx ].iov_len = sizeof(rx_frames[ idx ]);
+
+                memset( &rx_msgs[ idx ], 0, sizeof(rx_msgs[ idx ]) );
+                rx_msgs[ idx ].msg_hdr.msg_iov = &rx_iovecs[ idx ];
+                rx_msgs[ idx ].msg_hdr.msg_iovlen = 1;
+                rx_msgs[ idx ].msg_hdr.msg_control = rx_cmsgs[ idx ];
+                rx_msgs[ idx ].msg_hdr.msg_controllen = sizeof(rx_cmsgs[ idx ]);
+            }
+
+            rx_count = recvmmsg(
+                    handle,
+                    rx_msgs,
+                    (unsigned int) batch_count,
+                    MSG_DONTWAIT,
+                    NULL );
+        }
+    }
+
+    if( rx_count > 0 )
+    {
+        // one host clock sample for the batch, as with canlib
+        const timestamp_ms rx_timestamp = time_get_timestamp();
+        const timestamp_ms rx_timestamp_mono = time_get_monotonic_timestamp();
+        timestamp_ms last_native = 0;
+        int idx = 0;
+
+        for( idx = 0; idx < rx_count; idx += 1 )
+        {
+            const struct can_frame * const rx_frame = &rx_frames[ idx ];
+
+            // filters only pass standard data frames
+            if( rx_msgs[ idx ].msg_len == sizeof(*rx_frame) )
+            {
+                can_frame_s * const frame = &frames[ count ];
+
+                frame->native_rx_timestamp = get_native_timestamp( &rx_msgs[ idx ].msg_hdr );
+                frame->id = (unsigned long) (rx_frame->can_id & CAN_SFF_MASK);
+                frame->dlc = (unsigned long) m_min( rx_frame->can_dlc, CAN_MAX_DLEN );
+
+                memcpy(
+                        (void*) &frame->data[ 0 ],
+                        (const void*) &rx_frame->data[ 0 ],
+                        sizeof(frame->data) );
+
+                last_native = frame->native_rx_timestamp;
+                count += 1;
+            }
+        }
+
+        for( idx = 0; idx < (int) count; idx += 1 )
+        {
+            can_frame_s * const frame = &frames[ idx ];
+
+            timestamp_ms age = 0;
+
+            // frames without a timestamp are not back-dated
+            if( (frame->native_rx_timestamp != 0) && (frame->native_rx_timestamp < last_native) )
+            {
+                age = m_min(
+                        (last_native - frame->native_rx_timestamp),
+                        rx_timestamp_mono );
+            }
+
+            frame->rx_timestamp = (rx_timestamp - age);
+            frame->rx_timestamp_mono = (rx_timestamp_mono - age);
+        }
+    }
+
+    return count;
+}
+
+
+// the frame is queued on the interface once written, not necessarily on
+// the bus yet
+int can_write(
+        const can_handle_s handle,
+        const unsigned long id,
+        const unsigned long dlc,
+        const unsigned char * const data,
+        const timestamp_ms timeout )
+{
+    int ret = 1;
+    struct can_frame tx_frame;
+
+    if( (handle >= 0) && (dlc <= CAN_MAX_DLEN) )
+    {
+        memset( &tx_frame, 0, sizeof(tx_frame) );
+
+        tx_frame.can_id = (canid_t) (id & CAN_SFF_MASK);
+        tx_frame.can_dlc = (__u8) dlc;
+
+        if( dlc != 0 )
+        {
+            memcpy( tx_frame.data, data, (size_t) dlc );
+        }
+
+        if( wait_for( handle, POLLOUT, timeout ) == 0 )
+        {
+            if( write( handle, &tx_frame, sizeof(tx_frame) ) == (ssize_t) sizeof(tx_frame) )
+            {
+                ret = 0;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -103,6 +103,14 @@ static void on_key(
     {
         dm_context.config.active_page_index = ST_PAGE_5;
     }
+    else if( key == '6' )
+    {
+        dm_context.config.active_page_index = ST_PAGE_6;
+    }
+    else if( key == '7' )
+    {
+        dm_context.config.active_page_index = ST_PAGE_7;
+    }
 }
 
 
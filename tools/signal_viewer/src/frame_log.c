@@ -0,0 +1,576 @@
+/**
+ * @file frame_log.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "math_util.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// index entries allocated at a time
+#define INDEX_GROW_COUNT (1024ULL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void init_header(
+        fl_header_s * const header );
+
+
+//
+static int check_header(
+        const fl_header_s * const header,
+        const unsigned long long file_size );
+
+
+//
+static unsigned long long search_records(
+        const fl_reader_s * const reader,
+        unsigned long long first,
+        unsigned long long last,
+        const timestamp_ms rx_timestamp );
+
+
+//
+static int add_index_entry(
+        const fl_record_s * const record,
+        const unsigned long long record_number,
+        fl_writer_s * const writer );
+
+
+//
+static int truncate_records(
+        fl_writer_s * const writer );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void init_header(
+        fl_header_s * const header )
+{
+    memset( header, 0, sizeof(*header) );
+
+    strncpy( header->magic, FL_MAGIC, sizeof(header->magic) );
+    header->version = (uint32_t) FL_VERSION;
+    header->record_size = (uint32_t) sizeof(fl_record_s);
+    header->index_stride = (uint64_t) FL_INDEX_STRIDE;
+}
+
+
+// returns non-zero if the header does not describe this file
+static int check_header(
+        const fl_header_s * const header,
+        const unsigned long long file_size )
+{
+    int ret = 0;
+
+    if(
+            (strncmp( header->magic, FL_MAGIC, sizeof(header->magic) ) != 0)
+            || (header->version != (uint32_t) FL_VERSION)
+            || (header->record_size != (uint32_t) sizeof(fl_record_s)) )
+    {
+        ret = 1;
+    }
+    else if( header->index_offset != 0 )
+    {
+        const unsigned long long records_end =
+                sizeof(*header) + (header->record_count * sizeof(fl_record_s));
+        const unsigned long long index_end =
+                header->index_offset + (header->index_count * sizeof(fl_index_entry_s));
+
+        if(
+                (header->index_offset < records_end)
+                || (index_end > file_size)
+                || (header->index_stride == 0) )
+        {
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+
+// first record in [first, last) at or after rx_timestamp, last if none
+static unsigned long long search_records(
+        const fl_reader_s * const reader,
+        unsigned long long first,
+        unsigned long long last,
+        const timestamp_ms rx_timestamp )
+{
+    while( first < last )
+    {
+        const unsigned long long mid = first + ((last - first) / 2);
+
+        if( reader->records[ mid ].rx_timestamp < rx_timestamp )
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+
+    return first;
+}
+
+
+// returns non-zero on failure
+static int add_index_entry(
+        const fl_record_s * const record,
+        const unsigned long long record_number,
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+
+    if( writer->index_count == writer->index_capacity )
+    {
+        const unsigned long long capacity = writer->index_capacity + INDEX_GROW_COUNT;
+
+        fl_index_entry_s * const index = realloc(
+                writer->index,
+                (size_t) (capacity * sizeof(*index)) );
+
+        if( index == NULL )
+        {
+            ret = 1;
+        }
+        else
+        {
+            writer->index = index;
+            writer->index_capacity = capacity;
+        }
+    }
+
+    if( ret == 0 )
+    {
+        fl_index_entry_s * const entry = &writer->index[ writer->index_count ];
+
+        entry->rx_timestamp = record->rx_timestamp;
+        entry->record = (uint64_t) record_number;
+
+        writer->index_count += 1;
+    }
+
+    return ret;
+}
+
+
+// cuts the file back to the records written so far, the stream is
+// unbuffered so nothing of a failed write is left to flush
+// returns non-zero on failure
+static int truncate_records(
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+
+    const off_t records_end =
+            (off_t) (sizeof(fl_header_s) + (writer->record_count * sizeof(fl_record_s)));
+
+    clearerr( writer->file );
+
+    if(
+            (ftruncate( fileno( writer->file ), records_end ) != 0)
+            || (fseeko( writer->file, records_end, SEEK_SET ) != 0) )
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void fl_encode(
+        const can_frame_s * const frame,
+        fl_record_s * const record )
+{
+    memset( record, 0, sizeof(*record) );
+
+    record->rx_timestamp = (uint64_t) frame->rx_timestamp;
+    record->native_rx_timestamp = (uint64_t) frame->native_rx_timestamp;
+    record->id = (uint32_t) frame->id;
+    record->dlc = (uint8_t) m_min( frame->dlc, sizeof(record->data) );
+
+    memcpy(
+            (void*) record->data,
+            (const void*) frame->data,
+            sizeof(record->data) );
+}
+
+
+//
+void fl_decode(
+        const fl_record_s * const record,
+        can_frame_s * const frame )
+{
+    frame->rx_timestamp = (timestamp_ms) record->rx_timestamp;
+    frame->native_rx_timestamp = (timestamp_ms) record->native_rx_timestamp;
+    frame->id = (unsigned long) record->id;
+    frame->dlc = (unsigned long) record->dlc;
+
+    memcpy(
+            (void*) frame->data,
+            (const void*) record->data,
+            sizeof(frame->data) );
+}
+
+
+//
+int fl_open(
+        const char * const path,
+        fl_reader_s * const reader )
+{
+    int ret = 0;
+    struct stat file_stat;
+    void *map = MAP_FAILED;
+
+    memset( reader, 0, sizeof(*reader) );
+    reader->fd = open( path, O_RDONLY );
+
+    if( reader->fd < 0 )
+    {
+        printf( "failed to open log file '%s'\n", path );
+        ret = 1;
+    }
+    else if(
+            (fstat( reader->fd, &file_stat ) != 0)
+            || ((unsigned long long) file_stat.st_size < sizeof(fl_header_s)) )
+    {
+        printf( "log file '%s' is too short\n", path );
+        ret = 1;
+    }
+    else
+    {
+        reader->map_size = (unsigned long long) file_stat.st_size;
+
+        map = mmap(
+                NULL,
+                (size_t) reader->map_size,
+                PROT_READ,
+                MAP_PRIVATE,
+                reader->fd,
+                0 );
+
+        if( map == MAP_FAILED )
+        {
+            printf( "failed to map log file '%s'\n", path );
+            ret = 1;
+        }
+    }
+
+    if( ret == 0 )
+    {
+        const fl_header_s * const header = (const fl_header_s*) map;
+
+        reader->map = (const unsigned char*) map;
+        reader->records = (const fl_record_s*) &reader->map[ sizeof(*header) ];
+
+        if( check_header( header, reader->map_size ) != 0 )
+        {
+            printf( "'%s' is not a version %lu HOBD log\n", path, FL_VERSION );
+            ret = 1;
+        }
+        else if( header->index_offset == 0 )
+        {
+            // never closed, take whole records up to the end of the file
+            reader->record_count =
+                    (reader->map_size - sizeof(*header)) / sizeof(fl_record_s);
+        }
+        else
+        {
+            reader->record_count = (unsigned long long) header->record_count;
+            reader->index = (const fl_index_entry_s*) &reader->map[ header->index_offset ];
+            reader->index_count = (unsigned long long) header->index_count;
+            reader->index_stride = (unsigned long long) header->index_stride;
+        }
+    }
+
+    if( ret != 0 )
+    {
+        fl_close( reader );
+    }
+
+    return ret;
+}
+
+
+//
+void fl_close(
+        fl_reader_s * const reader )
+{
+    if( reader->map != NULL )
+    {
+        (void) munmap( (void*) reader->map, (size_t) reader->map_size );
+    }
+
+    if( reader->fd >= 0 )
+    {
+        (void) close( reader->fd );
+    }
+
+    memset( reader, 0, sizeof(*reader) );
+    reader->fd = -1;
+}
+
+
+// the index narrows the search to one stride of records
+unsigned long long fl_seek(
+        const fl_reader_s * const reader,
+        const timestamp_ms rx_timestamp )
+{
+    unsigned long long first = 0;
+    unsigned long long last = reader->record_count;
+
+    if( (reader->index != NULL) && (reader->index_count != 0) )
+    {
+        // first entry at or after rx_timestamp
+        unsigned long long low = 0;
+        unsigned long long high = reader->index_count;
+
+        while( low < high )
+        {
+            const unsigned long long mid = low + ((high - low) / 2);
+
+            if( reader->index[ mid ].rx_timestamp < rx_timestamp )
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        // the record is in the stride before that entry
+        if( low != 0 )
+        {
+            first = (unsigned long long) reader->index[ low - 1 ].record;
+        }
+
+        if( low < reader->index_count )
+        {
+            last = m_min( (unsigned long long) reader->index[ low ].record, reader->record_count );
+        }
+    }
+
+    return search_records( reader, first, last, rx_timestamp );
+}
+
+
+//
+int fl_writer_open(
+        const char * const path,
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+    fl_header_s header;
+
+    memset( writer, 0, sizeof(*writer) );
+    init_header( &header );
+
+    writer->file = fopen( path, "wb" );
+
+    if( writer->file == NULL )
+    {
+        printf( "failed to create log file '%s'\n", path );
+        ret = 1;
+    }
+    else if( setvbuf( writer->file, NULL, _IONBF, 0 ) != 0 )
+    {
+        printf( "failed to set up log file '%s'\n", path );
+        (void) fclose( writer->file );
+        writer->file = NULL;
+        ret = 1;
+    }
+    else if( fwrite( &header, sizeof(header), 1, writer->file ) != 1 )
+    {
+        printf( "failed to write log file header '%s'\n", path );
+        (void) fclose( writer->file );
+        writer->file = NULL;
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+// a failed block is dropped with its index entries
+int fl_writer_write(
+        fl_writer_s * const writer,
+        fl_record_s * const records,
+        const unsigned long count )
+{
+    int ret = 0;
+    unsigned long idx = 0;
+
+    const unsigned long long index_count = writer->index_count;
+    const uint64_t last_rx_timestamp = writer->last_rx_timestamp;
+
+    if( writer->file == NULL )
+    {
+        ret = 1;
+    }
+
+    for( idx = 0; (idx < count) && (ret == 0); idx += 1 )
+    {
+        const unsigned long long record_number = (writer->record_count + idx);
+
+        // keep the records searchable if the host clock stepped back
+        records[ idx ].rx_timestamp = m_max(
+                records[ idx ].rx_timestamp,
+                writer->last_rx_timestamp );
+
+        writer->last_rx_timestamp = records[ idx ].rx_timestamp;
+
+        if( (record_number % FL_INDEX_STRIDE) == 0 )
+        {
+            ret = add_index_entry( &records[ idx ], record_number, writer );
+        }
+    }
+
+    if( (ret == 0) && (count != 0) )
+    {
+        if( fwrite( records, sizeof(*records), (size_t) count, writer->file ) != (size_t) count )
+        {
+            ret = 1;
+        }
+        else
+        {
+            writer->record_count += count;
+        }
+    }
+
+    if( (ret != 0) && (writer->file != NULL) )
+    {
+        writer->index_count = index_count;
+        writer->last_rx_timestamp = last_rx_timestamp;
+
+        if( truncate_records( writer ) != 0 )
+        {
+            // the end of the records is unknown, leave the header as a log
+            // that was never closed, the reader takes the whole records
+            printf( "failed to truncate log file, index dropped\n" );
+            (void) fclose( writer->file );
+            writer->file = NULL;
+        }
+    }
+
+    return ret;
+}
+
+
+//
+int fl_writer_flush(
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+
+    if( (writer->file == NULL) || (fflush( writer->file ) != 0) )
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+//
+int fl_writer_close(
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+    fl_header_s header;
+
+    if( writer->file == NULL )
+    {
+        ret = 1;
+    }
+    else
+    {
+        init_header( &header );
+
+        header.record_count = (uint64_t) writer->record_count;
+        header.index_offset =
+                (uint64_t) (sizeof(header) + (writer->record_count * sizeof(fl_record_s)));
+        header.index_count = (uint64_t) writer->index_count;
+
+        if( fseeko( writer->file, (off_t) header.index_offset, SEEK_SET ) != 0 )
+        {
+            ret = 1;
+        }
+        else if(
+                (writer->index_count != 0)
+                && (fwrite( writer->index, sizeof(*writer->index), (size_t) writer->index_count, writer->file ) != (size_t) writer->index_count) )
+        {
+            ret = 1;
+        }
+
+        // the header goes last, it is only valid once the index is out
+        if( ret == 0 )
+        {
+            if(
+                    (fflush( writer->file ) != 0)
+                    || (fseek( writer->file, 0, SEEK_SET ) != 0)
+                    || (fwrite( &header, sizeof(header), 1, writer->file ) != 1) )
+            {
+                ret = 1;
+            }
+        }
+
+        if( fclose( writer->file ) != 0 )
+        {
+            ret = 1;
+        }
+    }
+
+    free( writer->index );
+    memset( writer, 0, sizeof(*writer) );
+
+    return ret;
+}
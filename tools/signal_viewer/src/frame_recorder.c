@@ -0,0 +1,307 @@
+/**
+ * @file frame_recorder.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "math_util.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+#include "frame_recorder.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void hand_off_block(
+        fr_state_s * const state );
+
+
+//
+static void write_block(
+        const unsigned long block,
+        unsigned int * const write_failed,
+        fr_state_s * const state );
+
+
+//
+static void *writer_thread(
+        void *user_data );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// the reader moves on to the other block
+static void hand_off_block(
+        fr_state_s * const state )
+{
+    const unsigned long active = state->active;
+
+    __atomic_store_n( &state->block_busy[ active ], 1, __ATOMIC_RELEASE );
+
+    (void) sem_post( &state->block_ready );
+
+    state->active = (active ^ 1UL);
+}
+
+
+// the log is left as it was after the first failed write
+static void write_block(
+        const unsigned long block,
+        unsigned int * const write_failed,
+        fr_state_s * const state )
+{
+    const unsigned long count = state->block_count[ block ];
+
+    if( (*write_failed) == 0 )
+    {
+        if(
+                (fl_writer_write( &state->writer, state->blocks[ block ], count ) != 0)
+                || (fl_writer_flush( &state->writer ) != 0) )
+        {
+            printf( "failed to write frame log, recording stopped\n" );
+
+            (*write_failed) = 1;
+        }
+    }
+
+    if( (*write_failed) == 0 )
+    {
+        const timestamp_ms latency = time_get_since_monotonic( state->block_start[ block ] );
+
+        __atomic_store_n( &state->latency, latency, __ATOMIC_RELAXED );
+        __atomic_store_n(
+                &state->max_latency,
+                m_max( state->max_latency, latency ),
+                __ATOMIC_RELAXED );
+    }
+    else
+    {
+        __atomic_store_n(
+                &state->write_drop_count,
+                (state->write_drop_count + count),
+                __ATOMIC_RELAXED );
+    }
+
+    state->block_count[ block ] = 0;
+
+    // hand the block back to the reader
+    __atomic_store_n( &state->block_busy[ block ], 0, __ATOMIC_RELEASE );
+}
+
+
+// blocks are handed over alternately, so they are written in that order
+static void *writer_thread(
+        void *user_data )
+{
+    fr_state_s * const state = (fr_state_s*) user_data;
+    unsigned long next_block = 0;
+    unsigned int write_failed = 0;
+    unsigned int running = 1;
+    sigset_t sig_set;
+
+    // control-c is for the main thread
+    (void) sigemptyset( &sig_set );
+    (void) sigaddset( &sig_set, SIGINT );
+    (void) pthread_sigmask( SIG_BLOCK, &sig_set, NULL );
+
+    while( running != 0 )
+    {
+        (void) sem_wait( &state->block_ready );
+
+        // a block handed over before fr_stop is seen here
+        running = (unsigned int) __atomic_load_n( &state->running, __ATOMIC_ACQUIRE );
+
+        while( __atomic_load_n( &state->block_busy[ next_block ], __ATOMIC_ACQUIRE ) != 0 )
+        {
+            write_block( next_block, &write_failed, state );
+
+            next_block ^= 1UL;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+int fr_start(
+        const char * const path,
+        fr_state_s * const state )
+{
+    int ret = 0;
+
+    memset( state, 0, sizeof(*state) );
+
+    ret = fl_writer_open( path, &state->writer );
+
+    if( ret == 0 )
+    {
+        if( sem_init( &state->block_ready, 0, 0 ) != 0 )
+        {
+            printf( "failed to create frame recorder semaphore\n" );
+
+            (void) fl_writer_close( &state->writer );
+
+            ret = 1;
+        }
+    }
+
+    if( ret == 0 )
+    {
+        __atomic_store_n( &state->running, 1, __ATOMIC_RELEASE );
+
+        ret = pthread_create(
+                &state->thread,
+                NULL,
+                &writer_thread,
+                (void*) state );
+
+        if( ret != 0 )
+        {
+            printf( "failed to create frame recorder thread\n" );
+
+            __atomic_store_n( &state->running, 0, __ATOMIC_RELEASE );
+
+            (void) sem_destroy( &state->block_ready );
+            (void) fl_writer_close( &state->writer );
+        }
+    }
+
+    return ret;
+}
+
+
+//
+void fr_stop(
+        fr_state_s * const state )
+{
+    if( __atomic_load_n( &state->running, __ATOMIC_ACQUIRE ) != 0 )
+    {
+        const unsigned long active = state->active;
+
+        if(
+                (__atomic_load_n( &state->block_busy[ active ], __ATOMIC_ACQUIRE ) == 0)
+                && (state->block_count[ active ] != 0) )
+        {
+            hand_off_block( state );
+        }
+
+        __atomic_store_n( &state->running, 0, __ATOMIC_RELEASE );
+
+        (void) sem_post( &state->block_ready );
+
+        (void) pthread_join( state->thread, NULL );
+
+        if( fl_writer_close( &state->writer ) != 0 )
+        {
+            printf( "failed to close frame log\n" );
+        }
+
+        (void) sem_destroy( &state->block_ready );
+    }
+}
+
+
+//
+void fr_push(
+        const can_frame_s * const frame,
+        fr_state_s * const state )
+{
+    const unsigned long active = state->active;
+
+    if( __atomic_load_n( &state->block_busy[ active ], __ATOMIC_ACQUIRE ) != 0 )
+    {
+        // the writer has not caught up with either block
+        __atomic_store_n( &state->drop_count, (state->drop_count + 1), __ATOMIC_RELAXED );
+    }
+    else
+    {
+        const unsigned long count = state->block_count[ active ];
+
+        if( count == 0 )
+        {
+            state->block_start[ active ] = frame->rx_timestamp_mono;
+        }
+
+        fl_encode( frame, &state->blocks[ active ][ count ] );
+
+        state->block_count[ active ] = (count + 1);
+
+        __atomic_store_n( &state->frame_count, (state->frame_count + 1), __ATOMIC_RELAXED );
+
+        if( (count + 1) == FR_BLOCK_SIZE )
+        {
+            hand_off_block( state );
+        }
+    }
+}
+
+
+//
+void fr_poll(
+        fr_state_s * const state )
+{
+    const unsigned long active = state->active;
+
+    if(
+            (__atomic_load_n( &state->block_busy[ active ], __ATOMIC_ACQUIRE ) == 0)
+            && (state->block_count[ active ] != 0)
+            && (time_get_since_monotonic( state->block_start[ active ] ) >= FR_FLUSH_INTERVAL) )
+    {
+        hand_off_block( state );
+    }
+}
+
+
+//
+void fr_get_status(
+        const fr_state_s * const state,
+        fr_status_s * const status )
+{
+    status->frame_count = __atomic_load_n( &state->frame_count, __ATOMIC_RELAXED );
+    status->drop_count =
+            __atomic_load_n( &state->drop_count, __ATOMIC_RELAXED )
+            + __atomic_load_n( &state->write_drop_count, __ATOMIC_RELAXED );
+    status->latency = __atomic_load_n( &state->latency, __ATOMIC_RELAXED );
+    status->max_latency = __atomic_load_n( &state->max_latency, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,286 @@
+/**
+ * @file log_bench.c
+ * @brief Native frame log benchmark.
+ *
+ * Maps a native '.hlog', see frame_log.h, and reports the open time, the
+ * host time per decoded frame over all records and the time per seek to
+ * random timestamps.
+ *
+ * With a frame count, a synthetic log of that many frames at a full
+ * 500 kbit bus rate is written to the file first.
+ *
+ * Usage: hobd-log-bench <hlog file> [frames]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// full bus rate, ~8 frames per ms
+#define FRAMES_PER_MS (8ULL)
+
+
+//
+#define SEEK_COUNT (1000000UL)
+
+
+// records written at a time
+#define BLOCK_SIZE (1024UL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static fl_record_s block[ BLOCK_SIZE ];
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static int write_log(
+        const char * const path,
+        const unsigned long long frames );
+
+
+//
+static double decode_all(
+        const fl_reader_s * const reader,
+        unsigned long long * const checksum );
+
+
+//
+static double seek_random(
+        const fl_reader_s * const reader,
+        unsigned long long * const checksum );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+// IDs cycle through the HOBD 0x040-0x0DF range
+static int write_log(
+        const char * const path,
+        const unsigned long long frames )
+{
+    int ret = 0;
+    fl_writer_s writer;
+    unsigned long long frame_idx = 0;
+
+    const timestamp_ms start = time_get_timestamp();
+
+    ret = fl_writer_open( path, &writer );
+
+    while( (ret == 0) && (frame_idx < frames) )
+    {
+        unsigned long count = 0;
+
+        for( count = 0; (count < BLOCK_SIZE) && (frame_idx < frames); count += 1 )
+        {
+            can_frame_s frame;
+
+            memset( &frame, 0, sizeof(frame) );
+            frame.rx_timestamp = start + (frame_idx / FRAMES_PER_MS);
+            frame.native_rx_timestamp = (frame_idx / FRAMES_PER_MS);
+            frame.id = 0x040UL + (unsigned long) (frame_idx % 0xA0ULL);
+            frame.dlc = 8;
+            memcpy( frame.data, &frame_idx, sizeof(frame_idx) );
+
+            fl_encode( &frame, &block[ count ] );
+
+            frame_idx += 1;
+        }
+
+        ret = fl_writer_write( &writer, block, count );
+    }
+
+    if( fl_writer_close( &writer ) != 0 )
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+// ns per frame
+static double decode_all(
+        const fl_reader_s * const reader,
+        unsigned long long * const checksum )
+{
+    unsigned long long idx = 0;
+    can_frame_s frame;
+
+    const double start = get_time_ns();
+
+    for( idx = 0; idx < reader->record_count; idx += 1 )
+    {
+        fl_decode( &reader->records[ idx ], &frame );
+
+        (*checksum) += frame.id + frame.data[ 0 ];
+    }
+
+    const double end = get_time_ns();
+
+    return (end - start) / (double) reader->record_count;
+}
+
+
+// ns per seek
+static double seek_random(
+        const fl_reader_s * const reader,
+        unsigned long long * const checksum )
+{
+    unsigned long idx = 0;
+
+    const timestamp_ms first = (timestamp_ms) reader->records[ 0 ].rx_timestamp;
+    const timestamp_ms span =
+            (timestamp_ms) reader->records[ reader->record_count - 1 ].rx_timestamp - first + 1;
+
+    srand( 1 );
+
+    const double start = get_time_ns();
+
+    for( idx = 0; idx < SEEK_COUNT; idx += 1 )
+    {
+        const timestamp_ms target = first + ((timestamp_ms) rand() % span);
+
+        (*checksum) += fl_seek( reader, target );
+    }
+
+    const double end = get_time_ns();
+
+    return (end - start) / (double) SEEK_COUNT;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    fl_reader_s reader;
+    unsigned long long checksum = 0;
+
+    if( (argc != 2) && (argc != 3) )
+    {
+        fprintf( stderr, "usage: %s <hlog file> [frames]\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else if( argc == 3 )
+    {
+        const unsigned long long frames = strtoull( argv[ 2 ], NULL, 0 );
+
+        const double start = get_time_ns();
+
+        if( (frames == 0) || (write_log( argv[ 1 ], frames ) != 0) )
+        {
+            fprintf( stderr, "%s: failed to write '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+        else
+        {
+            printf(
+                    "hobd-log-bench: wrote %llu frames in %.1f ms\n",
+                    frames,
+                    (get_time_ns() - start) / 1.0e6 );
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        const double start = get_time_ns();
+
+        if( fl_open( argv[ 1 ], &reader ) != 0 )
+        {
+            ret = EXIT_FAILURE;
+        }
+        else if( reader.record_count == 0 )
+        {
+            fprintf( stderr, "%s: no frames in '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            fl_close( &reader );
+
+            ret = EXIT_FAILURE;
+        }
+        else
+        {
+            const double open_ms = (get_time_ns() - start) / 1.0e6;
+
+            // first pass faults the pages in
+            const double cold_ns = decode_all( &reader, &checksum );
+            const double warm_ns = decode_all( &reader, &checksum );
+            const double seek_ns = seek_random( &reader, &checksum );
+
+            printf(
+                    "hobd-log-bench: %llu frames, %llu index entries, open %.3f ms\n",
+                    reader.record_count,
+                    reader.index_count,
+                    open_ms );
+
+            printf(
+                    "hobd-log-bench: decode cold %.1f ns/frame (%.1f M frames/s), warm %.1f ns/frame (%.1f M frames/s)\n",
+                    cold_ns,
+                    1.0e3 / cold_ns,
+                    warm_ns,
+                    1.0e3 / warm_ns );
+
+            printf(
+                    "hobd-log-bench: seek %.1f ns (checksum %llu)\n",
+                    seek_ns,
+                    checksum );
+
+            fl_close( &reader );
+        }
+    }
+
+    return ret;
+}
@@ -16,6 +16,9 @@
 
 #include "math_util.h"
 #include "can.h"
+#include "can_reader.h"
+#include "frame_log.h"
+#include "frame_recorder.h"
 #include "display_manager.h"
 
 
@@ -50,6 +53,14 @@
 static sig_atomic_t global_exit_signal = 0;
 
 
+// CAN reader thread and its frame queue
+static cr_state_s can_reader;
+
+
+// record mode log writer
+static fr_state_s frame_recorder;
+
+
 
 
 // *****************************************************
@@ -93,7 +104,10 @@ int main( int argc, char **argv )
 {
     // CAN bus interface handle
     can_handle_s can_handle = CAN_HANDLE_INVALID;
-    unsigned int can_is_replay = 0;
+    unsigned int can_source = CR_SOURCE_CAN;
+    unsigned int time_sync_enabled = 0;
+    unsigned int can_reader_started = 0;
+    const char *record_file = NULL;
     char title[256];
 
     // hook up the control-c signal handler, sets exit signaled flag
@@ -109,8 +123,17 @@ int main( int argc, char **argv )
             "%s",
             WINDOW_TITLE );
 
-    // check if CAN channel system ID or replay file path was provided
-    if( (argc == 2) && (strlen(argv[1]) > 0) )
+    // a trailing '-r <file>' records every frame received to a native log
+    if( (argc >= 4) && (strcmp(argv[argc - 2], "-r") == 0) )
+    {
+        record_file = argv[argc - 1];
+        argc -= 2;
+    }
+
+    // check if CAN channel system ID or replay file path was provided,
+    // a live channel can be followed by '-s' to act as the time master,
+    // a native log by the replay start offset in seconds
+    if( (argc >= 2) && (argc <= 3) && (strlen(argv[1]) > 0) )
     {
         if( isdigit(argv[1][0]) != 0 )
         {
@@ -126,13 +149,40 @@ int main( int argc, char **argv )
                         title,
                         " - Live Mode",
                         sizeof(title) );
+
+                if( (argc == 3) && (strcmp(argv[2], "-s") == 0) )
+                {
+                    printf( "sending time sync\n" );
+
+                    time_sync_enabled = 1;
+                }
             }
         }
+        else if( strstr(argv[1], FL_FILE_EXTENSION ) != NULL )
+        {
+            timestamp_ms start_offset = 0;
+
+            if( argc == 3 )
+            {
+                start_offset = (timestamp_ms) (m_max( atof( argv[2] ), 0.0 ) * 1000.0);
+            }
+
+            printf( "opening log file: '%s'\n", argv[1] );
+
+            can_source = CR_SOURCE_LOG;
+
+            can_handle = can_log_open( argv[1], start_offset );
+
+            strncat(
+                    title,
+                    " - Replay Mode",
+                    sizeof(title) );
+        }
         else if( strstr(argv[1], "plog" ) != NULL )
         {
             printf( "opening replay file: '%s'\n", argv[1] );
 
-            can_is_replay = 1;
+            can_source = CR_SOURCE_REPLAY;
 
             can_handle = can_replay_open( argv[1] );
 
@@ -162,60 +212,102 @@ int main( int argc, char **argv )
         global_exit_signal = 1;
     }
 
+    // recorded frames are written on their own thread
+    if( (global_exit_signal == 0) && (can_handle != CAN_HANDLE_INVALID) && (record_file != NULL) )
+    {
+        printf( "recording to log file: '%s'\n", record_file );
+
+        if( fr_start( record_file, &frame_recorder ) == 0 )
+        {
+            dm_get_context()->st_state.record_enabled = 1;
+        }
+        else
+        {
+            global_exit_signal = 1;
+        }
+    }
+
+    // CAN frames are read on their own thread
+    if( (global_exit_signal == 0) && (can_handle != CAN_HANDLE_INVALID) )
+    {
+        fr_state_s * const recorder =
+                (dm_get_context()->st_state.record_enabled != 0) ? &frame_recorder : NULL;
+
+        if( cr_start( can_handle, can_source, time_sync_enabled, recorder, &can_reader ) == 0 )
+        {
+            can_reader_started = 1;
+        }
+    }
+
     // wait for user to control-c
     while( global_exit_signal == 0 )
     {
-        // update display manager
-        timestamp_ms time_to_redraw = 0;
-        dm_update( &time_to_redraw );
-
-        // poll for CAN frames if enabled
-        if( can_handle != CAN_HANDLE_INVALID )
+        // apply every frame received since the last pass before a redraw
+        if( can_reader_started != 0 )
         {
-            // check for any ready CAN frames to process
+            dm_context_s * const dm_context = dm_get_context();
             can_frame_s rx_frame;
-            int can_status = 1;
-
-            if( can_is_replay == 0 )
-            {
-                can_status = can_read(
-                        can_handle,
-                        m_min(time_to_redraw, 5),
-                        &rx_frame );
-            }
-            else
-            {
-                can_status = can_replay_read(
-                        can_handle,
-                        m_min(time_to_redraw, 5),
-                        &rx_frame );
-            }
 
-            // if data ready
-            if( can_status == 0 )
+            while( cr_pop( &can_reader, &rx_frame ) == 0 )
             {
-                dm_context_s * const dm_context = dm_get_context();
-
                 st_process_can_frame(
                         &rx_frame,
                         &dm_context->config,
                         &dm_context->st_state );
             }
-        }
-        else
-        {
-            // otherwise just sleep
-            if( time_to_redraw > 0 )
+
+            if( dm_context->st_state.record_enabled != 0 )
             {
-                time_sleep_ms( m_min(time_to_redraw,5) );
+                fr_get_status( &frame_recorder, &dm_context->st_state.record_status );
             }
         }
+
+        // update display manager
+        timestamp_ms time_to_redraw = 0;
+        dm_update( &time_to_redraw );
+
+        // sleep until the next redraw
+        if( time_to_redraw > 0 )
+        {
+            time_sleep_ms( m_min(time_to_redraw,5) );
+        }
+    }
+
+    if( can_reader_started != 0 )
+    {
+        cr_stop( &can_reader );
+
+        printf(
+                "CAN reader: %llu frames, %llu dropped, %lu queued at most\n",
+                can_reader.rx_count,
+                can_reader.drop_count,
+                can_reader.high_water );
     }
 
-    if( can_is_replay == 0 )
+    // after the reader, it pushes the frames
+    if( dm_get_context()->st_state.record_enabled != 0 )
+    {
+        fr_status_s record_status;
+
+        fr_stop( &frame_recorder );
+
+        fr_get_status( &frame_recorder, &record_status );
+
+        printf(
+                "recorder: %llu frames, %llu dropped, %llu ms latency at most\n",
+                record_status.frame_count,
+                record_status.drop_count,
+                record_status.max_latency );
+    }
+
+    if( can_source == CR_SOURCE_CAN )
     {
         can_close( can_handle );
     }
+    else if( can_source == CR_SOURCE_LOG )
+    {
+        can_log_close( can_handle );
+    }
     else
     {
         can_replay_close( can_handle );
@@ -0,0 +1,169 @@
+/**
+ * @file plog_convert.c
+ * @brief PolySync log to native frame log converter.
+ *
+ * Reads the CAN frames of a PolySync '.plog' through the replay queue and
+ * writes them to a native '.hlog', see frame_log.h. The replay queue
+ * gives no end of log marker, conversion ends once it has been empty for
+ * IDLE_TIMEOUT.
+ *
+ * Usage: hobd-plog-convert <plog file> <hlog file>
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "can.h"
+#include "frame_log.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+// ms
+#define IDLE_TIMEOUT (2000ULL)
+
+
+// ms
+#define READ_TIMEOUT (100ULL)
+
+
+// records written at a time
+#define BLOCK_SIZE (256UL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static fl_record_s block[ BLOCK_SIZE ];
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static int convert(
+        const can_handle_s handle,
+        fl_writer_s * const writer );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+// returns non-zero on a write failure
+static int convert(
+        const can_handle_s handle,
+        fl_writer_s * const writer )
+{
+    int ret = 0;
+    unsigned long count = 0;
+    can_frame_s frame;
+
+    timestamp_ms last_frame = time_get_monotonic_timestamp();
+
+    while( (ret == 0) && (time_get_since_monotonic( last_frame ) < IDLE_TIMEOUT) )
+    {
+        if( can_replay_read( handle, READ_TIMEOUT, &frame ) == 0 )
+        {
+            fl_encode( &frame, &block[ count ] );
+            count += 1;
+
+            last_frame = time_get_monotonic_timestamp();
+        }
+
+        if( (count == BLOCK_SIZE) || ((count != 0) && (time_get_since_monotonic( last_frame ) >= READ_TIMEOUT)) )
+        {
+            ret = fl_writer_write( writer, block, count );
+            count = 0;
+        }
+    }
+
+    if( (ret == 0) && (count != 0) )
+    {
+        ret = fl_writer_write( writer, block, count );
+    }
+
+    return ret;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    can_handle_s handle = CAN_HANDLE_INVALID;
+    fl_writer_s writer;
+
+    if( argc != 3 )
+    {
+        fprintf( stderr, "usage: %s <plog file> <hlog file>\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else
+    {
+        handle = can_replay_open( argv[ 1 ] );
+
+        if( handle == CAN_HANDLE_INVALID )
+        {
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        if( fl_writer_open( argv[ 2 ], &writer ) != 0 )
+        {
+            ret = EXIT_FAILURE;
+        }
+        else
+        {
+            const int convert_status = convert( handle, &writer );
+            const unsigned long long record_count = writer.record_count;
+
+            if( (fl_writer_close( &writer ) != 0) || (convert_status != 0) )
+            {
+                fprintf( stderr, "%s: failed to write '%s'\n", argv[ 0 ], argv[ 2 ] );
+
+                ret = EXIT_FAILURE;
+            }
+            else
+            {
+                printf( "%s: %llu frames written to '%s'\n", argv[ 0 ], record_count, argv[ 2 ] );
+            }
+        }
+    }
+
+    if( handle != CAN_HANDLE_INVALID )
+    {
+        can_replay_close( handle );
+    }
+
+    return ret;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file profile_table.c
+ * @brief TODO.
+ *
+ * Decodes the gateway main loop profiler frames. The summary keeps the
+ * last interval, the histogram accumulates every interval since start.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "profile_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static const char * const STAGE_NAMES[ HOBD_PROFILE_STAGE_COUNT ] =
+{
+    "Main Loop",
+    "Diagnostics",
+    "Command",
+    "Publish Stats",
+    "OBD Process Buffer",
+    "OBD Parse",
+    "OBD Publish",
+    "GPS Process Buffer",
+    "GPS Parse",
+    "GPS Publish",
+    "IMU Process Buffer",
+    "IMU Parse",
+    "IMU Publish"
+};
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static pt_node_s *get_node(
+        const unsigned long node_id,
+        pt_state_s * const state );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static pt_node_s *get_node(
+        const unsigned long node_id,
+        pt_state_s * const state )
+{
+    pt_node_s *node = NULL;
+
+    unsigned long idx = 0;
+    for( idx = 0; (idx < PT_NODE_COUNT) && (node == NULL); idx += 1 )
+    {
+        if( state->nodes[ idx ].node_id == node_id )
+        {
+            node = &state->nodes[ idx ];
+        }
+    }
+
+    return node;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void pt_init(
+        pt_state_s * const state )
+{
+    memset( state, 0, sizeof(*state) );
+
+    state->nodes[ PT_NODE_OBD_GATEWAY ].node_id =
+            (HOBD_CAN_ID_PROFILE_OBD_GATEWAY - HOBD_CAN_ID_PROFILE_BASE);
+    snprintf(
+            state->nodes[ PT_NODE_OBD_GATEWAY ].name,
+            sizeof(state->nodes[ PT_NODE_OBD_GATEWAY ].name),
+            "OBD Gateway Profile" );
+
+    state->nodes[ PT_NODE_IMU_GATEWAY ].node_id =
+            (HOBD_CAN_ID_PROFILE_IMU_GATEWAY - HOBD_CAN_ID_PROFILE_BASE);
+    snprintf(
+            state->nodes[ PT_NODE_IMU_GATEWAY ].name,
+            sizeof(state->nodes[ PT_NODE_IMU_GATEWAY ].name),
+            "IMU Gateway Profile" );
+}
+
+
+//
+void pt_process_can_frame(
+        const can_frame_s * const can_frame,
+        pt_state_s * const state )
+{
+    pt_node_s *node = NULL;
+
+    if(
+            (can_frame->id >= HOBD_CAN_ID_PROFILE_BASE)
+            && (can_frame->id < HOBD_CAN_ID_PROFILE_HIST_BASE)
+            && (can_frame->dlc == (unsigned long) sizeof(hobd_profile_s)) )
+    {
+        const hobd_profile_s * const profile =
+                (const hobd_profile_s*) &can_frame->data[ 0 ];
+
+        node = get_node( can_frame->id - HOBD_CAN_ID_PROFILE_BASE, state );
+
+        if( (node != NULL) && (profile->stage < HOBD_PROFILE_STAGE_COUNT) )
+        {
+            pt_stage_s * const stage = &node->stages[ profile->stage ];
+
+            stage->rx_time = can_frame->rx_timestamp;
+            stage->profile = *profile;
+        }
+    }
+    else if(
+            (can_frame->id >= HOBD_CAN_ID_PROFILE_HIST_BASE)
+            && (can_frame->dlc == (unsigned long) sizeof(hobd_profile_hist_s)) )
+    {
+        const hobd_profile_hist_s * const hist =
+                (const hobd_profile_hist_s*) &can_frame->data[ 0 ];
+
+        node = get_node( can_frame->id - HOBD_CAN_ID_PROFILE_HIST_BASE, state );
+
+        if( (node != NULL) && (hist->stage < HOBD_PROFILE_STAGE_COUNT) )
+        {
+            pt_stage_s * const stage = &node->stages[ hist->stage ];
+
+            stage->hist = *hist;
+            stage->hist_count += 1;
+
+            unsigned long bin = 0;
+            for( bin = 0; bin < HOBD_PROFILE_HIST_BIN_COUNT; bin += 1 )
+            {
+                stage->hist_sum[ bin ] += (unsigned long long) hist->bins[ bin ];
+            }
+        }
+    }
+}
+
+
+//
+const char *pt_get_stage_name(
+        const unsigned long stage )
+{
+    const char *name = "Unknown";
+
+    if( stage < HOBD_PROFILE_STAGE_COUNT )
+    {
+        name = STAGE_NAMES[ stage ];
+    }
+
+    return name;
+}
+
+
+//
+double pt_get_hist_share(
+        const pt_stage_s * const stage,
+        const unsigned long bin )
+{
+    double share = 0.0;
+
+    if( (stage->hist_count != 0) && (bin < HOBD_PROFILE_HIST_BIN_COUNT) )
+    {
+        share = (double) stage->hist_sum[ bin ] / (255.0 * (double) stage->hist_count);
+    }
+
+    return share;
+}
+
+
+//
+double pt_get_bin_edge_us(
+        const unsigned long bin )
+{
+    const unsigned long ticks = (1UL << (HOBD_PROFILE_HIST_BIN_SHIFT * (bin + 1)));
+
+    return pt_ticks_to_us( ticks );
+}
+
+
+//
+double pt_ticks_to_us(
+        const unsigned long ticks )
+{
+    return ((double) ticks * (double) HOBD_PROFILE_TICK_NS) / 1000.0;
+}
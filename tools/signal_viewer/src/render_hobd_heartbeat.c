@@ -344,6 +344,38 @@ static GLdouble render_warnings(
         delta_y += 15.0;
     }
 
+    if( (warnings & HOBD_HEARTBEAT_WARN_NO_TIME_SYNC) != 0 )
+    {
+        snprintf(
+            string,
+            sizeof(string),
+            "- WARN NO TIME SYNC" );
+
+        render_text_2d(
+                base_x,
+                base_y + delta_y,
+                string,
+                font );
+
+        delta_y += 15.0;
+    }
+
+    if( (warnings & HOBD_HEARTBEAT_WARN_IMU_CONFIG) != 0 )
+    {
+        snprintf(
+            string,
+            sizeof(string),
+            "- WARN IMU CONFIG" );
+
+        render_text_2d(
+                base_x,
+                base_y + delta_y,
+                string,
+                font );
+
+        delta_y += 15.0;
+    }
+
     return delta_y;
 }
 
@@ -0,0 +1,213 @@
+/**
+ * @file render_hobd_profile.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gl_headers.h"
+#include "math_util.h"
+#include "time_domain.h"
+#include "render.h"
+#include "config.h"
+#include "profile_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void render_bin_labels(
+        const GLdouble base_x,
+        const GLdouble base_y,
+        const GLdouble bin_width )
+{
+    char string[512];
+
+    unsigned long bin = 0;
+    for( bin = 0; bin < HOBD_PROFILE_HIST_BIN_COUNT; bin += 1 )
+    {
+        if( bin < (HOBD_PROFILE_HIST_BIN_COUNT - 1) )
+        {
+            snprintf(
+                    string,
+                    sizeof(string),
+                    "<%.0f",
+                    pt_get_bin_edge_us( bin ) );
+        }
+        else
+        {
+            snprintf(
+                    string,
+                    sizeof(string),
+                    ">%.0f",
+                    pt_get_bin_edge_us( bin - 1 ) );
+        }
+
+        render_text_2d(
+                base_x + ((GLdouble) bin * bin_width),
+                base_y,
+                string,
+                GLUT_BITMAP_HELVETICA_10 );
+    }
+}
+
+
+//
+static void render_histogram(
+        const pt_stage_s * const stage,
+        const GLdouble base_x,
+        const GLdouble base_y,
+        const GLdouble bin_width,
+        const GLdouble height )
+{
+    const GLdouble bar_width = bin_width - 6.0;
+
+    unsigned long bin = 0;
+    for( bin = 0; bin < HOBD_PROFILE_HIST_BIN_COUNT; bin += 1 )
+    {
+        const GLdouble x = base_x + ((GLdouble) bin * bin_width);
+        const GLdouble bar_height = height * (GLdouble) pt_get_hist_share( stage, bin );
+
+        glBegin( GL_QUADS );
+
+        glVertex2d( x, base_y );
+        glVertex2d( x + bar_width, base_y );
+        glVertex2d( x + bar_width, base_y - bar_height );
+        glVertex2d( x, base_y - bar_height );
+
+        glEnd();
+
+        render_line(
+                x,
+                base_y,
+                x + bar_width,
+                base_y );
+    }
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void render_hobd_profile(
+        const config_s * const config,
+        const pt_node_s * const node,
+        const GLdouble base_x,
+        const GLdouble base_y )
+{
+    char string[512];
+    GLdouble delta_y = 0.0;
+    const GLdouble bound_x = 370.0;
+    const GLdouble text_yoff = 15.0;
+    const GLdouble text_xoff = 5.0;
+    const GLdouble bin_width = 50.0;
+    const GLdouble hist_height = 25.0;
+
+    glLineWidth( 2.0f );
+
+    render_line(
+            base_x,
+            base_y,
+            base_x + bound_x,
+            base_y );
+
+    snprintf(
+            string,
+            sizeof(string),
+            "%s - min/mean/max (us), histogram bins (us)",
+            node->name );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff,
+            string,
+            NULL );
+
+    delta_y += text_yoff + 15.0;
+
+    render_bin_labels(
+            base_x + text_xoff,
+            base_y + delta_y,
+            bin_width );
+
+    delta_y += 5.0;
+
+    render_line(
+            base_x,
+            base_y + delta_y,
+            base_x + bound_x,
+            base_y + delta_y );
+
+    unsigned long idx = 0;
+    for( idx = 0; idx < HOBD_PROFILE_STAGE_COUNT; idx += 1 )
+    {
+        const pt_stage_s * const stage = &node->stages[ idx ];
+
+        // only the stages the node reports
+        if( stage->rx_time != 0 )
+        {
+            snprintf(
+                    string,
+                    sizeof(string),
+                    "%-20s : %.1f / %.1f / %.1f - %u %%",
+                    pt_get_stage_name( idx ),
+                    pt_ticks_to_us( (unsigned long) stage->profile.min ),
+                    pt_ticks_to_us( (unsigned long) stage->profile.mean ),
+                    pt_ticks_to_us( (unsigned long) stage->profile.max ),
+                    (unsigned int) stage->profile.load );
+
+            render_text_2d(
+                    base_x + text_xoff,
+                    base_y + delta_y + text_yoff,
+                    string,
+                    NULL );
+
+            delta_y += text_yoff + 5.0 + hist_height;
+
+            render_histogram(
+                    stage,
+                    base_x + text_xoff,
+                    base_y + delta_y,
+                    bin_width,
+                    hist_height );
+
+            delta_y += 5.0;
+        }
+    }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file render_hobd_time_sync.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "gl_headers.h"
+#include "math_util.h"
+#include "time_domain.h"
+#include "render.h"
+#include "config.h"
+#include "signal_table_def.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static const char *get_state_name(
+        const uint8_t state );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static const char *get_state_name(
+        const uint8_t state )
+{
+    const char *name = "UNKNOWN";
+
+    if( state == HOBD_TIME_SYNC_STATE_NONE )
+    {
+        name = "NONE";
+    }
+    else if( state == HOBD_TIME_SYNC_STATE_LOCKING )
+    {
+        name = "LOCKING";
+    }
+    else if( state == HOBD_TIME_SYNC_STATE_LOCKED )
+    {
+        name = "LOCKED";
+    }
+    else if( state == HOBD_TIME_SYNC_STATE_HOLDOVER )
+    {
+        name = "HOLDOVER";
+    }
+
+    return name;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void render_hobd_time_sync(
+        const config_s * const config,
+        const hobd_time_sync_s * const data,
+        const GLdouble base_x,
+        const GLdouble base_y )
+{
+    char string[512];
+    GLdouble delta_y = 5.0;
+    const GLdouble bound_x = 355.0;
+    const GLdouble text_yoff = 15.0;
+    const GLdouble text_xoff = 5.0;
+
+    render_line(
+            base_x,
+            base_y,
+            base_x + bound_x,
+            base_y );
+
+    snprintf(
+            string,
+            sizeof(string),
+            "state                                            : %s",
+            get_state_name( data->state ) );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff,
+            string,
+            NULL );
+
+    render_line(
+            base_x,
+            base_y + text_yoff + delta_y,
+            base_x + bound_x,
+            base_y + text_yoff + delta_y );
+
+    delta_y += 15.0;
+
+    snprintf(
+            string,
+            sizeof(string),
+            "sequence                                     : %lu",
+            (unsigned long) data->sequence );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff + delta_y,
+            string,
+            NULL );
+
+    delta_y += 5.0;
+
+    render_line(
+            base_x,
+            base_y + text_yoff + delta_y,
+            base_x + bound_x,
+            base_y + text_yoff + delta_y );
+
+    delta_y += 15.0;
+
+    snprintf(
+            string,
+            sizeof(string),
+            "error                                            : %ld us",
+            (long) data->error );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff + delta_y,
+            string,
+            NULL );
+
+    delta_y += 5.0;
+
+    render_line(
+            base_x,
+            base_y + text_yoff + delta_y,
+            base_x + bound_x,
+            base_y + text_yoff + delta_y );
+
+    delta_y += 15.0;
+
+    snprintf(
+            string,
+            sizeof(string),
+            "drift                                             : %.3f ppm",
+            (double) data->drift / 1000.0 );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff + delta_y,
+            string,
+            NULL );
+
+    delta_y += 5.0;
+
+    render_line(
+            base_x,
+            base_y + text_yoff + delta_y,
+            base_x + bound_x,
+            base_y + text_yoff + delta_y );
+}
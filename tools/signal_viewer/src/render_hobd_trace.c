@@ -0,0 +1,151 @@
+/**
+ * @file render_hobd_trace.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gl_headers.h"
+#include "math_util.h"
+#include "time_domain.h"
+#include "render.h"
+#include "config.h"
+#include "trace_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void render_hobd_trace(
+        const config_s * const config,
+        const tt_node_s * const node,
+        const GLdouble base_x,
+        const GLdouble base_y )
+{
+    char string[512];
+    GLdouble delta_y = 0.0;
+    const GLdouble bound_x = 370.0;
+    const GLdouble text_yoff = 15.0;
+    const GLdouble text_xoff = 5.0;
+    tt_percentiles_s percentiles;
+
+    glLineWidth( 2.0f );
+
+    render_line(
+            base_x,
+            base_y,
+            base_x + bound_x,
+            base_y );
+
+    snprintf(
+            string,
+            sizeof(string),
+            "%s - p50/p90/p99/max (us)",
+            node->name );
+
+    render_text_2d(
+            base_x + text_xoff,
+            base_y + text_yoff,
+            string,
+            NULL );
+
+    delta_y += text_yoff + 5.0;
+
+    unsigned long idx = 0;
+    for( idx = 0; idx < HOBD_TRACE_GROUP_COUNT; idx += 1 )
+    {
+        const tt_group_s * const group = &node->groups[ idx ];
+
+        // only the groups the node traces
+        if( group->rx_time != 0 )
+        {
+            render_line(
+                    base_x,
+                    base_y + delta_y,
+                    base_x + bound_x,
+                    base_y + delta_y );
+
+            snprintf(
+                    string,
+                    sizeof(string),
+                    "%s : %llu traces, %llu lost",
+                    tt_get_group_name( idx ),
+                    group->trace_count,
+                    group->lost_count );
+
+            render_text_2d(
+                    base_x + text_xoff,
+                    base_y + delta_y + text_yoff,
+                    string,
+                    NULL );
+
+            delta_y += text_yoff + 5.0;
+
+            unsigned long latency = 0;
+            for( latency = 0; latency < TT_LATENCY_COUNT; latency += 1 )
+            {
+                tt_get_percentiles(
+                        group,
+                        latency,
+                        &percentiles );
+
+                snprintf(
+                        string,
+                        sizeof(string),
+                        "  %-16s : %.0f / %.0f / %.0f / %.0f",
+                        tt_get_latency_name( latency ),
+                        percentiles.p50,
+                        percentiles.p90,
+                        percentiles.p99,
+                        percentiles.max );
+
+                render_text_2d(
+                        base_x + text_xoff,
+                        base_y + delta_y + text_yoff,
+                        string,
+                        NULL );
+
+                delta_y += text_yoff + 5.0;
+            }
+        }
+    }
+}
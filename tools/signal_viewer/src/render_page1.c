@@ -47,6 +47,14 @@ void render_hobd_heartbeat(
         const GLdouble base_y );
 
 
+//
+void render_hobd_time_sync(
+        const config_s * const config,
+        const hobd_time_sync_s * const data,
+        const GLdouble base_x,
+        const GLdouble base_y );
+
+
 
 
 // *****************************************************
@@ -76,6 +84,14 @@ void render_page1(
             HOBD_CAN_ID_HEARTBEAT_IMU_GATEWAY,
             state );
 
+    signal_table_s * const table2 = st_get_table_by_can_id(
+            HOBD_CAN_ID_TIME_SYNC_OBD_GATEWAY,
+            state );
+
+    signal_table_s * const table3 = st_get_table_by_can_id(
+            HOBD_CAN_ID_TIME_SYNC_IMU_GATEWAY,
+            state );
+
     // render tables
     if( table0 != NULL )
     {
@@ -97,5 +113,25 @@ void render_page1(
                 80.0 );
     }
 
+    if( table2 != NULL )
+    {
+        render_table_base( table2, 795.0, 40.0 );
+        render_hobd_time_sync(
+                config,
+                &table2->time_sync_obd_gateway,
+                810.0,
+                80.0 );
+    }
+
+    if( table3 != NULL )
+    {
+        render_table_base( table3, 795.0, 240.0 );
+        render_hobd_time_sync(
+                config,
+                &table3->time_sync_imu_gateway,
+                810.0,
+                280.0 );
+    }
+
     glPopMatrix();
 }
@@ -0,0 +1,83 @@
+/**
+ * @file render_page7.c
+ * @brief TODO.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gl_headers.h"
+#include "math_util.h"
+#include "time_domain.h"
+#include "render.h"
+#include "signal_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+void render_hobd_trace(
+        const config_s * const config,
+        const tt_node_s * const node,
+        const GLdouble base_x,
+        const GLdouble base_y );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void render_page7(
+        const config_s * const config,
+        st_state_s * const state )
+{
+    glPushMatrix();
+
+    render_hobd_trace(
+            config,
+            &state->trace.nodes[ TT_NODE_OBD_GATEWAY ],
+            5.0,
+            40.0 );
+
+    render_hobd_trace(
+            config,
+            &state->trace.nodes[ TT_NODE_IMU_GATEWAY ],
+            400.0,
+            40.0 );
+
+    glPopMatrix();
+}
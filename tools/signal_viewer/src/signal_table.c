@@ -33,6 +33,50 @@
 // static global data
 // *****************************************************
 
+// CAN IDs without a table that the profile/trace tables or the compact
+// IMU expansion decode
+static const unsigned long DECODED_CAN_IDS[] =
+{
+    HOBD_CAN_ID_PROFILE_OBD_GATEWAY,
+    HOBD_CAN_ID_PROFILE_IMU_GATEWAY,
+    HOBD_CAN_ID_PROFILE_HIST_OBD_GATEWAY,
+    HOBD_CAN_ID_PROFILE_HIST_IMU_GATEWAY,
+    HOBD_CAN_ID_TRACE_OBD_GATEWAY,
+    HOBD_CAN_ID_TRACE_IMU_GATEWAY,
+    HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT,
+    HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN,
+    HOBD_CAN_ID_IMU_COMPACT_ACCEL
+};
+
+
+// HOBD CAN IDs without a table that nothing decodes, so only foreign IDs
+// are counted as unknown
+static const unsigned long KNOWN_CAN_IDS[] =
+{
+    HOBD_CAN_ID_COMMAND,
+    HOBD_CAN_ID_RESPONSE,
+    HOBD_CAN_ID_RX_STATS_OBD_GATEWAY,
+    HOBD_CAN_ID_RX_STATS_IMU_GATEWAY,
+    HOBD_CAN_ID_PUBLISH_STATS_OBD_GATEWAY,
+    HOBD_CAN_ID_PUBLISH_STATS_IMU_GATEWAY,
+    HOBD_CAN_ID_GPS_BASELINE_NED2,
+    HOBD_CAN_ID_GPS_BASELINE_NED3,
+    HOBD_CAN_ID_GPS_VEL_NED1,
+    HOBD_CAN_ID_GPS_VEL_NED2,
+    HOBD_CAN_ID_GPS_VEL_NED3,
+    HOBD_CAN_ID_GPS_HEADING1,
+    HOBD_CAN_ID_GPS_HEADING2,
+    HOBD_CAN_ID_GPS_DOP1,
+    HOBD_CAN_ID_GPS_DOP2,
+    HOBD_CAN_ID_IMU_SAMPLE_TIME,
+    HOBD_CAN_ID_IMU_POS_LLH1,
+    HOBD_CAN_ID_IMU_POS_LLH2,
+    HOBD_CAN_ID_IMU_VEL_NED1,
+    HOBD_CAN_ID_IMU_VEL_NED2,
+    HOBD_CAN_ID_IMU_MAGF1,
+    HOBD_CAN_ID_IMU_MAGF2
+};
+
 
 
 
@@ -70,12 +114,242 @@ void render_page5(
         st_state_s * const state );
 
 
+//
+void render_page6(
+        const config_s * const config,
+        st_state_s * const state );
+
+
+//
+void render_page7(
+        const config_s * const config,
+        st_state_s * const state );
+
+
+//
+static void build_can_id_map(
+        const unsigned long table_count,
+        st_state_s * const state );
+
+
+//
+static unsigned long get_can_id_slot(
+        const unsigned long can_id,
+        const st_state_s * const state );
+
+
+//
+static void update_table(
+        const can_frame_s * const can_frame,
+        st_state_s * const state );
+
+
+//
+static double from_compact(
+        const int16_t value,
+        const double scale );
+
+
+//
+static unsigned long expand_imu_compact(
+        const can_frame_s * const can_frame,
+        can_frame_s * const expanded );
+
+
 
 
 // *****************************************************
 // static definitions
 // *****************************************************
 
+// the first table of a CAN ID wins, as with the linear search it replaces
+static void build_can_id_map(
+        const unsigned long table_count,
+        st_state_s * const state )
+{
+    unsigned long idx = 0;
+
+    memset(
+            state->can_id_map,
+            (int) ST_CAN_ID_UNKNOWN,
+            sizeof(state->can_id_map) );
+
+    for( idx = 0; idx < (sizeof(DECODED_CAN_IDS) / sizeof(DECODED_CAN_IDS[0])); idx += 1 )
+    {
+        state->can_id_map[ DECODED_CAN_IDS[ idx ] ] = (unsigned char) ST_CAN_ID_DECODED;
+    }
+
+    for( idx = 0; idx < table_count; idx += 1 )
+    {
+        const unsigned long can_id = state->signal_tables[ idx ].can_id;
+
+        if( (can_id < ST_CAN_ID_COUNT) && (state->can_id_map[ can_id ] == (unsigned char) ST_CAN_ID_UNKNOWN) )
+        {
+            state->can_id_map[ can_id ] = (unsigned char) idx;
+        }
+    }
+
+    // a table added for one of them takes precedence
+    for( idx = 0; idx < (sizeof(KNOWN_CAN_IDS) / sizeof(KNOWN_CAN_IDS[0])); idx += 1 )
+    {
+        if( state->can_id_map[ KNOWN_CAN_IDS[ idx ] ] == (unsigned char) ST_CAN_ID_UNKNOWN )
+        {
+            state->can_id_map[ KNOWN_CAN_IDS[ idx ] ] = (unsigned char) ST_CAN_ID_KNOWN;
+        }
+    }
+
+    state->unknown_frame_count = 0;
+    state->unknown_can_id = 0;
+}
+
+
+// IDs outside the map are unknown
+static unsigned long get_can_id_slot(
+        const unsigned long can_id,
+        const st_state_s * const state )
+{
+    unsigned long slot = ST_CAN_ID_UNKNOWN;
+
+    if( can_id < ST_CAN_ID_COUNT )
+    {
+        slot = (unsigned long) state->can_id_map[ can_id ];
+    }
+
+    return slot;
+}
+
+
+//
+static void update_table(
+        const can_frame_s * const can_frame,
+        st_state_s * const state )
+{
+    // get a pointer to the data if we have a table for the frame
+    signal_table_s * const table = st_get_table_by_can_id(
+            can_frame->id,
+            state );
+
+    // copy new data
+    if( table != NULL )
+    {
+        table->native_rx_time = can_frame->native_rx_timestamp;
+        table->rx_time = can_frame->rx_timestamp;
+        table->rx_time_mono = can_frame->rx_timestamp_mono;
+
+        memcpy(
+                (void*) &table->buffer[ 0 ],
+                (void*) &can_frame->data[ 0 ],
+                (size_t) table->can_dlc );
+    }
+}
+
+
+//
+static double from_compact(
+        const int16_t value,
+        const double scale )
+{
+    return ((double) value / scale);
+}
+
+
+// compact IMU frames are expanded into the full encoding frames they
+// replace, so the tables only hold the one encoding
+// each frame is checked on its own, the orientation frame's version is
+// its CAN ID, the others carry theirs
+// returns the number of expanded frames, zero for other frames and for
+// compact frames of an unknown schema version
+static unsigned long expand_imu_compact(
+        const can_frame_s * const can_frame,
+        can_frame_s * const expanded )
+{
+    unsigned long count = 0;
+
+    // the rate of turn and acceleration frames share a layout
+    const hobd_imu_compact_rate_of_turn_s * const versioned =
+            (const hobd_imu_compact_rate_of_turn_s*) &can_frame->data[ 0 ];
+
+    const unsigned int version_known =
+            ((can_frame->dlc == (unsigned long) sizeof(*versioned))
+            && (versioned->version == HOBD_IMU_COMPACT_VERSION)) ? TRUE : FALSE;
+
+    if(
+            (can_frame->id == HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT)
+            && (can_frame->dlc == (unsigned long) sizeof(hobd_imu_compact_orient_quat_s)) )
+    {
+        const hobd_imu_compact_orient_quat_s * const compact =
+                (const hobd_imu_compact_orient_quat_s*) &can_frame->data[ 0 ];
+        hobd_imu_orient_quat1_s * const quat1 =
+                (hobd_imu_orient_quat1_s*) &expanded[ 0 ].data[ 0 ];
+        hobd_imu_orient_quat2_s * const quat2 =
+                (hobd_imu_orient_quat2_s*) &expanded[ 1 ].data[ 0 ];
+
+        expanded[ 0 ] = *can_frame;
+        expanded[ 0 ].id = HOBD_CAN_ID_IMU_ORIENT_QUAT1;
+        expanded[ 0 ].dlc = (unsigned long) sizeof(*quat1);
+        expanded[ 1 ] = *can_frame;
+        expanded[ 1 ].id = HOBD_CAN_ID_IMU_ORIENT_QUAT2;
+        expanded[ 1 ].dlc = (unsigned long) sizeof(*quat2);
+
+        quat1->q1 = (float) from_compact( compact->q1, HOBD_IMU_COMPACT_QUAT_SCALE );
+        quat1->q2 = (float) from_compact( compact->q2, HOBD_IMU_COMPACT_QUAT_SCALE );
+        quat2->q3 = (float) from_compact( compact->q3, HOBD_IMU_COMPACT_QUAT_SCALE );
+        quat2->q4 = (float) from_compact( compact->q4, HOBD_IMU_COMPACT_QUAT_SCALE );
+
+        count = 2;
+    }
+    else if(
+            (can_frame->id == HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN)
+            && (version_known == TRUE) )
+    {
+        const hobd_imu_compact_rate_of_turn_s * const compact =
+                (const hobd_imu_compact_rate_of_turn_s*) &can_frame->data[ 0 ];
+        hobd_imu_rate_of_turn1_s * const rate1 =
+                (hobd_imu_rate_of_turn1_s*) &expanded[ 0 ].data[ 0 ];
+        hobd_imu_rate_of_turn2_s * const rate2 =
+                (hobd_imu_rate_of_turn2_s*) &expanded[ 1 ].data[ 0 ];
+
+        expanded[ 0 ] = *can_frame;
+        expanded[ 0 ].id = HOBD_CAN_ID_IMU_RATE_OF_TURN1;
+        expanded[ 0 ].dlc = (unsigned long) sizeof(*rate1);
+        expanded[ 1 ] = *can_frame;
+        expanded[ 1 ].id = HOBD_CAN_ID_IMU_RATE_OF_TURN2;
+        expanded[ 1 ].dlc = (unsigned long) sizeof(*rate2);
+
+        rate1->x = (float) from_compact( compact->x, HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+        rate1->y = (float) from_compact( compact->y, HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+        rate2->z = (float) from_compact( compact->z, HOBD_IMU_COMPACT_RATE_OF_TURN_SCALE );
+
+        count = 2;
+    }
+    else if(
+            (can_frame->id == HOBD_CAN_ID_IMU_COMPACT_ACCEL)
+            && (version_known == TRUE) )
+    {
+        const hobd_imu_compact_accel_s * const compact =
+                (const hobd_imu_compact_accel_s*) &can_frame->data[ 0 ];
+        hobd_imu_accel1_s * const accel1 =
+                (hobd_imu_accel1_s*) &expanded[ 0 ].data[ 0 ];
+        hobd_imu_accel2_s * const accel2 =
+                (hobd_imu_accel2_s*) &expanded[ 1 ].data[ 0 ];
+
+        expanded[ 0 ] = *can_frame;
+        expanded[ 0 ].id = HOBD_CAN_ID_IMU_ACCEL1;
+        expanded[ 0 ].dlc = (unsigned long) sizeof(*accel1);
+        expanded[ 1 ] = *can_frame;
+        expanded[ 1 ].id = HOBD_CAN_ID_IMU_ACCEL2;
+        expanded[ 1 ].dlc = (unsigned long) sizeof(*accel2);
+
+        accel1->x = (float) from_compact( compact->x, HOBD_IMU_COMPACT_ACCEL_SCALE );
+        accel1->y = (float) from_compact( compact->y, HOBD_IMU_COMPACT_ACCEL_SCALE );
+        accel2->z = (float) from_compact( compact->z, HOBD_IMU_COMPACT_ACCEL_SCALE );
+
+        count = 2;
+    }
+
+    return count;
+}
+
 //
 static void render_page_header(
         const config_s * const config,
@@ -91,7 +365,9 @@ static void render_page_header(
     const GLdouble date_xoff = 5.0;
     const GLdouble mstime_xoff = 200.0;
     const GLdouble monotime_xoff = 400.0;
-    const GLdouble page_xoff = 600.0;
+    const GLdouble record_xoff = 600.0;
+    const GLdouble page_xoff = 800.0;
+    const GLdouble unknown_xoff = 1000.0;
 
     glLineWidth( 2.0f );
 
@@ -137,6 +413,23 @@ static void render_page_header(
             string,
             NULL );
 
+    if( state->record_enabled != 0 )
+    {
+        snprintf(
+                string,
+                sizeof(string),
+                "Rec drop: %llu lat: %llu/%llu ms",
+                state->record_status.drop_count,
+                state->record_status.latency,
+                state->record_status.max_latency );
+
+        render_text_2d(
+                record_xoff,
+                text_yoff,
+                string,
+                NULL );
+    }
+
     snprintf(
             string,
             sizeof(string),
@@ -149,6 +442,19 @@ static void render_page_header(
             text_yoff,
             string,
             NULL );
+
+    snprintf(
+            string,
+            sizeof(string),
+            "Unknown: %llu (0x%03lX)",
+            state->unknown_frame_count,
+            state->unknown_can_id );
+
+    render_text_2d(
+            unknown_xoff,
+            text_yoff,
+            string,
+            NULL );
 }
 
 
@@ -165,6 +471,10 @@ void st_init(
 {
     unsigned long index = 0;
 
+    pt_init( &state->profile );
+
+    tt_init( &state->trace );
+
     {
         signal_table_s * const table = &state->signal_tables[ index++ ];
 
@@ -187,6 +497,28 @@ void st_init(
                 "IMU Heartbeat" );
     }
 
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_TIME_SYNC_OBD_GATEWAY;
+        table->can_dlc = (unsigned long) sizeof( table->time_sync_obd_gateway );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "OBD Time Sync" );
+    }
+
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_TIME_SYNC_IMU_GATEWAY;
+        table->can_dlc = (unsigned long) sizeof( table->time_sync_imu_gateway );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Time Sync" );
+    }
+
     {
         signal_table_s * const table = &state->signal_tables[ index++ ];
 
@@ -198,6 +530,17 @@ void st_init(
                 "OBD Time" );
     }
 
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_OBD_TIME_US;
+        table->can_dlc = (unsigned long) sizeof( table->obd_time_us );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "OBD Time us" );
+    }
+
     {
         signal_table_s * const table = &state->signal_tables[ index++ ];
 
@@ -253,6 +596,17 @@ void st_init(
                 "GPS Time 2" );
     }
 
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_GPS_TIME_US;
+        table->can_dlc = (unsigned long) sizeof( table->gps_time_us );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "GPS Time us" );
+    }
+
     {
         signal_table_s * const table = &state->signal_tables[ index++ ];
 
@@ -275,6 +629,17 @@ void st_init(
                 "IMU Time 2" );
     }
 
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_IMU_TIME_US;
+        table->can_dlc = (unsigned long) sizeof( table->imu_time_us );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Time us" );
+    }
+
     {
         signal_table_s * const table = &state->signal_tables[ index++ ];
 
@@ -373,6 +738,53 @@ void st_init(
                 sizeof(table->table_name),
                 "IMU Rate of Turn 2" );
     }
+
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_IMU_ORIENT_QUAT1;
+        table->can_dlc = (unsigned long) sizeof( table->imu_orient_quat1 );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Orientation Quaternion 1" );
+    }
+
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_IMU_ORIENT_QUAT2;
+        table->can_dlc = (unsigned long) sizeof( table->imu_orient_quat2 );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Orientation Quaternion 2" );
+    }
+
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_IMU_ACCEL1;
+        table->can_dlc = (unsigned long) sizeof( table->imu_accel1 );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Acceleration 1" );
+    }
+
+    {
+        signal_table_s * const table = &state->signal_tables[ index++ ];
+
+        table->can_id = HOBD_CAN_ID_IMU_ACCEL2;
+        table->can_dlc = (unsigned long) sizeof( table->imu_accel2 );
+        snprintf(
+                table->table_name,
+                sizeof(table->table_name),
+                "IMU Acceleration 2" );
+    }
+
+    // tables past index are unused
+    build_can_id_map( index, state );
 }
 
 
@@ -415,6 +827,14 @@ void st_render(
     {
         render_page5( config, state );
     }
+    else if( config->active_page_index == ST_PAGE_6 )
+    {
+        render_page6( config, state );
+    }
+    else if( config->active_page_index == ST_PAGE_7 )
+    {
+        render_page7( config, state );
+    }
 
     glPopMatrix();
 }
@@ -427,13 +847,11 @@ signal_table_s *st_get_table_by_can_id(
 {
     signal_table_s *table = NULL;
 
-    unsigned long idx = 0;
-    for( idx = 0; (idx < ST_SIGNAL_COUNT) && (table == NULL); idx += 1 )
+    const unsigned long slot = get_can_id_slot( can_id, state );
+
+    if( slot < ST_SIGNAL_COUNT )
     {
-        if( state->signal_tables[ idx ].can_id == can_id )
-        {
-            table = &state->signal_tables[ idx ];
-        }
+        table = &state->signal_tables[ slot ];
     }
 
     return table;
@@ -448,22 +866,35 @@ void st_process_can_frame(
 {
     if( config->freeze_frame_enabled == FALSE )
     {
-        // get a pointer to the data if we have a table for the frame
-        signal_table_s * const table = st_get_table_by_can_id(
-                can_frame->id,
-                state );
+        can_frame_s expanded[ ST_IMU_COMPACT_EXPAND_MAX ];
+
+        const unsigned long expanded_count = expand_imu_compact(
+                can_frame,
+                expanded );
 
-        // copy new data
-        if( table != NULL )
+        unsigned long idx = 0;
+        for( idx = 0; idx < expanded_count; idx += 1 )
         {
-            table->native_rx_time = can_frame->native_rx_timestamp;
-            table->rx_time = can_frame->rx_timestamp;
-            table->rx_time_mono = can_frame->rx_timestamp_mono;
-
-            memcpy(
-                    (void*) &table->buffer[ 0 ],
-                    (void*) &can_frame->data[ 0 ],
-                    (size_t) table->can_dlc );
+            update_table( &expanded[ idx ], state );
         }
+
+        update_table( can_frame, state );
+
+        // neither tabled nor decoded, counted instead of dropped silently
+        if( get_can_id_slot( can_frame->id, state ) == ST_CAN_ID_UNKNOWN )
+        {
+            state->unknown_frame_count += 1;
+            state->unknown_can_id = can_frame->id;
+        }
+
+        // profile frames are accumulated, not tabled
+        pt_process_can_frame(
+                can_frame,
+                &state->profile );
+
+        // as are the trace frames
+        tt_process_can_frame(
+                can_frame,
+                &state->trace );
     }
 }
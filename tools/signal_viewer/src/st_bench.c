@@ -0,0 +1,235 @@
+/**
+ * @file st_bench.c
+ * @brief Signal table CAN frame benchmark.
+ *
+ * Replays frames through st_process_can_frame round robin over every
+ * tabled CAN ID, the profile, trace and compact IMU IDs decoded outside
+ * the tables, the command/response IDs that have neither, and one
+ * foreign ID that is counted as unknown.
+ *
+ * Reports the host time per frame.
+ *
+ * Usage: hobd-st-bench [frames]
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "config.h"
+#include "signal_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define FRAMES_DEFAULT (1000000UL)
+
+
+// tabled IDs plus the untabled ones below
+#define FRAME_SET_MAX (ST_SIGNAL_COUNT + 16UL)
+
+
+// not a HOBD ID, an OBD-II diagnostic response
+#define FOREIGN_CAN_ID (0x7E8UL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static config_s config;
+
+
+//
+static st_state_s state;
+
+
+//
+static can_frame_s frame_set[ FRAME_SET_MAX ];
+
+
+// CAN IDs without a signal table
+static const unsigned long UNTABLED_CAN_IDS[] =
+{
+    HOBD_CAN_ID_PROFILE_OBD_GATEWAY,
+    HOBD_CAN_ID_PROFILE_HIST_OBD_GATEWAY,
+    HOBD_CAN_ID_TRACE_OBD_GATEWAY,
+    HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT,
+    HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN,
+    HOBD_CAN_ID_IMU_COMPACT_ACCEL,
+    HOBD_CAN_ID_COMMAND,
+    HOBD_CAN_ID_RESPONSE,
+    FOREIGN_CAN_ID
+};
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static double get_time_ns( void );
+
+
+//
+static unsigned long build_frame_set( void );
+
+
+//
+static double run(
+        const unsigned long set_count,
+        const unsigned long frames );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static double get_time_ns( void )
+{
+    struct timespec now;
+
+    (void) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((double) now.tv_sec * 1.0e9) + (double) now.tv_nsec;
+}
+
+
+// one frame per ID, all zero data
+static unsigned long build_frame_set( void )
+{
+    unsigned long count = 0;
+    unsigned long idx = 0;
+
+    memset( frame_set, 0, sizeof(frame_set) );
+
+    for( idx = 0; idx < ST_SIGNAL_COUNT; idx += 1 )
+    {
+        const signal_table_s * const table = &state.signal_tables[ idx ];
+
+        if( table->can_dlc != 0 )
+        {
+            frame_set[ count ].id = table->can_id;
+            frame_set[ count ].dlc = table->can_dlc;
+            count += 1;
+        }
+    }
+
+    for( idx = 0; idx < (sizeof(UNTABLED_CAN_IDS) / sizeof(UNTABLED_CAN_IDS[0])); idx += 1 )
+    {
+        frame_set[ count ].id = UNTABLED_CAN_IDS[ idx ];
+        frame_set[ count ].dlc = 8;
+        count += 1;
+    }
+
+    return count;
+}
+
+
+// ns per frame
+static double run(
+        const unsigned long set_count,
+        const unsigned long frames )
+{
+    unsigned long idx = 0;
+    unsigned long set_idx = 0;
+
+    const double start = get_time_ns();
+
+    for( idx = 0; idx < frames; idx += 1 )
+    {
+        st_process_can_frame( &frame_set[ set_idx ], &config, &state );
+
+        set_idx += 1;
+        if( set_idx == set_count )
+        {
+            set_idx = 0;
+        }
+    }
+
+    const double end = get_time_ns();
+
+    return (end - start) / (double) frames;
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    int ret = EXIT_SUCCESS;
+    unsigned long frames = FRAMES_DEFAULT;
+
+    if( argc > 2 )
+    {
+        fprintf( stderr, "usage: %s [frames]\n", argv[ 0 ] );
+
+        ret = EXIT_FAILURE;
+    }
+    else if( argc == 2 )
+    {
+        frames = strtoul( argv[ 1 ], NULL, 0 );
+
+        if( frames == 0 )
+        {
+            fprintf( stderr, "%s: invalid frame count '%s'\n", argv[ 0 ], argv[ 1 ] );
+
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    if( ret == EXIT_SUCCESS )
+    {
+        memset( &config, 0, sizeof(config) );
+        memset( &state, 0, sizeof(state) );
+
+        config.freeze_frame_enabled = FALSE;
+
+        st_init( &config, &state );
+
+        const unsigned long set_count = build_frame_set();
+
+        // warm up
+        (void) run( set_count, set_count );
+
+        const double frame_ns = run( set_count, frames );
+
+        printf(
+                "hobd-st-bench: %lu frames over %lu CAN IDs, %.1f ns/frame\n",
+                frames,
+                set_count,
+                frame_ns );
+
+        printf(
+                "hobd-st-bench: %llu unknown frames, last CAN ID 0x%03lX\n",
+                state.unknown_frame_count,
+                state.unknown_can_id );
+    }
+
+    return ret;
+}
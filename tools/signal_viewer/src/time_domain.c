@@ -123,6 +123,22 @@ timestamp_ms time_get_monotonic_timestamp( void )
 }
 
 
+//
+timestamp_us time_get_monotonic_timestamp_us( void )
+{
+    struct timespec time;
+    timestamp_us timestamp;
+
+    clock_gettime( CLOCK_MONOTONIC, &time );
+
+    timestamp = (timestamp_us) time.tv_sec * 1000000ULL;
+
+    timestamp += (timestamp_us) NANO_TO_MICRO( (timestamp_us) time.tv_nsec );
+
+    return timestamp;
+}
+
+
 //
 timestamp_ms time_get_since(
         const timestamp_ms const value )
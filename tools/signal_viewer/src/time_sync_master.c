@@ -0,0 +1,140 @@
+/**
+ * @file time_sync_master.c
+ * @brief TODO.
+ *
+ * Time master for the gateways. The host monotonic clock is the shared
+ * time base: a sync broadcast goes out, and once it has left the
+ * interface its follow-up carries the time it did, in microseconds.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "time_domain.h"
+#include "can.h"
+#include "signal_table_def.h"
+#include "time_sync_master.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static int send_command(
+        const can_handle_s handle,
+        const unsigned char id,
+        const unsigned short data_0,
+        const unsigned long data_1 );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static int send_command(
+        const can_handle_s handle,
+        const unsigned char id,
+        const unsigned short data_0,
+        const unsigned long data_1 )
+{
+    hobd_command_s command;
+
+    command.id = (uint8_t) id;
+    command.key = HOBD_COMMAND_KEY_BROADCAST;
+    command.data_0 = (uint16_t) data_0;
+    command.data_1 = (uint32_t) data_1;
+
+    return can_write(
+            handle,
+            HOBD_CAN_ID_COMMAND,
+            (unsigned long) sizeof(command),
+            (const unsigned char*) &command,
+            TSM_TX_TIMEOUT );
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void tsm_init(
+        tsm_state_s * const state )
+{
+    memset( state, 0, sizeof(*state) );
+
+    state->next_sync = time_get_monotonic_timestamp();
+}
+
+
+//
+void tsm_update(
+        const can_handle_s handle,
+        tsm_state_s * const state )
+{
+    const timestamp_ms now = time_get_monotonic_timestamp();
+
+    if( now >= state->next_sync )
+    {
+        int ret = 0;
+
+        state->next_sync = now + (timestamp_ms) HOBD_CAN_TX_INTERVAL_TIME_SYNC;
+        state->sequence += 1;
+
+        ret = send_command(
+                handle,
+                HOBD_COMMAND_ID_TIME_SYNC,
+                state->sequence,
+                0 );
+
+        // the gateways stamped the sync when it was received, which is
+        // as close as the host gets to when it left the interface
+        const timestamp_us tx_time = time_get_monotonic_timestamp_us();
+
+        if( ret == 0 )
+        {
+            // the gateway clocks wrap at 32 bits
+            ret = send_command(
+                    handle,
+                    HOBD_COMMAND_ID_TIME_FOLLOW_UP,
+                    state->sequence,
+                    (unsigned long) (tx_time & 0xFFFFFFFFULL) );
+        }
+
+        if( ret == 0 )
+        {
+            state->sync_count += 1;
+        }
+        else
+        {
+            state->error_count += 1;
+        }
+    }
+}
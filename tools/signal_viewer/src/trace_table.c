@@ -0,0 +1,297 @@
+/**
+ * @file trace_table.c
+ * @brief TODO.
+ *
+ * Decodes the gateway publish group trace frames into a sliding window of
+ * latencies per group. Live and replayed frames take the same path, so
+ * the percentiles cover the last TT_WINDOW_SIZE traces either way.
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "trace_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static const char * const GROUP_NAMES[ HOBD_TRACE_GROUP_COUNT ] =
+{
+    "OBD Table 16",
+    "OBD Table 209",
+    "GPS",
+    "IMU"
+};
+
+
+//
+static const char * const LATENCY_NAMES[ TT_LATENCY_COUNT ] =
+{
+    "Rx to Parse",
+    "Parse to Queue",
+    "Queue to Tx",
+    "Rx to Tx"
+};
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static tt_node_s *get_node(
+        const unsigned long node_id,
+        tt_state_s * const state );
+
+
+//
+static int compare_samples(
+        const void * const a,
+        const void * const b );
+
+
+//
+static double get_rank(
+        const unsigned long * const sorted,
+        const unsigned long count,
+        const double percent );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static tt_node_s *get_node(
+        const unsigned long node_id,
+        tt_state_s * const state )
+{
+    tt_node_s *node = NULL;
+
+    unsigned long idx = 0;
+    for( idx = 0; (idx < TT_NODE_COUNT) && (node == NULL); idx += 1 )
+    {
+        if( state->nodes[ idx ].node_id == node_id )
+        {
+            node = &state->nodes[ idx ];
+        }
+    }
+
+    return node;
+}
+
+
+//
+static int compare_samples(
+        const void * const a,
+        const void * const b )
+{
+    const unsigned long value_a = *((const unsigned long*) a);
+    const unsigned long value_b = *((const unsigned long*) b);
+
+    int ret = 0;
+
+    if( value_a < value_b )
+    {
+        ret = -1;
+    }
+    else if( value_a > value_b )
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+// nearest rank, sorted must not be empty
+static double get_rank(
+        const unsigned long * const sorted,
+        const unsigned long count,
+        const double percent )
+{
+    const double position = (percent / 100.0) * (double) count;
+
+    // smallest sample with at least percent of the samples at or below it
+    unsigned long rank = (unsigned long) position;
+
+    if( ((double) rank == position) && (rank != 0) )
+    {
+        rank -= 1;
+    }
+
+    if( rank >= count )
+    {
+        rank = count - 1;
+    }
+
+    return (double) sorted[ rank ];
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+void tt_init(
+        tt_state_s * const state )
+{
+    memset( state, 0, sizeof(*state) );
+
+    state->nodes[ TT_NODE_OBD_GATEWAY ].node_id =
+            (HOBD_CAN_ID_TRACE_OBD_GATEWAY - HOBD_CAN_ID_TRACE_BASE);
+    snprintf(
+            state->nodes[ TT_NODE_OBD_GATEWAY ].name,
+            sizeof(state->nodes[ TT_NODE_OBD_GATEWAY ].name),
+            "OBD Gateway Latency" );
+
+    state->nodes[ TT_NODE_IMU_GATEWAY ].node_id =
+            (HOBD_CAN_ID_TRACE_IMU_GATEWAY - HOBD_CAN_ID_TRACE_BASE);
+    snprintf(
+            state->nodes[ TT_NODE_IMU_GATEWAY ].name,
+            sizeof(state->nodes[ TT_NODE_IMU_GATEWAY ].name),
+            "IMU Gateway Latency" );
+}
+
+
+//
+void tt_process_can_frame(
+        const can_frame_s * const can_frame,
+        tt_state_s * const state )
+{
+    tt_node_s *node = NULL;
+
+    if(
+            (can_frame->id >= HOBD_CAN_ID_TRACE_BASE)
+            && (can_frame->dlc == (unsigned long) sizeof(hobd_trace_s)) )
+    {
+        const hobd_trace_s * const trace =
+                (const hobd_trace_s*) &can_frame->data[ 0 ];
+
+        node = get_node( can_frame->id - HOBD_CAN_ID_TRACE_BASE, state );
+
+        if( (node != NULL) && (trace->group < HOBD_TRACE_GROUP_COUNT) )
+        {
+            tt_group_s * const group = &node->groups[ trace->group ];
+
+            // the first trace after a gateway reset or a trace enable is 1
+            if( (group->trace_count != 0) && (trace->sequence != 1) )
+            {
+                // sequence numbers wrap at 8 bits
+                const unsigned char gap =
+                        (unsigned char) (trace->sequence - group->trace.sequence - 1);
+
+                group->lost_count += (unsigned long long) gap;
+            }
+
+            group->rx_time = can_frame->rx_timestamp;
+            group->trace = *trace;
+            group->trace_count += 1;
+
+            const unsigned long idx = group->next_sample;
+
+            group->samples[ TT_LATENCY_PARSE ][ idx ] = (unsigned long) trace->parse_latency;
+            group->samples[ TT_LATENCY_QUEUE ][ idx ] = (unsigned long) trace->queue_latency;
+            group->samples[ TT_LATENCY_TX ][ idx ] = (unsigned long) trace->tx_latency;
+            group->samples[ TT_LATENCY_TOTAL ][ idx ] =
+                    (unsigned long) trace->parse_latency
+                    + (unsigned long) trace->queue_latency
+                    + (unsigned long) trace->tx_latency;
+
+            group->next_sample = ((idx + 1) % TT_WINDOW_SIZE);
+
+            if( group->sample_count < TT_WINDOW_SIZE )
+            {
+                group->sample_count += 1;
+            }
+        }
+    }
+}
+
+
+//
+const char *tt_get_group_name(
+        const unsigned long group )
+{
+    const char *name = "Unknown";
+
+    if( group < HOBD_TRACE_GROUP_COUNT )
+    {
+        name = GROUP_NAMES[ group ];
+    }
+
+    return name;
+}
+
+
+//
+const char *tt_get_latency_name(
+        const unsigned long latency )
+{
+    const char *name = "Unknown";
+
+    if( latency < TT_LATENCY_COUNT )
+    {
+        name = LATENCY_NAMES[ latency ];
+    }
+
+    return name;
+}
+
+
+//
+void tt_get_percentiles(
+        const tt_group_s * const group,
+        const unsigned long latency,
+        tt_percentiles_s * const percentiles )
+{
+    unsigned long sorted[ TT_WINDOW_SIZE ];
+
+    memset( percentiles, 0, sizeof(*percentiles) );
+
+    if( (group->sample_count != 0) && (latency < TT_LATENCY_COUNT) )
+    {
+        // window order does not matter once sorted
+        memcpy(
+                sorted,
+                group->samples[ latency ],
+                group->sample_count * sizeof(sorted[ 0 ]) );
+
+        qsort(
+                sorted,
+                (size_t) group->sample_count,
+                sizeof(sorted[ 0 ]),
+                &compare_samples );
+
+        percentiles->p50 = get_rank( sorted, group->sample_count, 50.0 );
+        percentiles->p90 = get_rank( sorted, group->sample_count, 90.0 );
+        percentiles->p99 = get_rank( sorted, group->sample_count, 99.0 );
+        percentiles->max = (double) sorted[ group->sample_count - 1 ];
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file canlib.h
+ * @brief Software canlib stand-in for the host tests.
+ *
+ * Declares the subset of the Kvaser canlib API used by can.c, so it
+ * builds without the SDK. The channel is a queue of frames pushed by the
+ * test with canlib_emu_push, read back by canRead/canReadWait with the
+ * canlib 32-bit ms hardware timestamp given at push time.
+ *
+ */
+
+
+
+
+#ifndef CANLIB_H
+#define CANLIB_H
+
+
+
+
+//
+#define canOK (0)
+#define canERR_NOMSG (-2)
+
+
+//
+#define BAUD_500K (-2)
+
+
+//
+#define canDRIVER_NORMAL (4)
+
+
+
+
+//
+typedef int canHandle;
+
+
+//
+typedef int canStatus;
+
+
+// calls seen by the emulated channel
+typedef struct
+{
+    //
+    //
+    unsigned long read_calls;
+    //
+    //
+    unsigned long read_wait_calls;
+    //
+    // of the last canReadWait
+    unsigned long last_timeout;
+} canlib_emu_stats_s;
+
+
+
+
+//
+canHandle canOpenChannel(
+        int channel,
+        int flags );
+
+
+//
+canStatus canSetBusParams(
+        const canHandle handle,
+        long freq,
+        unsigned int tseg1,
+        unsigned int tseg2,
+        unsigned int sjw,
+        unsigned int no_samp,
+        unsigned int syncmode );
+
+
+//
+canStatus canSetBusOutputControl(
+        const canHandle handle,
+        const unsigned int drivertype );
+
+
+//
+canStatus canBusOn(
+        const canHandle handle );
+
+
+//
+canStatus canClose(
+        const canHandle handle );
+
+
+// returns canERR_NOMSG when the queue is empty
+canStatus canRead(
+        const canHandle handle,
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time );
+
+
+// does not wait, an empty queue returns canERR_NOMSG
+canStatus canReadWait(
+        const canHandle handle,
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time,
+        unsigned long timeout );
+
+
+//
+canStatus canWrite(
+        const canHandle handle,
+        long id,
+        void *msg,
+        unsigned int dlc,
+        unsigned int flag );
+
+
+//
+canStatus canWriteSync(
+        const canHandle handle,
+        unsigned long timeout );
+
+
+// empties the queue and clears the stats
+void canlib_emu_reset( void );
+
+
+// queues a frame
+// returns non-zero if the queue is full
+int canlib_emu_push(
+        const unsigned long id,
+        const unsigned long dlc,
+        const unsigned char * const data,
+        const unsigned long tstamp );
+
+
+//
+unsigned long canlib_emu_pending( void );
+
+
+//
+canlib_emu_stats_s canlib_emu_get_stats( void );
+
+
+
+
+#endif /* CANLIB_H */
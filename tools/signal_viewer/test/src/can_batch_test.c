@@ -0,0 +1,319 @@
+/**
+ * @file can_batch_test.c
+ * @brief Host test of can_read_batch over the software canlib stand-in.
+ *
+ * Builds can.c against test/include/canlib.h and checks that batches
+ * drain the channel in order, never read past max_count, block only on
+ * the first read and back-date the host timestamps by the hardware
+ * timestamp distance, across the 32-bit canlib timestamp wraparound.
+ *
+ * Usage: hobd-can-batch-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "canlib.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "can.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define CHECK(cond) check( ((cond) ? 1 : 0), #cond, __LINE__ )
+
+
+// same as the CAN reader thread
+#define BATCH_SIZE (64UL)
+
+
+//
+#define FRAME_COUNT (1000UL)
+
+
+// two frames per ms, starting 8 ms before the 32-bit wrap
+#define TSTAMP_START (0xFFFFFFF8UL)
+
+
+//
+#define TSTAMP_MASK (0xFFFFFFFFULL)
+
+
+//
+#define TIMEOUT (5ULL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static can_frame_s frames[ BATCH_SIZE ];
+
+
+//
+static unsigned long check_count = 0;
+
+
+//
+static unsigned long fail_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line );
+
+
+//
+static void push_frames(
+        const unsigned long count );
+
+
+//
+static unsigned long frame_seq(
+        const can_frame_s * const frame );
+
+
+//
+static void test_drain( void );
+
+
+//
+static void test_sizing( void );
+
+
+//
+static void test_empty( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line )
+{
+    check_count += 1;
+
+    if( ok == 0 )
+    {
+        fail_count += 1;
+        printf( "%s:%d: check failed: %s\n", __FILE__, line, expr );
+    }
+}
+
+
+// the sequence number is the payload, the ID is derived from it
+static void push_frames(
+        const unsigned long count )
+{
+    unsigned long seq = 0;
+
+    for( seq = 0; seq < count; seq += 1 )
+    {
+        unsigned char data[8];
+
+        memset( data, 0, sizeof(data) );
+        memcpy( data, &seq, sizeof(seq) );
+
+        (void) canlib_emu_push(
+                0x040UL + (seq % 0xA0UL),
+                8,
+                data,
+                TSTAMP_START + (seq / 2) );
+    }
+}
+
+
+//
+static unsigned long frame_seq(
+        const can_frame_s * const frame )
+{
+    unsigned long seq = 0;
+
+    memcpy( &seq, frame->data, sizeof(seq) );
+
+    return seq;
+}
+
+
+// all pending frames, in order, in full batches and one partial one
+static void test_drain( void )
+{
+    unsigned long next_seq = 0;
+    unsigned long batches = 0;
+    unsigned long wrapped_batches = 0;
+    unsigned long count = 0;
+
+    canlib_emu_reset();
+    push_frames( FRAME_COUNT );
+
+    do
+    {
+        const unsigned long remaining = canlib_emu_pending();
+        const canlib_emu_stats_s before = canlib_emu_get_stats();
+        const timestamp_ms mono_before = time_get_monotonic_timestamp();
+
+        count = can_read_batch( 0, frames, BATCH_SIZE, TIMEOUT );
+
+        const timestamp_ms mono_after = time_get_monotonic_timestamp();
+        const canlib_emu_stats_s after = canlib_emu_get_stats();
+
+        CHECK( count == ((remaining < BATCH_SIZE) ? remaining : BATCH_SIZE) );
+        CHECK( after.read_wait_calls == (before.read_wait_calls + 1) );
+        CHECK( after.last_timeout == (unsigned long) TIMEOUT );
+
+        // no empty read once the batch is full
+        if( count == BATCH_SIZE )
+        {
+            CHECK( after.read_calls == (before.read_calls + count - 1) );
+        }
+        else
+        {
+            CHECK( after.read_calls == (before.read_calls + count) );
+        }
+
+        if( count != 0 )
+        {
+            const can_frame_s * const last = &frames[ count - 1 ];
+            unsigned long idx = 0;
+
+            // the host clock sample is taken after the last frame
+            CHECK( last->rx_timestamp_mono >= mono_before );
+            CHECK( last->rx_timestamp_mono <= mono_after );
+
+            if( frames[ 0 ].native_rx_timestamp > last->native_rx_timestamp )
+            {
+                wrapped_batches += 1;
+            }
+
+            for( idx = 0; idx < count; idx += 1 )
+            {
+                const can_frame_s * const frame = &frames[ idx ];
+                const timestamp_ms age =
+                        (last->native_rx_timestamp - frame->native_rx_timestamp) & TSTAMP_MASK;
+
+                CHECK( frame_seq( frame ) == next_seq );
+                CHECK( frame->id == (0x040UL + (next_seq % 0xA0UL)) );
+                CHECK( frame->dlc == 8 );
+                CHECK( frame->native_rx_timestamp ==
+                        ((TSTAMP_START + (next_seq / 2)) & TSTAMP_MASK) );
+
+                // within a batch the hardware distance is at most 32 ms
+                CHECK( age <= (BATCH_SIZE / 2) );
+                CHECK( (last->rx_timestamp_mono - frame->rx_timestamp_mono) == age );
+                CHECK( (last->rx_timestamp - frame->rx_timestamp) == age );
+
+                next_seq += 1;
+            }
+
+            batches += 1;
+        }
+    }
+    while( count != 0 );
+
+    CHECK( next_seq == FRAME_COUNT );
+    CHECK( batches == ((FRAME_COUNT + BATCH_SIZE - 1) / BATCH_SIZE) );
+    CHECK( wrapped_batches == 1 );
+    CHECK( canlib_emu_pending() == 0 );
+}
+
+
+// max_count bounds the reads, a zero timeout never uses canReadWait
+static void test_sizing( void )
+{
+    canlib_emu_stats_s stats;
+
+    canlib_emu_reset();
+    push_frames( 10 );
+
+    CHECK( can_read_batch( 0, frames, 0, TIMEOUT ) == 0 );
+    stats = canlib_emu_get_stats();
+    CHECK( (stats.read_calls + stats.read_wait_calls) == 0 );
+
+    CHECK( can_read_batch( CAN_HANDLE_INVALID, frames, BATCH_SIZE, TIMEOUT ) == 0 );
+    stats = canlib_emu_get_stats();
+    CHECK( (stats.read_calls + stats.read_wait_calls) == 0 );
+
+    CHECK( can_read_batch( 0, frames, 1, TIMEOUT ) == 1 );
+    stats = canlib_emu_get_stats();
+    CHECK( stats.read_wait_calls == 1 );
+    CHECK( stats.read_calls == 0 );
+    CHECK( frame_seq( &frames[ 0 ] ) == 0 );
+    CHECK( frames[ 0 ].rx_timestamp_mono != 0 );
+
+    CHECK( can_read_batch( 0, frames, 4, 0 ) == 4 );
+    stats = canlib_emu_get_stats();
+    CHECK( stats.read_wait_calls == 1 );
+    CHECK( stats.read_calls == 4 );
+    CHECK( frame_seq( &frames[ 0 ] ) == 1 );
+    CHECK( frame_seq( &frames[ 3 ] ) == 4 );
+
+    CHECK( can_read_batch( 0, frames, BATCH_SIZE, TIMEOUT ) == 5 );
+    CHECK( frame_seq( &frames[ 4 ] ) == 9 );
+    CHECK( canlib_emu_pending() == 0 );
+}
+
+
+// one blocking read, the frames are untouched
+static void test_empty( void )
+{
+    canlib_emu_stats_s stats;
+
+    canlib_emu_reset();
+    memset( frames, 0xAA, sizeof(frames) );
+
+    CHECK( can_read_batch( 0, frames, BATCH_SIZE, TIMEOUT ) == 0 );
+    stats = canlib_emu_get_stats();
+    CHECK( stats.read_wait_calls == 1 );
+    CHECK( stats.read_calls == 0 );
+    CHECK( frames[ 0 ].rx_timestamp_mono == 0xAAAAAAAAAAAAAAAAULL );
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    test_drain();
+    test_sizing();
+    test_empty();
+
+    printf(
+            "hobd-can-batch-test: %lu checks, %lu failed\n",
+            check_count,
+            fail_count );
+
+    return (fail_count == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
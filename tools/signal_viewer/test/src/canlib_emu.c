@@ -0,0 +1,278 @@
+/**
+ * @file canlib_emu.c
+ * @brief Software canlib stand-in for the host tests.
+ *
+ * One emulated channel, see canlib.h in test/include.
+ *
+ */
+
+
+
+
+#include <string.h>
+
+#include "canlib.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define QUEUE_SIZE (4096UL)
+
+
+// hardware timestamps are 32 bits of ms
+#define TSTAMP_MASK (0xFFFFFFFFUL)
+
+
+//
+typedef struct
+{
+    //
+    //
+    unsigned long id;
+    //
+    //
+    unsigned long dlc;
+    //
+    //
+    unsigned long tstamp;
+    //
+    //
+    unsigned char data[8];
+} emu_frame_s;
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static emu_frame_s queue[ QUEUE_SIZE ];
+
+
+//
+static unsigned long queue_head = 0;
+
+
+//
+static unsigned long queue_count = 0;
+
+
+//
+static canlib_emu_stats_s stats;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static canStatus pop_frame(
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static canStatus pop_frame(
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time )
+{
+    canStatus can_stat = canERR_NOMSG;
+
+    if( queue_count != 0 )
+    {
+        const emu_frame_s * const frame = &queue[ queue_head ];
+
+        (*id) = (long) frame->id;
+        (*dlc) = (unsigned int) frame->dlc;
+        (*flag) = 0;
+        (*time) = frame->tstamp;
+        memcpy( msg, frame->data, frame->dlc );
+
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count -= 1;
+
+        can_stat = canOK;
+    }
+
+    return can_stat;
+}
+
+
+
+
+// *****************************************************
+// public definitions
+// *****************************************************
+
+//
+canHandle canOpenChannel(
+        int channel,
+        int flags )
+{
+    return 0;
+}
+
+
+//
+canStatus canSetBusParams(
+        const canHandle handle,
+        long freq,
+        unsigned int tseg1,
+        unsigned int tseg2,
+        unsigned int sjw,
+        unsigned int no_samp,
+        unsigned int syncmode )
+{
+    return canOK;
+}
+
+
+//
+canStatus canSetBusOutputControl(
+        const canHandle handle,
+        const unsigned int drivertype )
+{
+    return canOK;
+}
+
+
+//
+canStatus canBusOn(
+        const canHandle handle )
+{
+    return canOK;
+}
+
+
+//
+canStatus canClose(
+        const canHandle handle )
+{
+    return canOK;
+}
+
+
+//
+canStatus canRead(
+        const canHandle handle,
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time )
+{
+    stats.read_calls += 1;
+
+    return pop_frame( id, msg, dlc, flag, time );
+}
+
+
+//
+canStatus canReadWait(
+        const canHandle handle,
+        long *id,
+        void *msg,
+        unsigned int *dlc,
+        unsigned int *flag,
+        unsigned long *time,
+        unsigned long timeout )
+{
+    stats.read_wait_calls += 1;
+    stats.last_timeout = timeout;
+
+    return pop_frame( id, msg, dlc, flag, time );
+}
+
+
+//
+canStatus canWrite(
+        const canHandle handle,
+        long id,
+        void *msg,
+        unsigned int dlc,
+        unsigned int flag )
+{
+    return canOK;
+}
+
+
+//
+canStatus canWriteSync(
+        const canHandle handle,
+        unsigned long timeout )
+{
+    return canOK;
+}
+
+
+//
+void canlib_emu_reset( void )
+{
+    queue_head = 0;
+    queue_count = 0;
+    memset( &stats, 0, sizeof(stats) );
+}
+
+
+//
+int canlib_emu_push(
+        const unsigned long id,
+        const unsigned long dlc,
+        const unsigned char * const data,
+        const unsigned long tstamp )
+{
+    int ret = 1;
+
+    if( (queue_count < QUEUE_SIZE) && (dlc <= 8) )
+    {
+        emu_frame_s * const frame =
+                &queue[ (queue_head + queue_count) % QUEUE_SIZE ];
+
+        frame->id = id;
+        frame->dlc = dlc;
+        frame->tstamp = (tstamp & TSTAMP_MASK);
+        memset( frame->data, 0, sizeof(frame->data) );
+        memcpy( frame->data, data, dlc );
+
+        queue_count += 1;
+
+        ret = 0;
+    }
+
+    return ret;
+}
+
+
+//
+unsigned long canlib_emu_pending( void )
+{
+    return queue_count;
+}
+
+
+//
+canlib_emu_stats_s canlib_emu_get_stats( void )
+{
+    return stats;
+}
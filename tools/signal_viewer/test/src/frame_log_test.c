@@ -0,0 +1,528 @@
+/**
+ * @file frame_log_test.c
+ * @brief Host test of the native frame log writer and reader.
+ *
+ * Writes logs to a temporary file and checks fl_seek against a linear
+ * scan, with strides sharing one timestamp, for a closed log and for one
+ * that was never closed. A short write is forced with RLIMIT_FSIZE in the
+ * middle of a record, the failed block must be dropped with its index
+ * entries and the log must read back as the good blocks only.
+ *
+ * The host clock then steps back, within a block and across blocks. The
+ * records must be written with times that never decrease, so fl_seek
+ * still matches the linear scan.
+ *
+ * Usage: hobd-frame-log-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "math_util.h"
+#include "time_domain.h"
+#include "can_frame.h"
+#include "frame_log.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define CHECK(cond) check( ((cond) ? 1 : 0), #cond, __LINE__ )
+
+
+// not a multiple of the index stride
+#define BLOCK_SIZE (1000UL)
+
+
+//
+#define RECORD_COUNT (6000UL)
+
+
+// 2500 records, over two strides, share the first timestamp
+#define DUP_COUNT (2500UL)
+
+
+//
+#define START_TIMESTAMP (1000000ULL)
+
+
+// host clock step back in the clock step test
+// ms
+#define STEP_BACK (60000ULL)
+
+
+// payload tags of the blocks in the write failure test
+#define TAG_GOOD (0x10000UL)
+#define TAG_FAILED (0x20000UL)
+#define TAG_AFTER (0x30000UL)
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static fl_record_s block[ FL_INDEX_STRIDE ];
+
+
+//
+static char log_path[] = "/tmp/hobd-frame-log-test-XXXXXX";
+
+
+//
+static unsigned long check_count = 0;
+
+
+//
+static unsigned long fail_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line );
+
+
+//
+static void fill_block(
+        const unsigned long long first,
+        const unsigned long count,
+        const unsigned long tag );
+
+
+//
+static unsigned long record_tag(
+        const fl_record_s * const record );
+
+
+//
+static unsigned long long linear_seek(
+        const fl_reader_s * const reader,
+        const timestamp_ms rx_timestamp );
+
+
+//
+static void check_seeks(
+        const fl_reader_s * const reader );
+
+
+//
+static void test_seek( void );
+
+
+//
+static void test_write_failure( void );
+
+
+//
+static void test_clock_step( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line )
+{
+    check_count += 1;
+
+    if( ok == 0 )
+    {
+        fail_count += 1;
+        printf( "%s:%d: check failed: %s\n", __FILE__, line, expr );
+    }
+}
+
+
+// the first DUP_COUNT records share a timestamp, then every third record
+// steps by 1 ms
+static void fill_block(
+        const unsigned long long first,
+        const unsigned long count,
+        const unsigned long tag )
+{
+    unsigned long idx = 0;
+
+    for( idx = 0; idx < count; idx += 1 )
+    {
+        const unsigned long long record = first + idx;
+        const unsigned long payload = tag + (unsigned long) record;
+        can_frame_s frame;
+
+        memset( &frame, 0, sizeof(frame) );
+        frame.rx_timestamp = START_TIMESTAMP;
+        if( record >= DUP_COUNT )
+        {
+            frame.rx_timestamp += 1 + ((record - DUP_COUNT) / 3);
+        }
+        frame.native_rx_timestamp = (timestamp_ms) record;
+        frame.id = 0x040UL + (unsigned long) (record % 0xA0ULL);
+        frame.dlc = 8;
+        memcpy( frame.data, &payload, sizeof(payload) );
+
+        fl_encode( &frame, &block[ idx ] );
+    }
+}
+
+
+//
+static unsigned long record_tag(
+        const fl_record_s * const record )
+{
+    unsigned long payload = 0;
+
+    memcpy( &payload, record->data, sizeof(payload) );
+
+    return payload;
+}
+
+
+//
+static unsigned long long linear_seek(
+        const fl_reader_s * const reader,
+        const timestamp_ms rx_timestamp )
+{
+    unsigned long long idx = 0;
+
+    while( (idx < reader->record_count) && (reader->records[ idx ].rx_timestamp < rx_timestamp) )
+    {
+        idx += 1;
+    }
+
+    return idx;
+}
+
+
+// every timestamp of the log and one either side
+static void check_seeks(
+        const fl_reader_s * const reader )
+{
+    const timestamp_ms first = (timestamp_ms) reader->records[ 0 ].rx_timestamp - 1;
+    const timestamp_ms last =
+            (timestamp_ms) reader->records[ reader->record_count - 1 ].rx_timestamp + 1;
+
+    unsigned long mismatch_count = 0;
+    timestamp_ms target = 0;
+
+    for( target = first; target <= last; target += 1 )
+    {
+        if( fl_seek( reader, target ) != linear_seek( reader, target ) )
+        {
+            mismatch_count += 1;
+        }
+    }
+
+    CHECK( mismatch_count == 0 );
+}
+
+
+// an open log is read as never closed, then again once closed
+static void test_seek( void )
+{
+    fl_writer_s writer;
+    fl_reader_s reader;
+    unsigned long long record = 0;
+    unsigned long long idx = 0;
+
+    CHECK( fl_writer_open( log_path, &writer ) == 0 );
+
+    for( record = 0; record < RECORD_COUNT; record += BLOCK_SIZE )
+    {
+        fill_block( record, BLOCK_SIZE, 0 );
+        CHECK( fl_writer_write( &writer, block, BLOCK_SIZE ) == 0 );
+    }
+
+    CHECK( fl_writer_flush( &writer ) == 0 );
+
+    if( fl_open( log_path, &reader ) == 0 )
+    {
+        CHECK( reader.record_count == RECORD_COUNT );
+        CHECK( reader.index == NULL );
+
+        check_seeks( &reader );
+
+        fl_close( &reader );
+    }
+    else
+    {
+        CHECK( 0 );
+    }
+
+    CHECK( fl_writer_close( &writer ) == 0 );
+
+    if( fl_open( log_path, &reader ) == 0 )
+    {
+        unsigned long bad_count = 0;
+
+        CHECK( reader.record_count == RECORD_COUNT );
+        CHECK( reader.index_count == ((RECORD_COUNT + FL_INDEX_STRIDE - 1) / FL_INDEX_STRIDE) );
+        CHECK( reader.index_stride == FL_INDEX_STRIDE );
+
+        for( idx = 0; idx < reader.index_count; idx += 1 )
+        {
+            if(
+                    (reader.index[ idx ].record != (idx * FL_INDEX_STRIDE))
+                    || (reader.index[ idx ].rx_timestamp != reader.records[ idx * FL_INDEX_STRIDE ].rx_timestamp) )
+            {
+                bad_count += 1;
+            }
+        }
+
+        for( idx = 0; idx < reader.record_count; idx += 1 )
+        {
+            if( record_tag( &reader.records[ idx ] ) != (unsigned long) idx )
+            {
+                bad_count += 1;
+            }
+        }
+
+        CHECK( bad_count == 0 );
+
+        check_seeks( &reader );
+
+        fl_close( &reader );
+    }
+    else
+    {
+        CHECK( 0 );
+    }
+}
+
+
+// the file size limit ends the second block part way through a record,
+// the block after it starts on the same stride
+static void test_write_failure( void )
+{
+    fl_writer_s writer;
+    fl_reader_s reader;
+    struct rlimit limit;
+    struct rlimit saved_limit;
+    struct stat file_stat;
+    unsigned long long idx = 0;
+
+    const unsigned long long records_end =
+            sizeof(fl_header_s) + (FL_INDEX_STRIDE * sizeof(fl_record_s));
+
+    CHECK( fl_writer_open( log_path, &writer ) == 0 );
+
+    fill_block( 0, FL_INDEX_STRIDE, TAG_GOOD );
+    CHECK( fl_writer_write( &writer, block, FL_INDEX_STRIDE ) == 0 );
+
+    CHECK( getrlimit( RLIMIT_FSIZE, &saved_limit ) == 0 );
+    limit = saved_limit;
+    limit.rlim_cur = (rlim_t) (records_end + (sizeof(fl_record_s) * 31) + 8);
+    CHECK( setrlimit( RLIMIT_FSIZE, &limit ) == 0 );
+
+    // stamped later than the block written after it
+    fill_block( FL_INDEX_STRIDE, FL_INDEX_STRIDE, TAG_FAILED );
+    for( idx = 0; idx < FL_INDEX_STRIDE; idx += 1 )
+    {
+        block[ idx ].rx_timestamp += 2000;
+    }
+    CHECK( fl_writer_write( &writer, block, FL_INDEX_STRIDE ) != 0 );
+
+    CHECK( setrlimit( RLIMIT_FSIZE, &saved_limit ) == 0 );
+
+    CHECK( writer.record_count == FL_INDEX_STRIDE );
+    CHECK( writer.index_count == 1 );
+    CHECK( (stat( log_path, &file_stat ) == 0) && ((unsigned long long) file_stat.st_size == records_end) );
+
+    // stamped a second later than the good block, the failed block's
+    // times must not hold it back
+    fill_block( FL_INDEX_STRIDE, FL_INDEX_STRIDE, TAG_AFTER );
+    for( idx = 0; idx < FL_INDEX_STRIDE; idx += 1 )
+    {
+        block[ idx ].rx_timestamp += 1000;
+    }
+    CHECK( fl_writer_write( &writer, block, FL_INDEX_STRIDE ) == 0 );
+
+    CHECK( fl_writer_close( &writer ) == 0 );
+
+    CHECK( (stat( log_path, &file_stat ) == 0)
+            && ((unsigned long long) file_stat.st_size ==
+                (records_end + (FL_INDEX_STRIDE * sizeof(fl_record_s)) + (2 * sizeof(fl_index_entry_s)))) );
+
+    if( fl_open( log_path, &reader ) == 0 )
+    {
+        unsigned long bad_count = 0;
+
+        CHECK( reader.record_count == (2 * FL_INDEX_STRIDE) );
+        CHECK( reader.index_count == 2 );
+        CHECK( reader.index[ 1 ].record == FL_INDEX_STRIDE );
+        CHECK( reader.index[ 1 ].rx_timestamp == reader.records[ FL_INDEX_STRIDE ].rx_timestamp );
+        CHECK( reader.records[ FL_INDEX_STRIDE ].rx_timestamp == (START_TIMESTAMP + 1000) );
+
+        for( idx = 0; idx < reader.record_count; idx += 1 )
+        {
+            const unsigned long tag = (idx < FL_INDEX_STRIDE) ? TAG_GOOD : TAG_AFTER;
+
+            if( record_tag( &reader.records[ idx ] ) != (tag + (unsigned long) idx) )
+            {
+                bad_count += 1;
+            }
+        }
+
+        CHECK( bad_count == 0 );
+
+        check_seeks( &reader );
+
+        fl_close( &reader );
+    }
+    else
+    {
+        CHECK( 0 );
+    }
+}
+
+
+
+// steps back mid block and again at a block start, each time before the
+// clock caught up with the last one
+static void test_clock_step( void )
+{
+    fl_writer_s writer;
+    fl_reader_s reader;
+    unsigned long long record = 0;
+    unsigned long long idx = 0;
+
+    CHECK( fl_writer_open( log_path, &writer ) == 0 );
+
+    for( record = 0; record < RECORD_COUNT; record += BLOCK_SIZE )
+    {
+        fill_block( record, BLOCK_SIZE, 0 );
+
+        for( idx = 0; idx < BLOCK_SIZE; idx += 1 )
+        {
+            // raw time, the wall clock before clamping
+            block[ idx ].native_rx_timestamp = block[ idx ].rx_timestamp;
+
+            if( (record + idx) >= 3500 )
+            {
+                block[ idx ].rx_timestamp -= STEP_BACK;
+            }
+
+            if( (record + idx) >= 4000 )
+            {
+                block[ idx ].rx_timestamp -= STEP_BACK;
+            }
+        }
+
+        CHECK( fl_writer_write( &writer, block, BLOCK_SIZE ) == 0 );
+    }
+
+    CHECK( fl_writer_close( &writer ) == 0 );
+
+    if( fl_open( log_path, &reader ) == 0 )
+    {
+        unsigned long bad_count = 0;
+
+        const uint64_t held = reader.records[ 3499 ].rx_timestamp;
+
+        CHECK( reader.record_count == RECORD_COUNT );
+        CHECK( reader.records[ 3499 ].native_rx_timestamp == held );
+
+        for( idx = 0; idx < reader.record_count; idx += 1 )
+        {
+            const fl_record_s * const r = &reader.records[ idx ];
+
+            // held at the last time before the first step, then raw again
+            // once the clock is past it
+            const uint64_t expected = m_max( r->native_rx_timestamp - ((idx >= 3500) ? STEP_BACK : 0) - ((idx >= 4000) ? STEP_BACK : 0), held );
+
+            if( (idx >= 3500) && (r->rx_timestamp != expected) )
+            {
+                bad_count += 1;
+            }
+
+            if( (idx != 0) && (r->rx_timestamp < reader.records[ idx - 1 ].rx_timestamp) )
+            {
+                bad_count += 1;
+            }
+        }
+
+        for( idx = 0; idx < reader.index_count; idx += 1 )
+        {
+            if( reader.index[ idx ].rx_timestamp != reader.records[ idx * FL_INDEX_STRIDE ].rx_timestamp )
+            {
+                bad_count += 1;
+            }
+        }
+
+        CHECK( bad_count == 0 );
+
+        check_seeks( &reader );
+
+        fl_close( &reader );
+    }
+    else
+    {
+        CHECK( 0 );
+    }
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    const int fd = mkstemp( log_path );
+
+    if( fd < 0 )
+    {
+        fprintf( stderr, "%s: failed to create '%s'\n", argv[ 0 ], log_path );
+        fail_count += 1;
+    }
+    else
+    {
+        (void) close( fd );
+
+        // a write past the file size limit fails instead of raising SIGXFSZ
+        (void) signal( SIGXFSZ, SIG_IGN );
+
+        test_seek();
+        test_write_failure();
+        test_clock_step();
+
+        (void) unlink( log_path );
+    }
+
+    printf(
+            "hobd-frame-log-test: %lu checks, %lu failed\n",
+            check_count,
+            fail_count );
+
+    return (fail_count == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file signal_table_test.c
+ * @brief Host test of the signal table CAN frame decoding.
+ *
+ * Feeds crafted frames through st_process_can_frame and checks the
+ * compact IMU frames expand into the full encoding tables. Each compact
+ * frame must decode on its own: the orientation with no rate of turn or
+ * acceleration frame seen, and after one of an unknown schema version.
+ *
+ * HOBD frames without a table, like the command response and the stats
+ * frames, must not be counted as unknown, foreign ones must.
+ *
+ * Usage: hobd-signal-table-test
+ *
+ */
+
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "time_domain.h"
+#include "can_frame.h"
+#include "config.h"
+#include "signal_table.h"
+
+
+
+
+// *****************************************************
+// static global types/macros
+// *****************************************************
+
+//
+#define CHECK(cond) check( ((cond) ? 1 : 0), #cond, __LINE__ )
+
+
+
+
+// *****************************************************
+// static global data
+// *****************************************************
+
+//
+static config_s config;
+
+
+//
+static st_state_s state;
+
+
+//
+static unsigned long check_count = 0;
+
+
+//
+static unsigned long fail_count = 0;
+
+
+
+
+// *****************************************************
+// static declarations
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line );
+
+
+//
+static void reset_state( void );
+
+
+//
+static void process_frame(
+        const unsigned long id,
+        const unsigned long dlc,
+        const void * const data );
+
+
+//
+static const void *get_table_data(
+        const unsigned long id );
+
+
+//
+static void test_compact_orient_alone( void );
+
+
+//
+static void test_compact_bad_version( void );
+
+
+//
+static void test_unknown_can_ids( void );
+
+
+
+
+// *****************************************************
+// static definitions
+// *****************************************************
+
+//
+static void check(
+        const int ok,
+        const char * const expr,
+        const int line )
+{
+    check_count += 1;
+
+    if( ok == 0 )
+    {
+        fail_count += 1;
+        printf( "%s:%d: check failed: %s\n", __FILE__, line, expr );
+    }
+}
+
+
+//
+static void reset_state( void )
+{
+    memset( &config, 0, sizeof(config) );
+    memset( &state, 0, sizeof(state) );
+
+    config.freeze_frame_enabled = FALSE;
+
+    st_init( &config, &state );
+}
+
+
+//
+static void process_frame(
+        const unsigned long id,
+        const unsigned long dlc,
+        const void * const data )
+{
+    can_frame_s frame;
+
+    memset( &frame, 0, sizeof(frame) );
+    frame.id = id;
+    frame.dlc = dlc;
+    memcpy( frame.data, data, dlc );
+
+    st_process_can_frame( &frame, &config, &state );
+}
+
+
+//
+static const void *get_table_data(
+        const unsigned long id )
+{
+    const signal_table_s * const table = st_get_table_by_can_id( id, &state );
+
+    CHECK( table != NULL );
+
+    return (const void*) ((table != NULL) ? &table->buffer[ 0 ] : NULL);
+}
+
+
+// no rate of turn or acceleration frame, e.g. both turned off over CAN
+static void test_compact_orient_alone( void )
+{
+    const hobd_imu_compact_orient_quat_s compact = { 16384, -8192, 0, 4096 };
+
+    reset_state();
+
+    process_frame( HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT, sizeof(compact), &compact );
+
+    const hobd_imu_orient_quat1_s * const quat1 = get_table_data( HOBD_CAN_ID_IMU_ORIENT_QUAT1 );
+    const hobd_imu_orient_quat2_s * const quat2 = get_table_data( HOBD_CAN_ID_IMU_ORIENT_QUAT2 );
+
+    if( (quat1 != NULL) && (quat2 != NULL) )
+    {
+        CHECK( quat1->q1 == 1.0f );
+        CHECK( quat1->q2 == -0.5f );
+        CHECK( quat2->q3 == 0.0f );
+        CHECK( quat2->q4 == 0.25f );
+    }
+
+    CHECK( state.unknown_frame_count == 0 );
+}
+
+
+// an unknown rate of turn version is dropped, the frames around it are not
+static void test_compact_bad_version( void )
+{
+    hobd_imu_compact_orient_quat_s compact_quat = { 8192, 0, 0, 0 };
+    hobd_imu_compact_rate_of_turn_s compact_rate = { (uint8_t) (HOBD_IMU_COMPACT_VERSION + 1), 1000, 2000, -3000 };
+    const hobd_imu_compact_accel_s compact_accel = { HOBD_IMU_COMPACT_VERSION, 100, -200, 981 };
+
+    reset_state();
+
+    const hobd_imu_rate_of_turn1_s * const rate1 = get_table_data( HOBD_CAN_ID_IMU_RATE_OF_TURN1 );
+    const hobd_imu_orient_quat1_s * const quat1 = get_table_data( HOBD_CAN_ID_IMU_ORIENT_QUAT1 );
+    const hobd_imu_accel1_s * const accel1 = get_table_data( HOBD_CAN_ID_IMU_ACCEL1 );
+    const hobd_imu_accel2_s * const accel2 = get_table_data( HOBD_CAN_ID_IMU_ACCEL2 );
+
+    if( (rate1 != NULL) && (quat1 != NULL) && (accel1 != NULL) && (accel2 != NULL) )
+    {
+        process_frame( HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN, sizeof(compact_rate), &compact_rate );
+
+        CHECK( rate1->x == 0.0f );
+
+        process_frame( HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT, sizeof(compact_quat), &compact_quat );
+
+        CHECK( quat1->q1 == 0.5f );
+
+        process_frame( HOBD_CAN_ID_IMU_COMPACT_ACCEL, sizeof(compact_accel), &compact_accel );
+
+        CHECK( accel1->x == 1.0f );
+        CHECK( accel1->y == -2.0f );
+        CHECK( accel2->z == 9.81f );
+
+        compact_rate.version = HOBD_IMU_COMPACT_VERSION;
+        process_frame( HOBD_CAN_ID_IMU_COMPACT_RATE_OF_TURN, sizeof(compact_rate), &compact_rate );
+
+        CHECK( rate1->x == 1.0f );
+        CHECK( rate1->y == 2.0f );
+
+        // a short frame is not decoded
+        compact_quat.q1 = 16384;
+        process_frame( HOBD_CAN_ID_IMU_COMPACT_ORIENT_QUAT, sizeof(compact_quat) - 1, &compact_quat );
+
+        CHECK( quat1->q1 == 0.5f );
+    }
+}
+
+
+
+// only IDs outside the HOBD protocol are counted as unknown
+static void test_unknown_can_ids( void )
+{
+    const uint8_t data[ 8 ] = { 0 };
+
+    const unsigned long hobd_ids[] =
+    {
+        HOBD_CAN_ID_COMMAND,
+        HOBD_CAN_ID_RESPONSE,
+        HOBD_CAN_ID_RX_STATS_OBD_GATEWAY,
+        HOBD_CAN_ID_RX_STATS_IMU_GATEWAY,
+        HOBD_CAN_ID_PUBLISH_STATS_OBD_GATEWAY,
+        HOBD_CAN_ID_PUBLISH_STATS_IMU_GATEWAY,
+        HOBD_CAN_ID_GPS_DOP1,
+        HOBD_CAN_ID_IMU_MAGF2,
+        HOBD_CAN_ID_PROFILE_OBD_GATEWAY,
+        HOBD_CAN_ID_HEARTBEAT_IMU_GATEWAY,
+        HOBD_CAN_ID_OBD1
+    };
+
+    unsigned long idx = 0;
+
+    reset_state();
+
+    for( idx = 0; idx < (sizeof(hobd_ids) / sizeof(hobd_ids[0])); idx += 1 )
+    {
+        process_frame( hobd_ids[ idx ], sizeof(data), data );
+    }
+
+    CHECK( state.unknown_frame_count == 0 );
+
+    // tables still win over the known list
+    CHECK( st_get_table_by_can_id( HOBD_CAN_ID_OBD1, &state ) != NULL );
+    CHECK( st_get_table_by_can_id( HOBD_CAN_ID_RESPONSE, &state ) == NULL );
+
+    process_frame( 0x7E8, sizeof(data), data );
+    process_frame( HOBD_CAN_ID_RESPONSE, sizeof(data), data );
+
+    CHECK( state.unknown_frame_count == 1 );
+    CHECK( state.unknown_can_id == 0x7E8 );
+
+    // extended IDs are outside the map
+    process_frame( 0x18DAF110, sizeof(data), data );
+
+    CHECK( state.unknown_frame_count == 2 );
+    CHECK( state.unknown_can_id == 0x18DAF110 );
+}
+
+
+
+
+// *****************************************************
+// main
+// *****************************************************
+int main(
+        int argc,
+        char **argv )
+{
+    test_compact_orient_alone();
+    test_compact_bad_version();
+    test_unknown_can_ids();
+
+    printf(
+            "hobd-signal-table-test: %lu checks, %lu failed\n",
+            check_count,
+            fail_count );
+
+    return (fail_count == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}